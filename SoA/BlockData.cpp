@@ -44,6 +44,13 @@ KEG_TYPE_DEF_SAME_NAME(Block, kt) {
     kt.addValue("allowsLight", keg::Value::basic(offsetof(Block, allowLight), keg::BasicType::BOOL));
     kt.addValue("crushable", keg::Value::basic(offsetof(Block, isCrushable), keg::BasicType::BOOL));
     kt.addValue("supportive", keg::Value::basic(offsetof(Block, isSupportive), keg::BasicType::BOOL));
+    kt.addValue("spreadsOnto", keg::Value::basic(offsetof(Block, spreadsOntoID), keg::BasicType::STRING));
+    kt.addValue("smotheredInto", keg::Value::basic(offsetof(Block, smotheredID), keg::BasicType::STRING));
+    kt.addValue("growsInto", keg::Value::basic(offsetof(Block, growsIntoID), keg::BasicType::STRING));
+    kt.addValue("growChance", keg::Value::basic(offsetof(Block, growChance), keg::BasicType::F32));
+    kt.addValue("fallDelay", keg::Value::basic(offsetof(Block, fallDelay), keg::BasicType::UI16));
+    kt.addValue("liquidStart", keg::Value::basic(offsetof(Block, liquidStartSID), keg::BasicType::STRING));
+    kt.addValue("liquidLevels", keg::Value::basic(offsetof(Block, liquidLevels), keg::BasicType::UI16));
 }
 
 // TODO(Ben): LOL
@@ -76,8 +76,16 @@ class Block
     nString sinkID;
     ui16 explosionRays;
     ui16 floraHeight = 0;
-    ui16 liquidStartID = 0;
+    // Liquids, see LiquidSimulation. Each level is its own block, level n is liquidStartID + n - 1.
+    BlockIdentifier liquidStartSID; ///< Level 1 block of the liquid this block is a level of
+    ui16 liquidStartID = 0; ///< Resolved from liquidStartSID by BlockPack::updateLiquids
     ui16 liquidLevels = 0;
+    // Block updates, see BlockUpdateScheduler
+    BlockIdentifier spreadsOntoID; ///< Random ticks turn a neighbor of this block into this one, if uncovered
+    BlockIdentifier smotheredID; ///< Random ticks turn this block into that one while covered
+    BlockIdentifier growsIntoID; ///< Random ticks turn this block into that one with growChance
+    f32 growChance = 0.0f;
+    ui16 fallDelay = 0; ///< Ticks before falling into a non colliding block below, 0 never falls
 
     BlockOcclusion occlude;
 
@@ -97,8 +97,13 @@ bool BlockLoader::saveBlocks(const nString& filePath, BlockPack* pack) {
         COND_WRITE_KEG("explosionPowerLoss", explosionPowerLoss);
         COND_WRITE_KEG("explosionRays", explosionRays);
         COND_WRITE_KEG("explosionResistance", explosionResistance);
+        COND_WRITE_KEG("fallDelay", fallDelay);
         COND_WRITE_KEG("flammability", flammability);
         COND_WRITE_KEG("floatingAction", floatingAction);
+        COND_WRITE_KEG("growChance", growChance);
+        COND_WRITE_KEG("growsInto", growsIntoID);
+        COND_WRITE_KEG("liquidLevels", liquidLevels);
+        COND_WRITE_KEG("liquidStart", liquidStartSID);
         if (b.colorFilter != d.colorFilter) { writer.push(keg::WriterParam::KEY) << nString("lightColorFilter"); writer.push(keg::WriterParam::VALUE) << keg::kegf32v3(b.colorFilter); }
         if (b.meshType != d.meshType) {
             writer.push(keg::WriterParam::KEY) << nString("meshType");
@@ -147,7 +152,9 @@ bool BlockLoader::saveBlocks(const nString& filePath, BlockPack* pack) {
                 break;
         }
         COND_WRITE_KEG("sinkID", sinkID);
+        COND_WRITE_KEG("smotheredInto", smotheredID);
         COND_WRITE_KEG("spawnerID", spawnerID);
+        COND_WRITE_KEG("spreadsOnto", spreadsOntoID);
         COND_WRITE_KEG("supportive", isSupportive);
         COND_WRITE_KEG("waterBreak", waterBreak);
 
@@ -42,6 +42,8 @@ BlockID BlockPack::append(Block& block) {
         // Set the correct index
         m_blockMap[block.sID] = rv;
     }
+    updateMeshTable(rv);
+    updateTickRule(rv);
     onBlockAddition(block.ID);
     return rv;
 }
@@ -50,4 +52,91 @@ void BlockPack::reserveID(const BlockIdentifier& sid, const BlockID& id) {
     if (id >= m_blockList.size()) m_blockList.resize(id + 1);
     m_blockMap[sid] = id;
     m_blockList[id].ID = id;
+    updateMeshTable(id);
+    updateTickRule(id);
+}
+
+void BlockPack::updateMeshTables() {
+    for (size_t i = 0; i < m_blockList.size(); i++) {
+        updateMeshTable((BlockID)i);
+    }
+}
+
+void BlockPack::updateMeshTable(const BlockID& id) {
+    if (m_occlusion.size() < m_blockList.size()) {
+        m_occlusion.resize(m_blockList.size(), 0);
+        m_meshTypes.resize(m_blockList.size(), (ui8)MeshType::NONE);
+        m_faceTextures.resize(m_blockList.size(), BlockFaceTextures{});
+    }
+
+    const Block& block = m_blockList[id];
+    switch (block.occlude) {
+        case BlockOcclusion::ALL:
+            m_occlusion[id] = BLOCK_OCCLUDES_ALL;
+            break;
+        case BlockOcclusion::SELF:
+            m_occlusion[id] = BLOCK_OCCLUDES_SELF;
+            break;
+        case BlockOcclusion::SELF_ONLY:
+            m_occlusion[id] = BLOCK_OCCLUDES_SELF_ONLY;
+            break;
+        default:
+            m_occlusion[id] = 0;
+            break;
+    }
+    m_meshTypes[id] = (ui8)block.meshType;
+    for (int i = 0; i < 6; i++) {
+        m_faceTextures[id].textures[i] = block.textures[i];
+    }
+}
+
+void BlockPack::updateTickRules() {
+    for (size_t i = 0; i < m_blockList.size(); i++) {
+        updateTickRule((BlockID)i);
+    }
+}
+
+void BlockPack::updateTickRule(const BlockID& id) {
+    if (m_tickRules.size() < m_blockList.size()) m_tickRules.resize(m_blockList.size());
+
+    const Block& block = m_blockList[id];
+    auto resolve = [this](const BlockIdentifier& sid) -> BlockID {
+        if (sid.empty()) return 0;
+        auto it = m_blockMap.find(sid);
+        return it == m_blockMap.end() ? 0 : it->second;
+    };
+    BlockTickRule& rule = m_tickRules[id];
+    rule.spreadsOnto = resolve(block.spreadsOntoID);
+    rule.smothered = resolve(block.smotheredID);
+    rule.growsInto = resolve(block.growsIntoID);
+    if (block.growChance >= 1.0f) {
+        rule.growThreshold = UINT32_MAX;
+    } else if (block.growChance > 0.0f) {
+        rule.growThreshold = (ui32)(block.growChance * 4294967296.0);
+    } else {
+        rule.growThreshold = 0;
+    }
+    if (!rule.growThreshold) rule.growsInto = 0;
+    rule.fallDelay = block.fallDelay;
+    rule.isRandomTicked = rule.spreadsOnto || rule.smothered || rule.growsInto;
+}
+
+void BlockPack::updateLiquids() {
+    m_liquid.startBlockID = 0;
+    m_liquid.numLevels = 0;
+    for (auto& block : m_blockList) {
+        block.liquidStartID = 0;
+        if (block.liquidStartSID.empty() || !block.liquidLevels) continue;
+        auto it = m_blockMap.find(block.liquidStartSID);
+        if (it == m_blockMap.end() || it->second + block.liquidLevels > m_blockList.size()) {
+            printf("Warning: liquid %s of block %s has no %u level blocks\n",
+                   block.liquidStartSID.c_str(), block.sID.c_str(), (ui32)block.liquidLevels);
+            continue;
+        }
+        block.liquidStartID = it->second;
+        if (!m_liquid.numLevels) {
+            m_liquid.startBlockID = block.liquidStartID;
+            m_liquid.numLevels = block.liquidLevels;
+        }
+    }
 }
@@ -19,6 +19,28 @@
 #include <Vorb/graphics/Texture.h>
 
 #include "BlockData.h"
+#include "LiquidData.h"
+
+/// Bits in the per-ID occlusion table
+#define BLOCK_OCCLUDES_ALL 0x1 ///< Hides faces of any neighbor
+#define BLOCK_OCCLUDES_SELF 0x2 ///< Hides faces of neighbors with the same ID
+#define BLOCK_OCCLUDES_SELF_ONLY 0x4 ///< BlockOcclusion::SELF_ONLY, never hides faces
+#define BLOCK_OCCLUDES_ANY (BLOCK_OCCLUDES_ALL | BLOCK_OCCLUDES_SELF | BLOCK_OCCLUDES_SELF_ONLY)
+
+/// Per-face textures of one block, exactly one cache line on 64 bit
+struct BlockFaceTextures {
+    const BlockTexture* textures[6];
+};
+
+/// Block update fields of one block with the identifiers resolved. IDs of 0 turn a rule off.
+struct BlockTickRule {
+    BlockID spreadsOnto = 0;
+    BlockID smothered = 0;
+    BlockID growsInto = 0;
+    ui32 growThreshold = 0; ///< Grows when a random ui32 is below it
+    ui16 fallDelay = 0;
+    bool isRandomTicked = false; ///< True if any random tick rule is on
+};
 
 /// A container for blocks
 class BlockPack {
@@ -77,10 +99,59 @@ class BlockPack {
     const std::unordered_map<BlockIdentifier, ui16>& getBlockMap() const { return m_blockMap; }
     const std::vector<Block>& getBlockList() const { return m_blockList; }
 
+    /************************************************************************/
+    /* Mesher tables                                                        */
+    /************************************************************************/
+    /// Compact per-ID copies of the block fields the mesher reads for every voxel
+    /// and neighbor, so it never touches the full Block structs in its inner loops.
+    /// append keeps them in sync, call updateMeshTables after editing blocks in place.
+    void updateMeshTables();
+
+    /// @return BLOCK_OCCLUDES_* bits
+    const ui8& getOcclusion(const BlockID& id) const {
+        return m_occlusion[id];
+    }
+    MeshType getMeshType(const BlockID& id) const {
+        return (MeshType)m_meshTypes[id];
+    }
+    const BlockFaceTextures& getFaceTextures(const BlockID& id) const {
+        return m_faceTextures[id];
+    }
+
+    /************************************************************************/
+    /* Block update tables                                                  */
+    /************************************************************************/
+    /// Resolves the block update fields of every block. Blocks name each other,
+    /// so call it once all of them are appended.
+    void updateTickRules();
+
+    const BlockTickRule& getTickRule(const BlockID& id) const {
+        return m_tickRules[id];
+    }
+
+    /// Resolves liquidStartSID of every block, and picks the first liquid
+    /// as the one worlds simulate. Call once all blocks are appended.
+    void updateLiquids();
+
+    /// numLevels is 0 if the pack has no liquid
+    const LiquidData& getLiquid() const { return m_liquid; }
+
     Event<ui16> onBlockAddition; ///< Signaled when a block is loaded
 private:
+    void updateMeshTable(const BlockID& id);
+    void updateTickRule(const BlockID& id);
+
     std::unordered_map<BlockIdentifier, ui16> m_blockMap; ///< Blocks indices organized by identifiers
     std::vector<Block> m_blockList; ///< Block data list
+
+    // Mesher tables, indexed by ID
+    std::vector<ui8> m_occlusion; ///< BLOCK_OCCLUDES_* bits
+    std::vector<ui8> m_meshTypes; ///< MeshType
+    std::vector<BlockFaceTextures> m_faceTextures;
+
+    std::vector<BlockTickRule> m_tickRules; ///< Indexed by ID
+
+    LiquidData m_liquid = {}; ///< Simulated liquid
 };
 
 #endif // BlockPack_h__
@@ -0,0 +1,100 @@
+#include "stdafx.h"
+#include "BlockTextureAtlasCache.h"
+
+#include "BlockTexturePack.h"
+
+namespace {
+    const ui32 CACHE_MAGIC = 0x41544243; // "CBTA"
+
+    struct CacheHeader {
+        ui32 magic;
+        ui32 version;
+        ui64 contentHash;
+        ui32 resolution;
+        ui32 pageWidthPixels;
+        ui32 mipLevels;
+        ui32 numPages;
+        ui32 numImages;
+        ui32 padding;
+    };
+
+    void hashBytes(ui64& hash, const char* bytes, size_t size) {
+        for (size_t i = 0; i < size; i++) hash = (hash ^ (ui8)bytes[i]) * 1099511628211ull;
+    }
+}
+
+ui64 BlockTextureAtlasCache::hashSources(vio::IOManager& iom, const nString& description, const std::vector<vio::Path>& sources) {
+    ui64 hash = 14695981039346656037ull;
+    hashBytes(hash, description.c_str(), description.size());
+    nString data;
+    for (auto& path : sources) {
+        const nString& name = path.getString();
+        hashBytes(hash, name.c_str(), name.size() + 1);
+        if (name.empty()) continue;
+        if (!iom.readFileToString(path, data)) return 0;
+        hashBytes(hash, data.c_str(), data.size());
+    }
+    return hash;
+}
+
+bool BlockTextureAtlasCache::save(const nString& cachePath, ui64 contentHash, const std::vector<ui32v2>& imageSizes,
+                                  const BlockTexturePack* texturePack) {
+    FILE* file = fopen(cachePath.c_str(), "wb");
+    if (!file) return false;
+
+    CacheHeader header = {};
+    header.magic = CACHE_MAGIC;
+    header.version = BLOCK_TEXTURE_ATLAS_CACHE_VERSION;
+    header.contentHash = contentHash;
+    header.resolution = texturePack->getResolution();
+    header.pageWidthPixels = texturePack->getPageWidthPixels();
+    header.mipLevels = texturePack->getMipLevels();
+    header.numPages = texturePack->getNumPages();
+    header.numImages = (ui32)imageSizes.size();
+
+    size_t pagePixels = texturePack->getPagePixelCount();
+    bool ok = fwrite(&header, sizeof(CacheHeader), 1, file) == 1;
+    if (ok && imageSizes.size()) ok = fwrite(imageSizes.data(), sizeof(ui32v2), imageSizes.size(), file) == imageSizes.size();
+    for (ui32 i = 0; ok && i < header.numPages; i++) {
+        ok = fwrite(texturePack->getPagePixels(i), sizeof(color4), pagePixels, file) == pagePixels;
+    }
+    fclose(file);
+    // Don't leave a truncated image behind
+    if (!ok) remove(cachePath.c_str());
+    return ok;
+}
+
+bool BlockTextureAtlasCache::load(const nString& cachePath, ui64 contentHash, OUT std::vector<ui32v2>& imageSizes,
+                                  BlockTexturePack* texturePack) {
+    FILE* file = fopen(cachePath.c_str(), "rb");
+    if (!file) return false;
+
+    CacheHeader header;
+    bool ok = fread(&header, sizeof(CacheHeader), 1, file) == 1 &&
+              header.magic == CACHE_MAGIC &&
+              header.version == BLOCK_TEXTURE_ATLAS_CACHE_VERSION &&
+              header.contentHash == contentHash &&
+              header.resolution == texturePack->getResolution() &&
+              header.pageWidthPixels == texturePack->getPageWidthPixels() &&
+              header.mipLevels == texturePack->getMipLevels() &&
+              header.numPages >= texturePack->getNumPages();
+    if (ok) {
+        imageSizes.resize(header.numImages);
+        if (imageSizes.size()) ok = fread(imageSizes.data(), sizeof(ui32v2), imageSizes.size(), file) == imageSizes.size();
+    }
+    if (ok) {
+        texturePack->reservePages(header.numPages);
+        size_t pagePixels = texturePack->getPagePixelCount();
+        ui32 i = 0;
+        for (; ok && i < header.numPages; i++) {
+            ok = fread(texturePack->getPagePixels(i), sizeof(color4), pagePixels, file) == pagePixels;
+        }
+        // Decoding starts from blank pages
+        if (!ok) {
+            for (ui32 j = 0; j < i; j++) memset(texturePack->getPagePixels(j), 0, pagePixels * sizeof(color4));
+        }
+    }
+    fclose(file);
+    if (!ok) imageSizes.assign(imageSizes.size(), ui32v2(0));
+    return ok;
+}
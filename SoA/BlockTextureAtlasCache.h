@@ -0,0 +1,45 @@
+///
+/// BlockTextureAtlasCache.h
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// On-disk image of the finished block texture atlas, keyed by a
+/// hash of every source image so unchanged packs skip decoding.
+///
+
+#pragma once
+
+#ifndef BlockTextureAtlasCache_h__
+#define BlockTextureAtlasCache_h__
+
+#include <Vorb/io/IOManager.h>
+
+class BlockTexturePack;
+
+// Bump this whenever the page layout, the mip filter or the atlas mapping changes
+#define BLOCK_TEXTURE_ATLAS_CACHE_VERSION 1
+// The key covers the whole pack, so one file is enough
+#define BLOCK_TEXTURE_ATLAS_CACHE_PATH "BlockTextureAtlas.bin"
+
+namespace BlockTextureAtlasCache {
+    /// 64 bit FNV-1a over the description and the contents of each source.
+    /// Unresolved sources only hash their path. 0 if a source can't be read.
+    /// @param description: Everything besides the pixels that decides the atlas layout
+    ui64 hashSources(vio::IOManager& iom, const nString& description, const std::vector<vio::Path>& sources);
+
+    /// Writes every page of the atlas, mip chains included
+    /// @param imageSizes: Size of each source image, 0 for ones that failed to load
+    bool save(const nString& cachePath, ui64 contentHash, const std::vector<ui32v2>& imageSizes,
+              const BlockTexturePack* texturePack);
+
+    /// Fills the atlas pages from a cache file. The layers still have to be mapped
+    /// with BlockTexturePack::addLayer, without pixels.
+    /// @return false if the file is missing, stale, from another version or corrupt
+    bool load(const nString& cachePath, ui64 contentHash, OUT std::vector<ui32v2>& imageSizes,
+              BlockTexturePack* texturePack);
+}
+
+#endif // BlockTextureAtlasCache_h__
@@ -3,9 +3,11 @@
 #include "ModPathResolver.h"
 #include "BlockTexturePack.h"
 #include "BlockData.h"
+#include "BlockTextureAtlasCache.h"
 #include "Errors.h"
 
 #include <Vorb/graphics/ImageIO.h>
+#include <Vorb/Timing.h>
 
 // Used for error checking
 #define CONNECTED_WIDTH 12
@@ -15,9 +17,10 @@
 #define HORIZONTAL_WIDTH 4
 #define HORIZONTAL_HEIGHT 1
 
-void BlockTextureLoader::init(ModPathResolver* texturePathResolver, BlockTexturePack* texturePack) {
+void BlockTextureLoader::init(ModPathResolver* texturePathResolver, BlockTexturePack* texturePack, OPT VoxPool* threadPool /* = nullptr */) {
     m_texturePathResolver = texturePathResolver;
     m_texturePack = texturePack;
+    m_threadPool = threadPool;
 }
 
 void BlockTextureLoader::loadTextureData() {
@@ -58,14 +61,152 @@ void BlockTextureLoader::loadBlockTextures(Block& block) {
      GameManager::texturePackLoader->getBlockTexture(particleTexName, particleTexture);
      particleTex = particleTexture.base.index;*/
 
+    // Flora height needs the layer size, which is known after flushLayers
+    m_pendingBlocks.push_back(&block);
+}
+
+ui32 BlockTextureLoader::flushLayers() {
+    PreciseTimer timer;
+    timer.start();
+    m_lastLoadUsedCache = false;
+
+    // Every source image that isn't in the pack yet, in the order they are added to it
+    std::vector<vio::Path> sources;
+    std::map<nString, ui32> sourceLookup;
+    nString description = std::to_string(m_texturePack->getResolution()) + "\n";
+    auto addSource = [&](const nString& name) {
+        if (sourceLookup.find(name) != sourceLookup.end()) return;
+        sourceLookup[name] = (ui32)sources.size();
+        sources.emplace_back();
+        // Unresolved files stay empty and fail to load
+        m_texturePathResolver->resolvePath(name, sources.back());
+    };
+    for (auto& layer : m_pendingLayers) {
+        if (m_texturePack->findLayer(layer->path).size.x != 0) continue;
+        addSource(layer->path);
+        if (layer->normalPath.size()) addSource(layer->normalPath);
+        if (layer->dispPath.size()) addSource(layer->dispPath);
+        // The mapping depends on the method as well as the image sizes
+        description += layer->path + "|" + layer->normalPath + "|" + layer->dispPath + "|" +
+                       std::to_string((int)layer->method) + "\n";
+    }
+
+    // Warm path, the pages come from the cache and only the mapping is redone
+    std::vector<ui32v2> imageSizes(sources.size(), ui32v2(0));
+    std::vector<color4*> imagePixels(sources.size(), nullptr);
+    ui64 contentHash = 0;
+    if (m_useCache && sources.size()) {
+        contentHash = BlockTextureAtlasCache::hashSources(m_iom, description, sources);
+        if (contentHash) {
+            m_lastLoadUsedCache = BlockTextureAtlasCache::load(BLOCK_TEXTURE_ATLAS_CACHE_PATH, contentHash, imageSizes, m_texturePack);
+        }
+    }
+
+    // Cold path, decode every image on the thread pool
+    BlockTextureDecodeTask* decodeTasks = nullptr;
+    if (!m_lastLoadUsedCache && sources.size()) {
+        decodeTasks = new BlockTextureDecodeTask[sources.size()];
+        for (size_t i = 0; i < sources.size(); i++) {
+            if (sources[i].getString().empty()) continue;
+            decodeTasks[i].path = sources[i];
+            decodeTasks[i].group = &m_decodeGroup;
+            m_decodeGroup.add(1);
+            if (m_threadPool) {
+                m_threadPool->addTask(&decodeTasks[i]);
+            } else {
+                decodeTasks[i].execute(nullptr);
+            }
+        }
+        m_decodeGroup.wait();
+        for (size_t i = 0; i < sources.size(); i++) {
+            if (!decodeTasks[i].group) continue;
+            // The thread pool still touches a task after execute returns
+            if (m_threadPool) {
+                while (!decodeTasks[i].getIsFinished()) std::this_thread::yield();
+            }
+            vg::BitmapResource& bitmap = decodeTasks[i].bitmap;
+            if (bitmap.data) {
+                imageSizes[i] = ui32v2(bitmap.width, bitmap.height);
+                imagePixels[i] = (color4*)bitmap.bytesUI8v4;
+            }
+        }
+    }
+
+    // Map the layers in load order so the atlas is the same whichever path we took
+    ui32 numFailed = 0;
+    for (auto& layer : m_pendingLayers) {
+        AtlasTextureDescription desc = m_texturePack->findLayer(layer->path);
+        // Check if its already been loaded
+        if (desc.size.x != 0) {
+            // Already loaded so just use the desc
+            // TODO(Ben): Worry about different methods using same file?
+            layer->size = desc.size;
+            layer->index.layer = desc.index;
+            continue;
+        }
+        ui32 i = sourceLookup[layer->path];
+        if (imageSizes[i].x == 0) {
+            pError("Failed to load texture " + layer->path);
+            numFailed++;
+            continue;
+        }
+        // Do post processing on the layer, it logs why it failed
+        if (!postProcessLayer(imageSizes[i].x, imageSizes[i].y, *layer)) {
+            numFailed++;
+            continue;
+        }
+        layer->index.layer = m_texturePack->addLayer(*layer, layer->path, imagePixels[i]);
+        // Normal map
+        if (layer->normalPath.size()) {
+            i = sourceLookup[layer->normalPath];
+            if (imageSizes[i].x) {
+                layer->index.normal = m_texturePack->addLayer(*layer, layer->normalPath, imagePixels[i]);
+            } else {
+                pError("Failed to load normal map " + layer->normalPath);
+                numFailed++;
+            }
+        }
+        // disp map
+        if (layer->dispPath.size()) {
+            i = sourceLookup[layer->dispPath];
+            if (imageSizes[i].x) {
+                layer->index.disp = m_texturePack->addLayer(*layer, layer->dispPath, imagePixels[i]);
+            } else {
+                pError("Failed to load displacement map " + layer->dispPath);
+                numFailed++;
+            }
+        }
+    }
+    if (decodeTasks) {
+        for (size_t i = 0; i < sources.size(); i++) {
+            if (decodeTasks[i].bitmap.data) vg::ImageIO::free(decodeTasks[i].bitmap);
+        }
+        delete[] decodeTasks;
+    }
+
+    // Mipmaps are built per page on the thread pool, and each page is queued for
+    // upload as soon as it's done
+    m_texturePack->finishPages(m_threadPool, m_lastLoadUsedCache);
+    m_texturePack->waitForMipmaps();
+    if (!m_lastLoadUsedCache && contentHash) {
+        BlockTextureAtlasCache::save(BLOCK_TEXTURE_ATLAS_CACHE_PATH, contentHash, imageSizes, m_texturePack);
+    }
+
     // Calculate flora height
     // TODO(Ben): This is dubious
-    if (block.textures[0]->layers.base.method == ConnectedTextureMethods::FLORA) {
-        // Just a bit of algebra to solve for n with the equation y = (n^2 + n) / 2
-        // which becomes n = (sqrt(8 * y + 1) - 1) / 2
-        int y = block.textures[0]->layers.base.size.y;
-        block.floraHeight = (ui16)(sqrt(8 * y + 1) - 1) / 2;
+    for (auto& block : m_pendingBlocks) {
+        if (block->textures[0]->layers.base.method == ConnectedTextureMethods::FLORA) {
+            // Just a bit of algebra to solve for n with the equation y = (n^2 + n) / 2
+            // which becomes n = (sqrt(8 * y + 1) - 1) / 2
+            int y = block->textures[0]->layers.base.size.y;
+            block->floraHeight = (ui16)(sqrt(8 * y + 1) - 1) / 2;
+        }
     }
+
+    std::vector<BlockTextureLayer*>().swap(m_pendingLayers);
+    std::vector<Block*>().swap(m_pendingBlocks);
+    m_lastLoadMs = timer.stop();
+    return numFailed;
 }
 
 bool BlockTextureLoader::loadLayerProperties() {
@@ -417,36 +558,13 @@ bool BlockTextureLoader::loadLayer(BlockTextureLayer& layer) {
         layer.size = desc.size;
         layer.index.layer = desc.index;
     } else {
-        vio::Path path;
-        if (!m_texturePathResolver->resolvePath(layer.path, path)) return false;
-        { // Get pixels for the base texture
-            vg::ScopedBitmapResource rs(vg::ImageIO().load(path, vg::ImageIOFormat::RGBA_UI8));
-            // Do post processing on the layer
-            if (!postProcessLayer(rs, layer)) return false;
-        
-            layer.index.layer = m_texturePack->addLayer(layer, layer.path, (color4*)rs.bytesUI8v4);
-        }
-        // Normal map
-        if (layer.normalPath.size() && m_texturePathResolver->resolvePath(layer.normalPath, path)) {
-            vg::ScopedBitmapResource rs(vg::ImageIO().load(path, vg::ImageIOFormat::RGBA_UI8));
-            // Do post processing on the layer
-            if (rs.data) {
-                layer.index.normal = m_texturePack->addLayer(layer, layer.normalPath, (color4*)rs.bytesUI8v4);
-            }
-        }
-        // disp map
-        if (layer.dispPath.size() && m_texturePathResolver->resolvePath(layer.dispPath, path)) {
-            vg::ScopedBitmapResource rs(vg::ImageIO().load(path, vg::ImageIOFormat::RGBA_UI8));
-            // Do post processing on the layer
-            if (rs.data) {
-                layer.index.disp = m_texturePack->addLayer(layer, layer.dispPath, (color4*)rs.bytesUI8v4);
-            }
-        }
+        // Decoded and added to the pack in flushLayers
+        m_pendingLayers.push_back(&layer);
     }
     return true;
 }
 
-bool BlockTextureLoader::postProcessLayer(vg::ScopedBitmapResource& bitmap, BlockTextureLayer& layer) {
+bool BlockTextureLoader::postProcessLayer(ui32 width, ui32 height, BlockTextureLayer& layer) {
 
     // ui32 floraRows;
     const ui32& resolution = m_texturePack->getResolution();
@@ -455,24 +573,21 @@ bool BlockTextureLoader::postProcessLayer(vg::ScopedBitmapResource& bitmap, Bloc
 
     // Helper for checking dimensions
 #define DIM_CHECK(w, cw, h, ch, method) \
-    if (bitmap.width != resolution * cw) { \
+    if (width != resolution * cw) { \
         pError("Texture " + layer.path + " is " #method " but width is not " + std::to_string(cw)); \
         return false; \
             } \
-    if (bitmap.height != resolution * ch) {  \
+    if (height != resolution * ch) {  \
         pError("Texture " + layer.path + " is " #method " but height is not " + std::to_string(ch)); \
         return false; \
             }
 
-    // Pixels must exist
-    if (!bitmap.data) return false;
-
     // Check that the texture is sized in units of resolution
-    if (bitmap.width % resolution) {
+    if (width % resolution) {
         pError("Texture " + layer.path + " width must be a multiple of " + std::to_string(resolution));
         return false;
     }
-    if (bitmap.height % resolution) {
+    if (height % resolution) {
         pError("Texture " + layer.path + " height must be a multiple of " + std::to_string(resolution));
         return false;
     }
@@ -482,64 +597,68 @@ bool BlockTextureLoader::postProcessLayer(vg::ScopedBitmapResource& bitmap, Bloc
         // Need to set up numTiles and totalWeight for RANDOM method
         case ConnectedTextureMethods::CONNECTED:
             layer.size = ui8v2(1);
-            DIM_CHECK(width, CONNECTED_WIDTH, bitmap.height, CONNECTED_HEIGHT, CONNECTED);
+            DIM_CHECK(width, CONNECTED_WIDTH, height, CONNECTED_HEIGHT, CONNECTED);
             break;
         case ConnectedTextureMethods::RANDOM:
-            layer.numTiles = bitmap.width / bitmap.height;
+            layer.numTiles = width / height;
             layer.size = ui32v2(1);
             if (layer.weights.size() == 0) {
                 layer.totalWeight = layer.numTiles;
             } else { // Need to check if there is the right number of weights
-                if (layer.weights.size() * resolution != bitmap.width) {
+                if (layer.weights.size() * resolution != width) {
                     pError("Texture " + layer.path + " weights length must match number of columns or be empty. weights.length() = " +
-                           std::to_string(layer.weights.size()) + " but there are " + std::to_string(bitmap.width / resolution) + " columns.");
+                           std::to_string(layer.weights.size()) + " but there are " + std::to_string(width / resolution) + " columns.");
                     return false;
                 }
+                layer.totalWeight = 0;
+                for (size_t i = 0; i < layer.weights.size(); i++) {
+                    layer.totalWeight += layer.weights[i];
+                }
             }
             break;
         case ConnectedTextureMethods::GRASS:
             layer.size = ui8v2(1);
-            DIM_CHECK(width, GRASS_WIDTH, bitmap.height, GRASS_HEIGHT, GRASS);
+            DIM_CHECK(width, GRASS_WIDTH, height, GRASS_HEIGHT, GRASS);
             break;
         case ConnectedTextureMethods::HORIZONTAL:
-            layer.size.x = (ui8)(bitmap.width / resolution);
-            layer.size.y = (ui8)(bitmap.height / resolution);
-            DIM_CHECK(width, HORIZONTAL_WIDTH, bitmap.height, HORIZONTAL_HEIGHT, HORIZONTAL);
+            layer.size.x = (ui8)(width / resolution);
+            layer.size.y = (ui8)(height / resolution);
+            DIM_CHECK(width, HORIZONTAL_WIDTH, height, HORIZONTAL_HEIGHT, HORIZONTAL);
             break;
         case ConnectedTextureMethods::VERTICAL:
-            layer.size.x = (ui8)(bitmap.width / resolution);
-            layer.size.y = (ui8)(bitmap.height / resolution);
-            DIM_CHECK(width, HORIZONTAL_HEIGHT, bitmap.height, HORIZONTAL_WIDTH, VERTICAL);
+            layer.size.x = (ui8)(width / resolution);
+            layer.size.y = (ui8)(height / resolution);
+            DIM_CHECK(width, HORIZONTAL_HEIGHT, height, HORIZONTAL_WIDTH, VERTICAL);
             break;
         case ConnectedTextureMethods::REPEAT:
-            layer.size.x = (ui8)(bitmap.width / resolution);
-            layer.size.y = (ui8)(bitmap.height / resolution);
-            DIM_CHECK(width, layer.size.x, bitmap.height, layer.size.y, REPEAT);
+            layer.size.x = (ui8)(width / resolution);
+            layer.size.y = (ui8)(height / resolution);
+            DIM_CHECK(width, layer.size.x, height, layer.size.y, REPEAT);
             break;
         //case ConnectedTextureMethods::FLORA:
         //    floraRows = BlockTextureLayer::getFloraRows(layer.floraHeight);
-        //    if (bitmap.height != resolution * floraRows) {
+        //    if (height != resolution * floraRows) {
         //        pError("Texture " + layer.path + " texture height must be equal to (maxFloraHeight^2 + maxFloraHeight) / 2 * resolution = " +
-        //               std::to_string(bitmap.height) + " but it is " + std::to_string(resolution * floraRows));
+        //               std::to_string(height) + " but it is " + std::to_string(resolution * floraRows));
         //        return false;
         //    }
         //    // If no weights, they are all equal
         //    if (layer.weights.size() == 0) {
-        //        layer.totalWeight = bitmap.width / resolution;
+        //        layer.totalWeight = width / resolution;
         //    } else { // Need to check if there is the right number of weights
-        //        if (layer.weights.size() * resolution != bitmap.width) {
+        //        if (layer.weights.size() * resolution != width) {
         //            pError("Texture " + layer.path + " weights length must match number of columns or be empty. weights.length() = " +
-        //                   std::to_string(layer.weights.size()) + " but there are " + std::to_string(bitmap.width / resolution) + " columns.");
+        //                   std::to_string(layer.weights.size()) + " but there are " + std::to_string(width / resolution) + " columns.");
         //            return false;
         //        }
         //    }
         //    // Tile dimensions and count
-        //    layer.size.x = bitmap.width / resolution;
+        //    layer.size.x = width / resolution;
         //    layer.size.y = floraRows;
         //    layer.numTiles = layer.size.x * layer.size.y;
         //    break;
         case ConnectedTextureMethods::NONE:
-            DIM_CHECK(bitmap.width, 1, bitmap.height, 1, NONE);
+            DIM_CHECK(width, 1, height, 1, NONE);
             break;
         default:
             break;
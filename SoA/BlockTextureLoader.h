@@ -19,8 +19,8 @@
 #include <Vorb/VorbPreDecl.inl>
 
 #include "BlockData.h"
-
-DECL_VG(class ScopedBitmapResource)
+#include "BlockTextureTasks.h"
+#include "VoxPool.h"
 
 class Block;
 class BlockTexturePack;
@@ -34,12 +34,27 @@ struct BlockTextureNames {
 
 class BlockTextureLoader {
 public:
-    void init(ModPathResolver* texturePathResolver, BlockTexturePack* texturePack);
+    /// @param threadPool: Decodes images and builds mipmaps. Everything runs on the calling thread without it.
+    void init(ModPathResolver* texturePathResolver, BlockTexturePack* texturePack, OPT VoxPool* threadPool = nullptr);
 
     void loadTextureData();
 
+    /// Assigns the block its textures and queues their layers. The layers are
+    /// loaded by flushLayers.
     void loadBlockTextures(Block& block);
 
+    /// Loads every queued layer into the texture pack, from the atlas cache when
+    /// nothing changed, otherwise by decoding the images on the thread pool. Returns
+    /// once every page is queued for upload by BlockTexturePack::update.
+    /// @return Number of layers and maps that failed to load, each is logged
+    ui32 flushLayers();
+
+    /// Disable to always decode the images and never write the atlas cache
+    void setUseCache(bool useCache) { m_useCache = useCache; }
+    /// Wall time of the last flushLayers call
+    f64 getLastLoadMs() const { return m_lastLoadMs; }
+    bool lastLoadUsedCache() const { return m_lastLoadUsedCache; }
+
     void dispose();
 
     BlockTexturePack* getTexturePack() const { return m_texturePack; }
@@ -48,15 +63,24 @@ class BlockTextureLoader {
     bool loadTextureProperties();
     bool loadBlockTextureMapping();
     bool loadLayer(BlockTextureLayer& layer);
-    bool postProcessLayer(vg::ScopedBitmapResource& bitmap, BlockTextureLayer& layer);
+    bool postProcessLayer(ui32 width, ui32 height, BlockTextureLayer& layer);
 
     std::map<nString, BlockTextureLayer> m_layers;
     std::map<BlockIdentifier, BlockTextureNames> m_blockMappings;
 
     ModPathResolver* m_texturePathResolver = nullptr;
     BlockTexturePack* m_texturePack = nullptr;
+    VoxPool* m_threadPool = nullptr;
     vio::IOManager m_iom;
     int m_generatedTextureCounter = 0;
+
+    std::vector<BlockTextureLayer*> m_pendingLayers; ///< Layers waiting for flushLayers, in load order
+    std::vector<Block*> m_pendingBlocks; ///< Blocks whose flora height needs the layer sizes
+    BlockTextureTaskGroup m_decodeGroup;
+
+    bool m_useCache = true;
+    f64 m_lastLoadMs = 0.0;
+    bool m_lastLoadUsedCache = false;
 };
 
 #endif // BlockTextureLoader_h__
@@ -12,16 +12,22 @@
 #include "VoxelBits.h"
 #include "soaUtils.h"
 
-#define GETBLOCK(a) (((*blocks)[((a) & 0x0FFF)]))
+// Neighbor lookups go through the compact BlockPack tables rather than the Block structs
+#define GETFACES(a) (blocks->getFaceTextures((a) & 0x0FFF))
+#define GETOCCLUSION(a) (blocks->getOcclusion((a) & 0x0FFF))
 // We are assuming layerIndex can be trusted to be 0 or 1 here, add asserts?
 #define TEXTURE_INDEX (params.layerIndex == 0 ? \
-    block->textures[params.faceIndex]->layers.base.indices[params.typeIndex] : \
-    block->textures[params.faceIndex]->layers.overlay.indices[params.typeIndex])
+    faces->textures[params.faceIndex]->layers.base.indices[params.typeIndex] : \
+    faces->textures[params.faceIndex]->layers.overlay.indices[params.typeIndex])
 
-inline ui32 getPositionSeed(const i32v3& pos) {
-    i32 val = ((pos.x & 0x7ff) | ((pos.y & 0x3ff) << 11) | ((pos.z & 0x7ff) << 21));
-    // Treat i32 bits as ui32 so we don't just truncate with a cast
-    return *(ui32*)&val;
+// Hash of the voxel being meshed. Salted by face so each side of a block varies independently,
+// but not by texture type so base, normal and disp maps always pick the same tile.
+inline ui32 getVoxelHash(const BlockTextureMethodParams& params) {
+    const ChunkMesher* cm = params.chunkMesher;
+    return BlockTextureMethods::getPositionHash(cm->chunkVoxelPos.pos.x + cm->bx,
+                                                cm->chunkVoxelPos.pos.y + cm->by,
+                                                cm->chunkVoxelPos.pos.z + cm->bz,
+                                                params.faceIndex);
 }
 
 void BlockTextureMethods::getDefaultTextureIndex(BlockTextureMethodParams& params, BlockTextureMethodData& result) {
@@ -30,13 +36,9 @@ void BlockTextureMethods::getDefaultTextureIndex(BlockTextureMethodParams& param
 
 //Gets a random offset for use by random textures
 void BlockTextureMethods::getRandomTextureIndex(BlockTextureMethodParams& params, BlockTextureMethodData& result) {
-    //TODO: MurmurHash3
-    const ChunkMesher* cm = params.chunkMesher;
     const BlockTextureLayer* blockTexInfo = params.blockTexInfo;
-    i32v3 pos(cm->chunkVoxelPos.pos.x + cm->bx, cm->chunkVoxelPos.pos.y + cm->by, cm->chunkVoxelPos.pos.z + cm->bz);
 
-    // TODO(Ben): Faster RNG?
-    f32 r = params.blockTexInfo->totalWeight * ((f32)rand() / RAND_MAX);
+    f32 r = blockTexInfo->totalWeight * BlockTextureMethods::getHashUnit(getVoxelHash(params));
     f32 totalWeight = 0;
 
     result.size = params.blockTexInfo->size;
@@ -44,31 +46,28 @@ void BlockTextureMethods::getRandomTextureIndex(BlockTextureMethodParams& params
     if (blockTexInfo->weights.size()) {
         for (ui32 i = 0; i < blockTexInfo->numTiles; i++) {
             totalWeight += blockTexInfo->weights[i];
-            if (r <= totalWeight) {
+            if (r < totalWeight) {
                 result.index += i;
                 return;
             }
         }
     } else {
-        for (ui32 i = 0; i < blockTexInfo->numTiles; i++) {
-            totalWeight += 1.0f;
-            if (r <= totalWeight) {
-                result.index += i;
-                return;
-            }
-        }
+        // Uniform weights, no need to walk the tiles
+        ui32 i = (ui32)r;
+        result.index += (i < blockTexInfo->numTiles) ? i : blockTexInfo->numTiles - 1;
     }
 }
 
 void BlockTextureMethods::getFloraTextureIndex(BlockTextureMethodParams& params, BlockTextureMethodData& result) {
-    //TODO: MurmurHash3
     const ChunkMesher* cm = params.chunkMesher;
-    // i32 seed = 0; // getPositionSeed(cm->x + cm->position.x, cm->y + cm->position.y, cm->z + cm->position.z);
 
-    f32 r = (f32)((/*PseudoRand(seed) +*/ 1.0) * 0.5 * params.blockTexInfo->totalWeight);
+    const BlockTextureLayer* blockTexInfo = params.blockTexInfo;
+
+    // Flora columns without weights are uniform
+    ui32 weightSum = blockTexInfo->totalWeight ? blockTexInfo->totalWeight : blockTexInfo->size.x;
+    f32 r = weightSum * BlockTextureMethods::getHashUnit(getVoxelHash(params));
     f32 totalWeight = 0;
 
-    const BlockTextureLayer* blockTexInfo = params.blockTexInfo;
     const ui16* tertiaryData = cm->tertiaryData;
 
     const int& blockIndex = cm->blockIndex;
@@ -79,7 +78,7 @@ void BlockTextureMethods::getFloraTextureIndex(BlockTextureMethodParams& params,
     if (blockTexInfo->weights.size()) {
         for (ui32 i = 0; i < blockTexInfo->size.x; i++) {
             totalWeight += blockTexInfo->weights[i];
-            if (r <= totalWeight) {
+            if (r < totalWeight) {
                 column = i;
                 break;
             }
@@ -87,7 +86,7 @@ void BlockTextureMethods::getFloraTextureIndex(BlockTextureMethodParams& params,
     } else {
         for (ui32 i = 0; i < blockTexInfo->size.x; i++) {
             totalWeight += 1.0f;
-            if (r <= totalWeight) {
+            if (r < totalWeight) {
                 column = i;
                 break;
             }
@@ -119,100 +118,92 @@ void BlockTextureMethods::getConnectedTextureIndex(BlockTextureMethodParams& par
     BlockTextureIndex tex = result.index;
 
     // Top Left
-    const Block *block = &GETBLOCK(blockIDData[blockIndex + upDir - rightDir]);
+    const BlockFaceTextures* faces = &GETFACES(blockIDData[blockIndex + upDir - rightDir]);
 
     if (TEXTURE_INDEX != tex) {
         connectedOffset |= 0x80;
     }
 
     // Top
-    block = &GETBLOCK(blockIDData[blockIndex + upDir]);
+    faces = &GETFACES(blockIDData[blockIndex + upDir]);
     if (TEXTURE_INDEX != tex) {
         connectedOffset |= 0xE0;
     }
 
     // Top Right
-    block = &GETBLOCK(blockIDData[blockIndex + upDir + rightDir]);
+    faces = &GETFACES(blockIDData[blockIndex + upDir + rightDir]);
     if (TEXTURE_INDEX != tex) {
         connectedOffset |= 0x20;
     }
 
     // Right
-    block = &GETBLOCK(blockIDData[blockIndex + rightDir]);
+    faces = &GETFACES(blockIDData[blockIndex + rightDir]);
     if (TEXTURE_INDEX != tex) {
         connectedOffset |= 0x38;
     }
 
     // Bottom Right
-    block = &GETBLOCK(blockIDData[blockIndex - upDir + rightDir]);
+    faces = &GETFACES(blockIDData[blockIndex - upDir + rightDir]);
     if (TEXTURE_INDEX != tex) {
         connectedOffset |= 0x8;
     }
 
     // Bottom
-    block = &GETBLOCK(blockIDData[blockIndex - upDir]);
+    faces = &GETFACES(blockIDData[blockIndex - upDir]);
     if (TEXTURE_INDEX != tex) {
         connectedOffset |= 0xE;
     }
 
     // Bottom Left
-    block = &GETBLOCK(blockIDData[blockIndex - upDir - rightDir]);
+    faces = &GETFACES(blockIDData[blockIndex - upDir - rightDir]);
     if (TEXTURE_INDEX != tex) {
         connectedOffset |= 0x2;
     }
 
     // Left
-    block = &GETBLOCK(blockIDData[blockIndex - rightDir]);
+    faces = &GETFACES(blockIDData[blockIndex - rightDir]);
     if (TEXTURE_INDEX != tex) {
         connectedOffset |= 0x83;
     }
 
     if (params.blockTexInfo->innerSeams) {
         // Top Front Left
-        block = &GETBLOCK(blockIDData[blockIndex + upDir - rightDir + frontDir]);
-        if (block->occlude != BlockOcclusion::NONE) {
+        if (GETOCCLUSION(blockIDData[blockIndex + upDir - rightDir + frontDir])) {
             connectedOffset |= 0x80;
         }
 
         // Top Front Right
-        block = &GETBLOCK(blockIDData[blockIndex + upDir + rightDir + frontDir]);
-        if (block->occlude != BlockOcclusion::NONE) {
+        if (GETOCCLUSION(blockIDData[blockIndex + upDir + rightDir + frontDir])) {
             connectedOffset |= 0x20;
         }
 
         // Bottom front Right
-        block = &GETBLOCK(blockIDData[blockIndex - upDir + rightDir + frontDir]);
-        if (block->occlude != BlockOcclusion::NONE) {
+        if (GETOCCLUSION(blockIDData[blockIndex - upDir + rightDir + frontDir])) {
             connectedOffset |= 0x8;
         }
 
         //Bottom front
-        block = &GETBLOCK(blockIDData[blockIndex - upDir + frontDir]);
-        if (block->occlude != BlockOcclusion::NONE) {
+        if (GETOCCLUSION(blockIDData[blockIndex - upDir + frontDir])) {
             connectedOffset |= 0xE;
         }
 
         // Bottom front Left
-        block = &GETBLOCK(blockIDData[blockIndex - upDir - rightDir + frontDir]);
-        if (block->occlude != BlockOcclusion::NONE) {
+        if (GETOCCLUSION(blockIDData[blockIndex - upDir - rightDir + frontDir])) {
             connectedOffset |= 0x2;
         }
 
         //Left front
-        block = &GETBLOCK(blockIDData[blockIndex - rightDir + frontDir]);
-        if (block->occlude != BlockOcclusion::NONE) {
+        if (GETOCCLUSION(blockIDData[blockIndex - rightDir + frontDir])) {
             connectedOffset |= 0x83;
         }
 
         //Top front
-        block = &GETBLOCK(blockIDData[blockIndex + upDir + frontDir]);
-        if (block->occlude != BlockOcclusion::NONE) {
+        if (GETOCCLUSION(blockIDData[blockIndex + upDir + frontDir])) {
             connectedOffset |= 0xE0;
         }
 
         //Right front
-        block = &GETBLOCK(blockIDData[blockIndex + rightDir + frontDir]);
-        if (block->occlude != BlockOcclusion::NONE) {
+        if (GETOCCLUSION(blockIDData[blockIndex + rightDir + frontDir])) {
             connectedOffset |= 0x38;
         }
     }
@@ -237,26 +228,26 @@ void BlockTextureMethods::getGrassTextureIndex(BlockTextureMethodParams& params,
     // Bottom Front
     int index = blockIndex - upDir + frontDir;
     int id = blockIDData[index];
-    const Block* block = &GETBLOCK(id);
+    const BlockFaceTextures* faces = &GETFACES(id);
 
     if (/*cm->levelOfDetail > 1 || */ TEXTURE_INDEX == tex) {
-        block = &GETBLOCK(blockIDData[blockIndex]);
-        result.index = block->textureTop->layers.base.index.layer;
-        block->textureTop->layers.base.blockTextureFunc(params, result);
-        block->textureTop->layers.base.getFinalColor(*params.color, cm->heightData->temperature, cm->heightData->humidity, 0);
-        result.size = block->textureTop->layers.base.size;
+        const BlockTexture* textureTop = GETFACES(blockIDData[blockIndex]).textures[(int)vvox::Cardinal::Y_POS];
+        result.index = textureTop->layers.base.index.layer;
+        textureTop->layers.base.blockTextureFunc(params, result);
+        textureTop->layers.base.getFinalColor(*params.color, cm->heightData->temperature, cm->heightData->humidity, 0);
+        result.size = textureTop->layers.base.size;
         return;
     }
 
     // Left
-    block = &GETBLOCK(blockIDData[blockIndex - rightDir]);
-    if (TEXTURE_INDEX == tex || block->occlude == BlockOcclusion::NONE) {
+    faces = &GETFACES(blockIDData[blockIndex - rightDir]);
+    if (TEXTURE_INDEX == tex || GETOCCLUSION(blockIDData[blockIndex - rightDir]) == 0) {
         connectedOffset |= 0x8;
 
         // REDUNDANT
         if (TEXTURE_INDEX == tex) {
             // bottom front Left
-            block = &GETBLOCK(blockIDData[blockIndex - upDir - rightDir + frontDir]);
+            faces = &GETFACES(blockIDData[blockIndex - upDir - rightDir + frontDir]);
             if (TEXTURE_INDEX == tex) {
                 connectedOffset |= 0xC;
             }
@@ -264,31 +255,31 @@ void BlockTextureMethods::getGrassTextureIndex(BlockTextureMethodParams& params,
     }
 
     // Front left
-    block = &GETBLOCK(blockIDData[blockIndex - rightDir + frontDir]);
+    faces = &GETFACES(blockIDData[blockIndex - rightDir + frontDir]);
     if (TEXTURE_INDEX == tex) {
         connectedOffset |= 0x8;
     }
 
     // Bottom left
-    block = &GETBLOCK(blockIDData[blockIndex - upDir - rightDir]);
+    faces = &GETFACES(blockIDData[blockIndex - upDir - rightDir]);
     if (TEXTURE_INDEX == tex) {
         connectedOffset |= 0xC;
     }
 
     // bottom right
-    block = &GETBLOCK(blockIDData[blockIndex - upDir + rightDir]);
+    faces = &GETFACES(blockIDData[blockIndex - upDir + rightDir]);
     if (TEXTURE_INDEX == tex) {
         connectedOffset |= 0x3;
     }
 
     // Right
-    block = &GETBLOCK(blockIDData[blockIndex + rightDir]);
-    if (TEXTURE_INDEX == tex || block->occlude == BlockOcclusion::NONE) {
+    faces = &GETFACES(blockIDData[blockIndex + rightDir]);
+    if (TEXTURE_INDEX == tex || GETOCCLUSION(blockIDData[blockIndex + rightDir]) == 0) {
         connectedOffset |= 0x1;
 
         if (TEXTURE_INDEX == tex) {
             // bottom front Right
-            block = &GETBLOCK(blockIDData[blockIndex - upDir + rightDir + frontDir]);
+            faces = &GETFACES(blockIDData[blockIndex - upDir + rightDir + frontDir]);
             if (TEXTURE_INDEX == tex) {
                 connectedOffset |= 0x3;
             }
@@ -296,7 +287,7 @@ void BlockTextureMethods::getGrassTextureIndex(BlockTextureMethodParams& params,
     }
 
     // Front right
-    block = &GETBLOCK(blockIDData[blockIndex + rightDir + frontDir]);
+    faces = &GETFACES(blockIDData[blockIndex + rightDir + frontDir]);
     if (TEXTURE_INDEX == tex) {
         connectedOffset |= 0x1;
     }
@@ -325,13 +316,13 @@ void BlockTextureMethods::getVerticalTextureIndex(BlockTextureMethodParams& para
     }
 
     //top bit
-    const Block *block = &GETBLOCK(blockIDData[blockIndex + upDir]);
+    const BlockFaceTextures* faces = &GETFACES(blockIDData[blockIndex + upDir]);
 
     if (TEXTURE_INDEX == tex) {
         connectedOffset |= 2;
     }
     //bottom bit
-    block = &GETBLOCK(blockIDData[blockIndex - upDir]);
+    faces = &GETFACES(blockIDData[blockIndex - upDir]);
     if (TEXTURE_INDEX == tex) {
         connectedOffset |= 1;
     }
@@ -351,25 +342,25 @@ void BlockTextureMethods::getHorizontalTextureIndex(BlockTextureMethodParams& pa
     BlockTextureIndex tex = result.index;
 
     //right bit
-    const Block *block = &GETBLOCK(blockIDData[blockIndex + rightDir]);
+    const BlockFaceTextures* faces = &GETFACES(blockIDData[blockIndex + rightDir]);
 
     if (TEXTURE_INDEX == tex) {
         connectedOffset |= 1;
     }
     //left bit
-    block = &GETBLOCK(blockIDData[blockIndex - rightDir]);
+    faces = &GETFACES(blockIDData[blockIndex - rightDir]);
     if (TEXTURE_INDEX == tex) {
         connectedOffset |= 2;
     }
 
     if (params.blockTexInfo->innerSeams) {
         //front right bit
-        block = &GETBLOCK(blockIDData[blockIndex + rightDir + frontDir]);
+        faces = &GETFACES(blockIDData[blockIndex + rightDir + frontDir]);
         if (TEXTURE_INDEX == tex) {
             connectedOffset &= 2;
         }
         //front left bit
-        block = &GETBLOCK(blockIDData[blockIndex - rightDir + frontDir]);
+        faces = &GETFACES(blockIDData[blockIndex - rightDir + frontDir]);
         if (TEXTURE_INDEX == tex) {
             connectedOffset &= 1;
         }
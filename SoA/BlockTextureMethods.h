@@ -61,6 +61,25 @@ struct BlockTextureMethodData {
 typedef std::function <void(BlockTextureMethodParams& params, BlockTextureMethodData& result)> BlockTextureFunc;
 
 namespace BlockTextureMethods {
+    /// Hashes a world voxel position for texture variation. This is stateless so every
+    /// mesher thread gets the same answer for the same voxel, and remeshing never flickers.
+    /// It is only integer math, so a loop over a row of faces vectorizes.
+    /// @param salt: Decorrelates hashes for the same position, such as per face
+    inline ui32 getPositionHash(i32 x, i32 y, i32 z, ui32 salt) {
+        ui32 h = ((ui32)x * 0x8DA6B343u) ^ ((ui32)y * 0xD8163841u) ^ ((ui32)z * 0xCB1AB31Fu) ^ (salt * 0x9E3779B9u);
+        // MurmurHash3 finalizer
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35u;
+        h ^= h >> 16;
+        return h;
+    }
+    /// @return hash mapped to [0, 1)
+    inline f32 getHashUnit(ui32 hash) {
+        return (f32)(hash >> 8) * (1.0f / 16777216.0f);
+    }
+
     void getDefaultTextureIndex(BlockTextureMethodParams& params, BlockTextureMethodData& result);
     void getRandomTextureIndex(BlockTextureMethodParams& params, BlockTextureMethodData& result);
     void getFloraTextureIndex(BlockTextureMethodParams& params, BlockTextureMethodData& result);
@@ -32,6 +32,15 @@ void BlockTexturePack::init(ui32 resolution, ui32 maxTextures) {
         width >>= 1;
         m_mipLevels++;
     }
+    // Lay out the mip chain of a page
+    m_mipOffsets.resize(m_mipLevels + 1);
+    m_pagePixels = 0;
+    width = m_pageWidthPixels;
+    for (ui32 i = 0; i <= m_mipLevels; i++) {
+        m_mipOffsets[i] = m_pagePixels;
+        m_pagePixels += width * width;
+        width >>= 1;
+    }
 
     // Set up first page for default textures
     flagDirtyPage(0);
@@ -89,32 +98,34 @@ BlockTextureIndex BlockTexturePack::addLayer(const BlockTextureLayer& layer, con
     flagDirtyPage(firstPageIndex);
     if (lastPageIndex != firstPageIndex) flagDirtyPage(lastPageIndex);
 
-    // Copy data
-    switch (layer.method) {
-        case ConnectedTextureMethods::CONNECTED:
-            writeToAtlasContiguous(rv, pixels, 12, 4, CONNECTED_TILES);
-            break;
-        case ConnectedTextureMethods::RANDOM:
-            writeToAtlasContiguous(rv, pixels, layer.numTiles, 1, layer.numTiles);
-            break;
-        case ConnectedTextureMethods::REPEAT:
-            writeToAtlas(rv, pixels, m_resolution * layer.size.x, m_resolution * layer.size.y, 1);
-            break;
-        case ConnectedTextureMethods::GRASS:
-            writeToAtlasContiguous(rv, pixels, 3, 3, GRASS_TILES);
-            break;
-        case ConnectedTextureMethods::HORIZONTAL:
-            writeToAtlasContiguous(rv, pixels, HORIZONTAL_TILES, 1, HORIZONTAL_TILES);
-            break;
-        case ConnectedTextureMethods::VERTICAL:
-            writeToAtlasContiguous(rv, pixels, 1, VERTICAL_TILES, VERTICAL_TILES);
-            break;
-        case ConnectedTextureMethods::FLORA:
-            writeToAtlasContiguous(rv, pixels, layer.size.x, layer.size.y, layer.numTiles);
-            break;
-        default:
-            writeToAtlas(rv, pixels, m_resolution, m_resolution, 1);
-            break;
+    // Copy data, unless the pages come from the atlas cache
+    if (pixels) {
+        switch (layer.method) {
+            case ConnectedTextureMethods::CONNECTED:
+                writeToAtlasContiguous(rv, pixels, 12, 4, CONNECTED_TILES);
+                break;
+            case ConnectedTextureMethods::RANDOM:
+                writeToAtlasContiguous(rv, pixels, layer.numTiles, 1, layer.numTiles);
+                break;
+            case ConnectedTextureMethods::REPEAT:
+                writeToAtlas(rv, pixels, m_resolution * layer.size.x, m_resolution * layer.size.y, 1);
+                break;
+            case ConnectedTextureMethods::GRASS:
+                writeToAtlasContiguous(rv, pixels, 3, 3, GRASS_TILES);
+                break;
+            case ConnectedTextureMethods::HORIZONTAL:
+                writeToAtlasContiguous(rv, pixels, HORIZONTAL_TILES, 1, HORIZONTAL_TILES);
+                break;
+            case ConnectedTextureMethods::VERTICAL:
+                writeToAtlasContiguous(rv, pixels, 1, VERTICAL_TILES, VERTICAL_TILES);
+                break;
+            case ConnectedTextureMethods::FLORA:
+                writeToAtlasContiguous(rv, pixels, layer.size.x, layer.size.y, layer.numTiles);
+                break;
+            default:
+                writeToAtlas(rv, pixels, m_resolution, m_resolution, 1);
+                break;
+        }
     }
 
     // Cache the texture description
@@ -178,32 +189,79 @@ BlockColorMap* BlockTexturePack::setColorMap(const nString& name, const ui8v3* p
     return colorMap;
 }
 
-void BlockTexturePack::update() {
-    bool needsMipmapGen = false;
-    if (m_needsRealloc) {
-        allocatePages();
-        m_needsRealloc = false;
-        needsMipmapGen = true;
-        // Upload all pages
-        glBindTexture(GL_TEXTURE_2D_ARRAY, m_atlasTexture);
-        for (size_t i = 0; i < m_pages.size(); i++) {
-            uploadPage(i);
+void BlockTexturePack::finishPages(OPT VoxPool* threadPool, bool hasMipmaps /* = false */) {
+    // The last batch of tasks has to be done before it can be freed
+    waitForMipmaps();
+    delete[] m_mipmapTasks;
+    m_mipmapTasks = nullptr;
+    m_numMipmapTasks = 0;
+
+    std::vector<ui32> dirtyPages;
+    for (size_t i = 0; i < m_pages.size(); i++) {
+        if (m_pages[i].dirty) {
+            m_pages[i].dirty = false;
+            dirtyPages.push_back((ui32)i);
         }
-        std::vector<int>().swap(m_dirtyPages);
-    } else if (m_dirtyPages.size()) {
-        needsMipmapGen = true;
-        // Upload dirty pages
-        glBindTexture(GL_TEXTURE_2D_ARRAY, m_atlasTexture);
-        for (auto& i : m_dirtyPages) {
-            uploadPage(i);
+    }
+    if (dirtyPages.empty()) return;
+
+    // Publish the page count first so update can size the texture before the first page lands
+    m_numPublishedPages = (ui32)m_pages.size();
+
+    if (hasMipmaps) {
+        for (auto& i : dirtyPages) m_finishedPages.enqueue(i);
+    } else if (!threadPool) {
+        for (auto& i : dirtyPages) finishPage(i);
+    } else {
+        m_numMipmapTasks = dirtyPages.size();
+        m_mipmapTasks = new AtlasMipmapTask[m_numMipmapTasks];
+        m_mipmapGroup.add((ui32)m_numMipmapTasks);
+        for (size_t i = 0; i < m_numMipmapTasks; i++) {
+            m_mipmapTasks[i].texturePack = this;
+            m_mipmapTasks[i].pageIndex = dirtyPages[i];
+            m_mipmapTasks[i].group = &m_mipmapGroup;
+            threadPool->addTask(&m_mipmapTasks[i]);
         }
-        std::vector<int>().swap(m_dirtyPages);
     }
+}
+
+void BlockTexturePack::waitForMipmaps() {
+    m_mipmapGroup.wait();
+    // The thread pool still touches a task after execute returns
+    for (size_t i = 0; i < m_numMipmapTasks; i++) {
+        while (!m_mipmapTasks[i].getIsFinished()) std::this_thread::yield();
+    }
+}
 
-    if (needsMipmapGen) {
-        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+void BlockTexturePack::update() {
+    // Grow the texture first. That throws away its contents, so upload what we had again.
+    ui32 numPages = m_numPublishedPages;
+    if (numPages > m_numAllocatedPages) {
+        allocatePages(numPages);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_atlasTexture);
+        for (ui32 i = 0; i < m_numAllocatedPages; i++) {
+            if (m_pages[i].uploaded) uploadPage(i);
+        }
         glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        m_numAllocatedPages = numPages;
     }
+
+    // Stream in the pages whose mipmaps are done
+    ui32 pageIndex;
+    bool bound = false;
+    while (m_finishedPages.try_dequeue(pageIndex)) {
+        if (!bound) {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, m_atlasTexture);
+            bound = true;
+        }
+        uploadPage(pageIndex);
+        m_pages[pageIndex].uploaded = true;
+    }
+    if (bound) glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void BlockTexturePack::reservePages(ui32 numPages) {
+    if (numPages) flagDirtyPage(numPages - 1);
 }
 
 void BlockTexturePack::writeDebugAtlases() {
@@ -225,6 +283,15 @@ void BlockTexturePack::writeDebugAtlases() {
 }
 
 void BlockTexturePack::dispose() {
+    waitForMipmaps();
+    delete[] m_mipmapTasks;
+    m_mipmapTasks = nullptr;
+    m_numMipmapTasks = 0;
+    ui32 pageIndex;
+    while (m_finishedPages.try_dequeue(pageIndex));
+    m_numPublishedPages = 0;
+    m_numAllocatedPages = 0;
+
     if (m_atlasTexture) glDeleteTextures(1, &m_atlasTexture);
     m_atlasTexture = 0;
     for (auto& p : m_pages) {
@@ -255,23 +322,54 @@ void BlockTexturePack::flagDirtyPage(ui32 pageIndex) {
         size_t i = m_pages.size();
         m_pages.resize(pageIndex + 1);
         for (; i < m_pages.size(); i++) {
-            m_pages[i].pixels = new color4[m_pageWidthPixels * m_pageWidthPixels];
-            memset(m_pages[i].pixels, 0, m_pageWidthPixels * m_pageWidthPixels * sizeof(color4));
+            m_pages[i].pixels = new color4[m_pagePixels];
+            memset(m_pages[i].pixels, 0, m_pagePixels * sizeof(color4));
         }
-        m_needsRealloc = true;    
     }
     m_pages[pageIndex].dirty = true;
 }
 
-void BlockTexturePack::allocatePages() {
+void BlockTexturePack::buildMipmaps(ui32 pageIndex) {
+    color4* pixels = m_pages[pageIndex].pixels;
+    ui32 width = m_pageWidthPixels;
+    // Tiles are a power of two wide and the chain stops at one pixel per tile, so a
+    // 2x2 block never straddles two tiles. Pixels are premultiplied, so a plain
+    // average is the right filter.
+    for (ui32 level = 1; level <= m_mipLevels; level++) {
+        const color4* src = pixels + m_mipOffsets[level - 1];
+        color4* dest = pixels + m_mipOffsets[level];
+        ui32 srcWidth = width;
+        width >>= 1;
+        for (ui32 y = 0; y < width; y++) {
+            const color4* row0 = src + y * 2 * srcWidth;
+            const color4* row1 = row0 + srcWidth;
+            for (ui32 x = 0; x < width; x++) {
+                const color4* a = row0 + x * 2;
+                const color4* b = row1 + x * 2;
+                color4& d = dest[y * width + x];
+                d.r = (ui8)((a[0].r + a[1].r + b[0].r + b[1].r + 2) >> 2);
+                d.g = (ui8)((a[0].g + a[1].g + b[0].g + b[1].g + 2) >> 2);
+                d.b = (ui8)((a[0].b + a[1].b + b[0].b + b[1].b + 2) >> 2);
+                d.a = (ui8)((a[0].a + a[1].a + b[0].a + b[1].a + 2) >> 2);
+            }
+        }
+    }
+}
+
+void BlockTexturePack::finishPage(ui32 pageIndex) {
+    buildMipmaps(pageIndex);
+    m_finishedPages.enqueue(pageIndex);
+}
+
+void BlockTexturePack::allocatePages(ui32 numPages) {
     // Set up the storage
     if (!m_atlasTexture) glGenTextures(1, &m_atlasTexture);
     glBindTexture(GL_TEXTURE_2D_ARRAY, m_atlasTexture);
 
     // Set up all the mipmap storage
     ui32 width = m_pageWidthPixels;
-    for (ui32 i = 0; i < m_mipLevels; i++) {
-        glTexImage3D(GL_TEXTURE_2D_ARRAY, i, GL_RGBA8, width, width, m_pages.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    for (ui32 i = 0; i <= m_mipLevels; i++) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, i, GL_RGBA8, width, width, numPages, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
         width >>= 1;
         if (width < 1) width = 1;
     }
@@ -302,7 +400,13 @@ void BlockTexturePack::allocatePages() {
 }
 
 void BlockTexturePack::uploadPage(ui32 pageIndex) {
-    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, pageIndex, m_pageWidthPixels, m_pageWidthPixels, 1, GL_RGBA, GL_UNSIGNED_BYTE, m_pages[pageIndex].pixels);
+    // Mipmaps were built on the CPU, so upload every level
+    ui32 width = m_pageWidthPixels;
+    for (ui32 i = 0; i <= m_mipLevels; i++) {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, pageIndex, width, width, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                        m_pages[pageIndex].pixels + m_mipOffsets[i]);
+        width >>= 1;
+    }
 }
 
 void BlockTexturePack::writeToAtlas(BlockTextureIndex texIndex, color4* pixels, ui32 pixelWidth, ui32 pixelHeight, ui32 tileWidth) {
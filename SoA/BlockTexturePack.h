@@ -16,8 +16,12 @@
 #define BlockTexturePack_h__
 
 #include "BlockTexture.h"
+#include "BlockTextureTasks.h"
+#include "VoxPool.h"
 
+#include <atomic>
 #include <map>
+#include <Vorb/concurrentqueue.h>
 #include <Vorb/graphics/gtypes.h>
 #include <Vorb/voxel/VoxelTextureStitcher.h>
 #include <Vorb/VorbPreDecl.inl>
@@ -46,7 +50,11 @@ class BlockTexturePack {
     m_resolution(0),
     m_pageWidthPixels(0),
     m_mipLevels(0),
-    m_needsRealloc(false),
+    m_pagePixels(0),
+    m_numPublishedPages(0),
+    m_numAllocatedPages(0),
+    m_mipmapTasks(nullptr),
+    m_numMipmapTasks(0),
     m_textures(nullptr),
     m_nextFree(0),
     m_maxTextures(0)
@@ -56,7 +64,8 @@ class BlockTexturePack {
 
     void init(ui32 resolution, ui32 maxTextures);
     // Maps the texture layer to the atlas and updates the index in layer.
-    // Does not check if texture already exists
+    // Does not check if texture already exists. Null pixels only map the layer,
+    // for when the pages are filled from the atlas cache.
     BlockTextureIndex addLayer(const BlockTextureLayer& layer, const nString& path, color4* pixels);
     // Tries to find the texture index. Returns empty description on fail.
     AtlasTextureDescription findLayer(const nString& filePath);
@@ -74,9 +83,28 @@ class BlockTexturePack {
     BlockColorMap* setColorMap(const nString& name, const vg::BitmapResource* rs);
     BlockColorMap* setColorMap(const nString& name, const ui8v3* pixels);
 
-    // Call on GL thread. Will upload any textures that aren't yet uploaded.
+    // Builds the mipmaps of every dirty page, on the thread pool when there is one, and
+    // queues each page for upload as soon as its mip chain is done. Layers must not be
+    // added while pages are being finished.
+    // @param hasMipmaps: The pages already hold their mip chains, so just queue them
+    void finishPages(OPT VoxPool* threadPool, bool hasMipmaps = false);
+    // Blocks until the mipmaps from finishPages are built
+    void waitForMipmaps();
+
+    // Call on GL thread. Uploads the pages finished so far, so it can be called every
+    // frame while loading to stream the atlas in.
     void update();
 
+    // Grows the atlas to at least numPages pages
+    void reservePages(ui32 numPages);
+    ui32 getNumPages() const { return (ui32)m_pages.size(); }
+    // Every mip level of the page, back to back, starting with the full size one
+    color4* getPagePixels(ui32 pageIndex) { return m_pages[pageIndex].pixels; }
+    const color4* getPagePixels(ui32 pageIndex) const { return m_pages[pageIndex].pixels; }
+    size_t getPagePixelCount() const { return m_pagePixels; }
+    const ui32& getPageWidthPixels() const { return m_pageWidthPixels; }
+    const ui32& getMipLevels() const { return m_mipLevels; }
+
     void writeDebugAtlases();
 
     void dispose();
@@ -85,10 +113,16 @@ class BlockTexturePack {
     const ui32& getResolution() const { return m_resolution; }
 private:
     VORB_NON_COPYABLE(BlockTexturePack);
+    friend class AtlasMipmapTask;
 
     void flagDirtyPage(ui32 pageIndex);
 
-    void allocatePages();
+    // Box filters level 0 of the page down the whole mip chain
+    void buildMipmaps(ui32 pageIndex);
+    // Builds the mipmaps and queues the page for upload
+    void finishPage(ui32 pageIndex);
+
+    void allocatePages(ui32 numPages);
 
     void uploadPage(ui32 pageIndex);
 
@@ -102,21 +136,30 @@ class BlockTexturePack {
     void onAddSphericalVoxelComponent(Sender s, SphericalVoxelComponent& cmp, vecs::EntityID e);
 
     struct AtlasPage {
-        AtlasPage():pixels(nullptr), dirty(true){}
-        color4* pixels;
+        AtlasPage():pixels(nullptr), dirty(true), uploaded(false){}
+        color4* pixels; ///< Whole mip chain
         bool dirty;
+        bool uploaded; ///< Only touched on the GL thread
     };
 
     vvox::VoxelTextureStitcher m_stitcher;
 
     VGTexture m_atlasTexture;
     std::vector<AtlasPage> m_pages; ///< Cached pixel data
-    std::vector<int> m_dirtyPages; ///< List of dirty pages TODO(Ben): Maybe bad for multithreading
     std::unordered_map<nString, AtlasTextureDescription> m_descLookup;
     ui32 m_resolution;
     ui32 m_pageWidthPixels;
-    ui32 m_mipLevels;
-    bool m_needsRealloc;
+    ui32 m_mipLevels; ///< Index of the last mip level, where a tile is one pixel
+    std::vector<size_t> m_mipOffsets; ///< Offset of each mip level within a page
+    size_t m_pagePixels; ///< Pixels in a page with all its mip levels
+
+    // Handoff from finishPages to update
+    std::atomic<ui32> m_numPublishedPages;
+    ui32 m_numAllocatedPages; ///< GL thread only
+    moodycamel::ConcurrentQueue<ui32> m_finishedPages;
+    AtlasMipmapTask* m_mipmapTasks; ///< Kept alive until the next finishPages or dispose
+    size_t m_numMipmapTasks;
+    BlockTextureTaskGroup m_mipmapGroup;
 
     // For cache friendly caching of textures
     std::map<nString, ui32> m_textureLookup;
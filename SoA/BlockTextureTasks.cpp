@@ -0,0 +1,29 @@
+#include "stdafx.h"
+#include "BlockTextureTasks.h"
+
+#include "BlockTexturePack.h"
+
+void BlockTextureTaskGroup::add(ui32 numTasks) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_numPending += numTasks;
+}
+
+void BlockTextureTaskGroup::done() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (--m_numPending == 0) m_cond.notify_all();
+}
+
+void BlockTextureTaskGroup::wait() {
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_cond.wait(lock, [this] { return m_numPending == 0; });
+}
+
+void BlockTextureDecodeTask::execute(WorkerData* workerData VORB_UNUSED) {
+    bitmap = vg::ImageIO().load(path, vg::ImageIOFormat::RGBA_UI8);
+    group->done();
+}
+
+void AtlasMipmapTask::execute(WorkerData* workerData VORB_UNUSED) {
+    texturePack->finishPage(pageIndex);
+    group->done();
+}
@@ -0,0 +1,70 @@
+///
+/// BlockTextureTasks.h
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// Thread pool tasks for building the block texture atlas.
+/// Images are decoded and page mipmaps are built on the workers.
+///
+
+#pragma once
+
+#ifndef BlockTextureTasks_h__
+#define BlockTextureTasks_h__
+
+#include <condition_variable>
+#include <mutex>
+#include <Vorb/IThreadPoolTask.h>
+#include <Vorb/graphics/ImageIO.h>
+#include <Vorb/io/Path.h>
+
+#include "VoxPool.h"
+
+class BlockTexturePack;
+
+#define BLOCK_TEXTURE_DECODE_TASK_ID 7
+#define ATLAS_MIPMAP_TASK_ID 8
+
+/// Counts a batch of tasks so the thread that queued them can block until they finish
+class BlockTextureTaskGroup {
+public:
+    void add(ui32 numTasks);
+    void done();
+    /// Blocks until every added task has called done
+    void wait();
+private:
+    std::mutex m_lock;
+    std::condition_variable m_cond;
+    ui32 m_numPending = 0;
+};
+
+/// Decodes one source image to RGBA8
+class BlockTextureDecodeTask : public vcore::IThreadPoolTask<WorkerData> {
+public:
+    BlockTextureDecodeTask() : vcore::IThreadPoolTask<WorkerData>(BLOCK_TEXTURE_DECODE_TASK_ID) {}
+
+    // Executes the task
+    void execute(WorkerData* workerData) override;
+
+    vio::Path path;
+    vg::BitmapResource bitmap = {}; ///< Freed by whoever queued the task
+    BlockTextureTaskGroup* group = nullptr;
+};
+
+/// Builds the mip chain of one atlas page and queues the page for upload
+class AtlasMipmapTask : public vcore::IThreadPoolTask<WorkerData> {
+public:
+    AtlasMipmapTask() : vcore::IThreadPoolTask<WorkerData>(ATLAS_MIPMAP_TASK_ID) {}
+
+    // Executes the task
+    void execute(WorkerData* workerData) override;
+
+    BlockTexturePack* texturePack = nullptr;
+    ui32 pageIndex = 0;
+    BlockTextureTaskGroup* group = nullptr;
+};
+
+#endif // BlockTextureTasks_h__
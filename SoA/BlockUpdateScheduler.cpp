@@ -0,0 +1,471 @@
+#include "stdafx.h"
+#include "BlockUpdateScheduler.h"
+
+#include <Vorb/ThreadPool.h>
+
+#include "BlockPack.h"
+#include "Chunk.h"
+#include "ChunkGrid.h"
+#include "ChunkUpdater.h"
+
+namespace {
+    /// The 26 voxels around a voxel, where spreading blocks can spread to
+    const i32v3 NEIGHBOR_OFFSETS[26] = {
+        i32v3(-1, -1, -1), i32v3(0, -1, -1), i32v3(1, -1, -1),
+        i32v3(-1, -1, 0), i32v3(0, -1, 0), i32v3(1, -1, 0),
+        i32v3(-1, -1, 1), i32v3(0, -1, 1), i32v3(1, -1, 1),
+        i32v3(-1, 0, -1), i32v3(0, 0, -1), i32v3(1, 0, -1),
+        i32v3(-1, 0, 0), i32v3(1, 0, 0),
+        i32v3(-1, 0, 1), i32v3(0, 0, 1), i32v3(1, 0, 1),
+        i32v3(-1, 1, -1), i32v3(0, 1, -1), i32v3(1, 1, -1),
+        i32v3(-1, 1, 0), i32v3(0, 1, 0), i32v3(1, 1, 0),
+        i32v3(-1, 1, 1), i32v3(0, 1, 1), i32v3(1, 1, 1)
+    };
+    const i32v3 UP(0, 1, 0);
+    // Random ticks read voxels this many at a time, under one lock
+    const ui32 RANDOM_TICK_BATCH = 32;
+
+    /// Orders the update heaps earliest first
+    bool isLater(const ScheduledBlockUpdate& a, const ScheduledBlockUpdate& b) {
+        if (a.tick != b.tick) return a.tick > b.tick;
+        return a.order > b.order;
+    }
+
+    inline i32v3 getPosition(ui16 blockIndex) {
+        return i32v3(blockIndex % CHUNK_WIDTH, blockIndex / CHUNK_LAYER, (blockIndex % CHUNK_LAYER) / CHUNK_WIDTH);
+    }
+}
+
+void BlockUpdateTask::init(BlockUpdateScheduler* scheduler) {
+    this->scheduler = scheduler;
+    chunks.clear();
+    numRandomTicks = 0;
+    numUpdates = 0;
+    setIsFinished(false);
+}
+
+void BlockUpdateTask::execute(WorkerData* workerData VORB_UNUSED) {
+    for (auto& chunk : chunks) {
+        scheduler->stepChunk(chunk, numRandomTicks, numUpdates);
+    }
+}
+
+ui32 BlockUpdateScheduler::Random::next() {
+    state += 0x9e3779b97f4a7c15ull;
+    return (ui32)(ChunkID::hash(state) >> 32);
+}
+
+void BlockUpdateScheduler::init(OPT ChunkGrid* grid, const BlockPack* blocks, OPT VoxPool* threadPool, ui64 seed /*= 0*/) {
+    m_grid = grid;
+    m_blocks = blocks;
+    m_threadPool = threadPool;
+    m_seed = seed;
+    m_frame = 0;
+    m_tick = 0;
+    m_updateOrder = 0;
+    m_numSteppedChunks = 0;
+    m_numRandomTicks = 0;
+    m_numUpdates = 0;
+    m_numChanges = 0;
+    m_numConflicts = 0;
+    if (m_grid) {
+        m_grid->onNeighborsAcquire += makeDelegate(*this, &BlockUpdateScheduler::onNeighborsAcquire);
+        m_grid->onNeighborsRelease += makeDelegate(*this, &BlockUpdateScheduler::onNeighborsRelease);
+    }
+    Chunk::DataChange += makeDelegate(*this, &BlockUpdateScheduler::onDataChange);
+}
+
+void BlockUpdateScheduler::dispose() {
+    Chunk::DataChange -= makeDelegate(*this, &BlockUpdateScheduler::onDataChange);
+    if (m_grid) {
+        m_grid->onNeighborsAcquire -= makeDelegate(*this, &BlockUpdateScheduler::onNeighborsAcquire);
+        m_grid->onNeighborsRelease -= makeDelegate(*this, &BlockUpdateScheduler::onNeighborsRelease);
+        m_grid = nullptr;
+    }
+    while (!collectTasks()) std::this_thread::yield();
+    for (auto& task : m_tasks) delete task;
+    std::vector<BlockUpdateTask*>().swap(m_tasks);
+    m_isTicking = false;
+
+    for (auto& change : m_pendingChanges) {
+        if (change.chunk) {
+            change.chunk->chunk.release();
+            delete change.chunk;
+        }
+    }
+    std::vector<PendingChange>().swap(m_pendingChanges);
+    std::vector<PendingUpdate>().swap(m_pendingUpdates);
+    std::vector<ChangedChunk>().swap(m_changedChunks);
+    for (auto& it : m_chunks) {
+        it.second->chunk.release();
+        delete it.second;
+    }
+    ChunkIDMap<BlockUpdateChunk*>().swap(m_chunks);
+    std::vector<BlockUpdateChunk*>().swap(m_tickChunks);
+    std::vector<BlockUpdateChunk*>().swap(m_writtenChunks);
+}
+
+void BlockUpdateScheduler::addChunk(ChunkHandle& chunk) {
+    BlockUpdateChunk* uc = new BlockUpdateChunk;
+    uc->chunk = chunk.acquire();
+    uc->id = chunk.getID();
+    std::lock_guard<std::mutex> l(m_lckPending);
+    m_pendingChanges.push_back({ PendingOp::ADD, uc->id, uc });
+}
+
+void BlockUpdateScheduler::removeChunk(const ChunkID& id) {
+    std::lock_guard<std::mutex> l(m_lckPending);
+    m_pendingChanges.push_back({ PendingOp::REMOVE, id, nullptr });
+}
+
+void BlockUpdateScheduler::scheduleUpdate(const ChunkID& id, ui16 blockIndex, ui32 delay) {
+    std::lock_guard<std::mutex> l(m_lckPending);
+    m_pendingUpdates.push_back({ id, blockIndex, delay });
+}
+
+void BlockUpdateScheduler::update() {
+    m_frame++;
+    if (m_isTicking) {
+        if (!collectTasks()) return;
+        finishTick();
+    }
+    if (m_frame < m_framesPerTick) return;
+    m_frame = 0;
+    beginTick();
+    // Without a thread pool the chunks already stepped
+    if (!m_threadPool) finishTick();
+}
+
+void BlockUpdateScheduler::tick() {
+    if (m_isTicking) {
+        while (!collectTasks()) std::this_thread::yield();
+        finishTick();
+    }
+    beginTick();
+    while (!collectTasks()) std::this_thread::yield();
+    finishTick();
+}
+
+size_t BlockUpdateScheduler::getNumPendingUpdates() const {
+    size_t n = 0;
+    for (auto& it : m_chunks) n += it.second->updates.size();
+    return n;
+}
+
+void BlockUpdateScheduler::beginTick() {
+    {
+        std::lock_guard<std::mutex> l(m_lckPending);
+        for (auto& change : m_pendingChanges) {
+            auto it = m_chunks.find(change.id);
+            switch (change.op) {
+                case PendingOp::ADD:
+                    if (it != m_chunks.end()) {
+                        // Already updated, so just count it again
+                        change.chunk->chunk.release();
+                        delete change.chunk;
+                        it->second->needsScan = true;
+                    } else {
+                        m_chunks[change.id] = change.chunk;
+                    }
+                    break;
+                case PendingOp::REMOVE:
+                    if (it == m_chunks.end()) break;
+                    it->second->chunk.release();
+                    delete it->second;
+                    m_chunks.erase(it);
+                    break;
+            }
+        }
+        m_pendingChanges.clear();
+        for (auto& changed : m_changedChunks) {
+            auto it = m_chunks.find(changed.id);
+            // IDs repeat across grids
+            if (it != m_chunks.end() && (Chunk*)it->second->chunk == changed.chunk) it->second->needsScan = true;
+        }
+        m_changedChunks.clear();
+        for (auto& update : m_pendingUpdates) {
+            auto it = m_chunks.find(update.id);
+            if (it != m_chunks.end()) pushUpdate(it->second, update.blockIndex, m_tick + update.delay);
+        }
+        m_pendingUpdates.clear();
+    }
+
+    m_tickChunks.clear();
+    for (auto& it : m_chunks) {
+        BlockUpdateChunk* chunk = it.second;
+        if (chunk->chunk->genLevel != GEN_DONE) continue;
+        bool isDue = chunk->updates.size() && chunk->updates.front().tick <= m_tick;
+        if (chunk->needsScan || chunk->numRandomTicked || isDue) m_tickChunks.push_back(chunk);
+    }
+    // Changes are applied in this order
+    std::sort(m_tickChunks.begin(), m_tickChunks.end(), [](const BlockUpdateChunk* a, const BlockUpdateChunk* b) {
+        return a->id.id < b->id.id;
+    });
+    m_numSteppedChunks = m_tickChunks.size();
+    m_isTicking = true;
+
+    if (!m_threadPool) {
+        ui32 numRandomTicks = 0;
+        ui32 numUpdates = 0;
+        for (auto& chunk : m_tickChunks) stepChunk(chunk, numRandomTicks, numUpdates);
+        m_numRandomTicks += numRandomTicks;
+        m_numUpdates += numUpdates;
+        return;
+    }
+
+    m_numRunningTasks = (m_tickChunks.size() + BLOCK_UPDATE_CHUNKS_PER_TASK - 1) / BLOCK_UPDATE_CHUNKS_PER_TASK;
+    while (m_tasks.size() < m_numRunningTasks) m_tasks.push_back(new BlockUpdateTask);
+    for (size_t i = 0; i < m_numRunningTasks; i++) {
+        BlockUpdateTask* task = m_tasks[i];
+        task->init(this);
+        size_t end = glm::min(m_tickChunks.size(), (i + 1) * BLOCK_UPDATE_CHUNKS_PER_TASK);
+        for (size_t j = i * BLOCK_UPDATE_CHUNKS_PER_TASK; j < end; j++) {
+            task->chunks.push_back(m_tickChunks[j]);
+        }
+        m_threadPool->addTask(task);
+    }
+}
+
+void BlockUpdateScheduler::finishTick() {
+    // In chunk order, so the same change wins a voxel every run
+    for (auto& chunk : m_tickChunks) {
+        for (auto& change : chunk->changes) {
+            if (!applyChange(change)) {
+                m_numConflicts++;
+                continue;
+            }
+            m_numChanges++;
+            for (ui8 i = 0; i < change.numWrites; i++) {
+                if (change.writes[i].newID != change.writes[i].oldID) scheduleFollowUps(change.writes[i]);
+            }
+        }
+        chunk->changes.clear();
+    }
+    // One remesh per chunk, however many of its voxels changed
+    for (auto& chunk : m_writtenChunks) {
+        chunk->isChanged = false;
+        ChunkUpdater::notifyDataChange(chunk->chunk);
+    }
+    m_writtenChunks.clear();
+    m_isTicking = false;
+    m_tick++;
+}
+
+bool BlockUpdateScheduler::collectTasks() {
+    for (size_t i = 0; i < m_numRunningTasks; i++) {
+        if (!m_tasks[i]->getIsFinished()) return false;
+    }
+    for (size_t i = 0; i < m_numRunningTasks; i++) {
+        m_numRandomTicks += m_tasks[i]->numRandomTicks;
+        m_numUpdates += m_tasks[i]->numUpdates;
+    }
+    m_numRunningTasks = 0;
+    return true;
+}
+
+void BlockUpdateScheduler::stepChunk(BlockUpdateChunk* chunk, ui32& numRandomTicks, ui32& numUpdates) {
+    Chunk* c = chunk->chunk;
+    chunk->changes.clear();
+    if (chunk->needsScan) {
+        chunk->numRandomTicked = countRandomTicked(c);
+        chunk->needsScan = false;
+    }
+
+    if (chunk->numRandomTicked) {
+        // Seeded by chunk and tick, so it doesn't matter which thread gets the chunk
+        Random random = { ChunkID::hash(m_seed ^ ChunkID::hash(chunk->id.id) ^ m_tick) };
+        ui16 blockIndices[RANDOM_TICK_BATCH];
+        BlockID ids[RANDOM_TICK_BATCH];
+        for (ui32 done = 0; done < m_randomTicksPerChunk; done += RANDOM_TICK_BATCH) {
+            ui32 n = glm::min(RANDOM_TICK_BATCH, m_randomTicksPerChunk - done);
+            for (ui32 i = 0; i < n; i++) blockIndices[i] = (ui16)(random.next() % CHUNK_SIZE);
+            {
+                // Compressed chunks are read in place
+                std::lock_guard<std::mutex> l(c->dataMutex);
+                for (ui32 i = 0; i < n; i++) ids[i] = c->blocks.get(blockIndices[i]);
+            }
+            for (ui32 i = 0; i < n; i++) {
+                if (m_blocks->getTickRule(ids[i]).isRandomTicked) {
+                    randomTick(chunk, getPosition(blockIndices[i]), ids[i], random);
+                }
+            }
+        }
+        numRandomTicks += m_randomTicksPerChunk;
+    }
+
+    std::vector<ScheduledBlockUpdate>& updates = chunk->updates;
+    while (updates.size() && updates.front().tick <= m_tick) {
+        std::pop_heap(updates.begin(), updates.end(), isLater);
+        ui16 blockIndex = updates.back().blockIndex;
+        updates.pop_back();
+        runUpdate(chunk, blockIndex);
+        numUpdates++;
+    }
+}
+
+void BlockUpdateScheduler::randomTick(BlockUpdateChunk* chunk, const i32v3& pos, BlockID id, Random& random) {
+    const BlockTickRule& rule = m_blocks->getTickRule(id);
+    BlockChange change;
+    BlockWrite& self = change.writes[0];
+    self.chunk = chunk;
+    self.blockIndex = (ui16)(pos.y * CHUNK_LAYER + pos.z * CHUNK_WIDTH + pos.x);
+    self.oldID = id;
+
+    if (rule.smothered) {
+        BlockWrite above;
+        if (getBlock(chunk, pos + UP, above) && (m_blocks->getOcclusion(above.oldID) & BLOCK_OCCLUDES_ALL)) {
+            self.newID = rule.smothered;
+            change.numWrites = 1;
+            chunk->changes.push_back(change);
+            return;
+        }
+    }
+
+    if (rule.spreadsOnto) {
+        const i32v3& offset = NEIGHBOR_OFFSETS[random.next() % 26];
+        BlockWrite& target = change.writes[1];
+        BlockWrite above;
+        if (getBlock(chunk, pos + offset, target) && target.oldID == rule.spreadsOnto &&
+            getBlock(chunk, pos + offset + UP, above) && !(m_blocks->getOcclusion(above.oldID) & BLOCK_OCCLUDES_ALL)) {
+            // Only spreads if the source is still there
+            self.newID = id;
+            target.newID = id;
+            change.numWrites = 2;
+            chunk->changes.push_back(change);
+        }
+    }
+
+    if (rule.growsInto && random.next() < rule.growThreshold) {
+        self.newID = rule.growsInto;
+        change.numWrites = 1;
+        chunk->changes.push_back(change);
+    }
+}
+
+void BlockUpdateScheduler::runUpdate(BlockUpdateChunk* chunk, ui16 blockIndex) {
+    i32v3 pos = getPosition(blockIndex);
+    BlockChange change;
+    BlockWrite& self = change.writes[0];
+    BlockWrite& below = change.writes[1];
+    if (!getBlock(chunk, pos, self)) return;
+    if (!m_blocks->getTickRule(self.oldID).fallDelay) return;
+    if (!getBlock(chunk, pos - UP, below) || (*m_blocks)[below.oldID].collide) return;
+    // Swapped, so falling into liquid keeps the liquid
+    self.newID = below.oldID;
+    below.newID = self.oldID;
+    change.numWrites = 2;
+    chunk->changes.push_back(change);
+}
+
+bool BlockUpdateScheduler::getBlock(BlockUpdateChunk* chunk, const i32v3& pos, BlockWrite& out) const {
+    i32v3 offset(0);
+    i32v3 p = pos;
+    for (int a = 0; a < 3; a++) {
+        if (p[a] < 0) {
+            offset[a] = -1;
+            p[a] += CHUNK_WIDTH;
+        } else if (p[a] >= CHUNK_WIDTH) {
+            offset[a] = 1;
+            p[a] -= CHUNK_WIDTH;
+        }
+    }
+    BlockUpdateChunk* owner = chunk;
+    if (offset != i32v3(0)) {
+        // Chunks only change between ticks, so the lookup is safe from any thread
+        auto it = m_chunks.find(ChunkID((i32)chunk->id.x + offset.x, (i32)chunk->id.y + offset.y, (i32)chunk->id.z + offset.z));
+        if (it == m_chunks.end()) return false;
+        owner = it->second;
+    }
+    Chunk* c = owner->chunk;
+    if (c->genLevel != GEN_DONE) return false;
+
+    out.chunk = owner;
+    out.blockIndex = (ui16)(p.y * CHUNK_LAYER + p.z * CHUNK_WIDTH + p.x);
+    std::lock_guard<std::mutex> l(c->dataMutex);
+    out.oldID = c->blocks.get(out.blockIndex);
+    out.newID = out.oldID;
+    return true;
+}
+
+bool BlockUpdateScheduler::applyChange(BlockChange& change) {
+    Chunk* a = change.writes[0].chunk->chunk;
+    Chunk* b = (change.numWrites > 1) ? (Chunk*)change.writes[1].chunk->chunk : a;
+    // Other systems edit voxels too, so hold both chunks while checking and writing
+    std::unique_lock<std::mutex> lA(a->dataMutex, std::defer_lock);
+    std::unique_lock<std::mutex> lB(b->dataMutex, std::defer_lock);
+    if (a == b) {
+        lA.lock();
+    } else {
+        std::lock(lA, lB);
+    }
+
+    for (ui8 i = 0; i < change.numWrites; i++) {
+        const BlockWrite& write = change.writes[i];
+        Chunk* c = write.chunk->chunk;
+        if (c->blocks.get(write.blockIndex) != write.oldID) return false;
+    }
+    for (ui8 i = 0; i < change.numWrites; i++) {
+        BlockWrite& write = change.writes[i];
+        if (write.newID == write.oldID) continue;
+        Chunk* c = write.chunk->chunk;
+        ChunkUpdater::placeBlockNoUpdate(c, write.blockIndex, write.newID);
+        // Chunks with no blocks are never meshed
+        if (!write.oldID) c->numBlocks++;
+        if (!write.newID) c->numBlocks--;
+        write.chunk->needsScan = true;
+        if (!write.chunk->isChanged) {
+            write.chunk->isChanged = true;
+            m_writtenChunks.push_back(write.chunk);
+        }
+    }
+    return true;
+}
+
+void BlockUpdateScheduler::scheduleFollowUps(const BlockWrite& write) {
+    ui16 fallDelay = m_blocks->getTickRule(write.newID).fallDelay;
+    if (fallDelay) pushUpdate(write.chunk, write.blockIndex, m_tick + fallDelay);
+    // An opening lets the block above fall
+    if ((*m_blocks)[write.newID].collide) return;
+    BlockWrite above;
+    if (getBlock(write.chunk, getPosition(write.blockIndex) + UP, above)) {
+        fallDelay = m_blocks->getTickRule(above.oldID).fallDelay;
+        if (fallDelay) pushUpdate(above.chunk, above.blockIndex, m_tick + fallDelay);
+    }
+}
+
+void BlockUpdateScheduler::pushUpdate(BlockUpdateChunk* chunk, ui16 blockIndex, ui32 tick) {
+    chunk->updates.push_back({ tick, m_updateOrder++, blockIndex });
+    std::push_heap(chunk->updates.begin(), chunk->updates.end(), isLater);
+}
+
+ui32 BlockUpdateScheduler::countRandomTicked(Chunk* chunk) const {
+    ui32 n = 0;
+    std::lock_guard<std::mutex> l(chunk->dataMutex);
+    if (chunk->blocks.getState() == vvox::VoxelStorageState::INTERVAL_TREE) {
+        // A run at a time, without decompressing
+        auto& dataTree = chunk->blocks.getTree();
+        for (size_t i = 0; i < dataTree.size(); i++) {
+            if (m_blocks->getTickRule(dataTree[i].data).isRandomTicked) n += dataTree[i].length;
+        }
+    } else {
+        const ui16* data = chunk->blocks.getDataArray();
+        for (int i = 0; i < CHUNK_SIZE; i++) {
+            if (m_blocks->getTickRule(data[i]).isRandomTicked) n++;
+        }
+    }
+    return n;
+}
+
+void BlockUpdateScheduler::onNeighborsAcquire(Sender s VORB_UNUSED, ChunkHandle& chunk) {
+    addChunk(chunk);
+}
+
+void BlockUpdateScheduler::onNeighborsRelease(Sender s VORB_UNUSED, ChunkHandle& chunk) {
+    removeChunk(chunk.getID());
+}
+
+void BlockUpdateScheduler::onDataChange(Sender s VORB_UNUSED, ChunkHandle& chunk) {
+    // Called from worker threads too
+    std::lock_guard<std::mutex> l(m_lckPending);
+    m_changedChunks.push_back({ chunk.getID(), (Chunk*)chunk });
+}
@@ -0,0 +1,220 @@
+///
+/// BlockUpdateScheduler.h
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// Random ticks and timed block updates for loaded chunks, such as
+/// grass spreading, saplings growing and sand falling.
+///
+
+#pragma once
+
+#ifndef BlockUpdateScheduler_h__
+#define BlockUpdateScheduler_h__
+
+#include <Vorb/Events.hpp>
+#include <Vorb/IThreadPoolTask.h>
+
+#include "BlockData.h"
+#include "ChunkHandle.h"
+#include "ChunkIDMap.hpp"
+#include "Constants.h"
+#include "VoxPool.h"
+
+class BlockPack;
+class ChunkGrid;
+
+#define BLOCK_UPDATE_TASK_ID 10
+
+/// Random ticks each chunk gets per tick, 3 per 16^3 voxels
+#define BLOCK_RANDOM_TICKS_PER_CHUNK 24
+/// Calls to update() per tick, 20 ticks a second at 60 frames
+#define BLOCK_UPDATE_FRAMES_PER_TICK 3
+/// Chunks one task steps
+#define BLOCK_UPDATE_CHUNKS_PER_TASK 32
+
+struct BlockUpdateChunk;
+
+struct ScheduledBlockUpdate {
+    ui32 tick; ///< Tick it runs on
+    ui32 order; ///< Updates due on the same tick run in the order they were scheduled
+    ui16 blockIndex;
+};
+
+struct BlockWrite {
+    BlockUpdateChunk* chunk;
+    ui16 blockIndex;
+    BlockID oldID;
+    BlockID newID;
+};
+
+/// Writes that happen together, and only if every voxel still holds its oldID
+struct BlockChange {
+    BlockWrite writes[2];
+    ui8 numWrites;
+};
+
+struct BlockUpdateChunk {
+    ChunkHandle chunk;
+    ChunkID id;
+    std::vector<ScheduledBlockUpdate> updates; ///< Heap, earliest first
+    std::vector<BlockChange> changes; ///< Made by the last step, applied in order when the tick finishes
+    ui32 numRandomTicked = 0; ///< Voxels with a random tick rule, as of the last scan
+    bool needsScan = true; ///< Voxels changed since numRandomTicked was counted
+    bool isChanged = false; ///< Written this tick, so it gets remeshed once the tick finishes
+};
+
+class BlockUpdateScheduler;
+
+class BlockUpdateTask : public vcore::IThreadPoolTask<WorkerData> {
+public:
+    BlockUpdateTask() : vcore::IThreadPoolTask<WorkerData>(BLOCK_UPDATE_TASK_ID) {}
+
+    /// Clears the chunks and readies the task to be added again
+    void init(BlockUpdateScheduler* scheduler);
+
+    // Executes the task
+    void execute(WorkerData* workerData) override;
+
+    BlockUpdateScheduler* scheduler = nullptr;
+    std::vector<BlockUpdateChunk*> chunks;
+    ui32 numRandomTicks = 0;
+    ui32 numUpdates = 0;
+};
+
+/// Every tick, each chunk with blocks that have random tick rules gets a few random voxels ticked,
+/// and runs the timed updates that came due. Chunks step in parallel without writing anything.
+/// What they would change is applied once all are done, in chunk order, and only where voxels
+/// still hold what the step read, so results don't depend on the thread count. Then each
+/// changed chunk is remeshed once.
+///
+/// Rules only reach voxels of chunks that are updated too, other voxels are left alone.
+/// Updates scheduled in chunks that aren't are dropped.
+class BlockUpdateScheduler {
+    friend class BlockUpdateTask;
+public:
+    /// @param grid: Its chunks with acquired neighbors are updated. If nullptr, chunks are only added by hand.
+    /// @param threadPool: Steps the chunks. If nullptr, they step on the calling thread.
+    /// @param seed: Seeds the random ticks
+    void init(OPT ChunkGrid* grid, const BlockPack* blocks, OPT VoxPool* threadPool, ui64 seed = 0);
+    /// Waits for running steps and releases all chunks
+    void dispose();
+
+    /// Updates a chunk from the next tick on
+    void addChunk(ChunkHandle& chunk);
+    void removeChunk(const ChunkID& id);
+    /// Runs the update of a voxel delay ticks after the next tick starts. Thread safe.
+    /// Edits from outside should schedule the voxel and the one above it, so blocks fall.
+    void scheduleUpdate(const ChunkID& id, ui16 blockIndex, ui32 delay);
+
+    /// Call once per frame. Starts a tick every framesPerTick calls, and finishes it on a later call.
+    void update();
+    /// Finishes the running tick if there is one, then runs a whole new one
+    void tick();
+
+    void setFramesPerTick(ui32 framesPerTick) { m_framesPerTick = framesPerTick; }
+    void setRandomTicksPerChunk(ui32 randomTicksPerChunk) { m_randomTicksPerChunk = randomTicksPerChunk; }
+
+    /// Number of finished ticks
+    const ui32& getTick() const { return m_tick; }
+    size_t getNumChunks() const { return m_chunks.size(); }
+    /// Chunks stepped by the last tick, the rest had nothing to do
+    const size_t& getNumSteppedChunks() const { return m_numSteppedChunks; }
+    /// Voxels random ticked so far
+    const ui64& getNumRandomTicks() const { return m_numRandomTicks; }
+    /// Scheduled updates run so far
+    const ui64& getNumUpdates() const { return m_numUpdates; }
+    /// Changes applied so far
+    const ui64& getNumChanges() const { return m_numChanges; }
+    /// Changes dropped because another change got to a voxel first
+    const ui64& getNumConflicts() const { return m_numConflicts; }
+    /// Scheduled updates in updated chunks, not run yet
+    size_t getNumPendingUpdates() const;
+private:
+    enum class PendingOp {
+        ADD,
+        REMOVE
+    };
+    struct PendingChange {
+        PendingOp op;
+        ChunkID id;
+        BlockUpdateChunk* chunk; ///< Only for ADD
+    };
+    struct PendingUpdate {
+        ChunkID id;
+        ui16 blockIndex;
+        ui32 delay;
+    };
+    struct ChangedChunk {
+        ChunkID id;
+        const Chunk* chunk;
+    };
+    /// Random numbers of one chunk for one tick
+    struct Random {
+        ui64 state;
+        ui32 next();
+    };
+
+    /// Applies pending changes and steps or launches the chunks that have something to do
+    void beginTick();
+    /// Applies the changes of the stepped chunks and remeshes the ones that changed
+    void finishTick();
+    /// @return true if no task is running
+    bool collectTasks();
+
+    /// Counts random ticked voxels if needed, then random ticks the chunk and runs its due updates.
+    /// Only reads voxels, so chunks step in parallel.
+    void stepChunk(BlockUpdateChunk* chunk, ui32& numRandomTicks, ui32& numUpdates);
+    /// Smothers, spreads and grows a voxel by the rules of its block
+    void randomTick(BlockUpdateChunk* chunk, const i32v3& pos, BlockID id, Random& random);
+    /// Drops a falling block if it isn't held up
+    void runUpdate(BlockUpdateChunk* chunk, ui16 blockIndex);
+    /// Reads a voxel of the chunk or any of its 26 neighbors
+    /// @param pos: Position in the space of chunk, one chunk past its sides at most
+    /// @return false if the voxel's chunk isn't updated or generated
+    bool getBlock(BlockUpdateChunk* chunk, const i32v3& pos, BlockWrite& out) const;
+    /// @return false if a voxel no longer holds what the step read
+    bool applyChange(BlockChange& change);
+    /// Schedules updates a write can trigger, on the voxel and on the one above it
+    void scheduleFollowUps(const BlockWrite& write);
+    void pushUpdate(BlockUpdateChunk* chunk, ui16 blockIndex, ui32 tick);
+    ui32 countRandomTicked(Chunk* chunk) const;
+
+    void onNeighborsAcquire(Sender s, ChunkHandle& chunk);
+    void onNeighborsRelease(Sender s, ChunkHandle& chunk);
+    void onDataChange(Sender s, ChunkHandle& chunk);
+
+    ChunkGrid* m_grid = nullptr;
+    const BlockPack* m_blocks = nullptr;
+    VoxPool* m_threadPool = nullptr;
+    ui64 m_seed = 0;
+    ui32 m_framesPerTick = BLOCK_UPDATE_FRAMES_PER_TICK;
+    ui32 m_randomTicksPerChunk = BLOCK_RANDOM_TICKS_PER_CHUNK;
+    ui32 m_frame = 0;
+
+    ChunkIDMap<BlockUpdateChunk*> m_chunks; ///< Only changed between ticks
+
+    std::mutex m_lckPending;
+    std::vector<PendingChange> m_pendingChanges;
+    std::vector<PendingUpdate> m_pendingUpdates;
+    std::vector<ChangedChunk> m_changedChunks; ///< Edited since the last tick, so they are counted again
+
+    std::vector<BlockUpdateChunk*> m_tickChunks; ///< Chunks stepping this tick, in ID order
+    std::vector<BlockUpdateChunk*> m_writtenChunks; ///< Chunks the running tick wrote to
+    std::vector<BlockUpdateTask*> m_tasks; ///< Reused every tick
+    size_t m_numRunningTasks = 0;
+    bool m_isTicking = false;
+
+    ui32 m_tick = 0;
+    ui32 m_updateOrder = 0;
+    size_t m_numSteppedChunks = 0;
+    ui64 m_numRandomTicks = 0;
+    ui64 m_numUpdates = 0;
+    ui64 m_numChanges = 0;
+    ui64 m_numConflicts = 0;
+};
+
+#endif // BlockUpdateScheduler_h__
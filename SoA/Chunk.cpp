@@ -10,6 +10,8 @@ void Chunk::init(WorldCubeFace face) {
     m_chunkPosition.pos = i32v3(m_id.x, m_id.y, m_id.z);
     m_chunkPosition.face = face;
     m_voxelPosition = VoxelSpaceConversions::chunkToVoxel(m_chunkPosition);
+    dirtySlabs = 0;
+    dirtyNeighbors = 0;
 }
 
 void Chunk::initAndFillEmpty(WorldCubeFace face, vvox::VoxelStorageState /*= vvox::VoxelStorageState::INTERVAL_TREE*/) {
@@ -22,7 +24,7 @@ void Chunk::initAndFillEmpty(WorldCubeFace face, vvox::VoxelStorageState /*= vvo
     tertiary.initFromSortedArray(vvox::VoxelStorageState::INTERVAL_TREE, &tertiaryNode, 1);
 }
 
-void Chunk::setRecyclers(vcore::FixedSizeArrayRecycler<CHUNK_SIZE, ui16>* shortRecycler) {
+void Chunk::setRecyclers(vvox::VoxelArrayRecycler<CHUNK_SIZE, ui16>* shortRecycler) {
     blocks.setArrayRecycler(shortRecycler);
     tertiary.setArrayRecycler(shortRecycler);
 }
@@ -30,4 +32,34 @@ void Chunk::setRecyclers(vcore::FixedSizeArrayRecycler<CHUNK_SIZE, ui16>* shortR
 void Chunk::updateContainers() {
     blocks.update(dataMutex);
     tertiary.update(dataMutex);
-}
\ No newline at end of file
+}
+
+void Chunk::flagDirty(BlockIndex blockIndex, bool visibilityChanged) {
+    isDirty = true;
+    int x = blockIndex % CHUNK_WIDTH;
+    int y = blockIndex / CHUNK_LAYER;
+    int z = (blockIndex % CHUNK_LAYER) / CHUNK_WIDTH;
+
+    // Faces of the voxels above and below can change too
+    int slabBelow = glm::max(y - 1, 0) / CHUNK_MESH_SLAB_HEIGHT;
+    int slabAbove = glm::min(y + 1, CHUNK_WIDTH - 1) / CHUNK_MESH_SLAB_HEIGHT;
+    ui8 slabs = (ui8)((1 << slabBelow) | (1 << slabAbove));
+    dirtySlabs |= slabs;
+
+    // A neighbor only needs a remesh if its face against this voxel appears or disappears.
+    // Edge and corner neighbors never see it, the mesher clones their padding from face neighbors.
+    if (!visibilityChanged) return;
+    ui8 neighborSlabs[6] = { 0, 0, 0, 0, 0, 0 };
+    if (x == 0) neighborSlabs[0] = slabs;
+    if (x == CHUNK_WIDTH - 1) neighborSlabs[1] = slabs;
+    if (y == 0) neighborSlabs[2] = (ui8)(1 << (CHUNK_MESH_SLABS - 1));
+    if (y == CHUNK_WIDTH - 1) neighborSlabs[3] = 1;
+    if (z == 0) neighborSlabs[4] = slabs;
+    if (z == CHUNK_WIDTH - 1) neighborSlabs[5] = slabs;
+    for (int i = 0; i < 6; i++) {
+        if (neighborSlabs[i] && neighbors[i].isAquired()) {
+            neighbors[i]->dirtySlabs |= neighborSlabs[i];
+            dirtyNeighbors |= (ui8)(1 << i);
+        }
+    }
+}
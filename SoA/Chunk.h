@@ -22,7 +22,8 @@
 #include "MetaSection.h"
 #include "ChunkGenerator.h"
 #include "ChunkID.h"
-#include <Vorb/FixedSizeArrayRecycler.hpp>
+#include "VoxelArrayRecycler.hpp"
+#include <atomic>
 
 #if defined(_MSC_VER)
 #define ALIGNED_(x) __declspec(align(x))
@@ -70,7 +71,7 @@ class Chunk {
     void init(WorldCubeFace face);
     // Initializes the chunk and sets all voxel data to 0
     void initAndFillEmpty(WorldCubeFace face, vvox::VoxelStorageState = vvox::VoxelStorageState::INTERVAL_TREE);
-    void setRecyclers(vcore::FixedSizeArrayRecycler<CHUNK_SIZE, ui16>* shortRecycler);
+    void setRecyclers(vvox::VoxelArrayRecycler<CHUNK_SIZE, ui16>* shortRecycler);
     void updateContainers();
 
     /************************************************************************/
@@ -91,7 +92,11 @@ class Chunk {
     }
 
     // Marks the chunks as dirty and flags for a re-mesh
-    void flagDirty() { isDirty = true; }
+    void flagDirty() { isDirty = true; dirtySlabs = CHUNK_MESH_SLABS_ALL; }
+    /// Marks the chunk as dirty and flags only the mesh slabs a voxel change can affect.
+    /// Border voxels also flag the slabs of neighbors they can show or hide faces of.
+    /// @param visibilityChanged: False if the old and new block hide neighbor faces the same way
+    void flagDirty(BlockIndex blockIndex, bool visibilityChanged);
 
     /************************************************************************/
     /* Members                                                              */
@@ -126,6 +131,10 @@ class Chunk {
     // Block indexes where flora must be generated.
     std::vector<ui16> floraToGenerate;
     volatile ui32 updateVersion;
+    /// Mesh slabs changed since the last mesh was prepared. 0 means unknown, so remesh everything
+    std::atomic<ui8> dirtySlabs;
+    /// Bit per neighbors[] entry whose mesh this chunk's edits changed, for notifyDataChange
+    std::atomic<ui8> dirtyNeighbors;
 
     ChunkAccessor* accessor;
 
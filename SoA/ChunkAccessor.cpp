@@ -45,7 +45,7 @@ void ChunkAccessor::init(PagedChunkAllocator* allocator) {
     m_allocator = allocator;
 }
 void ChunkAccessor::destroy() {
-    std::unordered_map<ChunkID, ChunkHandle>().swap(m_chunkLookup);
+    ChunkIDMap<ChunkHandle>().swap(m_chunkLookup);
 }
 
 #ifdef FAST_CHUNK_ACCESS
@@ -60,9 +60,10 @@ ChunkHandle ChunkAccessor::acquire(ChunkID id) {
         h->m_id = id;
         h->accessor = this;
         h->m_handleState = HANDLE_STATE_ALIVE;
+        ChunkHandle tmp(h);
         lMap.unlock();
-        onAdd(ChunkHandle(h));
-        return h;
+        onAdd(ChunkHandle(tmp));
+        return tmp;
     } else {
         InterlockedIncrement(&it->second->m_handleRefCount);
         it->second->m_handleState = HANDLE_STATE_ALIVE;
@@ -173,10 +174,11 @@ ChunkHandle ChunkAccessor::safeAdd(ChunkID id, bool& wasOld) {
         h->accessor = this;
         h->m_handleState = HANDLE_STATE_ALIVE;
         h->m_handleRefCount = 1;
+        // h lives in the lookup, which may move it once unlocked
         ChunkHandle tmp(h);
         l.unlock();
         onAdd(tmp);
-        return h;
+        return tmp;
     } else {
         wasOld = true;
         return it->second;
@@ -17,6 +17,7 @@
 
 #include "Chunk.h"
 #include "ChunkHandle.h"
+#include "ChunkIDMap.hpp"
 
 #include <Vorb/Events.hpp>
 
@@ -42,7 +43,7 @@ class ChunkAccessor {
     void safeRemove(ChunkHandle& chunk);
 
     std::mutex m_lckLookup;
-    std::unordered_map<ChunkID, ChunkHandle> m_chunkLookup;
+    ChunkIDMap<ChunkHandle> m_chunkLookup;
     PagedChunkAllocator* m_allocator = nullptr;
 };
 
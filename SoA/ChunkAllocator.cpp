@@ -8,12 +8,23 @@
 
 #define INITIAL_UPDATE_VERSION 1
 
+// Chunks a thread keeps before handing half back to the pages
+#define CHUNK_MAGAZINE_SIZE 32
+
+namespace {
+    std::atomic<ui32> nextAllocatorID(1);
+}
+
 PagedChunkAllocator::PagedChunkAllocator() :
-m_shortFixedSizeArrayRecycler(MAX_VOXEL_ARRAYS_TO_CACHE * NUM_SHORT_VOXEL_ARRAYS) {
+m_shortFixedSizeArrayRecycler(MAX_VOXEL_ARRAYS_TO_CACHE * NUM_SHORT_VOXEL_ARRAYS),
+m_id(nextAllocatorID++) {
     // Empty
 }
 
 PagedChunkAllocator::~PagedChunkAllocator() {
+    for (auto& magazine : m_magazines) {
+        delete magazine;
+    }
     for (auto& page : m_chunkPages) {
         delete page;
     }
@@ -21,22 +32,19 @@ PagedChunkAllocator::~PagedChunkAllocator() {
 
 Chunk* PagedChunkAllocator::alloc() {
     // TODO(Ben): limit
-    std::lock_guard<std::mutex> lock(m_lock);
-
-    // Allocate chunk pages if needed
-    if (m_freeChunks.empty()) {
-        ChunkPage* page = new ChunkPage();
-        m_chunkPages.push_back(page);
-        // Add chunks to free chunks lists
-        for (size_t i = 0; i < CHUNK_PAGE_SIZE; i++) {
-            Chunk* chunk = &page->chunks[CHUNK_PAGE_SIZE - i - 1];
-            chunk->setRecyclers(&m_shortFixedSizeArrayRecycler);
-            m_freeChunks.push_back(chunk);
+    Chunk* chunk;
+    {
+        ChunkMagazine* magazine = getMagazine();
+        std::lock_guard<std::mutex> l(magazine->lock);
+        if (magazine->chunks.empty()) {
+            // Only the refill touches the shared pages
+            std::lock_guard<std::mutex> lock(m_lock);
+            refillMagazine(magazine, CHUNK_MAGAZINE_SIZE / 2);
         }
+        // Grab a free chunk
+        chunk = magazine->chunks.back();
+        magazine->chunks.pop_back();
     }
-    // Grab a free chunk
-    Chunk* chunk = m_freeChunks.back();
-    m_freeChunks.pop_back();
 
     // Set defaults
     chunk->gridData = nullptr;
@@ -53,12 +61,133 @@ Chunk* PagedChunkAllocator::alloc() {
 }
 
 void PagedChunkAllocator::free(Chunk* chunk) {
-    // TODO(Ben): Deletion if there is a lot?
-    std::lock_guard<std::mutex> lock(m_lock);
-    m_freeChunks.push_back(chunk);
-
     // Free data
     chunk->blocks.clear();
     chunk->tertiary.clear();
     std::vector<ChunkQuery*>().swap(chunk->m_genQueryData.pending);
+
+    ChunkMagazine* magazine = getMagazine();
+    std::lock_guard<std::mutex> l(magazine->lock);
+    if (magazine->chunks.size() == CHUNK_MAGAZINE_SIZE) {
+        // Hand back the older half in one go
+        std::lock_guard<std::mutex> lock(m_lock);
+        returnChunks(magazine, CHUNK_MAGAZINE_SIZE / 2);
+    }
+    magazine->chunks.push_back(chunk);
+}
+
+ui32 PagedChunkAllocator::freeEmptyPages(ui32 numSpare) {
+    { // Chunks sitting in magazines would keep their pages alive
+        std::lock_guard<std::mutex> l(m_lckMagazines);
+        for (auto& magazine : m_magazines) {
+            std::lock_guard<std::mutex> lMagazine(magazine->lock);
+            std::lock_guard<std::mutex> lock(m_lock);
+            returnChunks(magazine, magazine->chunks.size());
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_lock);
+    ui32 numFreed = 0;
+    ui32 numEmpty = 0;
+    for (size_t i = 0; i < m_chunkPages.size();) {
+        ChunkPage* page = m_chunkPages[i];
+        if (page->freeChunks.size() == CHUNK_PAGE_SIZE && ++numEmpty > numSpare) {
+            delete page;
+            m_chunkPages[i] = m_chunkPages.back();
+            m_chunkPages.pop_back();
+            numFreed++;
+        } else {
+            i++;
+        }
+    }
+    return numFreed;
+}
+
+void PagedChunkAllocator::clearVoxelArrayCache() {
+    m_shortFixedSizeArrayRecycler.destroy();
+}
+
+size_t PagedChunkAllocator::getNumPages() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_chunkPages.size();
+}
+
+size_t PagedChunkAllocator::getNumUsedChunks() {
+    size_t numFree = 0;
+    {
+        std::lock_guard<std::mutex> l(m_lckMagazines);
+        for (auto& magazine : m_magazines) {
+            std::lock_guard<std::mutex> lMagazine(magazine->lock);
+            numFree += magazine->chunks.size();
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (auto& page : m_chunkPages) {
+        numFree += page->freeChunks.size();
+    }
+    return m_chunkPages.size() * CHUNK_PAGE_SIZE - numFree;
+}
+
+size_t PagedChunkAllocator::getPageBytes() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_chunkPages.size() * (sizeof(ChunkPage) + CHUNK_PAGE_SIZE * sizeof(Chunk*));
+}
+
+size_t PagedChunkAllocator::getCachedVoxelArrayBytes() {
+    return m_shortFixedSizeArrayRecycler.getSize() * CHUNK_SIZE * sizeof(ui16);
+}
+
+PagedChunkAllocator::ChunkMagazine* PagedChunkAllocator::getMagazine() {
+    // IDs are never reused, so entries of destroyed allocators are never matched
+    thread_local std::vector<std::pair<ui32, ChunkMagazine*>> magazines;
+    for (auto& it : magazines) {
+        if (it.first == m_id) return it.second;
+    }
+    ChunkMagazine* magazine = new ChunkMagazine;
+    magazine->chunks.reserve(CHUNK_MAGAZINE_SIZE);
+    {
+        std::lock_guard<std::mutex> l(m_lckMagazines);
+        m_magazines.push_back(magazine);
+    }
+    magazines.emplace_back(m_id, magazine);
+    return magazine;
+}
+
+void PagedChunkAllocator::refillMagazine(ChunkMagazine* magazine, size_t numChunks) {
+    while (numChunks) {
+        // Fill the fullest page first, so the emptiest ones drain and can be freed
+        ChunkPage* page = nullptr;
+        for (auto& p : m_chunkPages) {
+            if (p->freeChunks.size() && (!page || p->freeChunks.size() < page->freeChunks.size())) page = p;
+        }
+        // Allocate chunk pages if needed
+        if (!page) {
+            page = new ChunkPage();
+            m_chunkPages.push_back(page);
+            // Add chunks to free chunks lists
+            page->freeChunks.reserve(CHUNK_PAGE_SIZE);
+            for (size_t i = 0; i < CHUNK_PAGE_SIZE; i++) {
+                Chunk* chunk = &page->chunks[CHUNK_PAGE_SIZE - i - 1];
+                chunk->setRecyclers(&m_shortFixedSizeArrayRecycler);
+                page->freeChunks.push_back(chunk);
+            }
+        }
+        size_t n = std::min(numChunks, page->freeChunks.size());
+        magazine->chunks.insert(magazine->chunks.end(), page->freeChunks.end() - n, page->freeChunks.end());
+        page->freeChunks.resize(page->freeChunks.size() - n);
+        numChunks -= n;
+    }
+}
+
+void PagedChunkAllocator::returnChunks(ChunkMagazine* magazine, size_t numChunks) {
+    for (size_t i = 0; i < numChunks; i++) {
+        findPage(magazine->chunks[i])->freeChunks.push_back(magazine->chunks[i]);
+    }
+    magazine->chunks.erase(magazine->chunks.begin(), magazine->chunks.begin() + numChunks);
+}
+
+PagedChunkAllocator::ChunkPage* PagedChunkAllocator::findPage(Chunk* chunk) {
+    for (auto& page : m_chunkPages) {
+        if (chunk >= page->chunks && chunk < page->chunks + CHUNK_PAGE_SIZE) return page;
+    }
+    return nullptr;
 }
@@ -15,10 +15,9 @@
 #ifndef ChunkAllocator_h__
 #define ChunkAllocator_h__
 
-#include <Vorb/FixedSizeArrayRecycler.hpp>
-
 #include "Chunk.h"
 #include "Constants.h"
+#include "VoxelArrayRecycler.hpp"
 
 /*! @brief The chunk allocator.
  */
@@ -32,20 +31,53 @@ class PagedChunkAllocator {
     
     //void appendExtraSize(size_t s, MemoryFormatter fConstructor);
 
-    /// Gets a new chunk ID
+    /// Gets a new chunk ID. Served from a magazine of the calling thread,
+    /// which is refilled in batches.
     Chunk* alloc();
-    /// Frees a chunk
+    /// Frees a chunk into a magazine of the calling thread
     void free(Chunk* chunk);
+
+    /// Returns the chunks of every thread's magazine, then deletes pages with no chunks in use
+    /// @param numSpare: Empty pages to keep for later allocations
+    /// @return Number of pages deleted
+    ui32 freeEmptyPages(ui32 numSpare);
+    /// Deletes the voxel arrays kept for reuse
+    void clearVoxelArrayCache();
+
+    size_t getNumPages();
+    size_t getNumUsedChunks();
+    /// Memory of all pages, including their free chunks
+    size_t getPageBytes();
+    size_t getCachedVoxelArrayBytes();
 protected:
     static const size_t CHUNK_PAGE_SIZE = 2048;
     struct ChunkPage {
         Chunk chunks[CHUNK_PAGE_SIZE];
+        std::vector<Chunk*> freeChunks; ///< List of inactive chunks in this page
     };
 
-    std::vector<Chunk*> m_freeChunks; ///< List of inactive chunks
+    struct ChunkMagazine {
+        std::mutex lock; ///< Only contended while magazines are flushed
+        std::vector<Chunk*> chunks;
+        ui8 padding[64]; ///< Keeps magazines of different threads off the same cache line
+    };
+
+    /// Magazine of the calling thread, created on first use
+    ChunkMagazine* getMagazine();
+    /// Moves free chunks from the pages to a magazine. Lock both first.
+    void refillMagazine(ChunkMagazine* magazine, size_t numChunks);
+    /// Moves the first numChunks chunks of a magazine back to their pages. Lock both first.
+    void returnChunks(ChunkMagazine* magazine, size_t numChunks);
+    /// Finds the page that holds a chunk
+    ChunkPage* findPage(Chunk* chunk);
+
     std::vector<ChunkPage*> m_chunkPages; ///< All pages
-    vcore::FixedSizeArrayRecycler<CHUNK_SIZE, ui16> m_shortFixedSizeArrayRecycler; ///< For recycling voxel data
-    std::mutex m_lock; ///< Lock access to free-list
+    vvox::VoxelArrayRecycler<CHUNK_SIZE, ui16> m_shortFixedSizeArrayRecycler; ///< For recycling voxel data
+    std::mutex m_lock; ///< Lock access to pages and their free-lists
+
+    std::mutex m_lckMagazines;
+    std::vector<ChunkMagazine*> m_magazines; ///< Every thread's magazine, owned here
+    ui32 m_id; ///< Tells magazines of different allocators apart
 };
 
 #endif // ChunkAllocator_h__
@@ -0,0 +1,172 @@
+#include "stdafx.h"
+#include "ChunkEditJournal.h"
+
+#include "Chunk.h"
+#include "ChunkIOManager.h"
+#include "Errors.h"
+
+namespace {
+    /// Bytes of one run: start index, length and block, each a big endian ui16
+    const size_t RUN_SIZE = 6;
+
+    inline void writeShort(std::vector<ui8>& data, ui16 v) {
+        data.push_back((ui8)(v >> 8));
+        data.push_back((ui8)(v & 0xFF));
+    }
+    inline ui16 readShort(const ui8* data) {
+        return (ui16)((data[0] << 8) | data[1]);
+    }
+
+    bool isBefore(const VoxelEdit& edit, ui16 blockIndex) {
+        return edit.blockIndex < blockIndex;
+    }
+}
+
+void ChunkEditJournal::init(WorldCubeFace face, OPT ChunkIOManager* io) {
+    m_face = face;
+    m_io = io;
+}
+
+void ChunkEditJournal::dispose() {
+    std::unique_lock<std::mutex> l(m_lck);
+    m_io = nullptr;
+    m_loadDone.wait(l, [this]() { return m_numLoading == 0; });
+}
+
+void ChunkEditJournal::record(const ChunkID& id, ui16 blockIndex, BlockID blockID) {
+    std::lock_guard<std::mutex> l(m_lck);
+    ChunkEdits& chunk = m_chunks[id];
+    auto it = std::lower_bound(chunk.edits.begin(), chunk.edits.end(), blockIndex, isBefore);
+    if (it != chunk.edits.end() && it->blockIndex == blockIndex) {
+        it->blockID = blockID;
+    } else {
+        chunk.edits.insert(it, { blockIndex, blockID });
+    }
+    chunk.isDirty = true;
+}
+
+void ChunkEditJournal::load(const ChunkID& id) {
+    ChunkIOManager* io;
+    {
+        std::lock_guard<std::mutex> l(m_lck);
+        if (!m_io || m_chunks.find(id) != m_chunks.end()) return;
+        io = m_io;
+        m_numLoading++;
+    }
+
+    std::vector<ui8> data;
+    bool isLoaded = io->loadEditData(m_face, id, data);
+    {
+        std::lock_guard<std::mutex> l(m_lck);
+        m_numLoading--;
+    }
+    m_loadDone.notify_all();
+    if (!isLoaded) return;
+    ChunkEdits chunk;
+    if (!decode(data.data(), data.size(), chunk.edits)) {
+        pError("Corrupt voxel edits for chunk " + std::to_string(id.x) + " " + std::to_string(id.y) + " " + std::to_string(id.z));
+        return;
+    }
+    if (chunk.edits.empty()) return;
+
+    std::lock_guard<std::mutex> l(m_lck);
+    // Edits recorded while it was read are newer
+    if (m_chunks.find(id) == m_chunks.end()) m_chunks[id] = std::move(chunk);
+}
+
+bool ChunkEditJournal::apply(Chunk* chunk) const {
+    // Copied, so m_lck is never held while waiting on a chunk. Editors record with the chunk locked.
+    std::vector<VoxelEdit> edits;
+    if (!getEdits(chunk->getID(), edits)) return false;
+
+    bool changed = false;
+    std::lock_guard<std::mutex> l(chunk->dataMutex);
+    for (auto& edit : edits) {
+        BlockID oldID = chunk->blocks.get(edit.blockIndex);
+        if (oldID == edit.blockID) continue;
+        chunk->blocks.set(edit.blockIndex, edit.blockID);
+        if (!oldID) chunk->numBlocks++;
+        if (!edit.blockID) chunk->numBlocks--;
+        changed = true;
+    }
+    return changed;
+}
+
+size_t ChunkEditJournal::save() {
+    // Saves run on the thread that disposes, so m_io can't change under it
+    if (!m_io) return 0;
+    struct SaveData {
+        ChunkID id;
+        std::vector<ui8> data;
+    };
+    std::vector<SaveData> saves;
+    {
+        std::lock_guard<std::mutex> l(m_lck);
+        for (auto& it : m_chunks) {
+            if (!it.second.isDirty) continue;
+            saves.emplace_back();
+            saves.back().id = it.first;
+            encode(it.second.edits, saves.back().data);
+            it.second.isDirty = false;
+        }
+    }
+
+    size_t numSaved = 0;
+    for (auto& save : saves) {
+        if (m_io->saveEditData(m_face, save.id, save.data)) {
+            numSaved++;
+        } else {
+            // Try again next save
+            std::lock_guard<std::mutex> l(m_lck);
+            m_chunks[save.id].isDirty = true;
+        }
+    }
+    return numSaved;
+}
+
+bool ChunkEditJournal::getEdits(const ChunkID& id, std::vector<VoxelEdit>& edits) const {
+    std::lock_guard<std::mutex> l(m_lck);
+    auto it = m_chunks.find(id);
+    if (it == m_chunks.end() || it->second.edits.empty()) return false;
+    edits = it->second.edits;
+    return true;
+}
+
+size_t ChunkEditJournal::getNumChunks() const {
+    std::lock_guard<std::mutex> l(m_lck);
+    return m_chunks.size();
+}
+
+void ChunkEditJournal::encode(const std::vector<VoxelEdit>& edits, std::vector<ui8>& data) {
+    data.clear();
+    data.push_back(CHUNK_EDITS_VERSION);
+    size_t i = 0;
+    while (i < edits.size()) {
+        size_t end = i + 1;
+        while (end < edits.size() && edits[end].blockID == edits[i].blockID &&
+               edits[end].blockIndex == edits[end - 1].blockIndex + 1) {
+            end++;
+        }
+        writeShort(data, edits[i].blockIndex);
+        writeShort(data, (ui16)(end - i));
+        writeShort(data, edits[i].blockID);
+        i = end;
+    }
+}
+
+bool ChunkEditJournal::decode(const ui8* data, size_t size, std::vector<VoxelEdit>& edits) {
+    edits.clear();
+    if (size == 0 || data[0] != CHUNK_EDITS_VERSION || (size - 1) % RUN_SIZE) return false;
+    for (size_t i = 1; i < size; i += RUN_SIZE) {
+        ui32 start = readShort(data + i);
+        ui32 length = readShort(data + i + 2);
+        BlockID blockID = readShort(data + i + 4);
+        // Runs are sorted and don't overlap
+        if (length == 0 || start + length > CHUNK_SIZE) return false;
+        if (edits.size() && start <= edits.back().blockIndex) return false;
+        for (ui32 j = start; j < start + length; j++) {
+            edits.push_back({ (ui16)j, blockID });
+        }
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+///
+/// ChunkEditJournal.h
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// Player edits of the chunks of a grid. Only these are saved, chunks
+/// are regenerated on load and the edits written back over them.
+///
+
+#pragma once
+
+#ifndef ChunkEditJournal_h__
+#define ChunkEditJournal_h__
+
+#include <condition_variable>
+
+#include "BlockData.h"
+#include "ChunkID.h"
+#include "ChunkIDMap.hpp"
+#include "VoxelCoordinateSpaces.h"
+
+class Chunk;
+class ChunkIOManager;
+
+/// Version byte that starts the saved edits of a chunk
+#define CHUNK_EDITS_VERSION 1
+/// Updates of a SphericalVoxelComponent between saves of its edits, 10 seconds at 60 updates per second
+#define CHUNK_EDITS_SAVE_INTERVAL 600
+
+struct VoxelEdit {
+    ui16 blockIndex;
+    BlockID blockID;
+};
+
+/// Latest edit of every voxel the player changed, per chunk. Generation is deterministic,
+/// so a chunk is its generated voxels with these written over them. Thread safe.
+class ChunkEditJournal {
+public:
+    /// @param io: Saves and loads the edits. If nullptr, they only live in memory.
+    void init(WorldCubeFace face, OPT ChunkIOManager* io);
+    /// Stops using the IO manager and waits for loads that are still reading from it.
+    /// Call before the IO manager is deleted, generate tasks may still be running.
+    void dispose();
+
+    /// Records an edit of a voxel, replacing any earlier one. The caller writes the voxel.
+    void record(const ChunkID& id, ui16 blockIndex, BlockID blockID);
+    /// Reads the saved edits of a chunk unless it has edits in memory already.
+    /// Call before the chunk is generated.
+    void load(const ChunkID& id);
+    /// Writes the edits of a chunk over its voxels and keeps numBlocks right.
+    /// Call again whenever generation writes over the chunk, such as flora of a neighbor.
+    /// @return true if a voxel changed
+    bool apply(Chunk* chunk) const;
+    /// Saves the chunks edited since the last save
+    /// @return Number of chunks saved
+    size_t save();
+
+    /// Gets the edits of a chunk, sorted by block index
+    /// @return false if the chunk has none
+    bool getEdits(const ChunkID& id, std::vector<VoxelEdit>& edits) const;
+    size_t getNumChunks() const;
+
+    /// Packs sorted edits into runs of consecutive voxels set to the same block
+    static void encode(const std::vector<VoxelEdit>& edits, std::vector<ui8>& data);
+    /// @return false if data isn't valid edits of one chunk
+    static bool decode(const ui8* data, size_t size, std::vector<VoxelEdit>& edits);
+private:
+    struct ChunkEdits {
+        std::vector<VoxelEdit> edits; ///< Sorted by block index
+        bool isDirty = false; ///< Edited since it was last saved
+    };
+
+    WorldCubeFace m_face = FACE_NONE;
+    ChunkIOManager* m_io = nullptr; ///< Guarded by m_lck
+    ui32 m_numLoading = 0; ///< Loads reading from m_io right now
+    std::condition_variable m_loadDone;
+
+    mutable std::mutex m_lck;
+    ChunkIDMap<ChunkEdits> m_chunks;
+};
+
+#endif // ChunkEditJournal_h__
@@ -87,6 +87,7 @@ void ChunkGenerator::update() {
             std::vector<ChunkQuery*>().swap(chunk.m_genQueryData.pending);
             // Notify listeners that this chunk is finished
             onGenFinish(q->chunk, q->genLevel);
+            onQueryFinish(q);
             q->chunk.release();
             if (q->shouldRelease) q->release();
         } else {
@@ -117,6 +118,7 @@ void ChunkGenerator::update() {
             }
             // Notify listeners that this chunk is finished
             onGenFinish(q->chunk, q->genLevel);
+            onQueryFinish(q);
             q->chunk.release();
             if (q->shouldRelease) q->release();
         }
@@ -49,6 +49,7 @@ class ChunkGenerator {
     void update();
 
     Event<ChunkHandle&, ChunkGenLevel> onGenFinish;
+    Event<ChunkQuery*> onQueryFinish; ///< Called for the query that did the generation, before it is released
 private:
     void tryFlagMeshableNeighbors(ChunkHandle& ch);
     void flagMeshbleNeighbor(ChunkHandle& n, ui32 bit);
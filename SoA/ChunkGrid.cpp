@@ -43,6 +43,7 @@ ChunkQuery* ChunkGrid::submitQuery(const i32v3& chunkPos, ChunkGenLevel genLevel
     query->shouldRelease = shouldRelease;
     query->grid = this;
     query->m_isFinished = false;
+    query->submitTime = std::chrono::steady_clock::now();
 
     ChunkID id(query->chunkPos);
     query->chunk = accessor.acquire(id);
@@ -64,7 +65,7 @@ void ChunkGrid::releaseQuery(ChunkQuery* query) {
 
 ChunkGridData* ChunkGrid::getChunkGridData(const i32v2& gridPos) {
     std::lock_guard<std::mutex> l(m_lckGridData);
-    auto it = m_chunkGridDataMap.find(gridPos);
+    auto it = m_chunkGridDataMap.find(getGridDataID(gridPos));
     if (it == m_chunkGridDataMap.end()) return nullptr;
     return it->second;
 }
@@ -104,12 +105,12 @@ void ChunkGrid::onAccessorAdd(Sender s VORB_UNUSED, ChunkHandle& chunk) {
     { // Get grid data
         std::lock_guard<std::mutex> l(m_lckGridData);
         // Check and see if the grid data is already allocated here
-        auto it = m_chunkGridDataMap.find(gridPos);
+        auto it = m_chunkGridDataMap.find(getGridDataID(gridPos));
         if (it == m_chunkGridDataMap.end()) {
             // If its not allocated, make a new one with a new voxelMapData
             // TODO(Ben): Cache this
             chunk->gridData = new ChunkGridData(chunk->getChunkPosition());
-            m_chunkGridDataMap[gridPos] = chunk->gridData;
+            m_chunkGridDataMap[getGridDataID(gridPos)] = chunk->gridData;
         } else {
             chunk->gridData = it->second;
             chunk->gridData->refCount++;
@@ -130,7 +131,7 @@ void ChunkGrid::onAccessorRemove(Sender s VORB_UNUSED, ChunkHandle& chunk) {
         std::unique_lock<std::mutex> l(m_lckGridData);
         chunk->gridData->refCount--;
         if (chunk->gridData->refCount == 0) {
-            m_chunkGridDataMap.erase(chunk->getChunkPosition());
+            m_chunkGridDataMap.erase(getGridDataID(chunk->getChunkPosition()));
             l.unlock();
             delete chunk->gridData;
             chunk->gridData = nullptr;
@@ -24,7 +24,9 @@
 #include "Chunk.h"
 #include "ChunkAllocator.h"
 #include "ChunkAccessor.h"
+#include "ChunkEditJournal.h"
 #include "ChunkHandle.h"
+#include "ChunkIDMap.hpp"
 
 #include "VoxelNodeSetter.h"
 
@@ -32,6 +34,7 @@ class BlockPack;
 
 class ChunkGrid {
     friend class ChunkMeshManager;
+    friend class ChunkResidencyManager;
 public:
     void init(WorldCubeFace face,
               OPT vcore::ThreadPool<WorkerData>* threadPool,
@@ -70,6 +73,7 @@ class ChunkGrid {
     BlockPack* blockPack = nullptr; ///< Handle to the block pack for this grid
 
     VoxelNodeSetter nodeSetter;
+    ChunkEditJournal edits; ///< Player edits, init separately since it needs the save
 
     Event<ChunkHandle&> onNeighborsAcquire;
     Event<ChunkHandle&> onNeighborsRelease;
@@ -85,9 +89,11 @@ class ChunkGrid {
     std::mutex m_lckActiveChunks;
     std::vector<ChunkHandle> m_activeChunks;
 
-    // TODO(Ben): Compare to std::map performance
+    /// Key of a 2D grid position in m_chunkGridDataMap
+    static ChunkID getGridDataID(const i32v2& gridPos) { return ChunkID(gridPos.x, 0, gridPos.y); }
+
     std::mutex m_lckGridData;
-    std::unordered_map<i32v2, ChunkGridData*> m_chunkGridDataMap; ///< 2D grid specific data
+    ChunkIDMap<ChunkGridData*> m_chunkGridDataMap; ///< 2D grid specific data, keyed by getGridDataID
     
     vcore::IDGenerator<ChunkID> m_idGenerator;
 
@@ -32,13 +32,24 @@ struct ChunkID {
         ui64 id;
     };
     operator ui64() const { return id; }
+
+    /// Mixes every bit of the packed id into every bit of the hash, so ids that
+    /// differ only in high bits still land in different power of two buckets.
+    static ui64 hash(ui64 id) {
+        // SplitMix64 finalizer
+        id ^= id >> 30;
+        id *= 0xbf58476d1ce4e5b9ull;
+        id ^= id >> 27;
+        id *= 0x94d049bb133111ebull;
+        id ^= id >> 31;
+        return id;
+    }
 };
 // Hash for ID
 template <>
 struct std::hash<ChunkID> {
     size_t operator()(const ChunkID& id) const {
-        std::hash<ui64> h;
-        return h(id.id);
+        return (size_t)ChunkID::hash(id.id);
     }
 };
 
@@ -0,0 +1,191 @@
+///
+/// ChunkIDMap.hpp
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// Flat open addressing hash map keyed by ChunkID. Lookups of
+/// neighboring chunks probe one contiguous array instead of
+/// chasing a node per bucket.
+///
+
+#pragma once
+
+#ifndef ChunkIDMap_h__
+#define ChunkIDMap_h__
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "ChunkID.h"
+
+// Start capacity, a power of two
+#define CHUNK_ID_MAP_MIN_CAPACITY 16
+
+/// Linear probing with backward shift deletion, so there are no tombstones.
+/// Inserting may move every element and erasing may move others, so neither
+/// keeps iterators or references. Not thread safe.
+template<typename V>
+class ChunkIDMap {
+public:
+    typedef std::pair<ChunkID, V> value_type;
+    typedef size_t size_type;
+
+    template<typename M, typename P>
+    class Iterator {
+        friend class ChunkIDMap;
+    public:
+        P& operator*() const { return m_map->m_slots[m_index]; }
+        P* operator->() const { return &m_map->m_slots[m_index]; }
+        Iterator& operator++() {
+            m_index = m_map->nextUsed(m_index + 1);
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator it = *this;
+            ++(*this);
+            return it;
+        }
+        bool operator==(const Iterator& other) const { return m_index == other.m_index; }
+        bool operator!=(const Iterator& other) const { return m_index != other.m_index; }
+    private:
+        Iterator(M* map, size_t index) : m_map(map), m_index(index) {}
+
+        M* m_map;
+        size_t m_index;
+    };
+    typedef Iterator<ChunkIDMap, value_type> iterator;
+    typedef Iterator<const ChunkIDMap, const value_type> const_iterator;
+
+    iterator begin() { return iterator(this, nextUsed(0)); }
+    iterator end() { return iterator(this, m_slots.size()); }
+    const_iterator begin() const { return const_iterator(this, nextUsed(0)); }
+    const_iterator end() const { return const_iterator(this, m_slots.size()); }
+
+    iterator find(const ChunkID& id) {
+        return iterator(this, findIndex(id));
+    }
+    const_iterator find(const ChunkID& id) const {
+        return const_iterator(this, findIndex(id));
+    }
+
+    /// Default constructs the value if the id is missing
+    V& operator[](const ChunkID& id) {
+        return m_slots[insertIndex(id).first].second;
+    }
+    /// @return The element with the id and false if it was already there
+    template<typename T>
+    std::pair<iterator, bool> emplace(const ChunkID& id, T&& value) {
+        auto r = insertIndex(id);
+        if (r.second) m_slots[r.first].second = std::forward<T>(value);
+        return std::make_pair(iterator(this, r.first), r.second);
+    }
+
+    void erase(const iterator& it) {
+        eraseIndex(it.m_index);
+    }
+    size_type erase(const ChunkID& id) {
+        size_t i = findIndex(id);
+        if (i == m_slots.size()) return 0;
+        eraseIndex(i);
+        return 1;
+    }
+
+    /// Grows so n elements fit without rehashing
+    void reserve(size_type n) {
+        size_t capacity = CHUNK_ID_MAP_MIN_CAPACITY;
+        while (capacity * 3 < n * 4) capacity <<= 1;
+        if (capacity > m_slots.size()) rehash(capacity);
+    }
+    void clear() {
+        for (size_t i = 0; i < m_slots.size(); i++) {
+            if (m_used[i]) m_slots[i] = value_type();
+        }
+        m_used.assign(m_used.size(), 0);
+        m_size = 0;
+    }
+    void swap(ChunkIDMap& other) {
+        m_slots.swap(other.m_slots);
+        m_used.swap(other.m_used);
+        std::swap(m_size, other.m_size);
+    }
+
+    size_type size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    /// Number of slots, a power of two
+    size_type capacity() const { return m_slots.size(); }
+private:
+    size_t getHome(const ChunkID& id) const {
+        return (size_t)ChunkID::hash(id.id) & (m_slots.size() - 1);
+    }
+
+    size_t nextUsed(size_t i) const {
+        while (i < m_slots.size() && !m_used[i]) i++;
+        return i;
+    }
+
+    /// @return Slot of the id, or capacity() if it is missing
+    size_t findIndex(const ChunkID& id) const {
+        if (!m_size) return m_slots.size();
+        size_t mask = m_slots.size() - 1;
+        for (size_t i = getHome(id); m_used[i]; i = (i + 1) & mask) {
+            if (m_slots[i].first.id == id.id) return i;
+        }
+        return m_slots.size();
+    }
+
+    /// @return Slot of the id and true if it was added
+    std::pair<size_t, bool> insertIndex(const ChunkID& id) {
+        // Load stays under 3/4 so probes stay short
+        if ((m_size + 1) * 4 > m_slots.size() * 3) {
+            rehash(std::max((size_t)CHUNK_ID_MAP_MIN_CAPACITY, m_slots.size() * 2));
+        }
+        size_t mask = m_slots.size() - 1;
+        size_t i = getHome(id);
+        for (; m_used[i]; i = (i + 1) & mask) {
+            if (m_slots[i].first.id == id.id) return std::make_pair(i, false);
+        }
+        m_used[i] = 1;
+        m_slots[i].first = id;
+        m_size++;
+        return std::make_pair(i, true);
+    }
+
+    void eraseIndex(size_t i) {
+        size_t mask = m_slots.size() - 1;
+        // Shift back later elements of the run that are not at their home slot
+        for (size_t j = (i + 1) & mask; m_used[j]; j = (j + 1) & mask) {
+            size_t home = getHome(m_slots[j].first);
+            // Only move j into the hole if its home is not between the hole and j
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                m_slots[i] = std::move(m_slots[j]);
+                i = j;
+            }
+        }
+        m_slots[i] = value_type();
+        m_used[i] = 0;
+        m_size--;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<value_type> slots(capacity);
+        std::vector<ui8> used(capacity, 0);
+        slots.swap(m_slots);
+        used.swap(m_used);
+        m_size = 0;
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (!used[i]) continue;
+            size_t j = insertIndex(slots[i].first).first;
+            m_slots[j].second = std::move(slots[i].second);
+        }
+    }
+
+    std::vector<value_type> m_slots;
+    std::vector<ui8> m_used; ///< Parallel to m_slots, since every ChunkID is a valid key
+    size_t m_size = 0;
+};
+
+#endif // ChunkIDMap_h__
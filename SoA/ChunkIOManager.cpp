@@ -21,9 +21,13 @@
 #include "GameManager.h"
 #include "SoaOptions.h"
 
+#include <Vorb/io/IOManager.h>
+
 ChunkIOManager::ChunkIOManager(const nString& saveDir) :
-    _regionFileManager(saveDir)
+    _regionFileManager(saveDir),
+    _saveDir(saveDir)
 {
+    _hasRegionDir = false;
     _isThreadFinished = 0;
     readWriteThread = NULL;
     _shouldDisableLoading = 0;
@@ -181,4 +185,62 @@ bool ChunkIOManager::saveVersionFile() {
 
 bool ChunkIOManager::checkVersion() {
     return _regionFileManager.checkVersion();
-}
\ No newline at end of file
+}
+
+bool ChunkIOManager::saveEditData(WorldCubeFace face, const ChunkID& id, const std::vector<ui8>& data) {
+    nString region;
+    ui32 chunkIndex;
+    getEditSlot(face, id, region, chunkIndex);
+
+    std::lock_guard<std::mutex> l(_regionLock);
+    if (!_hasRegionDir) {
+        vio::IOManager().makeDirectory(_saveDir);
+        vio::IOManager().makeDirectory(_saveDir + "/Region");
+        _hasRegionDir = true;
+    }
+    if (!_regionFileManager.saveChunkData(region, chunkIndex, data.data(), (ui32)data.size())) return false;
+    _regionFileManager.flush();
+
+    std::lock_guard<std::mutex> le(_editRegionLock);
+    _editRegionExists[region] = true;
+    return true;
+}
+
+bool ChunkIOManager::loadEditData(WorldCubeFace face, const ChunkID& id, std::vector<ui8>& data) {
+    nString region;
+    ui32 chunkIndex;
+    getEditSlot(face, id, region, chunkIndex);
+
+    //Most chunks of a fresh world have no edit region at all
+    {
+        std::lock_guard<std::mutex> le(_editRegionLock);
+        auto it = _editRegionExists.find(region);
+        if (it != _editRegionExists.end() && !it->second) return false;
+    }
+
+    std::lock_guard<std::mutex> l(_regionLock);
+    {
+        std::lock_guard<std::mutex> le(_editRegionLock);
+        auto it = _editRegionExists.find(region);
+        if (it == _editRegionExists.end()) {
+            //Checked once per region, opening it would flush the open one too
+            struct stat statbuf;
+            bool exists = stat((_saveDir + "/Region/" + region + ".soar").c_str(), &statbuf) == 0;
+            _editRegionExists[region] = exists;
+            if (!exists) return false;
+        } else if (!it->second) {
+            return false;
+        }
+    }
+    return _regionFileManager.loadChunkData(region, chunkIndex, data);
+}
+
+void ChunkIOManager::getEditSlot(WorldCubeFace face, const ChunkID& id, nString& region, ui32& chunkIndex) {
+    //Arithmetic shifts floor, so negative chunks land in the right region
+    i32 x = (i32)id.x;
+    i32 y = (i32)id.y;
+    i32 z = (i32)id.z;
+    region = "edits." + std::to_string((int)face) + "." + std::to_string(x >> RSHIFT) + "."
+        + std::to_string(y >> RSHIFT) + "." + std::to_string(z >> RSHIFT);
+    chunkIndex = (x & (REGION_WIDTH - 1)) + (z & (REGION_WIDTH - 1)) * REGION_WIDTH + (y & (REGION_WIDTH - 1)) * REGION_LAYER;
+}
@@ -3,7 +3,9 @@
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <unordered_map>
 
+#include "ChunkID.h"
 #include "RegionFileManager.h"
 #include "readerwriterqueue.h"
 
@@ -29,6 +31,11 @@ class ChunkIOManager{
     bool saveVersionFile();
     bool checkVersion();
 
+    //Saves the encoded player edits of a chunk, replacing any saved before. Thread safe
+    bool saveEditData(WorldCubeFace face, const ChunkID& id, const std::vector<ui8>& data);
+    //Loads the encoded player edits of a chunk. Returns false if it has none saved. Thread safe
+    bool loadEditData(WorldCubeFace face, const ChunkID& id, std::vector<ui8>& data);
+
     moodycamel::ReaderWriterQueue<Chunk* > chunksToLoad;
     moodycamel::ReaderWriterQueue<Chunk* > chunksToSave;
     std::thread* readWriteThread;
@@ -38,6 +45,17 @@ class ChunkIOManager{
 
     void readWriteChunks(); //used by the thread
 
+    //Edits of a face go to their own regions, named edits.face.x.y.z
+    static void getEditSlot(WorldCubeFace face, const ChunkID& id, nString& region, ui32& chunkIndex);
+
+    nString _saveDir;
+    //Guards _regionFileManager, which keeps a single open region and buffer
+    std::mutex _regionLock;
+    bool _hasRegionDir;
+    //Whether each edit region looked up so far has a file, so misses skip _regionLock and the disk
+    std::mutex _editRegionLock;
+    std::unordered_map<nString, bool> _editRegionExists;
+
     std::mutex _queueLock;
     std::condition_variable _cond;
 
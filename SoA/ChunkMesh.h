@@ -2,6 +2,9 @@
 #include "Vertex.h"
 #include "BlockTextureMethods.h"
 #include "ChunkHandle.h"
+#include "ChunkVertexArena.h"
+#include "ChunkVisibility.h"
+#include "Constants.h"
 #include <Vorb/io/Keg.h>
 #include <Vorb/graphics/gtypes.h>
 
@@ -49,6 +52,7 @@ class ChunkMeshRenderData {
     i32 lowestZ = INT_MAX;
     ui32 indexSize = 0;
     ui32 waterIndexSize = 0;
+    ui64 faceConnections = CHUNK_FACES_ALL_CONNECTED; ///< See ChunkVisibility
 };
 
 struct VoxelQuad {
@@ -99,6 +103,10 @@ class ChunkMeshData
     std::vector <LiquidVertex> waterVertices;
     MeshTaskType type;
 
+    //*** Quads per mesh slab, so edits can splice in remeshed slabs ***
+    ui16 opaqueSlabQuads[6][CHUNK_MESH_SLABS] = {}; ///< opaqueQuads is ordered by face, then by slab
+    ui16 cutoutSlabQuads[CHUNK_MESH_SLABS] = {};
+
     //*** Transparency info for sorting ***
     ui32 transVertIndex = 0;
     std::vector <i8v3> transQuadPositions;
@@ -106,6 +114,9 @@ class ChunkMeshData
 };
 
 #define ACTIVE_MESH_INDEX_NONE UINT_MAX
+// Full resolution, then cells of 2, 4 and 8 voxels
+#define CHUNK_MESH_LOD_LEVELS 4
+#define CHUNK_MESH_MAX_LOD_CELL_VOLUME 512
 
 class ChunkMesh
 {
@@ -135,10 +146,19 @@ class ChunkMesh
         VGVertexArray vaos[4];
     };
 
+    ui32 arenaOffset = CHUNK_VERTEX_ARENA_NONE; ///< Quad offset of the opaque quads in ChunkRenderer::vertexArena
+    ui32 arenaQuads = 0; ///< 0 when the opaque quads are in vboID instead
+
     f64 distance2 = 32.0;
     f64v3 position;
     ui32 activeMeshesIndex = ACTIVE_MESH_INDEX_NONE; ///< Index into active meshes array
     ui32 updateVersion;
+    ChunkMeshData* meshData = nullptr; ///< CPU copy of the uploaded mesh, only kept for chunks being edited
+    ChunkHandle chunk; ///< Held while the mesh exists, so it can be remeshed at another level
+    ui8 lodLevel = 0; ///< Level of the newest mesh task, see ChunkMesher::downsample
+    ui32 occlusionStamp = 0; ///< Set when ChunkOcclusionCuller reaches the mesh
+    ui32 taskSeq = 0; ///< Incremented for each mesh task
+    ui32 uploadedSeq = 0; ///< taskSeq of the uploaded mesh
     bool inFrustum = false;
     bool needsSort = true;
     ChunkID id;
@@ -0,0 +1,87 @@
+#include "stdafx.h"
+#include "ChunkMeshClassifier.h"
+
+#include "BlockPack.h"
+#include "Chunk.h"
+
+namespace {
+    // Index step along x, y and z
+    const int AXIS_STRIDES[3] = { 1, CHUNK_LAYER, CHUNK_WIDTH };
+
+    bool isOpaqueBlock(ui16 id, const BlockPack* blocks) {
+        return blocks->getMeshType(id) == MeshType::BLOCK && (blocks->getOcclusion(id) & BLOCK_OCCLUDES_ALL);
+    }
+
+    // Voxels of a face are the ones where (index / stride) % CHUNK_WIDTH == layer
+    bool intervalTouchesFace(int start, int end, int stride, int layer) {
+        int period = stride * CHUNK_WIDTH;
+        int offset = start % period;
+        int faceStart = layer * stride;
+        int first;
+        if (offset < faceStart) {
+            first = start - offset + faceStart;
+        } else if (offset < faceStart + stride) {
+            first = start;
+        } else {
+            first = start - offset + period + faceStart;
+        }
+        return first < end;
+    }
+}
+
+ChunkMeshClass ChunkMeshClassifier::classify(Chunk* chunk, Chunk* const neighbors[6], const BlockPack* blocks) {
+    bool isEmpty = true;
+    bool isSolid = true;
+    {
+        std::lock_guard<std::mutex> l(chunk->dataMutex);
+        if (chunk->blocks.getState() == vvox::VoxelStorageState::INTERVAL_TREE) {
+            auto& dataTree = chunk->blocks.getTree();
+            for (size_t i = 0; i < dataTree.size() && (isEmpty || isSolid); i++) {
+                ui16 id = dataTree[i].data;
+                if (blocks->getMeshType(id) != MeshType::NONE) isEmpty = false;
+                if (!isOpaqueBlock(id, blocks)) isSolid = false;
+            }
+        } else {
+            const ui16* data = chunk->blocks.getDataArray();
+            for (int i = 0; i < CHUNK_SIZE && (isEmpty || isSolid); i++) {
+                if (blocks->getMeshType(data[i]) != MeshType::NONE) isEmpty = false;
+                if (!isOpaqueBlock(data[i], blocks)) isSolid = false;
+            }
+        }
+    }
+    if (isEmpty) return ChunkMeshClass::EMPTY;
+    if (!isSolid) return ChunkMeshClass::MIXED;
+
+    // Solid chunks still show faces through any open voxel touching them
+    for (int face = 0; face < 6; face++) {
+        Chunk* neighbor = neighbors[face];
+        std::lock_guard<std::mutex> l(neighbor->dataMutex);
+        if (!isFaceOpaque(neighbor, face ^ 1, blocks)) return ChunkMeshClass::MIXED;
+    }
+    return ChunkMeshClass::BURIED;
+}
+
+bool ChunkMeshClassifier::isFaceOpaque(const Chunk* chunk, int face, const BlockPack* blocks) {
+    int axis = face >> 1;
+    int layer = (face & 1) ? CHUNK_WIDTH - 1 : 0;
+    int stride = AXIS_STRIDES[axis];
+
+    if (chunk->blocks.getState() == vvox::VoxelStorageState::INTERVAL_TREE) {
+        auto& dataTree = chunk->blocks.getTree();
+        for (size_t i = 0; i < dataTree.size(); i++) {
+            if (isOpaqueBlock(dataTree[i].data, blocks)) continue;
+            int start = (int)dataTree[i].getStart();
+            if (intervalTouchesFace(start, start + (int)dataTree[i].length, stride, layer)) return false;
+        }
+    } else {
+        const ui16* data = chunk->blocks.getDataArray();
+        int strideA = AXIS_STRIDES[(axis + 1) % 3];
+        int strideB = AXIS_STRIDES[(axis + 2) % 3];
+        for (int a = 0; a < CHUNK_WIDTH; a++) {
+            for (int b = 0; b < CHUNK_WIDTH; b++) {
+                if (!isOpaqueBlock(data[layer * stride + a * strideA + b * strideB], blocks)) return false;
+            }
+        }
+    }
+    return true;
+}
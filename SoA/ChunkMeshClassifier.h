@@ -0,0 +1,40 @@
+///
+/// ChunkMeshClassifier.h
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// Finds chunks whose mesh is known to be empty without meshing
+/// them, such as open air and rock enclosed by rock.
+///
+
+#pragma once
+
+#ifndef ChunkMeshClassifier_h__
+#define ChunkMeshClassifier_h__
+
+class BlockPack;
+class Chunk;
+
+enum class ChunkMeshClass {
+    EMPTY, ///< Nothing but MeshType::NONE voxels, open to every side
+    BURIED, ///< Opaque blocks only and every neighbor face touching it is opaque
+    MIXED ///< Has to be meshed
+};
+
+class ChunkMeshClassifier {
+public:
+    /// Reads the interval tree of a compressed chunk, so this is cheap for the trivial cases.
+    /// Locks the data of the chunk, then of each neighbor.
+    /// @param neighbors: Same order as Chunk::neighbors. Must be generated.
+    static ChunkMeshClass classify(Chunk* chunk, Chunk* const neighbors[6], const BlockPack* blocks);
+
+    /// @param face: Same order as Chunk::neighbors
+    /// @return True if every voxel on that face of the chunk hides whatever is behind it.
+    /// The caller must lock the chunk data.
+    static bool isFaceOpaque(const Chunk* chunk, int face, const BlockPack* blocks);
+};
+
+#endif // ChunkMeshClassifier_h__
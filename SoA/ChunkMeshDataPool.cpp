@@ -0,0 +1,76 @@
+#include "stdafx.h"
+#include "ChunkMeshDataPool.h"
+
+#include "ChunkMesh.h"
+
+namespace {
+    // Pooled data kept per bucket. The big buckets hold up to a few MB each.
+    const size_t MAX_FREE[MESH_DATA_SIZE_CLASSES] = { 256, 128, 32, 8 };
+}
+
+CALLER_DELETE ChunkMeshData* ChunkMeshDataPool::alloc(ui32 opaqueHint, ui32 cutoutHint) {
+    ChunkMeshData* meshData = nullptr;
+    // Try the matching bucket first, then bigger ones, then smaller ones
+    ui32 sizeClass = getSizeClass(opaqueHint);
+    for (ui32 i = sizeClass; i < MESH_DATA_SIZE_CLASSES && !meshData; i++) {
+        m_free[i].try_dequeue(meshData);
+    }
+    for (ui32 i = sizeClass; i > 0 && !meshData; i--) {
+        m_free[i - 1].try_dequeue(meshData);
+    }
+    if (!meshData) {
+        meshData = new ChunkMeshData(MeshTaskType::DEFAULT);
+        m_numMisses++;
+    }
+
+    // Avoids regrowing while meshing
+    meshData->opaqueQuads.reserve(opaqueHint);
+    meshData->cutoutQuads.reserve(cutoutHint);
+    return meshData;
+}
+
+void ChunkMeshDataPool::recycle(ChunkMeshData* meshData) {
+    ui32 sizeClass = getSizeClass(meshData->opaqueQuads.capacity());
+    if (m_free[sizeClass].size_approx() >= MAX_FREE[sizeClass]) {
+        delete meshData;
+        return;
+    }
+
+    meshData->chunkMeshRenderData = ChunkMeshRenderData();
+    meshData->opaqueQuads.clear();
+    meshData->transQuads.clear();
+    meshData->cutoutQuads.clear();
+    meshData->waterVertices.clear();
+    meshData->type = MeshTaskType::DEFAULT;
+    meshData->transVertIndex = 0;
+    meshData->transQuadPositions.clear();
+    meshData->transQuadIndices.clear();
+    memset(meshData->opaqueSlabQuads, 0, sizeof(meshData->opaqueSlabQuads));
+    memset(meshData->cutoutSlabQuads, 0, sizeof(meshData->cutoutSlabQuads));
+    m_free[sizeClass].enqueue(meshData);
+}
+
+void ChunkMeshDataPool::trim(size_t maxFree) {
+    for (int i = 0; i < MESH_DATA_SIZE_CLASSES; i++) {
+        ChunkMeshData* meshData;
+        while (m_free[i].size_approx() > maxFree && m_free[i].try_dequeue(meshData)) {
+            delete meshData;
+        }
+    }
+}
+
+void ChunkMeshDataPool::dispose() {
+    for (int i = 0; i < MESH_DATA_SIZE_CLASSES; i++) {
+        ChunkMeshData* meshData;
+        while (m_free[i].try_dequeue(meshData)) {
+            delete meshData;
+        }
+    }
+}
+
+ui32 ChunkMeshDataPool::getSizeClass(size_t numQuads) {
+    if (numQuads < 512) return 0;
+    if (numQuads < 2048) return 1;
+    if (numQuads < 8192) return 2;
+    return 3;
+}
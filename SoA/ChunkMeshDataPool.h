@@ -0,0 +1,55 @@
+///
+/// ChunkMeshDataPool.h
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// Recycles ChunkMeshData between mesher threads and the
+/// upload thread so quad buffers keep their capacity across
+/// remeshes instead of being reallocated every time.
+///
+
+#pragma once
+
+#ifndef ChunkMeshDataPool_h__
+#define ChunkMeshDataPool_h__
+
+#include <atomic>
+#include <Vorb/concurrentqueue.h>
+
+class ChunkMeshData;
+
+// Buckets by opaque quad capacity: < 512, < 2048, < 8192, and the rest
+#define MESH_DATA_SIZE_CLASSES 4
+// Pooled data kept per bucket after trimming for memory
+#define MESH_DATA_TRIMMED_FREE 4
+
+class ChunkMeshDataPool {
+public:
+    ~ChunkMeshDataPool() { dispose(); }
+
+    /// Gets empty mesh data, preferring buffers that already fit the hint.
+    /// Thread safe.
+    /// @param opaqueHint: Opaque quads in the chunk's previous mesh, 0 if unknown
+    /// @param cutoutHint: Cutout quads in the chunk's previous mesh
+    CALLER_DELETE ChunkMeshData* alloc(ui32 opaqueHint, ui32 cutoutHint);
+    /// Clears mesh data and keeps it for reuse, or frees it if its bucket is full.
+    /// Thread safe.
+    void recycle(ChunkMeshData* meshData);
+    /// Frees pooled data beyond maxFree per bucket. Thread safe.
+    void trim(size_t maxFree);
+    /// Frees everything in the pool
+    void dispose();
+
+    static ui32 getSizeClass(size_t numQuads);
+
+    /// Allocations that could not be served from the pool
+    ui32 getNumMisses() const { return m_numMisses; }
+private:
+    moodycamel::ConcurrentQueue<ChunkMeshData*> m_free[MESH_DATA_SIZE_CLASSES];
+    std::atomic<ui32> m_numMisses{ 0 };
+};
+
+#endif // ChunkMeshDataPool_h__
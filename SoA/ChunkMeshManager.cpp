@@ -8,7 +8,13 @@
 #include "SpaceSystemComponents.h"
 #include "soaUtils.h"
 
+#include <Vorb/utils.h>
+
 #define MAX_UPDATES_PER_FRAME 300
+#define MAX_LOD_REMESHES_PER_FRAME 64
+// Chunks have to be this much past a level boundary to cross it, both ways
+#define LOD_HYSTERESIS 1.1
+#define INDICES_PER_QUAD 6
 
 ChunkMeshManager::ChunkMeshManager(vcore::ThreadPool<WorkerData>* threadPool, BlockPack* blockPack) {
     m_threadPool = threadPool;
@@ -26,16 +32,52 @@ void ChunkMeshManager::update(const f64v3& cameraPosition, bool shouldSort) {
         }
     }
 
+    recycleFinishedTasks();
+
     // Update pending meshes
     {
         std::lock_guard<std::mutex> l(m_lckPendingMesh);
         for (auto it = m_pendingMesh.begin(); it != m_pendingMesh.end();) {
-            ChunkMeshTask* task = createMeshTask(it->second);
+            ChunkMesh* mesh = nullptr;
+            {
+                std::lock_guard<std::mutex> l(m_lckActiveChunks);
+                auto mit = m_activeChunks.find(it->first);
+                if (mit != m_activeChunks.end()) mesh = mit->second;
+            }
+            // Chunks known to have no faces skip the mesh task
+            ChunkMeshClass meshClass = classifyChunk(it->second);
+            if (meshClass != ChunkMeshClass::MIXED) {
+                it->second->dirtySlabs = 0;
+                // Buried chunks still get a mesh, so the occlusion walk knows they are closed
+                if (mesh || meshClass == ChunkMeshClass::BURIED) {
+                    if (!mesh) mesh = createMesh(it->second);
+                    mesh->updateVersion = it->second->updateVersion;
+                    updateTrivialMesh(mesh, meshClass);
+                }
+                m_numTrivialChunks++;
+                it->second.release();
+                m_pendingMesh.erase(it++);
+                continue;
+            }
+            ChunkMeshTask* task = createMeshTask(it->second, mesh);
             if (task) {
-                {
-                    std::lock_guard<std::mutex> l(m_lckActiveChunks);
-                    m_activeChunks[it->first]->updateVersion = it->second->updateVersion;
+                // First mesh for this chunk
+                if (!mesh) mesh = createMesh(it->second);
+                mesh->updateVersion = it->second->updateVersion;
+                // Edits are spliced into the last mesh when it was kept
+                task->baseMeshData = mesh->meshData;
+                mesh->meshData = nullptr;
+                task->taskSeq = ++mesh->taskSeq;
+                // Headless meshing is benchmarked, so keep its work the same
+                if (!m_isHeadless) {
+                    f64v3 closestPoint = getClosestPointOnAABB(cameraPosition, mesh->position, f64v3(CHUNK_WIDTH));
+                    mesh->lodLevel = selectLodLevel(glm::length(closestPoint - cameraPosition), m_lodDistance, mesh->lodLevel);
                 }
+                task->lodLevel = mesh->lodLevel;
+                // Only keep a CPU copy for chunks that are being edited. Coarse meshes are never spliced.
+                ui8 dirtySlabs = it->second->dirtySlabs;
+                task->keepMeshData = dirtySlabs != 0 && dirtySlabs != CHUNK_MESH_SLABS_ALL && mesh->lodLevel == 0;
+                m_runningTasks.push_back(task);
                 m_threadPool->addTask(task);
                 it->second.release();
                 m_pendingMesh.erase(it++);
@@ -47,6 +89,7 @@ void ChunkMeshManager::update(const f64v3& cameraPosition, bool shouldSort) {
 
     // TODO(Ben): This is redundant with the chunk manager! Find a way to share! (Pointer?)
     updateMeshDistances(cameraPosition);
+    updateMeshLods();
     if (shouldSort) {
         
     }
@@ -54,8 +97,18 @@ void ChunkMeshManager::update(const f64v3& cameraPosition, bool shouldSort) {
 
 void ChunkMeshManager::destroy() {
     std::vector <ChunkMesh*>().swap(m_activeChunkMeshes);
+    m_activeMeshSpheres = FrustumSpheres();
+    std::vector<ChunkMesh*>().swap(m_visibleChunkMeshes);
+    std::vector<ui32>().swap(m_visibleIndices);
     moodycamel::ConcurrentQueue<ChunkMeshUpdateMessage>().swap(m_messages);
-    std::unordered_map<ChunkID, ChunkMesh*>().swap(m_activeChunks);
+    for (auto& it : m_activeChunks) {
+        delete it.second->meshData;
+        it.second->meshData = nullptr;
+        it.second->chunk.release();
+    }
+    ChunkIDMap<ChunkMesh*>().swap(m_activeChunks);
+    recycleFinishedTasks();
+    m_meshDataPool.dispose();
 }
 
 ChunkMesh* ChunkMeshManager::createMesh(ChunkHandle& h) {
@@ -65,6 +118,10 @@ ChunkMesh* ChunkMeshManager::createMesh(ChunkHandle& h) {
         mesh = m_meshRecycler.create();
     }
     mesh->id = h.getID();
+    mesh->chunk = h.acquire();
+    mesh->lodLevel = 0;
+    // Until its first mesh says otherwise, the chunk could be open
+    mesh->renderData.faceConnections = CHUNK_FACES_ALL_CONNECTED;
 
     // Set the position
     mesh->position = h->m_voxelPosition;
@@ -73,7 +130,12 @@ ChunkMesh* ChunkMeshManager::createMesh(ChunkHandle& h) {
     memset(mesh->vbos, 0, sizeof(mesh->vbos));
     memset(mesh->vaos, 0, sizeof(mesh->vaos));
     mesh->transIndexID = 0;
+    mesh->arenaOffset = CHUNK_VERTEX_ARENA_NONE;
+    mesh->arenaQuads = 0;
     mesh->activeMeshesIndex = ACTIVE_MESH_INDEX_NONE;
+    mesh->meshData = nullptr;
+    mesh->taskSeq = 0;
+    mesh->uploadedSeq = 0;
 
     { // Register chunk as active and give it a mesh
         std::lock_guard<std::mutex> l(m_lckActiveChunks);
@@ -83,7 +145,7 @@ ChunkMesh* ChunkMeshManager::createMesh(ChunkHandle& h) {
     return mesh;
 }
 
-ChunkMeshTask* ChunkMeshManager::createMeshTask(ChunkHandle& chunk) {
+ChunkMeshTask* ChunkMeshManager::createMeshTask(ChunkHandle& chunk, const ChunkMesh* mesh) {
     ChunkHandle& left = chunk->neighbor.left;
     ChunkHandle& right = chunk->neighbor.right;
     ChunkHandle& bottom = chunk->neighbor.bottom;
@@ -100,9 +162,16 @@ ChunkMeshTask* ChunkMeshManager::createMeshTask(ChunkHandle& chunk) {
         back->genLevel != GEN_DONE || front->genLevel != GEN_DONE ||
         bottom->genLevel != GEN_DONE || top->genLevel != GEN_DONE) return nullptr;
 
-    // TODO(Ben): Recycler
-    ChunkMeshTask* meshTask = new ChunkMeshTask;
-    meshTask->init(chunk, MeshTaskType::DEFAULT, m_blockPack, this);
+    // Remeshes usually come out close to the old mesh size
+    ui32 opaqueHint = 0;
+    ui32 cutoutHint = 0;
+    if (mesh) {
+        opaqueHint = mesh->renderData.indexSize / INDICES_PER_QUAD;
+        cutoutHint = mesh->renderData.cutoutVboSize / INDICES_PER_QUAD;
+    }
+
+    ChunkMeshTask* meshTask = m_taskRecycler.create();
+    meshTask->init(chunk, MeshTaskType::DEFAULT, m_blockPack, this, opaqueHint, cutoutHint);
 
     // Set dependencies
     meshTask->neighborHandles[NEIGHBOR_HANDLE_LEFT] = left.acquire();
@@ -114,21 +183,65 @@ ChunkMeshTask* ChunkMeshManager::createMeshTask(ChunkHandle& chunk) {
     return meshTask;
 }
 
+ChunkMeshClass ChunkMeshManager::classifyChunk(ChunkHandle& chunk) {
+    Chunk* neighbors[6];
+    for (int i = 0; i < 6; i++) {
+        ChunkHandle& neighbor = chunk->neighbors[i];
+        // The mesh task waits for them
+        if (!neighbor.isAquired() || neighbor->genLevel != GEN_DONE) return ChunkMeshClass::MIXED;
+        neighbors[i] = neighbor;
+    }
+    return ChunkMeshClassifier::classify(chunk, neighbors, m_blockPack);
+}
+
+void ChunkMeshManager::updateTrivialMesh(ChunkMesh* mesh, ChunkMeshClass meshClass) {
+    ChunkMeshUpdateMessage msg;
+    msg.chunkID = mesh->id;
+    msg.submitTime = std::chrono::steady_clock::now();
+    msg.taskSeq = ++mesh->taskSeq;
+    msg.meshData = m_meshDataPool.alloc(0, 0);
+    if (meshClass == ChunkMeshClass::BURIED) msg.meshData->chunkMeshRenderData.faceConnections = 0;
+    if (mesh->meshData) {
+        m_meshDataPool.recycle(mesh->meshData);
+        mesh->meshData = nullptr;
+    }
+    // Empty mesh data frees whatever the last mesh uploaded
+    updateMesh(msg);
+}
+
+void ChunkMeshManager::recycleFinishedTasks() {
+    // The thread pool still touches a task after execute returns, so wait for it
+    // to be flagged finished rather than recycling when its message arrives
+    for (size_t i = 0; i < m_runningTasks.size();) {
+        if (m_runningTasks[i]->getIsFinished()) {
+            m_taskRecycler.recycle(m_runningTasks[i]);
+            m_runningTasks[i] = m_runningTasks.back();
+            m_runningTasks.pop_back();
+        } else {
+            i++;
+        }
+    }
+}
+
 void ChunkMeshManager::disposeMesh(ChunkMesh* mesh) {
     // De-allocate buffer objects
-    glDeleteBuffers(4, mesh->vbos);
-    glDeleteVertexArrays(4, mesh->vaos);
-    if (mesh->transIndexID) glDeleteBuffers(1, &mesh->transIndexID);
+    if (!m_isHeadless) {
+        glDeleteBuffers(4, mesh->vbos);
+        glDeleteVertexArrays(4, mesh->vaos);
+        if (mesh->transIndexID) glDeleteBuffers(1, &mesh->transIndexID);
+        if (mesh->arenaQuads) ChunkRenderer::vertexArena.free(mesh->arenaOffset, mesh->arenaQuads);
+    }
+    if (mesh->meshData) {
+        m_meshDataPool.recycle(mesh->meshData);
+        mesh->meshData = nullptr;
+    }
 
     { // Remove from mesh list
         std::lock_guard<std::mutex> l(lckActiveChunkMeshes);
-        if (mesh->activeMeshesIndex != ACTIVE_MESH_INDEX_NONE) {
-            m_activeChunkMeshes[mesh->activeMeshesIndex] = m_activeChunkMeshes.back();
-            m_activeChunkMeshes[mesh->activeMeshesIndex]->activeMeshesIndex = mesh->activeMeshesIndex;
-            m_activeChunkMeshes.pop_back();
-            mesh->activeMeshesIndex = ACTIVE_MESH_INDEX_NONE;
-        }
+        removeActiveMesh(mesh);
     }
+    // Only after removal, since updateMeshLods acquires it from the list
+    mesh->chunk.release();
     
     { // Release the mesh
         std::lock_guard<std::mutex> l(m_lckMeshRecycler);
@@ -136,18 +249,89 @@ void ChunkMeshManager::disposeMesh(ChunkMesh* mesh) {
     }
 }
 
+void ChunkMeshManager::removeActiveMesh(ChunkMesh* mesh) {
+    if (mesh->activeMeshesIndex == ACTIVE_MESH_INDEX_NONE) return;
+
+    m_activeChunkMeshes[mesh->activeMeshesIndex] = m_activeChunkMeshes.back();
+    m_activeChunkMeshes[mesh->activeMeshesIndex]->activeMeshesIndex = mesh->activeMeshesIndex;
+    m_activeChunkMeshes.pop_back();
+    m_activeMeshSpheres.swapRemove(mesh->activeMeshesIndex);
+    mesh->activeMeshesIndex = ACTIVE_MESH_INDEX_NONE;
+
+    // Later render stages must not see it. Removal is rare, so a search is fine.
+    if (mesh->inFrustum) {
+        mesh->inFrustum = false;
+        auto it = std::find(m_visibleChunkMeshes.begin(), m_visibleChunkMeshes.end(), mesh);
+        if (it != m_visibleChunkMeshes.end()) {
+            *it = m_visibleChunkMeshes.back();
+            m_visibleChunkMeshes.pop_back();
+        }
+    }
+}
+
+const std::vector<ChunkMesh*>& ChunkMeshManager::cullChunkMeshes(const Frustum& frustum, const f64v3& cameraPosition) {
+    for (auto& mesh : m_visibleChunkMeshes) mesh->inFrustum = false;
+    m_visibleChunkMeshes.clear();
+
+    m_visibleIndices.clear();
+    frustum.cullSpheres(m_activeMeshSpheres, f32v3(cameraPosition), 0, m_activeMeshSpheres.size(), m_visibleIndices);
+
+    m_numOccludedMeshes = 0;
+    if (m_useOcclusionCulling && m_visibleIndices.size()) {
+        // Only walk as far as the meshes that could be drawn
+        i32v3 minPos(fastFloor(cameraPosition.x / CHUNK_WIDTH), fastFloor(cameraPosition.y / CHUNK_WIDTH), fastFloor(cameraPosition.z / CHUNK_WIDTH));
+        i32v3 maxPos = minPos;
+        for (auto& i : m_visibleIndices) {
+            i32v3 chunkPos = i32v3(glm::floor(m_activeChunkMeshes[i]->position / (f64)CHUNK_WIDTH));
+            minPos = glm::min(minPos, chunkPos);
+            maxPos = glm::max(maxPos, chunkPos);
+        }
+        ui32 stamp = ++m_occlusionStamp;
+        {
+            std::lock_guard<std::mutex> l(m_lckActiveChunks);
+            m_occlusionCuller.markVisibleMeshes(m_activeChunks, frustum, cameraPosition, minPos, maxPos, stamp);
+        }
+        size_t numVisible = 0;
+        for (auto& i : m_visibleIndices) {
+            if (m_activeChunkMeshes[i]->occlusionStamp == stamp) m_visibleIndices[numVisible++] = i;
+        }
+        m_numOccludedMeshes = (ui32)(m_visibleIndices.size() - numVisible);
+        m_visibleIndices.resize(numVisible);
+    }
+
+    for (auto& i : m_visibleIndices) {
+        ChunkMesh* mesh = m_activeChunkMeshes[i];
+        mesh->inFrustum = true;
+        m_visibleChunkMeshes.push_back(mesh);
+    }
+    return m_visibleChunkMeshes;
+}
+
 void ChunkMeshManager::updateMesh(ChunkMeshUpdateMessage& message) {
+    onMeshUpdate(message);
+    if (m_isHeadless) {
+        m_meshDataPool.recycle(message.meshData);
+        return;
+    }
+
     ChunkMesh *mesh;
     { // Get the mesh object
         std::lock_guard<std::mutex> l(m_lckActiveChunks);
         auto it = m_activeChunks.find(message.chunkID);
         if (it == m_activeChunks.end()) {
-            delete message.meshData;
+            m_meshDataPool.recycle(message.meshData);
             return; /// The mesh was already released, so ignore!
         }
         mesh = it->second;
     }
-    
+
+    // Tasks can finish out of order, don't replace a newer mesh
+    if (message.taskSeq < mesh->uploadedSeq) {
+        m_meshDataPool.recycle(message.meshData);
+        return;
+    }
+    mesh->uploadedSeq = message.taskSeq;
+
     if (ChunkMesher::uploadMeshData(*mesh, message.meshData)) {
         // Add to active list if its not there
         std::lock_guard<std::mutex> l(lckActiveChunkMeshes);
@@ -155,20 +339,21 @@ void ChunkMeshManager::updateMesh(ChunkMeshUpdateMessage& message) {
             mesh->activeMeshesIndex = m_activeChunkMeshes.size();
             mesh->updateVersion = 0;
             m_activeChunkMeshes.push_back(mesh);
+            // Chunk centers are multiples of half a chunk, so f32 holds them exactly
+            m_activeMeshSpheres.add(f32v3(mesh->position + f64v3(CHUNK_WIDTH / 2)), CHUNK_DIAGONAL_LENGTH);
         }
     } else {
         // Remove from active list
         std::lock_guard<std::mutex> l(lckActiveChunkMeshes);
-        if (mesh->activeMeshesIndex != ACTIVE_MESH_INDEX_NONE) {
-            m_activeChunkMeshes[mesh->activeMeshesIndex] = m_activeChunkMeshes.back();
-            m_activeChunkMeshes[mesh->activeMeshesIndex]->activeMeshesIndex = mesh->activeMeshesIndex;
-            m_activeChunkMeshes.pop_back();
-            mesh->activeMeshesIndex = ACTIVE_MESH_INDEX_NONE;
-        }
+        removeActiveMesh(mesh);
     }
 
-    // TODO(Ben): come on...
-    delete message.meshData;
+    // Only the newest mesh can be spliced into
+    if (message.keepMeshData && message.taskSeq == mesh->taskSeq && !mesh->meshData) {
+        mesh->meshData = message.meshData;
+    } else {
+        m_meshDataPool.recycle(message.meshData);
+    }
 }
 
 void ChunkMeshManager::updateMeshDistances(const f64v3& cameraPosition) {
@@ -183,6 +368,93 @@ void ChunkMeshManager::updateMeshDistances(const f64v3& cameraPosition) {
     }
 }
 
+void ChunkMeshManager::updateMeshLods() {
+    {
+        std::lock_guard<std::mutex> l(lckActiveChunkMeshes);
+        for (auto& mesh : m_activeChunkMeshes) {
+            if (selectLodLevel(sqrt(mesh->distance2), m_lodDistance, mesh->lodLevel) == mesh->lodLevel) continue;
+            m_lodRemeshes.push_back(mesh->chunk.acquire());
+            if (m_lodRemeshes.size() == MAX_LOD_REMESHES_PER_FRAME) break;
+        }
+    }
+    // The level is picked again when the task is made
+    std::lock_guard<std::mutex> l(m_lckPendingMesh);
+    std::lock_guard<std::mutex> la(m_lckActiveChunks);
+    for (auto& h : m_lodRemeshes) {
+        // onNeighborsRelease may have disposed the mesh since it was listed
+        if (m_activeChunks.find(h.getID()) != m_activeChunks.end() &&
+            m_pendingMesh.find(h.getID()) == m_pendingMesh.end()) {
+            ChunkID id = h.getID();
+            m_pendingMesh[id] = std::move(h);
+        } else {
+            h.release();
+        }
+    }
+    m_lodRemeshes.clear();
+}
+
+ui8 ChunkMeshManager::selectLodLevel(f64 distance, f64 lodDistance, ui8 currentLevel) {
+    if (lodDistance <= 0.0) return 0;
+    auto levelAt = [lodDistance](f64 d) {
+        ui8 level = 0;
+        for (f64 boundary = lodDistance; level < CHUNK_MESH_LOD_LEVELS - 1 && d > boundary; boundary *= 2.0) level++;
+        return level;
+    };
+    ui8 coarser = levelAt(distance / LOD_HYSTERESIS);
+    ui8 finer = levelAt(distance * LOD_HYSTERESIS);
+    if (currentLevel < coarser) return coarser;
+    if (currentLevel > finer) return finer;
+    return currentLevel;
+}
+
+namespace {
+    size_t getMeshDataBytes(const ChunkMeshData* meshData) {
+        return meshData->opaqueQuads.capacity() * sizeof(VoxelQuad) +
+            meshData->transQuads.capacity() * sizeof(VoxelQuad) +
+            meshData->cutoutQuads.capacity() * sizeof(VoxelQuad) +
+            meshData->waterVertices.capacity() * sizeof(LiquidVertex) +
+            meshData->transQuadPositions.capacity() * sizeof(i8v3) +
+            meshData->transQuadIndices.capacity() * sizeof(ui32);
+    }
+}
+
+size_t ChunkMeshManager::getMemoryUsage() {
+    size_t bytes = 0;
+    std::lock_guard<std::mutex> l(m_lckActiveChunks);
+    for (auto& it : m_activeChunks) {
+        const ChunkMesh* mesh = it.second;
+        const ChunkMeshRenderData& renderData = mesh->renderData;
+        bytes += (renderData.indexSize + renderData.cutoutVboSize + renderData.transVboSize) / INDICES_PER_QUAD * sizeof(VoxelQuad);
+        if (mesh->meshData) bytes += sizeof(ChunkMeshData) + getMeshDataBytes(mesh->meshData);
+    }
+    return bytes;
+}
+
+size_t ChunkMeshManager::trimMeshData(size_t numBytes) {
+    m_trimmedMeshes.clear();
+    {
+        std::lock_guard<std::mutex> l(m_lckActiveChunks);
+        for (auto& it : m_activeChunks) {
+            if (it.second->meshData) m_trimmedMeshes.push_back(it.second);
+        }
+    }
+    std::sort(m_trimmedMeshes.begin(), m_trimmedMeshes.end(), [](const ChunkMesh* a, const ChunkMesh* b) {
+        return a->distance2 > b->distance2;
+    });
+
+    size_t freed = 0;
+    for (auto& mesh : m_trimmedMeshes) {
+        if (freed >= numBytes) break;
+        freed += sizeof(ChunkMeshData) + getMeshDataBytes(mesh->meshData);
+        // Freed outright, the pool would keep the buffers
+        delete mesh->meshData;
+        mesh->meshData = nullptr;
+    }
+    // Buckets refill from the meshers, keep a few so they don't all miss
+    m_meshDataPool.trim(MESH_DATA_TRIMMED_FREE);
+    return freed;
+}
+
 void ChunkMeshManager::onAddSphericalVoxelComponent(Sender s VORB_UNUSED, SphericalVoxelComponent& cmp, vecs::EntityID e VORB_UNUSED) {
     for (ui32 i = 0; i < 6; i++) {
         for (ui32 j = 0; j < cmp.chunkGrids[i].numGenerators; j++) {
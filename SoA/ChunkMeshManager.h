@@ -18,13 +18,25 @@
 
 #include "Vorb/concurrentqueue.h"
 #include "Chunk.h"
+#include "ChunkIDMap.hpp"
 #include "ChunkMesh.h"
+#include "ChunkMeshClassifier.h"
+#include "ChunkMeshDataPool.h"
+#include "ChunkMeshTask.h"
+#include "Frustum.h"
 #include "SpaceSystemAssemblages.h"
+#include <chrono>
 #include <mutex>
 
+// Distance to the first coarser mesh level, doubled for each level after it
+#define CHUNK_MESH_LOD_DISTANCE 192.0
+
 struct ChunkMeshUpdateMessage {
     ChunkID chunkID;
     ChunkMeshData* meshData = nullptr;
+    std::chrono::steady_clock::time_point submitTime; ///< When the mesh task was created
+    ui32 taskSeq = 0; ///< Lets late results of older tasks be dropped
+    bool keepMeshData = false; ///< Keep meshData on the ChunkMesh for splicing later edits
 };
 
 class ChunkMeshManager {
@@ -36,24 +48,76 @@ class ChunkMeshManager {
     void sendMessage(const ChunkMeshUpdateMessage& message) { m_messages.enqueue(message); }
     /// Destroys all meshes
     void destroy();
+    /// When headless, finished meshes are never uploaded and no GL calls are made
+    void setHeadless(bool isHeadless) { m_isHeadless = isHeadless; }
+    /// Mesh data for a mesh task to fill. It is recycled once uploaded. Thread safe
+    CALLER_DELETE ChunkMeshData* allocMeshData(ui32 opaqueHint, ui32 cutoutHint) { return m_meshDataPool.alloc(opaqueHint, cutoutHint); }
+    /// Returns mesh data to the pool. Thread safe
+    void recycleMeshData(CALLEE_DELETE ChunkMeshData* meshData) { m_meshDataPool.recycle(meshData); }
+    const ChunkMeshDataPool& getMeshDataPool() const { return m_meshDataPool; }
+    /// Distance to the first coarser mesh level. 0 meshes everything at full resolution.
+    void setLodDistance(f64 lodDistance) { m_lodDistance = lodDistance; }
+    /// Level for a chunk at distance from the camera. Only moves away from currentLevel
+    /// once the distance is well past the boundary, so chunks don't flip between levels.
+    static ui8 selectLodLevel(f64 distance, f64 lodDistance, ui8 currentLevel);
+
+    /// Called on the update thread for every finished mesh, before it is uploaded
+    Event<ChunkMeshUpdateMessage&> onMeshUpdate;
 
     // Be sure to lock lckActiveChunkMeshes
     const std::vector <ChunkMesh*>& getChunkMeshes() { return m_activeChunkMeshes; }
+    /// Frustum culls all active meshes and sets ChunkMesh::inFrustum. Meshes hidden behind
+    /// closed chunks are culled too, unless occlusion culling is off.
+    /// Be sure to lock lckActiveChunkMeshes
+    /// @param frustum: Frustum of the chunk camera, relative to cameraPosition
+    /// @return The meshes in the frustum, same as getVisibleChunkMeshes()
+    const std::vector<ChunkMesh*>& cullChunkMeshes(const Frustum& frustum, const f64v3& cameraPosition);
+    /// Result of the last cullChunkMeshes(), minus meshes removed since.
+    /// Be sure to lock lckActiveChunkMeshes
+    const std::vector<ChunkMesh*>& getVisibleChunkMeshes() { return m_visibleChunkMeshes; }
+    void setUseOcclusionCulling(bool useOcclusionCulling) { m_useOcclusionCulling = useOcclusionCulling; }
+    /// Meshes in the frustum that the last cull found hidden
+    const ui32& getNumOccludedMeshes() const { return m_numOccludedMeshes; }
+    /// Chunks that were found empty or buried and never sent to a mesh task
+    const ui32& getNumTrivialChunks() const { return m_numTrivialChunks; }
+    /// Bytes of uploaded quads and of the mesh data kept for splicing edits
+    size_t getMemoryUsage();
+    /// Frees mesh data kept for splicing edits, farthest meshes first, then empties the pool.
+    /// Edits of trimmed meshes remesh the whole chunk. Call on the update thread.
+    /// @param numBytes: Stops trimming meshes once this much is freed
+    /// @return Bytes freed, not counting the pool
+    size_t trimMeshData(size_t numBytes);
     std::mutex lckActiveChunkMeshes;
 private:
     VORB_NON_COPYABLE(ChunkMeshManager);
 
     ChunkMesh* createMesh(ChunkHandle& h);
 
-    ChunkMeshTask* createMeshTask(ChunkHandle& chunk);
+    /// MIXED until all neighbors are generated
+    ChunkMeshClass classifyChunk(ChunkHandle& chunk);
+    /// Replaces the mesh of an empty or buried chunk without meshing it
+    void updateTrivialMesh(ChunkMesh* mesh, ChunkMeshClass meshClass);
+
+    /// @param mesh: The chunk's current mesh, used to size the new mesh data
+    ChunkMeshTask* createMeshTask(ChunkHandle& chunk, const ChunkMesh* mesh);
+
+    /// Recycles tasks the thread pool is done with
+    void recycleFinishedTasks();
 
     void disposeMesh(ChunkMesh* mesh);
 
+    /// Swap removes a mesh from the active and visible lists.
+    /// Be sure to lock lckActiveChunkMeshes
+    void removeActiveMesh(ChunkMesh* mesh);
+
     /// Uploads a mesh and adds to list if needed
     void updateMesh(ChunkMeshUpdateMessage& message);
 
     void updateMeshDistances(const f64v3& cameraPosition);
 
+    /// Queues remeshes of meshes whose level no longer fits their distance
+    void updateMeshLods();
+
     /************************************************************************/
     /* Event Handlers                                                       */
     /************************************************************************/
@@ -68,18 +132,33 @@ class ChunkMeshManager {
     /* Members                                                              */
     /************************************************************************/
     std::vector<ChunkMesh*> m_activeChunkMeshes; ///< Meshes that should be drawn
+    FrustumSpheres m_activeMeshSpheres; ///< Bounding spheres, parallel to m_activeChunkMeshes
+    std::vector<ChunkMesh*> m_visibleChunkMeshes; ///< Active meshes that passed the last cull
+    std::vector<ui32> m_visibleIndices; ///< Scratch space for culling
+    ChunkOcclusionCuller m_occlusionCuller;
+    bool m_useOcclusionCulling = true;
+    ui32 m_occlusionStamp = 0;
+    ui32 m_numOccludedMeshes = 0;
+    ui32 m_numTrivialChunks = 0;
     moodycamel::ConcurrentQueue<ChunkMeshUpdateMessage> m_messages; ///< Lock-free queue of messages
    
     BlockPack* m_blockPack = nullptr;
     vcore::ThreadPool<WorkerData>* m_threadPool = nullptr;
+    bool m_isHeadless = false;
+    f64 m_lodDistance = CHUNK_MESH_LOD_DISTANCE;
+    std::vector<ChunkHandle> m_lodRemeshes; ///< Scratch space for updateMeshLods
+    std::vector<ChunkMesh*> m_trimmedMeshes; ///< Scratch space for trimMeshData
 
     std::mutex m_lckPendingMesh;
     std::map<ChunkID, ChunkHandle> m_pendingMesh;
 
     std::mutex m_lckMeshRecycler;
     PtrRecycler<ChunkMesh> m_meshRecycler;
+    PtrRecycler<ChunkMeshTask> m_taskRecycler; ///< Only touched on the update thread
+    std::vector<ChunkMeshTask*> m_runningTasks; ///< Handed to the thread pool and not recycled yet
+    ChunkMeshDataPool m_meshDataPool;
     std::mutex m_lckActiveChunks;
-    std::unordered_map<ChunkID, ChunkMesh*> m_activeChunks; ///< Stores chunk IDs that have meshes
+    ChunkIDMap<ChunkMesh*> m_activeChunks; ///< Stores chunk IDs that have meshes
 };
 
 #endif // ChunkMeshManager_h__
@@ -29,22 +29,40 @@ void ChunkMeshTask::execute(WorkerData* workerData) {
     // Prepare message
     ChunkMeshUpdateMessage msg;
     msg.chunkID = chunk.getID();
+    msg.submitTime = submitTime;
+    msg.taskSeq = taskSeq;
+    msg.keepMeshData = keepMeshData;
 
     // Pre-processing
     workerData->chunkMesher->prepareDataAsync(chunk, neighborHandles);
+    workerData->chunkMesher->downsample(lodLevel);
 
     // Create the actual mesh
-    msg.meshData = workerData->chunkMesher->createChunkMeshData(type);
+    msg.meshData = workerData->chunkMesher->createChunkMeshData(type, meshManager->allocMeshData(opaqueHint, cutoutHint), baseMeshData);
+    if (baseMeshData) {
+        meshManager->recycleMeshData(baseMeshData);
+        baseMeshData = nullptr;
+    }
 
     // Send it for update
     meshManager->sendMessage(msg);
 }
 
-void ChunkMeshTask::init(ChunkHandle& ch, MeshTaskType cType, const BlockPack* blockPack, ChunkMeshManager* meshManager) {
+void ChunkMeshTask::init(ChunkHandle& ch, MeshTaskType cType, const BlockPack* blockPack, ChunkMeshManager* meshManager,
+                         ui32 opaqueHint /*= 0*/, ui32 cutoutHint /*= 0*/) {
     type = cType;
+    submitTime = std::chrono::steady_clock::now();
     chunk = ch.acquire();
     this->blockPack = blockPack;
     this->meshManager = meshManager;
+    this->opaqueHint = opaqueHint;
+    this->cutoutHint = cutoutHint;
+    baseMeshData = nullptr;
+    taskSeq = 0;
+    keepMeshData = false;
+    lodLevel = 0;
+    // Recycled tasks still have the flag from their last run
+    setIsFinished(false);
 }
 
 // TODO(Ben): uhh
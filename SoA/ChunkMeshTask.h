@@ -15,6 +15,7 @@
 #ifndef RenderTask_h__
 #define RenderTask_h__
 
+#include <chrono>
 #include <Vorb/IThreadPoolTask.h>
 
 #include "ChunkHandle.h"
@@ -52,13 +53,22 @@ class ChunkMeshTask : public vcore::IThreadPoolTask<WorkerData> {
     void execute(WorkerData* workerData) override;
 
     // Initializes the task
-    void init(ChunkHandle& ch, MeshTaskType cType, const BlockPack* blockPack, ChunkMeshManager* meshManager);
+    // @param opaqueHint, cutoutHint: Quad counts of the chunk's previous mesh, to size the mesh data
+    void init(ChunkHandle& ch, MeshTaskType cType, const BlockPack* blockPack, ChunkMeshManager* meshManager,
+              ui32 opaqueHint = 0, ui32 cutoutHint = 0);
 
     MeshTaskType type; 
+    std::chrono::steady_clock::time_point submitTime; ///< For latency stats
     ChunkHandle chunk;
     ChunkMeshManager* meshManager = nullptr;
     const BlockPack* blockPack = nullptr;
     ChunkHandle neighborHandles[NUM_NEIGHBOR_HANDLES];
+    ui32 opaqueHint = 0;
+    ui32 cutoutHint = 0;
+    ChunkMeshData* baseMeshData = nullptr; ///< Previous mesh to splice into, recycled after meshing
+    ui32 taskSeq = 0; ///< ChunkMesh::taskSeq for this task
+    bool keepMeshData = false; ///< Ask the manager to keep the CPU copy for the next edit
+    ui8 lodLevel = 0; ///< See ChunkMesher::downsample
 private:
     void updateLight(VoxelLightEngine* voxelLightEngine);
 };
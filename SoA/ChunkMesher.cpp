@@ -1,9 +1,6 @@
 #include "stdafx.h"
 #include "ChunkMesher.h"
 
-#include <random>
-
-
 #include "Biome.h"
 #include "BlockData.h"
 
@@ -37,7 +34,8 @@ const int PADDED_WIDTH_M1 = PADDED_WIDTH - 1;
 
 #define QUAD_SIZE 7
 
-//#define USE_AO
+// Color scale for each ambient occlusion level, out of 256
+const ui16 AO_SCALE[4] = { 256, 204, 160, 120 };
 
 // Base texture index
 #define B_INDEX 0
@@ -83,6 +81,24 @@ void ChunkMesher::init(const BlockPack* blocks) {
 
     m_textureMethodParams[Z_POS][B_INDEX].init(this, 1, PADDED_CHUNK_LAYER, PADDED_CHUNK_WIDTH, Z_POS, B_INDEX);
     m_textureMethodParams[Z_POS][O_INDEX].init(this, 1, PADDED_CHUNK_LAYER, PADDED_CHUNK_WIDTH, Z_POS, O_INDEX);
+
+    // Set up the ambient occlusion neighborhoods. Each vertex is shaded by the voxels
+    // that touch its corner in the layer in front of the face.
+    const int AXIS_STRIDES[3] = { 1, PADDED_CHUNK_LAYER, PADDED_CHUNK_WIDTH };
+    for (int face = 0; face < 6; face++) {
+        int normalAxis = face / 2;
+        int upOffset = (face & 1) ? AXIS_STRIDES[normalAxis] : -AXIS_STRIDES[normalAxis];
+        int axisA = (normalAxis + 1) % 3;
+        int axisB = (normalAxis + 2) % 3;
+        for (int i = 0; i < 4; i++) {
+            const ui8v3& corner = VoxelMesher::VOXEL_POSITIONS[face][i];
+            int offsetA = corner[axisA] ? AXIS_STRIDES[axisA] : -AXIS_STRIDES[axisA];
+            int offsetB = corner[axisB] ? AXIS_STRIDES[axisB] : -AXIS_STRIDES[axisB];
+            m_aoOffsets[face][i][0] = upOffset + offsetA;
+            m_aoOffsets[face][i][1] = upOffset + offsetB;
+            m_aoOffsets[face][i][2] = upOffset + offsetA + offsetB;
+        }
+    }
 }
 
 void ChunkMesher::prepareData(const Chunk* chunk) {
@@ -101,6 +117,9 @@ void ChunkMesher::prepareData(const Chunk* chunk) {
 
     wSize = 0;
     chunkVoxelPos = chunk->getVoxelPosition();
+    // The chunk is const, so it is left to the caller to clear the flags
+    m_rebuildSlabs = chunk->dirtySlabs;
+    m_lodLevel = 0;
     if (chunk->gridData) {
         m_chunkHeightData = chunk->gridData->heightData;
     } else {
@@ -126,7 +145,7 @@ void ChunkMesher::prepareData(const Chunk* chunk) {
 
                 wc = (pos.y + 1)*PADDED_LAYER + (pos.z + 1)*PADDED_WIDTH + (pos.x + 1);
                 blockData[wc] = dataTree[i].data;
-                if (GETBLOCK(blockData[wc]).meshType == MeshType::LIQUID) {
+                if (blocks->getMeshType(blockData[wc]) == MeshType::LIQUID) {
                     m_wvec[s++] = wc;
                 }
 
@@ -140,7 +159,7 @@ void ChunkMesher::prepareData(const Chunk* chunk) {
                 for (x = 0; x < CHUNK_WIDTH; x++, c++) {
                     wc = (y + 1)*PADDED_LAYER + (z + 1)*PADDED_WIDTH + (x + 1);
                     blockData[wc] = chunk->blocks[c];
-                    if (GETBLOCK(blockData[wc]).meshType == MeshType::LIQUID) {
+                    if (blocks->getMeshType(blockData[wc]) == MeshType::LIQUID) {
                         m_wvec[s++] = wc;
                     }
                 }
@@ -246,6 +265,10 @@ void ChunkMesher::prepareData(const Chunk* chunk) {
             }
         }
     }
+
+    buildOccluders();
+    // From the full resolution voxels, before any downsample
+    m_faceConnections = m_visibility.computeConnections(m_occluders);
 }
 
 #define GET_EDGE_X(ch, sy, sz, dy, dz) \
@@ -316,6 +339,9 @@ void ChunkMesher::prepareDataAsync(ChunkHandle& chunk, ChunkHandle neighbors[NUM
     // TODO(Ben): Dude macro this or something.
     { // Main chunk
         std::lock_guard<std::mutex> l(chunk->dataMutex);
+        // Edits made after this point flag the slabs again for the next mesh
+        m_rebuildSlabs = chunk->dirtySlabs.exchange(0);
+        m_lodLevel = 0;
         if (chunk->blocks.getState() == vvox::VoxelStorageState::INTERVAL_TREE) {
 
             int s = 0;
@@ -329,7 +355,7 @@ void ChunkMesher::prepareDataAsync(ChunkHandle& chunk, ChunkHandle neighbors[NUM
 
                     wc = (pos.y + 1)*PADDED_LAYER + (pos.z + 1)*PADDED_WIDTH + (pos.x + 1);
                     blockData[wc] = dataTree[i].data;
-                    if (GETBLOCK(blockData[wc]).meshType == MeshType::LIQUID) {
+                    if (blocks->getMeshType(blockData[wc]) == MeshType::LIQUID) {
                         m_wvec[s++] = wc;
                     }
                 }
@@ -342,7 +368,7 @@ void ChunkMesher::prepareDataAsync(ChunkHandle& chunk, ChunkHandle neighbors[NUM
                     for (x = 0; x < CHUNK_WIDTH; x++, c++) {
                         wc = (y + 1)*PADDED_LAYER + (z + 1)*PADDED_WIDTH + (x + 1);
                         blockData[wc] = chunk->blocks[c];
-                        if (GETBLOCK(blockData[wc]).meshType == MeshType::LIQUID) {
+                        if (blocks->getMeshType(blockData[wc]) == MeshType::LIQUID) {
                             m_wvec[s++] = wc;
                         }
                     }
@@ -541,9 +567,87 @@ void ChunkMesher::prepareDataAsync(ChunkHandle& chunk, ChunkHandle neighbors[NUM
         blockData[destIndex] = blockData[srcIndex];
         tertiaryData[destIndex] = tertiaryData[srcIndex];
     }
+
+    buildOccluders();
+    // From the full resolution voxels, before any downsample
+    m_faceConnections = m_visibility.computeConnections(m_occluders);
+}
+
+void ChunkMesher::buildOccluders() {
+    // One table lookup per voxel here saves several per face vertex later
+    memset(m_occluders, 0, sizeof(m_occluders));
+    for (int i = 0; i < PADDED_SIZE; i++) {
+        if (blocks->getOcclusion(blockData[i]) & BLOCK_OCCLUDES_ALL) {
+            m_occluders[i >> 6] |= 1ull << (i & 63);
+        }
+    }
+}
+
+void ChunkMesher::downsample(ui32 lodLevel) {
+    m_lodLevel = lodLevel;
+    if (lodLevel == 0) return;
+    // Coarse meshes are never spliced
+    m_rebuildSlabs = CHUNK_MESH_SLABS_ALL;
+    wSize = 0;
+
+    const int cellWidth = 1 << lodLevel;
+    const int cellVolume = cellWidth * cellWidth * cellWidth;
+    ui16 ids[CHUNK_MESH_MAX_LOD_CELL_VOLUME];
+    ui16 tertiaries[CHUNK_MESH_MAX_LOD_CELL_VOLUME];
+    ui32 weights[CHUNK_MESH_MAX_LOD_CELL_VOLUME];
+    for (int cy = 1; cy <= CHUNK_WIDTH; cy += cellWidth) {
+        for (int cz = 1; cz <= CHUNK_WIDTH; cz += cellWidth) {
+            for (int cx = 1; cx <= CHUNK_WIDTH; cx += cellWidth) {
+                // Weigh the solid blocks of the cell
+                int numIds = 0;
+                for (int y = cy; y < cy + cellWidth; y++) {
+                    for (int z = cz; z < cz + cellWidth; z++) {
+                        for (int x = cx; x < cx + cellWidth; x++) {
+                            int i = y * PADDED_LAYER + z * PADDED_WIDTH + x;
+                            ui16 id = blockData[i];
+                            if (blocks->getMeshType(id) != MeshType::BLOCK) continue;
+                            // Blocks under open space are the ones seen from afar, like grass over dirt
+                            ui32 weight = (blocks->getMeshType(blockData[i + PADDED_LAYER]) != MeshType::BLOCK) ? cellVolume : 1;
+                            int j = 0;
+                            while (j < numIds && ids[j] != id) j++;
+                            if (j == numIds) {
+                                ids[numIds++] = id;
+                                tertiaries[j] = tertiaryData[i];
+                                weights[j] = 0;
+                            }
+                            weights[j] += weight;
+                        }
+                    }
+                }
+                ui16 cellID = 0;
+                ui16 cellTertiary = 0;
+                ui32 bestWeight = 0;
+                for (int j = 0; j < numIds; j++) {
+                    if (weights[j] > bestWeight) {
+                        bestWeight = weights[j];
+                        cellID = ids[j];
+                        cellTertiary = tertiaries[j];
+                    }
+                }
+
+                // Fill the cell
+                for (int y = cy; y < cy + cellWidth; y++) {
+                    for (int z = cz; z < cz + cellWidth; z++) {
+                        int i = y * PADDED_LAYER + z * PADDED_WIDTH + cx;
+                        for (int x = 0; x < cellWidth; x++) {
+                            blockData[i + x] = cellID;
+                            tertiaryData[i + x] = cellTertiary;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    buildOccluders();
 }
 
-CALLER_DELETE ChunkMeshData* ChunkMesher::createChunkMeshData(MeshTaskType type VORB_UNUSED) {
+CALLER_DELETE ChunkMeshData* ChunkMesher::createChunkMeshData(MeshTaskType type VORB_UNUSED, OPT ChunkMeshData* meshData /*= nullptr*/, OPT const ChunkMeshData* baseData /*= nullptr*/) {
     m_numQuads = 0;
     m_highestY = 0;
     m_lowestY = 256;
@@ -552,76 +656,167 @@ CALLER_DELETE ChunkMeshData* ChunkMesher::createChunkMeshData(MeshTaskType type
     m_highestZ = 0;
     m_lowestZ = 256;
 
+    // Only splice into meshes this mesher could have made. 0 means the changes are unknown.
+    ui8 rebuildSlabs = m_rebuildSlabs;
+    if (!baseData || baseData->type != MeshTaskType::DEFAULT ||
+        baseData->transQuads.size() || baseData->waterVertices.size() || rebuildSlabs == 0) {
+        rebuildSlabs = CHUNK_MESH_SLABS_ALL;
+    }
+    bool isSplice = rebuildSlabs != CHUNK_MESH_SLABS_ALL;
+
     // Clear quad indices
     memset(m_quadIndices, 0xFF, sizeof(m_quadIndices));
 
     for (int i = 0; i < 6; i++) {
         m_quads[i].clear();
     }
+    m_floraQuads.clear();
 
     // TODO(Ben): Here?
     _waterVboVerts.clear();
 
     // Stores the data for a chunk mesh
-    // TODO(Ben): new is bad mkay
-    m_chunkMeshData = new ChunkMeshData(MeshTaskType::DEFAULT);
+    m_chunkMeshData = meshData ? meshData : new ChunkMeshData(MeshTaskType::DEFAULT);
+
+    // Downsampled cells are uniform, so their first voxel stands for all of them.
+    // Slabs are as tall as the biggest cell, so cells never cross one.
+    const int cellWidth = 1 << m_lodLevel;
 
     // Loop through blocks
-    for (by = 0; by < CHUNK_WIDTH; by++) {
-        for (bz = 0; bz < CHUNK_WIDTH; bz++) {
-            for (bx = 0; bx < CHUNK_WIDTH; bx++) {
-                // Get data for this voxel
-                // TODO(Ben): Could optimize out -1
-                blockIndex = (by + 1) * PADDED_CHUNK_LAYER + (bz + 1) * PADDED_CHUNK_WIDTH + (bx + 1);
-                blockID = blockData[blockIndex];
-                if (blockID == 0) continue; // Skip air blocks
-                heightData = &m_chunkHeightData[bz * CHUNK_WIDTH + bx];
-                block = &blocks->operator[](blockID);
-                // TODO(Ben) Don't think bx needs to be member
-                voxelPosOffset = ui8v3(bx * QUAD_SIZE, by * QUAD_SIZE, bz * QUAD_SIZE);
-
-                switch (block->meshType) {
-                    case MeshType::BLOCK:
-                        addBlock();
-                        break;
-                    case MeshType::LEAVES:
-                    case MeshType::CROSSFLORA:
-                    case MeshType::TRIANGLE:
-                        addFlora();
-                        break;
-                    default:
-                        //No mesh, do nothing
-                        break;
+    for (int slab = 0; slab < CHUNK_MESH_SLABS; slab++) {
+        for (int i = 0; i < 6; i++) {
+            m_slabQuadStarts[i][slab] = m_quads[i].size();
+        }
+        m_slabFloraStarts[slab] = m_floraQuads.size();
+        if (!(rebuildSlabs & (1 << slab))) continue;
+
+        int slabEnd = (slab + 1) * CHUNK_MESH_SLAB_HEIGHT;
+        for (by = slab * CHUNK_MESH_SLAB_HEIGHT; by < slabEnd; by += cellWidth) {
+            for (bz = 0; bz < CHUNK_WIDTH; bz += cellWidth) {
+                for (bx = 0; bx < CHUNK_WIDTH; bx += cellWidth) {
+                    // Get data for this voxel
+                    // TODO(Ben): Could optimize out -1
+                    blockIndex = (by + 1) * PADDED_CHUNK_LAYER + (bz + 1) * PADDED_CHUNK_WIDTH + (bx + 1);
+                    blockID = blockData[blockIndex];
+                    if (blockID == 0) continue; // Skip air blocks
+                    heightData = &m_chunkHeightData[bz * CHUNK_WIDTH + bx];
+                    // Only the address, the Block itself is rarely touched
+                    block = &blocks->operator[](blockID);
+                    faceTextures = &blocks->getFaceTextures(blockID);
+                    // TODO(Ben) Don't think bx needs to be member
+                    voxelPosOffset = ui8v3(bx * QUAD_SIZE, by * QUAD_SIZE, bz * QUAD_SIZE);
+
+                    switch (blocks->getMeshType(blockID)) {
+                        case MeshType::BLOCK:
+                            if (cellWidth > 1) {
+                                addCoarseBlock(cellWidth);
+                            } else {
+                                addBlock();
+                            }
+                            break;
+                        case MeshType::LEAVES:
+                        case MeshType::CROSSFLORA:
+                        case MeshType::TRIANGLE:
+                            addFlora();
+                            break;
+                        default:
+                            //No mesh, do nothing
+                            break;
+                    }
                 }
             }
         }
     }
+    // Liquid is remeshed whole, it changes every few ticks anyway
+    for (int i = 0; i < wSize; i++) {
+        addLiquid(m_wvec[i]);
+    }
+    for (int i = 0; i < 6; i++) {
+        m_slabQuadStarts[i][CHUNK_MESH_SLABS] = m_quads[i].size();
+    }
+    m_slabFloraStarts[CHUNK_MESH_SLABS] = m_floraQuads.size();
 
     ChunkMeshRenderData& renderData = m_chunkMeshData->chunkMeshRenderData;
 
     // Get quad buffer to fill
     std::vector<VoxelQuad>& finalQuads = m_chunkMeshData->opaqueQuads;
 
-    finalQuads.resize(m_numQuads);
-    // Copy the data
+    ui32 numQuads = m_numQuads;
+    if (isSplice) {
+        for (int i = 0; i < 6; i++) {
+            for (int slab = 0; slab < CHUNK_MESH_SLABS; slab++) {
+                if (!(rebuildSlabs & (1 << slab))) numQuads += baseData->opaqueSlabQuads[i][slab];
+            }
+        }
+    }
+    finalQuads.resize(numQuads);
+    // Copy the data, taking unchanged slabs from the base mesh
     // TODO(Ben): Could construct in place and not need ANY copying with 6 iterations?
     i32 index = 0;
+    i32 baseIndex = 0;
     i32 sizes[6];
     for (int i = 0; i < 6; i++) {
         std::vector<VoxelQuad>& quads = m_quads[i];
         int tmp = index;
-        for (size_t j = 0; j < quads.size(); j++) {
-            VoxelQuad& q = quads[j];
-            if (q.v.v0.mesherFlags & MESH_FLAG_ACTIVE) {
-                finalQuads[index++] = q;
+        for (int slab = 0; slab < CHUNK_MESH_SLABS; slab++) {
+            int slabStart = index;
+            if (rebuildSlabs & (1 << slab)) {
+                for (ui32 j = m_slabQuadStarts[i][slab]; j < m_slabQuadStarts[i][slab + 1]; j++) {
+                    VoxelQuad& q = quads[j];
+                    if (q.v.v0.mesherFlags & MESH_FLAG_ACTIVE) {
+                        finalQuads[index++] = q;
+                    }
+                }
+            } else {
+                ui16 count = baseData->opaqueSlabQuads[i][slab];
+                for (ui16 j = 0; j < count; j++) {
+                    finalQuads[index++] = baseData->opaqueQuads[baseIndex + j];
+                }
             }
+            if (isSplice) baseIndex += baseData->opaqueSlabQuads[i][slab];
+            m_chunkMeshData->opaqueSlabQuads[i][slab] = (ui16)(index - slabStart);
         }
         sizes[i] = index - tmp;
     }
 
-    // Swap flora quads
-    renderData.cutoutVboSize = m_floraQuads.size() * INDICES_PER_QUAD;
-    m_chunkMeshData->cutoutQuads.swap(m_floraQuads);
+    if (isSplice) {
+        // Flora quads are spliced the same way
+        std::vector<VoxelQuad>& cutoutQuads = m_chunkMeshData->cutoutQuads;
+        cutoutQuads.clear();
+        baseIndex = 0;
+        for (int slab = 0; slab < CHUNK_MESH_SLABS; slab++) {
+            size_t slabStart = cutoutQuads.size();
+            ui16 baseCount = baseData->cutoutSlabQuads[slab];
+            if (rebuildSlabs & (1 << slab)) {
+                cutoutQuads.insert(cutoutQuads.end(), m_floraQuads.begin() + m_slabFloraStarts[slab], m_floraQuads.begin() + m_slabFloraStarts[slab + 1]);
+            } else {
+                cutoutQuads.insert(cutoutQuads.end(), baseData->cutoutQuads.begin() + baseIndex, baseData->cutoutQuads.begin() + baseIndex + baseCount);
+            }
+            baseIndex += baseCount;
+            m_chunkMeshData->cutoutSlabQuads[slab] = (ui16)(cutoutQuads.size() - slabStart);
+        }
+        renderData.cutoutVboSize = cutoutQuads.size() * INDICES_PER_QUAD;
+
+        // Bounds of the copied slabs are not stored, so take them from every quad
+        for (auto& quads : { &finalQuads, &cutoutQuads }) {
+            for (auto& q : *quads) {
+                const ui8v3& p = q.v.v0.position;
+                if (p.x < m_lowestX) m_lowestX = p.x;
+                if (p.x > m_highestX) m_highestX = p.x;
+                if (p.y < m_lowestY) m_lowestY = p.y;
+                if (p.y > m_highestY) m_highestY = p.y;
+                if (p.z < m_lowestZ) m_lowestZ = p.z;
+                if (p.z > m_highestZ) m_highestZ = p.z;
+            }
+        }
+    } else {
+        for (int slab = 0; slab < CHUNK_MESH_SLABS; slab++) {
+            m_chunkMeshData->cutoutSlabQuads[slab] = (ui16)(m_slabFloraStarts[slab + 1] - m_slabFloraStarts[slab]);
+        }
+        // Swap flora quads
+        renderData.cutoutVboSize = m_floraQuads.size() * INDICES_PER_QUAD;
+        m_chunkMeshData->cutoutQuads.swap(m_floraQuads);
+    }
 
     m_highestY /= QUAD_SIZE;
     m_lowestY /= QUAD_SIZE;
@@ -655,6 +850,10 @@ CALLER_DELETE ChunkMeshData* ChunkMesher::createChunkMeshData(MeshTaskType type
         renderData.highestZ = m_highestZ;
         renderData.lowestZ = m_lowestZ;
     }
+    renderData.faceConnections = m_faceConnections;
+
+    renderData.waterIndexSize = (_waterVboVerts.size() / 4) * INDICES_PER_QUAD;
+    m_chunkMeshData->waterVertices.swap(_waterVboVerts);
 
     return m_chunkMeshData;
 }
@@ -687,12 +886,33 @@ bool ChunkMesher::uploadMeshData(ChunkMesh& mesh, ChunkMeshData* meshData) {
     switch (meshData->type) {
         case MeshTaskType::DEFAULT:
             if (meshData->opaqueQuads.size()) {
-
-                mapBufferData(mesh.vboID, meshData->opaqueQuads.size() * sizeof(VoxelQuad), &(meshData->opaqueQuads[0]), GL_STATIC_DRAW);
+                ui32 numQuads = (ui32)meshData->opaqueQuads.size();
+                // Opaque quads go in the shared arena so they can be multi drawn
+                if (mesh.arenaQuads != numQuads) {
+                    if (mesh.arenaQuads) ChunkRenderer::vertexArena.free(mesh.arenaOffset, mesh.arenaQuads);
+                    mesh.arenaOffset = ChunkRenderer::vertexArena.allocate(numQuads);
+                    mesh.arenaQuads = (mesh.arenaOffset == CHUNK_VERTEX_ARENA_NONE) ? 0 : numQuads;
+                }
+                if (mesh.arenaQuads) {
+                    ChunkRenderer::vertexArena.write(mesh.arenaOffset, &(meshData->opaqueQuads[0]), numQuads);
+                    if (mesh.vboID != 0) {
+                        glDeleteBuffers(1, &(mesh.vboID));
+                        mesh.vboID = 0;
+                    }
+                } else {
+                    // Arena is full, fall back to a buffer of its own
+                    mapBufferData(mesh.vboID, meshData->opaqueQuads.size() * sizeof(VoxelQuad), &(meshData->opaqueQuads[0]), GL_STATIC_DRAW);
+                }
                 canRender = true;
 
-                if (!mesh.vaoID) buildVao(mesh);
+                // The quads may have moved, so always point the vao at them
+                buildVao(mesh);
             } else {
+                if (mesh.arenaQuads) {
+                    ChunkRenderer::vertexArena.free(mesh.arenaOffset, mesh.arenaQuads);
+                    mesh.arenaOffset = CHUNK_VERTEX_ARENA_NONE;
+                    mesh.arenaQuads = 0;
+                }
                 if (mesh.vboID != 0) {
                     glDeleteBuffers(1, &(mesh.vboID));
                     mesh.vboID = 0;
@@ -771,6 +991,9 @@ bool ChunkMesher::uploadMeshData(ChunkMesh& mesh, ChunkMeshData* meshData) {
 
 void ChunkMesher::freeChunkMesh(CALLEE_DELETE ChunkMesh* mesh) {
     // Opaque
+    if (mesh->arenaQuads) {
+        ChunkRenderer::vertexArena.free(mesh->arenaOffset, mesh->arenaQuads);
+    }
     if (mesh->vboID != 0) {
         glDeleteBuffers(1, &mesh->vboID);
     }
@@ -858,77 +1081,107 @@ void ChunkMesher::freeBuffers() {
 void ChunkMesher::addBlock()
 {
     // Ambient occlusion buffer for vertices
-    f32 ao[4];
+    ui8 ao[4];
 
     // Check the faces
     // Left
     if (shouldRenderFace(-1)) {
-        computeAmbientOcclusion(-1, -PADDED_CHUNK_LAYER, PADDED_CHUNK_WIDTH, ao);
+        computeAmbientOcclusion(X_NEG, ao);
         addQuad(X_NEG, (int)vvox::Axis::Z, (int)vvox::Axis::Y, -PADDED_CHUNK_WIDTH, -PADDED_CHUNK_LAYER, 2, ui8v2(1, 1), ao);
     }
     // Right
     if (shouldRenderFace(1)) {
-        computeAmbientOcclusion(1, -PADDED_CHUNK_LAYER, -PADDED_CHUNK_WIDTH, ao);
+        computeAmbientOcclusion(X_POS, ao);
         addQuad(X_POS, (int)vvox::Axis::Z, (int)vvox::Axis::Y, -PADDED_CHUNK_WIDTH, -PADDED_CHUNK_LAYER, 0, ui8v2(-1, 1), ao);
     }
     // Bottom
     if (shouldRenderFace(-PADDED_CHUNK_LAYER)) { 
-        computeAmbientOcclusion(-PADDED_CHUNK_LAYER, PADDED_CHUNK_WIDTH, 1, ao);
+        computeAmbientOcclusion(Y_NEG, ao);
         addQuad(Y_NEG, (int)vvox::Axis::X, (int)vvox::Axis::Z, -1, -PADDED_CHUNK_WIDTH, 2, ui8v2(1, 1), ao);
     }
     // Top
     if (shouldRenderFace(PADDED_CHUNK_LAYER)) {
-        computeAmbientOcclusion(PADDED_CHUNK_LAYER, -PADDED_CHUNK_WIDTH, -1, ao);
+        computeAmbientOcclusion(Y_POS, ao);
         addQuad(Y_POS, (int)vvox::Axis::X, (int)vvox::Axis::Z, -1, -PADDED_CHUNK_WIDTH, 0, ui8v2(-1, 1), ao);
     }
     // Back
     if (shouldRenderFace(-PADDED_CHUNK_WIDTH)) {
-        computeAmbientOcclusion(-PADDED_CHUNK_WIDTH, -PADDED_CHUNK_LAYER, -1, ao);
+        computeAmbientOcclusion(Z_NEG, ao);
         addQuad(Z_NEG, (int)vvox::Axis::X, (int)vvox::Axis::Y, -1, -PADDED_CHUNK_LAYER, 0, ui8v2(-1, 1), ao);
     }
     // Front
     if (shouldRenderFace(PADDED_CHUNK_WIDTH)) {
-        computeAmbientOcclusion(PADDED_CHUNK_WIDTH, -PADDED_CHUNK_LAYER, 1, ao);
+        computeAmbientOcclusion(Z_POS, ao);
         addQuad(Z_POS, (int)vvox::Axis::X, (int)vvox::Axis::Y, -1, -PADDED_CHUNK_LAYER, 2, ui8v2(1, 1), ao);
     }
 }
 
-void ChunkMesher::computeAmbientOcclusion(int upOffset VORB_UNUSED, int frontOffset VORB_UNUSED, int rightOffset VORB_UNUSED, f32 ambientOcclusion VORB_UNUSED[]) {
-#ifdef USE_AO
-    // Ambient occlusion factor
-#define OCCLUSION_FACTOR 0.2f;
-    // Helper macro
-    // TODO(Ben): This isn't exactly right since self will occlude. Use a function
-#define CALCULATE_VERTEX(v, s1, s2) \
-    nearOccluders = getOcclusion(blocks->operator[](blockData[blockIndex])) + \
-    getOcclusion(blocks->operator[](blockData[blockIndex s1 frontOffset])) + \
-    getOcclusion(blocks->operator[](blockData[blockIndex s2 rightOffset])) + \
-    getOcclusion(blocks->operator[](blockData[blockIndex s1 frontOffset s2 rightOffset])); \
-    ambientOcclusion[v] = 1.0f - nearOccluders * OCCLUSION_FACTOR; 
-   
-    // Move the block index upwards
-    int blockIndex = this->blockIndex + upOffset;
-    int nearOccluders; ///< For ambient occlusion
-
-    // TODO(Ben): I know for a fact the inputs are wrong for some faces
-
-    // Vertex 0
-    CALCULATE_VERTEX(0, -, -)
-
-    // Vertex 1
-    CALCULATE_VERTEX(1, +, -)
-
-    // Vertex 2
-    CALCULATE_VERTEX(2, +, +)
-
-    // Vertex 3
-    CALCULATE_VERTEX(3, -, +)
-#endif
+void ChunkMesher::addCoarseBlock(int cellWidth) {
+    // Unshaded, far away it's lost in the distance anyway
+    const ui8 ao[4] = { 0, 0, 0, 0 };
+
+    bool isOpen[6];
+    isOpen[X_NEG] = isCoarseFaceOpen(0, false, cellWidth);
+    isOpen[X_POS] = isCoarseFaceOpen(0, true, cellWidth);
+    isOpen[Y_NEG] = isCoarseFaceOpen(1, false, cellWidth);
+    isOpen[Y_POS] = isCoarseFaceOpen(1, true, cellWidth);
+    isOpen[Z_NEG] = isCoarseFaceOpen(2, false, cellWidth);
+    isOpen[Z_POS] = isCoarseFaceOpen(2, true, cellWidth);
+    // Skirts. Where a visible top meets a neighbor of another level their surfaces don't line up,
+    // so the border side of the cell hangs down over the crack. Terrain in front of it hides it.
+    if (isOpen[Y_POS]) {
+        if (bx == 0) isOpen[X_NEG] = true;
+        if (bx + cellWidth == CHUNK_WIDTH) isOpen[X_POS] = true;
+        if (bz == 0) isOpen[Z_NEG] = true;
+        if (bz + cellWidth == CHUNK_WIDTH) isOpen[Z_POS] = true;
+    }
+
+    if (isOpen[X_NEG]) addQuad(X_NEG, (int)vvox::Axis::Z, (int)vvox::Axis::Y, -PADDED_CHUNK_WIDTH, -PADDED_CHUNK_LAYER, 2, ui8v2(1, 1), ao, cellWidth);
+    if (isOpen[X_POS]) addQuad(X_POS, (int)vvox::Axis::Z, (int)vvox::Axis::Y, -PADDED_CHUNK_WIDTH, -PADDED_CHUNK_LAYER, 0, ui8v2(-1, 1), ao, cellWidth);
+    if (isOpen[Y_NEG]) addQuad(Y_NEG, (int)vvox::Axis::X, (int)vvox::Axis::Z, -1, -PADDED_CHUNK_WIDTH, 2, ui8v2(1, 1), ao, cellWidth);
+    if (isOpen[Y_POS]) addQuad(Y_POS, (int)vvox::Axis::X, (int)vvox::Axis::Z, -1, -PADDED_CHUNK_WIDTH, 0, ui8v2(-1, 1), ao, cellWidth);
+    if (isOpen[Z_NEG]) addQuad(Z_NEG, (int)vvox::Axis::X, (int)vvox::Axis::Y, -1, -PADDED_CHUNK_LAYER, 0, ui8v2(-1, 1), ao, cellWidth);
+    if (isOpen[Z_POS]) addQuad(Z_POS, (int)vvox::Axis::X, (int)vvox::Axis::Y, -1, -PADDED_CHUNK_LAYER, 2, ui8v2(1, 1), ao, cellWidth);
+}
+
+bool ChunkMesher::isCoarseFaceOpen(int axis, bool isPositive, int cellWidth) {
+    const int STRIDES[3] = { 1, PADDED_CHUNK_LAYER, PADDED_CHUNK_WIDTH };
+    const int cell[3] = { bx, by, bz };
+    int stride = STRIDES[axis];
+    int first = blockIndex + (isPositive ? stride * cellWidth : -stride);
+    bool isBorder = isPositive ? cell[axis] + cellWidth == CHUNK_WIDTH : cell[axis] == 0;
+    // Inside the chunk the neighbor is another uniform cell
+    if (!isBorder) return getOcclusion(blockData[first]) == 0;
+
+    // The padding is full resolution, so the face is open if any voxel across it is
+    int strideA = STRIDES[(axis + 1) % 3];
+    int strideB = STRIDES[(axis + 2) % 3];
+    for (int a = 0; a < cellWidth; a++) {
+        for (int b = 0; b < cellWidth; b++) {
+            if (getOcclusion(blockData[first + a * strideA + b * strideB]) == 0) return true;
+        }
+    }
+    return false;
+}
+
+void ChunkMesher::computeAmbientOcclusion(int face, ui8 ambientOcclusion[]) {
+    if (!useAmbientOcclusion) {
+        memset(ambientOcclusion, 0, 4);
+        return;
+    }
+    for (int i = 0; i < 4; i++) {
+        const int* offsets = m_aoOffsets[face][i];
+        int side1 = isOccluder(blockIndex + offsets[0]);
+        int side2 = isOccluder(blockIndex + offsets[1]);
+        int corner = isOccluder(blockIndex + offsets[2]);
+        // Two sides hide the corner completely
+        ambientOcclusion[i] = (ui8)((side1 && side2) ? 3 : side1 + side2 + corner);
+    }
 }
 
-void ChunkMesher::addQuad(int face, int rightAxis, int frontAxis, int leftOffset, int backOffset, int rightStretchIndex, const ui8v2& texOffset, f32 ambientOcclusion VORB_UNUSED[]) {
+void ChunkMesher::addQuad(int face, int rightAxis, int frontAxis, int leftOffset, int backOffset, int rightStretchIndex, const ui8v2& texOffset, const ui8 ambientOcclusion[], int cellWidth /*= 1*/) {
     // Get texture TODO(Ben): Null check?
-    const BlockTexture* texture = block->textures[face];
+    const BlockTexture* texture = faceTextures->textures[face];
 
     // Get colors
     // TODO(Ben): altColors
@@ -968,23 +1221,22 @@ void ChunkMesher::addQuad(int face, int rightAxis, int frontAxis, int leftOffset
     quads.emplace_back();
     m_numQuads++;
     VoxelQuad* quad = &quads.back();
+    // Clear unused vertex bytes so identical chunks produce identical meshes
+    memset(quad, 0, sizeof(VoxelQuad));
     quad->v.v0.mesherFlags = MESH_FLAG_ACTIVE;
 
     for (int i = 0; i < 4; i++) {
         BlockVertex& v = quad->verts[i];
-        v.position = VoxelMesher::VOXEL_POSITIONS[face][i] + voxelPosOffset;
-#ifdef USE_AO
-        f32& ao = ambientOcclusion[i];
-        v.color.r = (ui8)(blockColor[B_INDEX].r * ao);
-        v.color.g = (ui8)(blockColor[B_INDEX].g * ao);
-        v.color.b = (ui8)(blockColor[B_INDEX].b * ao);
-        v.overlayColor.r = (ui8)(blockColor[O_INDEX].r * ao);
-        v.overlayColor.g = (ui8)(blockColor[O_INDEX].g * ao);
-        v.overlayColor.b = (ui8)(blockColor[O_INDEX].b * ao);
-#else
-        v.color = blockColor[B_INDEX];
-        v.overlayColor = blockColor[O_INDEX];
-#endif
+        v.position = VoxelMesher::VOXEL_POSITIONS[face][i] * (ui8)cellWidth + voxelPosOffset;
+        // Baked into the colors so the shaders don't need to know about it
+        v.ao = ambientOcclusion[i];
+        ui16 aoScale = AO_SCALE[v.ao];
+        v.color.r = (ui8)((blockColor[B_INDEX].r * aoScale) >> 8);
+        v.color.g = (ui8)((blockColor[B_INDEX].g * aoScale) >> 8);
+        v.color.b = (ui8)((blockColor[B_INDEX].b * aoScale) >> 8);
+        v.overlayColor.r = (ui8)((blockColor[O_INDEX].r * aoScale) >> 8);
+        v.overlayColor.g = (ui8)((blockColor[O_INDEX].g * aoScale) >> 8);
+        v.overlayColor.b = (ui8)((blockColor[O_INDEX].b * aoScale) >> 8);
         // TODO(Ben) array?
         v.texturePosition.base.index = (ui8)methodDatas[0].index;
         v.texturePosition.base.atlas = atlasIndices[0];
@@ -1013,6 +1265,15 @@ void ChunkMesher::addQuad(int face, int rightAxis, int frontAxis, int leftOffset
     quad->verts[2].tex.y = (ui8)(UV_0 + vOffset);
     quad->verts[3].tex.x = (ui8)(UV_1 + uOffset);
     quad->verts[3].tex.y = (ui8)(UV_1 + vOffset);
+    if (cellWidth > 1) {
+        // Tile the texture once per voxel, as if cellWidth quads were merged each way
+        ui8 uStretch = (ui8)(texOffset.x * (cellWidth - 1));
+        ui8 vStretch = (ui8)(texOffset.y * (cellWidth - 1));
+        quad->verts[rightStretchIndex].tex.x += uStretch;
+        quad->verts[rightStretchIndex + 1].tex.x += uStretch;
+        quad->verts[0].tex.y += vStretch;
+        quad->verts[3].tex.y += vStretch;
+    }
 
     // Check against lowest and highest for culling in render
     // TODO(Ben): Think about this more
@@ -1023,7 +1284,7 @@ void ChunkMesher::addQuad(int face, int rightAxis, int frontAxis, int leftOffset
     if (quad->v.v0.position.z < m_lowestZ) m_lowestZ = quad->v.v0.position.z;
     if (quad->v.v0.position.z > m_highestZ) m_highestZ = quad->v.v0.position.z;
 
-    m_numQuads -= tryMergeQuad(quad, quads, face, rightAxis, frontAxis, leftOffset, backOffset, rightStretchIndex, texOffset);
+    if (cellWidth == 1) m_numQuads -= tryMergeQuad(quad, quads, face, rightAxis, frontAxis, leftOffset, backOffset, rightStretchIndex, texOffset);
 }
 
 struct FloraQuadData {
@@ -1040,7 +1301,7 @@ struct FloraQuadData {
 void ChunkMesher::addFlora() {
     FloraQuadData data;
 
-    data.texture = block->textures[0];
+    data.texture = faceTextures->textures[0];
     // Get colors
     // TODO(Ben): altColors
     data.texture->layers.base.getFinalColor(data.blockColor[B_INDEX],
@@ -1066,21 +1327,23 @@ void ChunkMesher::addFlora() {
     i32v3 pos(bx, by, bz);
     data.uOffset = (ui8)(pos[FACE_AXIS[0][0]] * FACE_AXIS_SIGN[0][0]);
     data.vOffset = (ui8)(pos[FACE_AXIS[0][1]] * FACE_AXIS_SIGN[0][1]);
+    // Pick the mesh variant from the voxel position so remeshing is stable
+    ui32 hash = BlockTextureMethods::getPositionHash(chunkVoxelPos.pos.x + bx, chunkVoxelPos.pos.y + by, chunkVoxelPos.pos.z + bz, 0);
     int r;
-    switch (block->meshType) {
+    switch (blocks->getMeshType(blockID)) {
         case MeshType::LEAVES:
 
             break;
         case MeshType::CROSSFLORA:
             //Generate a random number between 0 and 3 inclusive
-            r = std::bind(std::uniform_int_distribution<int>(0, NUM_CROSSFLORA_MESHES-1), std::mt19937(/*getPositionSeed(mi.nx, mi.nz)*/))();
+            r = hash % NUM_CROSSFLORA_MESHES;
 
             ChunkMesher::addFloraQuad(VoxelMesher::crossFloraVertices[r], data);
             ChunkMesher::addFloraQuad(VoxelMesher::crossFloraVertices[r] + 4, data);
             break;
         case MeshType::TRIANGLE:
             //Generate a random number between 0 and 3 inclusive
-            r = std::bind(std::uniform_int_distribution<int>(0, NUM_FLORA_MESHES-1), std::mt19937(/*getPositionSeed(mi.nx, mi.nz)*/))();
+            r = hash % NUM_FLORA_MESHES;
 
             ChunkMesher::addFloraQuad(VoxelMesher::floraVertices[r], data);
             ChunkMesher::addFloraQuad(VoxelMesher::floraVertices[r] + 4, data);
@@ -1095,6 +1358,7 @@ void ChunkMesher::addFloraQuad(const ui8v3* positions, FloraQuadData& data) {
 
     m_floraQuads.emplace_back();
     VoxelQuad& quad = m_floraQuads.back();
+    memset(&quad, 0, sizeof(VoxelQuad));
 
     for (int i = 0; i < 4; i++) {
         BlockVertex& v = quad.verts[i];
@@ -1169,20 +1433,22 @@ int ChunkMesher::tryMergeQuad(VoxelQuad* quad, std::vector<VoxelQuad>& quads, in
             }
         }
     }
-    // Check back merge
+    // Check back merge. Quads never cross a slab boundary so slabs can be remeshed alone.
+    bool slabBoundary = backOffset == -PADDED_CHUNK_LAYER && by % CHUNK_MESH_SLAB_HEIGHT == 0;
     if (quad->v.v0 == quad->v.v1 && quad->v.v2 == quad->v.v3) {
         quad->v.v0.mesherFlags |= MESH_FLAG_MERGE_FRONT;
-        int backIndex = m_quadIndices[blockIndex + backOffset][face];
+        int backIndex = slabBoundary ? NO_QUAD_INDEX : m_quadIndices[blockIndex + backOffset][face];
         if (backIndex != NO_QUAD_INDEX) {
             VoxelQuad* bQuad = &quads[backIndex];
             while (!(bQuad->v.v0.mesherFlags & MESH_FLAG_ACTIVE)) {
                 backIndex = bQuad->v.replaceQuad;
                 bQuad = &quads[backIndex];
             }
+            // Both edges have to match, ambient occlusion can differ between them
             if (((bQuad->v.v0.mesherFlags & MESH_FLAG_MERGE_FRONT) != 0) &&
                 bQuad->v.v0.position[rightAxis] == quad->v.v0.position[rightAxis] &&
                 bQuad->v.v2.position[rightAxis] == quad->v.v2.position[rightAxis] &&
-                bQuad->v.v0 == quad->v.v0 && bQuad->v.v1 == quad->v.v1) {
+                bQuad->v.v0 == quad->v.v0 && bQuad->v.v3 == quad->v.v3) {
                 bQuad->v.v0.position[frontAxis] += QUAD_SIZE;
                 bQuad->v.v0.tex.y += texOffset.y;
                 bQuad->v.v3.position[frontAxis] += QUAD_SIZE;
@@ -1201,323 +1467,73 @@ int ChunkMesher::tryMergeQuad(VoxelQuad* quad, std::vector<VoxelQuad>& quads, in
     return rv;
 }
 
-//Gets the liquid level from a block index
-#define LEVEL(i) ((_blockIDData[i] == 0) ? 0 : (((nextBlock = &GETBLOCK(_blockIDData[i]))->caIndex == block.caIndex) ? nextBlock->waterMeshLevel : 0))
+// Alpha of liquid faces
+#define LIQUID_ALPHA 175
 
-#define CALCULATE_LIQUID_VERTEX_HEIGHT(height, heightA, heightB, cornerIndex) \
-    div = 0; \
-    tot = 0; \
-    if (heightA) { \
-        tot += heightA; \
-        div++; \
-    } \
-    \
-    if (heightB) { \
-        tot += heightB; \
-        div++; \
-    } \
-    \
-    if (div) { \
-        int lvl = LEVEL(cornerIndex); \
-        if (lvl) { \
-            tot += lvl; \
-            div++; \
-        } \
-        height = (height + (tot / (float)maxLevel)) / (div + 1); \
-    } 
-    
-   
-//END CALCULATE_LIQUID_VERTEX_HEIGHT
-
-// TODO(Ben): Instead of 8 verts per box, share vertices and index into it!
-void ChunkMesher::addLiquid() {
-  //  const Block &block = (*m_blocks)[mi.btype];
-  //  Block* nextBlock;
-  //  i32 nextBlockID;
-  //  const i32 wc = mi.wc;
-  //  i32 x = mi.x;
-  //  i32 y = mi.y;
-  //  i32 z = mi.z;
-
-  //  RenderTask* task = mi.task;
+void ChunkMesher::addLiquid(int wc) {
+    // Front, right, top, left, bottom, back, like VoxelMesher::liquidVertices
+    static const int FACE_OFFSETS[6] = { PADDED_WIDTH, 1, PADDED_LAYER, -1, -PADDED_LAYER, -PADDED_WIDTH };
+    static const int TOP_FACE = 2;
 
-  //  const i32 maxLevel = 100;
+    BlockID id = blockData[wc];
+    const Block& liquid = blocks->operator[](id);
+    auto isSameLiquid = [&](int i) {
+        return liquid.liquidLevels ? getLiquidLevel(i, liquid) != 0 : blockData[i] == id;
+    };
 
-  //  float liquidLevel = block.waterMeshLevel / (float)maxLevel;
-  //  float fallingReduction = 0.0f;
-
-  //  bool faces[6] = { false, false, false, false, false, false };
-
-  //  float backLeftHeight = liquidLevel;
-  //  float backRightHeight = liquidLevel;
-  //  float frontRightHeight = liquidLevel;
-  //  float frontLeftHeight = liquidLevel;
+    // Liquid without levels, or under more of itself, fills the voxel
+    f32 height = 1.0f;
+    if (liquid.liquidLevels && !isSameLiquid(wc + PADDED_LAYER)) {
+        height = getLiquidLevel(wc, liquid) / (f32)liquid.liquidLevels;
+    }
 
-  //  const i32 MIN_ALPHA = 75;
-  //  const i32 MAX_ALPHA = 175;
-  //  const i32 ALPHA_RANGE = MAX_ALPHA - MIN_ALPHA;
-
-  //  ui8 backRightAlpha, frontRightAlpha, frontLeftAlpha, backLeftAlpha;
-
-  //  i32 textureUnit = 0;
-
-  //  i32 div;
-  //  i32 tot;
-
-  //  i32 left, right, back, front, bottom;
-
-  //  ui8 uOff = x * 7;
-  //  ui8 vOff = 224 - z * 7;
-
-  //  ui8 temperature = chunkGridData->heightData[x + z*CHUNK_WIDTH].temperature;
-  //  ui8 depth = chunkGridData->heightData[x + z*CHUNK_WIDTH].depth;
-
-  //  ColorRGB8 color;// = GameManager::texturePackLoader->getColorMap(TerrainGenerator::DefaultColorMaps::WATER)[depth * 256 + temperature];
-
-  //  ui8 sunlight = _sunlightData[wc];
-  //  ColorRGB8 lampLight((_lampLightData[wc] & LAMP_RED_MASK) >> LAMP_RED_SHIFT,
-  //                      (_lampLightData[wc] & LAMP_GREEN_MASK) >> LAMP_GREEN_SHIFT,
-  //                      _lampLightData[wc] & LAMP_BLUE_MASK);
-
-  //  sunlight = (ui8)(255.0f*(LIGHT_OFFSET + pow(LIGHT_MULT, MAXLIGHT - sunlight)));
-  //  lampLight.r = (ui8)(255.0f*(LIGHT_OFFSET + pow(LIGHT_MULT, MAXLIGHT - lampLight.r)));
-  //  lampLight.g = (ui8)(255.0f*(LIGHT_OFFSET + pow(LIGHT_MULT, MAXLIGHT - lampLight.g)));
-  //  lampLight.b = (ui8)(255.0f*(LIGHT_OFFSET + pow(LIGHT_MULT, MAXLIGHT - lampLight.b)));
-
-  //  nextBlockID = _blockIDData[wc + PADDED_OFFSETS::BOTTOM];
-  //  nextBlock = &GETBLOCK(nextBlockID);
-  //  //Check if the block is falling
-  //  if (nextBlockID == 0 || nextBlock->waterBreak || (nextBlock->caIndex == block.caIndex && nextBlock->waterMeshLevel != maxLevel)) {
-  //      memset(faces, 1, 6); //all faces are active
-  ////      backLeftHeight = backRightHeight = frontLeftHeight = frontRightHeight 
-  //      fallingReduction = 1.0f;
-  //  } else {
-
-  //      //Get occlusion
-  //      nextBlock = &GETBLOCK(_blockIDData[wc + PADDED_OFFSETS::LEFT]);
-  //      faces[XNEG] = ((nextBlock->caIndex != block.caIndex) && (nextBlock->occlude == BlockOcclusion::NONE));
-
-  //      nextBlock = &GETBLOCK(_blockIDData[wc + PADDED_OFFSETS::BACK]);
-  //      faces[ZNEG] = ((nextBlock->caIndex != block.caIndex) && (nextBlock->occlude == BlockOcclusion::NONE));
-
-  //      nextBlock = &GETBLOCK(_blockIDData[wc + PADDED_OFFSETS::RIGHT]);
-  //      faces[XPOS] = ((nextBlock->caIndex != block.caIndex) && (nextBlock->occlude == BlockOcclusion::NONE));
-
-  //      nextBlock = &GETBLOCK(_blockIDData[wc + PADDED_OFFSETS::FRONT]);
-  //      faces[ZPOS] = ((nextBlock->caIndex != block.caIndex) && (nextBlock->occlude == BlockOcclusion::NONE));
-
-  //      nextBlock = &GETBLOCK(_blockIDData[wc + PADDED_OFFSETS::BOTTOM]);
-  //      faces[YNEG] = ((nextBlock->caIndex != block.caIndex) && (nextBlock->occlude == BlockOcclusion::NONE));
-  //  }
-
-  //  left = LEVEL(wc + PADDED_OFFSETS::LEFT);
-  //  right = LEVEL(wc + PADDED_OFFSETS::RIGHT);
-  //  back = LEVEL(wc + PADDED_OFFSETS::BACK);
-  //  front = LEVEL(wc + PADDED_OFFSETS::FRONT);
-  //  bottom = LEVEL(wc + PADDED_OFFSETS::BOTTOM);
-
-  //  //Calculate the liquid levels
-
-  //  //Back Left Vertex
-  //  CALCULATE_LIQUID_VERTEX_HEIGHT(backLeftHeight, left, back, wc + PADDED_OFFSETS::BACK_LEFT);
-
-  //  //Back Right Vertex
-  //  CALCULATE_LIQUID_VERTEX_HEIGHT(backRightHeight, right, back, wc + PADDED_OFFSETS::BACK_RIGHT);
-
-  //  //Front Right Vertex
-  //  CALCULATE_LIQUID_VERTEX_HEIGHT(frontRightHeight, right, front, wc + PADDED_OFFSETS::FRONT_RIGHT);
-
-  //  //Front Left Vertex
-  //  CALCULATE_LIQUID_VERTEX_HEIGHT(frontLeftHeight, left, front, wc + PADDED_OFFSETS::FRONT_LEFT);
-
-  //  //only occlude top if we are a full water block and our sides arent down at all
-  //  if (liquidLevel == 1.0f && backRightHeight == 1.0f && backLeftHeight == 1.0f && frontLeftHeight == 1.0f && frontRightHeight == 1.0f) {
-  //      nextBlock = &GETBLOCK(_blockIDData[wc + PADDED_OFFSETS::TOP]);
-  //      faces[YPOS] = ((nextBlock->caIndex != block.caIndex) && (nextBlock->occlude == BlockOcclusion::NONE));
-  //  } else {
-  //      faces[YPOS] = true;
-  //  }
-  //  
-  //  //Compute alpha
-  //  if (bottom == maxLevel) {
-  //      backRightAlpha = backLeftAlpha = frontRightAlpha = frontLeftAlpha = MAX_ALPHA;
-  //  } else {
-  //      backRightAlpha = (ui8)(backRightHeight * ALPHA_RANGE + MIN_ALPHA);
-  //      backLeftAlpha = (ui8)(backLeftHeight * ALPHA_RANGE + MIN_ALPHA);
-  //      frontRightAlpha = (ui8)(frontRightHeight * ALPHA_RANGE + MIN_ALPHA);
-  //      frontLeftAlpha = (ui8)(frontLeftHeight * ALPHA_RANGE + MIN_ALPHA);
-  //  }
-
-  //  //Add vertices for the faces
-  //  if (faces[YNEG]){
-
-  //      VoxelMesher::makeLiquidFace(_waterVboVerts, mi.liquidIndex, uOff, vOff, lampLight, sunlight, color, textureUnit);
-  //      
-  //      _waterVboVerts[mi.liquidIndex].position[0] = x + VoxelMesher::liquidVertices[48];
-  //      _waterVboVerts[mi.liquidIndex].position[1] = y + VoxelMesher::liquidVertices[49] - fallingReduction;
-  //      _waterVboVerts[mi.liquidIndex].position[2] = z + VoxelMesher::liquidVertices[50];
-  //      _waterVboVerts[mi.liquidIndex + 1].position[0] = x + VoxelMesher::liquidVertices[51];
-  //      _waterVboVerts[mi.liquidIndex + 1].position[1] = y + VoxelMesher::liquidVertices[52] - fallingReduction;
-  //      _waterVboVerts[mi.liquidIndex + 1].position[2] = z + VoxelMesher::liquidVertices[53];
-  //      _waterVboVerts[mi.liquidIndex + 2].position[0] = x + VoxelMesher::liquidVertices[54];
-  //      _waterVboVerts[mi.liquidIndex + 2].position[1] = y + VoxelMesher::liquidVertices[55] - fallingReduction;
-  //      _waterVboVerts[mi.liquidIndex + 2].position[2] = z + VoxelMesher::liquidVertices[56];
-  //      _waterVboVerts[mi.liquidIndex + 3].position[0] = x + VoxelMesher::liquidVertices[57];
-  //      _waterVboVerts[mi.liquidIndex + 3].position[1] = y + VoxelMesher::liquidVertices[58] - fallingReduction;
-  //      _waterVboVerts[mi.liquidIndex + 3].position[2] = z + VoxelMesher::liquidVertices[59];
-
-  //      //set alpha
-  //      _waterVboVerts[mi.liquidIndex].color.a = backLeftAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 1].color.a = backRightAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 2].color.a = frontRightAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 3].color.a = backLeftAlpha;
-
-  //      mi.liquidIndex += 4;
-  //  }
-
-  //  if (faces[ZPOS]){
-
-  //      VoxelMesher::makeLiquidFace(_waterVboVerts, mi.liquidIndex, uOff, vOff, lampLight, sunlight, color, textureUnit);
-
-  //      _waterVboVerts[mi.liquidIndex].position[0] = x + VoxelMesher::liquidVertices[0];
-  //      _waterVboVerts[mi.liquidIndex].position[1] = y + frontLeftHeight;
-  //      _waterVboVerts[mi.liquidIndex].position[2] = z + VoxelMesher::liquidVertices[2];
-  //      _waterVboVerts[mi.liquidIndex + 1].position[0] = x + VoxelMesher::liquidVertices[3];
-  //      _waterVboVerts[mi.liquidIndex + 1].position[1] = y + VoxelMesher::liquidVertices[4] - fallingReduction;
-  //      _waterVboVerts[mi.liquidIndex + 1].position[2] = z + VoxelMesher::liquidVertices[5];
-  //      _waterVboVerts[mi.liquidIndex + 2].position[0] = x + VoxelMesher::liquidVertices[6];
-  //      _waterVboVerts[mi.liquidIndex + 2].position[1] = y + VoxelMesher::liquidVertices[7] - fallingReduction;
-  //      _waterVboVerts[mi.liquidIndex + 2].position[2] = z + VoxelMesher::liquidVertices[8];
-  //      _waterVboVerts[mi.liquidIndex + 3].position[0] = x + VoxelMesher::liquidVertices[9];
-  //      _waterVboVerts[mi.liquidIndex + 3].position[1] = y + frontRightHeight;
-  //      _waterVboVerts[mi.liquidIndex + 3].position[2] = z + VoxelMesher::liquidVertices[11];
-
-  //      _waterVboVerts[mi.liquidIndex].color.a = frontLeftAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 1].color.a = frontLeftAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 2].color.a = frontRightAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 3].color.a = frontRightAlpha;
-
-  //      mi.liquidIndex += 4;
-  //  }
-
-  //  if (faces[YPOS]){
-
-  //      VoxelMesher::makeLiquidFace(_waterVboVerts, mi.liquidIndex, uOff, vOff, lampLight, sunlight, color, textureUnit);
-
-  //      _waterVboVerts.resize(_waterVboVerts.size() + 4);
-  //      _waterVboVerts[mi.liquidIndex].position[0] = x + VoxelMesher::liquidVertices[24];
-  //      _waterVboVerts[mi.liquidIndex].position[1] = y + backLeftHeight;
-  //      _waterVboVerts[mi.liquidIndex].position[2] = z + VoxelMesher::liquidVertices[26];
-  //      _waterVboVerts[mi.liquidIndex + 1].position[0] = x + VoxelMesher::liquidVertices[27];
-  //      _waterVboVerts[mi.liquidIndex + 1].position[1] = y + frontLeftHeight;
-  //      _waterVboVerts[mi.liquidIndex + 1].position[2] = z + VoxelMesher::liquidVertices[29];
-  //      _waterVboVerts[mi.liquidIndex + 2].position[0] = x + VoxelMesher::liquidVertices[30];
-  //      _waterVboVerts[mi.liquidIndex + 2].position[1] = y + frontRightHeight;
-  //      _waterVboVerts[mi.liquidIndex + 2].position[2] = z + VoxelMesher::liquidVertices[32];
-  //      _waterVboVerts[mi.liquidIndex + 3].position[0] = x + VoxelMesher::liquidVertices[33];
-  //      _waterVboVerts[mi.liquidIndex + 3].position[1] = y + backRightHeight;
-  //      _waterVboVerts[mi.liquidIndex + 3].position[2] = z + VoxelMesher::liquidVertices[35];
-
-  //      _waterVboVerts[mi.liquidIndex].color.a = backLeftAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 1].color.a = frontLeftAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 2].color.a = frontRightAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 3].color.a = backRightAlpha;
-
-  //      mi.liquidIndex += 4;
-  //  }
-
-  //  if (faces[ZNEG]){
-
-  //      VoxelMesher::makeLiquidFace(_waterVboVerts, mi.liquidIndex, uOff, vOff, lampLight, sunlight, color, textureUnit);
-
-  //      _waterVboVerts[mi.liquidIndex].position[0] = x + VoxelMesher::liquidVertices[60];
-  //      _waterVboVerts[mi.liquidIndex].position[1] = y + backRightHeight;
-  //      _waterVboVerts[mi.liquidIndex].position[2] = z + VoxelMesher::liquidVertices[62];
-  //      _waterVboVerts[mi.liquidIndex + 1].position[0] = x + VoxelMesher::liquidVertices[63];
-  //      _waterVboVerts[mi.liquidIndex + 1].position[1] = y + VoxelMesher::liquidVertices[64] - fallingReduction;
-  //      _waterVboVerts[mi.liquidIndex + 1].position[2] = z + VoxelMesher::liquidVertices[65];
-  //      _waterVboVerts[mi.liquidIndex + 2].position[0] = x + VoxelMesher::liquidVertices[66];
-  //      _waterVboVerts[mi.liquidIndex + 2].position[1] = y + VoxelMesher::liquidVertices[67] - fallingReduction;
-  //      _waterVboVerts[mi.liquidIndex + 2].position[2] = z + VoxelMesher::liquidVertices[68];
-  //      _waterVboVerts[mi.liquidIndex + 3].position[0] = x + VoxelMesher::liquidVertices[69];
-  //      _waterVboVerts[mi.liquidIndex + 3].position[1] = y + backLeftHeight;
-  //      _waterVboVerts[mi.liquidIndex + 3].position[2] = z + VoxelMesher::liquidVertices[71];
-
-  //      _waterVboVerts[mi.liquidIndex].color.a = backRightAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 1].color.a = backRightAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 2].color.a = backLeftAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 3].color.a = backLeftAlpha;
-
-  //      mi.liquidIndex += 4;
-  //  }
-  //  if (faces[XPOS]){
-
-  //      VoxelMesher::makeLiquidFace(_waterVboVerts, mi.liquidIndex, uOff, vOff, lampLight, sunlight, color, textureUnit);
-
-  //      _waterVboVerts[mi.liquidIndex].position.x = x + VoxelMesher::liquidVertices[12];
-  //      _waterVboVerts[mi.liquidIndex].position.y = y + frontRightHeight;
-  //      _waterVboVerts[mi.liquidIndex].position.z = z + VoxelMesher::liquidVertices[14];
-  //      _waterVboVerts[mi.liquidIndex + 1].position.x = x + VoxelMesher::liquidVertices[15];
-  //      _waterVboVerts[mi.liquidIndex + 1].position.y = y + VoxelMesher::liquidVertices[16] - fallingReduction;
-  //      _waterVboVerts[mi.liquidIndex + 1].position.z = z + VoxelMesher::liquidVertices[17];
-  //      _waterVboVerts[mi.liquidIndex + 2].position.x = x + VoxelMesher::liquidVertices[18];
-  //      _waterVboVerts[mi.liquidIndex + 2].position.y = y + VoxelMesher::liquidVertices[19] - fallingReduction;
-  //      _waterVboVerts[mi.liquidIndex + 2].position.z = z + VoxelMesher::liquidVertices[20];
-  //      _waterVboVerts[mi.liquidIndex + 3].position.x = x + VoxelMesher::liquidVertices[21];
-  //      _waterVboVerts[mi.liquidIndex + 3].position.y = y + backRightHeight;
-  //      _waterVboVerts[mi.liquidIndex + 3].position.z = z + VoxelMesher::liquidVertices[23];
-
-  //      _waterVboVerts[mi.liquidIndex].color.a = frontRightAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 1].color.a = frontRightAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 2].color.a = backRightAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 3].color.a = backRightAlpha;
-
-  //      mi.liquidIndex += 4;
-  //  }
-  //  if (faces[XNEG]){
-
-  //      VoxelMesher::makeLiquidFace(_waterVboVerts, mi.liquidIndex, uOff, vOff, lampLight, sunlight, color, textureUnit);
-
-  //      _waterVboVerts[mi.liquidIndex].position[0] = x + VoxelMesher::liquidVertices[36];
-  //      _waterVboVerts[mi.liquidIndex].position[1] = y + backLeftHeight;
-  //      _waterVboVerts[mi.liquidIndex].position[2] = z + VoxelMesher::liquidVertices[38];
-  //      _waterVboVerts[mi.liquidIndex + 1].position[0] = x + VoxelMesher::liquidVertices[39];
-  //      _waterVboVerts[mi.liquidIndex + 1].position[1] = y + VoxelMesher::liquidVertices[40] - fallingReduction;
-  //      _waterVboVerts[mi.liquidIndex + 1].position[2] = z + VoxelMesher::liquidVertices[41];
-  //      _waterVboVerts[mi.liquidIndex + 2].position[0] = x + VoxelMesher::liquidVertices[42];
-  //      _waterVboVerts[mi.liquidIndex + 2].position[1] = y + VoxelMesher::liquidVertices[43] - fallingReduction;
-  //      _waterVboVerts[mi.liquidIndex + 2].position[2] = z + VoxelMesher::liquidVertices[44];
-  //      _waterVboVerts[mi.liquidIndex + 3].position[0] = x + VoxelMesher::liquidVertices[45];
-  //      _waterVboVerts[mi.liquidIndex + 3].position[1] = y + frontLeftHeight;
-  //      _waterVboVerts[mi.liquidIndex + 3].position[2] = z + VoxelMesher::liquidVertices[47];
-
-  //      _waterVboVerts[mi.liquidIndex].color.a = backLeftAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 1].color.a = backLeftAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 2].color.a = frontLeftAlpha;
-  //      _waterVboVerts[mi.liquidIndex + 3].color.a = frontLeftAlpha;
-
-  //      mi.liquidIndex += 4;
-  //  }
+    int x = wc % PADDED_WIDTH - 1;
+    int y = wc / PADDED_LAYER - 1;
+    int z = (wc % PADDED_LAYER) / PADDED_WIDTH - 1;
+    ui8 uOff = (ui8)(x * 7);
+    ui8 vOff = (ui8)(224 - z * 7);
+
+    const BlockTexture* texture = blocks->getFaceTextures(id).textures[0];
+    ColorRGB8 color(255, 255, 255);
+    if (texture) color = texture->layers.base.color;
+    // TODO(Ben): Lighting
+    ColorRGB8 lampColor(0, 0, 0);
+    ui8 sunlight = 255;
+
+    for (int face = 0; face < 6; face++) {
+        int n = wc + FACE_OFFSETS[face];
+        if (isSameLiquid(n)) continue;
+        // A lowered surface shows under whatever is above it
+        if (isOccluder(n) && !(face == TOP_FACE && height < 1.0f)) continue;
+
+        int index = (int)_waterVboVerts.size();
+        VoxelMesher::makeLiquidFace(_waterVboVerts, index, uOff, vOff, lampColor, sunlight, color, 0);
+        for (int v = 0; v < 4; v++) {
+            const GLfloat* p = &VoxelMesher::liquidVertices[face * 12 + v * 3];
+            LiquidVertex& vertex = _waterVboVerts[index + v];
+            vertex.position = f32v3(x + p[0], y + p[1] * height, z + p[2]);
+            vertex.color.a = LIQUID_ALPHA;
+        }
+    }
 }
 
 int ChunkMesher::getLiquidLevel(int blockIndex, const Block& block) {
     int val = GETBLOCKID(blockData[blockIndex]); // Get block ID
-    val = val - block.liquidStartID;
-    if (val < 0) return 0;
+    // Level 1 is liquidStartID, so 0 is never the liquid
+    val = val - block.liquidStartID + 1;
+    if (val <= 0) return 0;
     if (val > block.liquidLevels) return 0;
     return val;
 }
 
 bool ChunkMesher::shouldRenderFace(int offset) {
-    const Block& neighbor = blocks->operator[](blockData[blockIndex + offset]);
-    if (neighbor.occlude == BlockOcclusion::ALL) return false;
-    if ((neighbor.occlude == BlockOcclusion::SELF) && (blockID == neighbor.ID)) return false;
-    return true;
+    return getOcclusion(blockData[blockIndex + offset]) == 0;
 }
 
-int ChunkMesher::getOcclusion(const Block& block) {
-    if (block.occlude == BlockOcclusion::ALL) return 1;
-    if ((block.occlude == BlockOcclusion::SELF) && (blockID == block.ID)) return 1;
+int ChunkMesher::getOcclusion(BlockID id) {
+    ui8 occlusion = blocks->getOcclusion(id);
+    if (occlusion & BLOCK_OCCLUDES_ALL) return 1;
+    if ((occlusion & BLOCK_OCCLUDES_SELF) && (blockID == id)) return 1;
     return 0;
 }
 
@@ -1605,33 +1621,41 @@ void ChunkMesher::buildCutoutVao(ChunkMesh& cm) {
 }
 
 void ChunkMesher::buildVao(ChunkMesh& cm) {
-    glGenVertexArrays(1, &(cm.vaoID));
+    if (!cm.vaoID) glGenVertexArrays(1, &(cm.vaoID));
     glBindVertexArray(cm.vaoID);
-    glBindBuffer(GL_ARRAY_BUFFER, cm.vboID);
+    if (cm.arenaQuads) {
+        glBindBuffer(GL_ARRAY_BUFFER, ChunkRenderer::vertexArena.getVbo());
+        setBlockVertexAttribs((size_t)cm.arenaOffset * sizeof(VoxelQuad));
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, cm.vboID);
+        setBlockVertexAttribs(0);
+    }
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ChunkRenderer::sharedIBO);
 
+    glBindVertexArray(0);
+}
+
+void ChunkMesher::setBlockVertexAttribs(size_t baseOffset) {
     for (int i = 0; i < 8; i++) {
         glEnableVertexAttribArray(i);
     }
 
     // vPosition_Face
-    glVertexAttribPointer(0, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(BlockVertex), offsetptr(BlockVertex, position));
+    glVertexAttribPointer(0, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(BlockVertex), (void*)(baseOffset + offsetof(BlockVertex, position)));
     // vTex_Animation_BlendMode
-    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(BlockVertex), offsetptr(BlockVertex, tex));
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(BlockVertex), (void*)(baseOffset + offsetof(BlockVertex, tex)));
     // vTexturePos
-    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(BlockVertex), offsetptr(BlockVertex, texturePosition));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(BlockVertex), (void*)(baseOffset + offsetof(BlockVertex, texturePosition)));
     // vNormTexturePos
-    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(BlockVertex), offsetptr(BlockVertex, normTexturePosition));
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(BlockVertex), (void*)(baseOffset + offsetof(BlockVertex, normTexturePosition)));
     // vDispTexturePos
-    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(BlockVertex), offsetptr(BlockVertex, dispTexturePosition));
+    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(BlockVertex), (void*)(baseOffset + offsetof(BlockVertex, dispTexturePosition)));
     // vTexDims
-    glVertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(BlockVertex), offsetptr(BlockVertex, textureDims));
+    glVertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(BlockVertex), (void*)(baseOffset + offsetof(BlockVertex, textureDims)));
     // vColor
-    glVertexAttribPointer(6, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BlockVertex), offsetptr(BlockVertex, color));
+    glVertexAttribPointer(6, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BlockVertex), (void*)(baseOffset + offsetof(BlockVertex, color)));
     // vOverlayColor
-    glVertexAttribPointer(7, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BlockVertex), offsetptr(BlockVertex, overlayColor));
-
-    glBindVertexArray(0);
+    glVertexAttribPointer(7, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BlockVertex), (void*)(baseOffset + offsetof(BlockVertex, overlayColor)));
 }
 
 void ChunkMesher::buildWaterVao(ChunkMesh& cm) {
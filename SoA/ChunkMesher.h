@@ -6,6 +6,7 @@
 #include "ChunkMeshTask.h"
 
 class BlockPack;
+struct BlockFaceTextures;
 class BlockTextureLayer;
 class ChunkMeshData;
 struct BlockTexture;
@@ -28,7 +29,7 @@ const int PADDED_CHUNK_SIZE = (PADDED_CHUNK_LAYER * PADDED_CHUNK_WIDTH);
 // This class is too big to statically allocate
 class ChunkMesher {
 public:
-    ChunkMesher():blocks(nullptr), m_chunkMeshData(nullptr){}
+    ChunkMesher():faceTextures(nullptr), blocks(nullptr), m_chunkMeshData(nullptr){}
 
     void init(const BlockPack* blocks);
 
@@ -46,13 +47,26 @@ class ChunkMesher {
     // For use with threadpool
     void prepareDataAsync(ChunkHandle& chunk, ChunkHandle neighbors[NUM_NEIGHBOR_HANDLES]);
 
+    // Coarsens the prepared chunk into cells of 2^lodLevel voxels for a distant mesh. A cell becomes
+    // solid when any of its voxels is, so the coarse surface never falls short of the real one.
+    // createChunkMeshData then meshes each cell as one scaled quad per open face. The padding keeps
+    // full resolution, and cells on the chunk border hang skirts over seams to other levels.
+    // Call between prepareData or prepareDataAsync and createChunkMeshData.
+    void downsample(ui32 lodLevel);
+
     // TODO(Ben): Unique ptr?
     // Must call prepareData or prepareDataAsync first
-    CALLER_DELETE ChunkMeshData* createChunkMeshData(MeshTaskType type);
+    // @param meshData: Optional empty mesh data to fill, such as from a ChunkMeshDataPool
+    // @param baseData: Optional previous mesh of the chunk. Only the slabs flagged in Chunk::dirtySlabs
+    // are remeshed and the rest are copied from it. It is not modified.
+    CALLER_DELETE ChunkMeshData* createChunkMeshData(MeshTaskType type, OPT ChunkMeshData* meshData = nullptr, OPT const ChunkMeshData* baseData = nullptr);
 
     // Returns true if the mesh is renderable
     static bool uploadMeshData(ChunkMesh& mesh, ChunkMeshData* meshData);
 
+    // Points attributes 0 to 7 at BlockVertex data in the bound array buffer, starting baseOffset bytes in
+    static void setBlockVertexAttribs(size_t baseOffset);
+
     // Frees buffers AND deletes memory. mesh Pointer is invalid after calling.
     static void freeChunkMesh(CALLEE_DELETE ChunkMesh* mesh);
 
@@ -62,6 +76,7 @@ class ChunkMesher {
     int blockIndex;
     ui16 blockID;
     const Block* block;
+    const BlockFaceTextures* faceTextures; ///< Textures of the current block
     const PlanetHeightData* heightData;
     ui8v3 voxelPosOffset;
 
@@ -74,19 +89,30 @@ class ChunkMesher {
     const BlockPack* blocks;
 
     VoxelPosition3D chunkVoxelPos;
+
+    bool useAmbientOcclusion = true; ///< Only turned off to measure its cost
 private:
     void addBlock();
-    void addQuad(int face, int rightAxis, int frontAxis, int leftOffset, int backOffset, int rightStretchIndex, const ui8v2& texOffset, f32 ambientOcclusion[]);
-    void computeAmbientOcclusion(int upOffset, int frontOffset, int rightOffset, f32 ambientOcclusion[]);
+    // Adds the open faces of a coarse cell with its origin at the current voxel
+    void addCoarseBlock(int cellWidth);
+    // @param axis: 0 = x, 1 = y, 2 = z
+    bool isCoarseFaceOpen(int axis, bool isPositive, int cellWidth);
+    // @param cellWidth: Voxels the quad spans along each edge. Scaled quads are never merged.
+    void addQuad(int face, int rightAxis, int frontAxis, int leftOffset, int backOffset, int rightStretchIndex, const ui8v2& texOffset, const ui8 ambientOcclusion[], int cellWidth = 1);
+    void computeAmbientOcclusion(int face, ui8 ambientOcclusion[]);
+    // Fills m_occluders from blockData
+    void buildOccluders();
+    bool isOccluder(int paddedIndex) const { return (m_occluders[paddedIndex >> 6] >> (paddedIndex & 63)) & 1; }
     void addFlora();
     void addFloraQuad(const ui8v3* positions, FloraQuadData& data);
     int tryMergeQuad(VoxelQuad* quad, std::vector<VoxelQuad>& quads, int face, int rightAxis, int frontAxis, int leftOffset, int backOffset, int rightStretchIndex, const ui8v2& texOffset);
-    void addLiquid();
+    // Adds the faces of the liquid at a padded index that aren't hidden by more of it or an occluder
+    void addLiquid(int wc);
 
     int getLiquidLevel(int blockIndex, const Block& block);
 
     bool shouldRenderFace(int offset);
-    int getOcclusion(const Block& block);
+    int getOcclusion(BlockID id);
 
     ui8 getBlendMode(const BlendType& blendType);
 
@@ -96,6 +122,12 @@ class ChunkMesher {
     static void buildWaterVao(ChunkMesh& cm);
 
     ui16 m_quadIndices[PADDED_CHUNK_SIZE][6];
+    // Bit per padded voxel that hides any neighbor, for ambient occlusion
+    ui64 m_occluders[(PADDED_CHUNK_SIZE + 63) / 64];
+    ChunkVisibility m_visibility;
+    ui64 m_faceConnections = CHUNK_FACES_ALL_CONNECTED; ///< Of the prepared chunk
+    // Per face vertex, padded offsets of the two side voxels and the corner voxel that shade it
+    int m_aoOffsets[6][4][3];
     ui16 m_wvec[CHUNK_SIZE];
 
     std::vector<BlockVertex> m_finalVerts[6];
@@ -104,6 +136,12 @@ class ChunkMesher {
     std::vector<VoxelQuad> m_quads[6];
     ui32 m_numQuads;
 
+    ui8 m_rebuildSlabs; ///< Chunk::dirtySlabs when the data was prepared
+    ui32 m_lodLevel = 0; ///< Of the last downsample since the data was prepared
+    // Where each slab starts in m_quads and m_floraQuads. Skipped slabs are empty ranges.
+    ui32 m_slabQuadStarts[6][CHUNK_MESH_SLABS + 1];
+    ui32 m_slabFloraStarts[CHUNK_MESH_SLABS + 1];
+
     BlockTextureMethodParams m_textureMethodParams[6][2];
 
     // TODO(Ben): Change this up a bit
@@ -18,6 +18,7 @@
 #include "ChunkHandle.h"
 #include "GenerateTask.h"
 
+#include <chrono>
 #include <Vorb/PtrRecycler.hpp>
 
 enum ChunkGenLevel { GEN_NONE = 0, GEN_TERRAIN, GEN_FLORA, GEN_SCRIPT, GEN_DONE };
@@ -46,6 +47,7 @@ class ChunkQuery {
     ChunkHandle chunk; ///< Gets set on submitQuery
     bool shouldRelease;
     ChunkGrid* grid;
+    std::chrono::steady_clock::time_point submitTime; ///< For latency stats
 private:
     bool m_isFinished;
     std::mutex m_lock;
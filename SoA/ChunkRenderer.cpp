@@ -4,6 +4,7 @@
 #include "Camera.h"
 #include "Chunk.h"
 #include "ChunkMeshManager.h"
+#include "ChunkMesher.h"
 #include "Frustum.h"
 #include "GameManager.h"
 #include "GameRenderParams.h"
@@ -17,6 +18,7 @@ volatile f32 ChunkRenderer::fadeDist = 1.0f;
 f32m4 ChunkRenderer::worldMatrix = f32m4(1.0f);
 
 VGIndexBuffer ChunkRenderer::sharedIBO = 0;
+ChunkVertexArena ChunkRenderer::vertexArena;
 
 void ChunkRenderer::init() {
     // Not thread safe
@@ -48,6 +50,39 @@ void ChunkRenderer::init() {
         m_opaqueProgram.use();
         glUniform1i(m_opaqueProgram.getUniform("unTextures"), 0);
     }
+    // Needs base instance and indirect draws
+    if (GLEW_VERSION_4_3) { // Opaque multi draw
+        m_multiDrawProgram = ShaderLoader::createProgramFromFile("Shaders/BlockShading/standardShading.vert",
+                                                                 "Shaders/BlockShading/standardShading.frag",
+                                                                 nullptr, "#define MULTI_DRAW\n");
+        GLint offsetAttrib = glGetAttribLocation(m_multiDrawProgram.getID(), "vChunkOffset");
+        if (offsetAttrib == -1) {
+            // Shaders without the MULTI_DRAW path still link, so fall back to per chunk draws
+            printf("Warning: standardShading has no MULTI_DRAW path, drawing chunks one at a time.\n");
+            m_multiDrawProgram.dispose();
+        } else {
+            m_multiDrawProgram.use();
+            glUniform1i(m_multiDrawProgram.getUniform("unTextures"), 0);
+
+            // Only multi draws need it. Without it meshes get buffers of their own.
+            if (!vertexArena.getVbo()) vertexArena.init(CHUNK_VERTEX_ARENA_QUADS);
+
+            glGenBuffers(1, &m_commandBuffer);
+            glGenBuffers(1, &m_chunkOffsetBuffer);
+            glGenVertexArrays(1, &m_multiDrawVao);
+            glBindVertexArray(m_multiDrawVao);
+            glBindBuffer(GL_ARRAY_BUFFER, vertexArena.getVbo());
+            ChunkMesher::setBlockVertexAttribs(0);
+            // One offset per chunk, picked by baseInstance
+            glBindBuffer(GL_ARRAY_BUFFER, m_chunkOffsetBuffer);
+            glEnableVertexAttribArray(offsetAttrib);
+            glVertexAttribPointer(offsetAttrib, 3, GL_FLOAT, GL_FALSE, sizeof(f32v3), 0);
+            glVertexAttribDivisor(offsetAttrib, 1);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sharedIBO);
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+    }
     // TODO(Ben): Fix the shaders
     { // Transparent
    //     m_transparentProgram = ShaderLoader::createProgramFromFile("Shaders/BlockShading/standardShading.vert",
@@ -68,6 +103,21 @@ void ChunkRenderer::init() {
 
 void ChunkRenderer::dispose() {
     if (m_opaqueProgram.isCreated()) m_opaqueProgram.dispose();
+    if (m_multiDrawProgram.isCreated()) m_multiDrawProgram.dispose();
+    if (m_multiDrawVao) {
+        glDeleteVertexArrays(1, &m_multiDrawVao);
+        m_multiDrawVao = 0;
+    }
+    if (m_commandBuffer) {
+        glDeleteBuffers(1, &m_commandBuffer);
+        m_commandBuffer = 0;
+    }
+    if (m_chunkOffsetBuffer) {
+        glDeleteBuffers(1, &m_chunkOffsetBuffer);
+        m_chunkOffsetBuffer = 0;
+    }
+    // Meshes still drawing from the arena keep it, such as when shaders are reloaded
+    if (vertexArena.getVbo() && vertexArena.getNumUsedQuads() == 0) vertexArena.dispose();
     if (m_transparentProgram.isCreated()) m_transparentProgram.dispose();
     if (m_cutoutProgram.isCreated()) m_cutoutProgram.dispose();
     if (m_waterProgram.isCreated()) m_waterProgram.dispose();
@@ -76,21 +126,14 @@ void ChunkRenderer::dispose() {
 // TODO: blockAmbient variables were going unused, what are they for?
 
 void ChunkRenderer::beginOpaque(VGTexture textureAtlas, const f32v3& sunDir, const f32v3& lightColor VORB_UNUSED /*= f32v3(1.0f)*/, const f32v3& ambient /*= f32v3(0.0f)*/) {
-    m_opaqueProgram.use();
-    glUniform3fv(m_opaqueProgram.getUniform("unLightDirWorld"), 1, &(sunDir[0]));
-    glUniform1f(m_opaqueProgram.getUniform("unSpecularExponent"), soaOptions.get(OPT_SPECULAR_EXPONENT).value.f);
-    glUniform1f(m_opaqueProgram.getUniform("unSpecularIntensity"), soaOptions.get(OPT_SPECULAR_INTENSITY).value.f * 0.3f);
+    m_numOpaqueDrawCalls = 0;
+    if (m_multiDrawProgram.isCreated()) setOpaqueUniforms(m_multiDrawProgram, sunDir, ambient);
+    setOpaqueUniforms(m_opaqueProgram, sunDir, ambient);
 
     // Bind the block textures
     glActiveTexture(GL_TEXTURE0);
-    glUniform1i(m_opaqueProgram.getUniform("unTextures"), 0); // TODO(Ben): Temporary
     glBindTexture(GL_TEXTURE_2D_ARRAY, textureAtlas);
 
-    // f32 blockAmbient = 0.000f;
-    glUniform3fv(m_opaqueProgram.getUniform("unAmbientLight"), 1, &ambient[0]);
-    glUniform3fv(m_opaqueProgram.getUniform("unSunColor"), 1, &sunDir[0]);
-
-    glUniform1f(m_opaqueProgram.getUniform("unFadeDist"), 100000.0f/*ChunkRenderer::fadeDist*/);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sharedIBO);
 }
 
@@ -105,33 +148,50 @@ void ChunkRenderer::drawOpaque(const ChunkMesh *cm, const f64v3 &PlayerPos, cons
 
     glBindVertexArray(cm->vaoID);
 
-    const ChunkMeshRenderData& chunkMeshInfo = cm->renderData;
-    //top
-    if (chunkMeshInfo.pyVboSize && PlayerPos.y > cm->position.y + chunkMeshInfo.lowestY) {
-        glDrawElements(GL_TRIANGLES, chunkMeshInfo.pyVboSize, GL_UNSIGNED_INT, (void*)(chunkMeshInfo.pyVboOff * sizeof(GLuint)));
-    }
-    //front
-    if (chunkMeshInfo.pzVboSize && PlayerPos.z > cm->position.z + chunkMeshInfo.lowestZ){
-        glDrawElements(GL_TRIANGLES, chunkMeshInfo.pzVboSize, GL_UNSIGNED_INT, (void*)(chunkMeshInfo.pzVboOff * sizeof(GLuint)));
-    }
-    //back
-    if (chunkMeshInfo.nzVboSize && PlayerPos.z < cm->position.z + chunkMeshInfo.highestZ){
-        glDrawElements(GL_TRIANGLES, chunkMeshInfo.nzVboSize, GL_UNSIGNED_INT, (void*)(chunkMeshInfo.nzVboOff * sizeof(GLuint)));
+    i32v2 faces[6];
+    ui32 numFaces = getVisibleOpaqueFaces(cm, PlayerPos, faces);
+    for (ui32 i = 0; i < numFaces; i++) {
+        glDrawElements(GL_TRIANGLES, faces[i].y, GL_UNSIGNED_INT, (void*)(faces[i].x * sizeof(GLuint)));
     }
-    //left
-    if (chunkMeshInfo.nxVboSize && PlayerPos.x < cm->position.x + chunkMeshInfo.highestX){
-        glDrawElements(GL_TRIANGLES, chunkMeshInfo.nxVboSize, GL_UNSIGNED_INT, (void*)(chunkMeshInfo.nxVboOff * sizeof(GLuint)));
+    m_numOpaqueDrawCalls += numFaces;
+
+    glBindVertexArray(0);
+}
+
+void ChunkRenderer::drawOpaqueBatch(const std::vector<ChunkMesh*>& meshes, const f64v3& PlayerPos, const f32m4& VP) {
+    if (!m_useMultiDraw || !m_multiDrawProgram.isCreated()) {
+        for (int i = meshes.size() - 1; i >= 0; i--) {
+            drawOpaque(meshes[i], PlayerPos, VP);
+        }
+        return;
     }
-    //right
-    if (chunkMeshInfo.pxVboSize && PlayerPos.x > cm->position.x + chunkMeshInfo.lowestX){
-        glDrawElements(GL_TRIANGLES, chunkMeshInfo.pxVboSize, GL_UNSIGNED_INT, (void*)(chunkMeshInfo.pxVboOff * sizeof(GLuint)));
+
+    buildOpaqueCommands(meshes, PlayerPos, m_commands, m_chunkOffsets, m_unbatched);
+    if (m_commands.size()) {
+        m_multiDrawProgram.use();
+        glUniformMatrix4fv(m_multiDrawProgram.getUniform("unVP"), 1, GL_FALSE, &VP[0][0]);
+
+        // Orphan last frame's data so we don't wait on it
+        glBindBuffer(GL_ARRAY_BUFFER, m_chunkOffsetBuffer);
+        glBufferData(GL_ARRAY_BUFFER, m_chunkOffsets.size() * sizeof(f32v3), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, m_chunkOffsets.size() * sizeof(f32v3), m_chunkOffsets.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commands.size() * sizeof(ChunkDrawCommand), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, m_commands.size() * sizeof(ChunkDrawCommand), m_commands.data());
+
+        glBindVertexArray(m_multiDrawVao);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)m_commands.size(), 0);
+        m_numOpaqueDrawCalls++;
+        glBindVertexArray(0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        m_opaqueProgram.use();
     }
-    //bottom
-    if (chunkMeshInfo.nyVboSize && PlayerPos.y < cm->position.y + chunkMeshInfo.highestY){
-        glDrawElements(GL_TRIANGLES, chunkMeshInfo.nyVboSize, GL_UNSIGNED_INT, (void*)(chunkMeshInfo.nyVboOff * sizeof(GLuint)));
+    // Meshes that didn't fit in the arena
+    for (auto& cm : m_unbatched) {
+        drawOpaque(cm, PlayerPos, VP);
     }
-
-    glBindVertexArray(0);
 }
 
 void ChunkRenderer::drawOpaqueCustom(const ChunkMesh* cm, vg::GLProgram& m_program, const f64v3& PlayerPos, const f32m4& VP) {
@@ -146,33 +206,92 @@ void ChunkRenderer::drawOpaqueCustom(const ChunkMesh* cm, vg::GLProgram& m_progr
 
     glBindVertexArray(cm->vaoID);
 
+    i32v2 faces[6];
+    ui32 numFaces = getVisibleOpaqueFaces(cm, PlayerPos, faces);
+    for (ui32 i = 0; i < numFaces; i++) {
+        glDrawElements(GL_TRIANGLES, faces[i].y, GL_UNSIGNED_INT, (void*)(faces[i].x * sizeof(GLuint)));
+    }
+
+    glBindVertexArray(0);
+}
+
+ui32 ChunkRenderer::getVisibleOpaqueFaces(const ChunkMesh* cm, const f64v3& PlayerPos, OUT i32v2 faces[6]) {
     const ChunkMeshRenderData& chunkMeshInfo = cm->renderData;
+    ui32 numFaces = 0;
     //top
     if (chunkMeshInfo.pyVboSize && PlayerPos.y > cm->position.y + chunkMeshInfo.lowestY) {
-        glDrawElements(GL_TRIANGLES, chunkMeshInfo.pyVboSize, GL_UNSIGNED_INT, (void*)(chunkMeshInfo.pyVboOff * sizeof(GLuint)));
+        faces[numFaces++] = i32v2(chunkMeshInfo.pyVboOff, chunkMeshInfo.pyVboSize);
     }
     //front
     if (chunkMeshInfo.pzVboSize && PlayerPos.z > cm->position.z + chunkMeshInfo.lowestZ) {
-        glDrawElements(GL_TRIANGLES, chunkMeshInfo.pzVboSize, GL_UNSIGNED_INT, (void*)(chunkMeshInfo.pzVboOff * sizeof(GLuint)));
+        faces[numFaces++] = i32v2(chunkMeshInfo.pzVboOff, chunkMeshInfo.pzVboSize);
     }
     //back
     if (chunkMeshInfo.nzVboSize && PlayerPos.z < cm->position.z + chunkMeshInfo.highestZ) {
-        glDrawElements(GL_TRIANGLES, chunkMeshInfo.nzVboSize, GL_UNSIGNED_INT, (void*)(chunkMeshInfo.nzVboOff * sizeof(GLuint)));
+        faces[numFaces++] = i32v2(chunkMeshInfo.nzVboOff, chunkMeshInfo.nzVboSize);
     }
     //left
     if (chunkMeshInfo.nxVboSize && PlayerPos.x < cm->position.x + chunkMeshInfo.highestX) {
-        glDrawElements(GL_TRIANGLES, chunkMeshInfo.nxVboSize, GL_UNSIGNED_INT, (void*)(chunkMeshInfo.nxVboOff * sizeof(GLuint)));
+        faces[numFaces++] = i32v2(chunkMeshInfo.nxVboOff, chunkMeshInfo.nxVboSize);
     }
     //right
     if (chunkMeshInfo.pxVboSize && PlayerPos.x > cm->position.x + chunkMeshInfo.lowestX) {
-        glDrawElements(GL_TRIANGLES, chunkMeshInfo.pxVboSize, GL_UNSIGNED_INT, (void*)(chunkMeshInfo.pxVboOff * sizeof(GLuint)));
+        faces[numFaces++] = i32v2(chunkMeshInfo.pxVboOff, chunkMeshInfo.pxVboSize);
     }
     //bottom
     if (chunkMeshInfo.nyVboSize && PlayerPos.y < cm->position.y + chunkMeshInfo.highestY) {
-        glDrawElements(GL_TRIANGLES, chunkMeshInfo.nyVboSize, GL_UNSIGNED_INT, (void*)(chunkMeshInfo.nyVboOff * sizeof(GLuint)));
+        faces[numFaces++] = i32v2(chunkMeshInfo.nyVboOff, chunkMeshInfo.nyVboSize);
     }
+    return numFaces;
+}
 
-    glBindVertexArray(0);
+void ChunkRenderer::buildOpaqueCommands(const std::vector<ChunkMesh*>& meshes, const f64v3& PlayerPos,
+                                        OUT std::vector<ChunkDrawCommand>& commands, OUT std::vector<f32v3>& chunkOffsets,
+                                        OUT std::vector<const ChunkMesh*>& unbatched) {
+    commands.clear();
+    chunkOffsets.clear();
+    unbatched.clear();
+
+    i32v2 faces[6];
+    for (int i = meshes.size() - 1; i >= 0; i--) {
+        const ChunkMesh* cm = meshes[i];
+        if (cm->vaoID == 0) continue;
+        if (!cm->arenaQuads) {
+            unbatched.push_back(cm);
+            continue;
+        }
+        ui32 numFaces = getVisibleOpaqueFaces(cm, PlayerPos, faces);
+        if (!numFaces) continue;
+
+        // Same translation as the world matrix of drawOpaque
+        ui32 chunkIndex = (ui32)chunkOffsets.size();
+        chunkOffsets.emplace_back((f32)(cm->position.x - PlayerPos.x),
+                                  (f32)(cm->position.y - PlayerPos.y),
+                                  (f32)(cm->position.z - PlayerPos.z));
+        for (ui32 j = 0; j < numFaces; j++) {
+            commands.emplace_back();
+            ChunkDrawCommand& command = commands.back();
+            command.count = (ui32)faces[j].y;
+            command.instanceCount = 1;
+            command.firstIndex = (ui32)faces[j].x;
+            command.baseVertex = (i32)(cm->arenaOffset * 4);
+            command.baseInstance = chunkIndex;
+        }
+    }
+}
+
+void ChunkRenderer::setOpaqueUniforms(vg::GLProgram& program, const f32v3& sunDir, const f32v3& ambient) {
+    program.use();
+    glUniform3fv(program.getUniform("unLightDirWorld"), 1, &(sunDir[0]));
+    glUniform1f(program.getUniform("unSpecularExponent"), soaOptions.get(OPT_SPECULAR_EXPONENT).value.f);
+    glUniform1f(program.getUniform("unSpecularIntensity"), soaOptions.get(OPT_SPECULAR_INTENSITY).value.f * 0.3f);
+    glUniform1i(program.getUniform("unTextures"), 0); // TODO(Ben): Temporary
+
+    // f32 blockAmbient = 0.000f;
+    glUniform3fv(program.getUniform("unAmbientLight"), 1, &ambient[0]);
+    glUniform3fv(program.getUniform("unSunColor"), 1, &sunDir[0]);
+
+    glUniform1f(program.getUniform("unFadeDist"), 100000.0f/*ChunkRenderer::fadeDist*/);
 }
 
 
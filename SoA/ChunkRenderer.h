@@ -6,11 +6,23 @@
 #include <Vorb/graphics/GLProgram.h>
 
 #include "ChunkMesh.h"
+#include "ChunkVertexArena.h"
 
 class GameRenderParams;
 class PhysicsBlockMesh;
 
 #define CHUNK_DIAGONAL_LENGTH 28.0f
+// 64 MB of opaque quads
+#define CHUNK_VERTEX_ARENA_QUADS 524288
+
+/// Layout of DrawElementsIndirectCommand
+struct ChunkDrawCommand {
+    ui32 count;
+    ui32 instanceCount;
+    ui32 firstIndex;
+    i32 baseVertex;
+    ui32 baseInstance; ///< Index of the chunk offset
+};
 
 class ChunkRenderer {
 public:
@@ -20,8 +32,26 @@ class ChunkRenderer {
 
     void beginOpaque(VGTexture textureAtlas, const f32v3& sunDir, const f32v3& lightColor = f32v3(1.0f), const f32v3& ambient = f32v3(0.0f));
     void drawOpaque(const ChunkMesh* cm, const f64v3& PlayerPos, const f32m4& VP) const;
+    /// Draws every mesh in the arena with one glMultiDrawElementsIndirect, then the rest with drawOpaque.
+    /// Meshes are drawn last to first, like looping drawOpaque over them.
+    void drawOpaqueBatch(const std::vector<ChunkMesh*>& meshes, const f64v3& PlayerPos, const f32m4& VP);
     static void drawOpaqueCustom(const ChunkMesh* cm, vg::GLProgram& m_program, const f64v3& PlayerPos, const f32m4& VP);
 
+    /// Gets the index ranges of the faces of an opaque mesh that can face the player
+    /// @param faces: Filled with an index offset and count per face
+    /// @return Number of faces
+    static ui32 getVisibleOpaqueFaces(const ChunkMesh* cm, const f64v3& PlayerPos, OUT i32v2 faces[6]);
+    /// Builds the indirect commands for the arena meshes, last to first, and collects the rest in unbatched
+    static void buildOpaqueCommands(const std::vector<ChunkMesh*>& meshes, const f64v3& PlayerPos,
+                                    OUT std::vector<ChunkDrawCommand>& commands, OUT std::vector<f32v3>& chunkOffsets,
+                                    OUT std::vector<const ChunkMesh*>& unbatched);
+
+    /// False without GL 4.3 or when the shader has no MULTI_DRAW path
+    bool canMultiDraw() const { return m_multiDrawProgram.isCreated(); }
+    void setUseMultiDraw(bool useMultiDraw) { m_useMultiDraw = useMultiDraw; }
+    /// Opaque draw calls since beginOpaque
+    const ui32& getNumOpaqueDrawCalls() const { return m_numOpaqueDrawCalls; }
+
     void beginTransparent(VGTexture textureAtlas, const f32v3& sunDir, const f32v3& lightColor = f32v3(1.0f), const f32v3& ambient = f32v3(0.0f));
     void drawTransparent(const ChunkMesh* cm, const f64v3& playerPos, const f32m4& VP) const;
     
@@ -36,9 +66,23 @@ class ChunkRenderer {
 
     static volatile f32 fadeDist;
     static VGIndexBuffer sharedIBO;
+    static ChunkVertexArena vertexArena; ///< Opaque quads of all chunk meshes that fit
 private:
+    void setOpaqueUniforms(vg::GLProgram& program, const f32v3& sunDir, const f32v3& ambient);
+
     static f32m4 worldMatrix; ///< Reusable world matrix for chunks
     vg::GLProgram m_opaqueProgram;
+    /// standardShading with MULTI_DRAW defined. Takes the chunk translation from the
+    /// per instance vChunkOffset attribute and projects with unVP instead of unW and unWVP.
+    vg::GLProgram m_multiDrawProgram;
+    VGVertexArray m_multiDrawVao = 0; ///< Reads the whole arena, baseVertex picks the chunk
+    VGBuffer m_commandBuffer = 0;
+    VGBuffer m_chunkOffsetBuffer = 0;
+    std::vector<ChunkDrawCommand> m_commands;
+    std::vector<f32v3> m_chunkOffsets;
+    std::vector<const ChunkMesh*> m_unbatched;
+    bool m_useMultiDraw = true;
+    mutable ui32 m_numOpaqueDrawCalls = 0;
     vg::GLProgram m_transparentProgram;
     vg::GLProgram m_cutoutProgram;
     vg::GLProgram m_waterProgram;
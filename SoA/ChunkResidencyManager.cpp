@@ -0,0 +1,229 @@
+#include "stdafx.h"
+#include "ChunkResidencyManager.h"
+
+#include <algorithm>
+
+#include "ChunkAllocator.h"
+#include "ChunkGrid.h"
+#include "ChunkMeshManager.h"
+#include "SpaceSystemAssemblages.h"
+#include "SpaceSystemComponents.h"
+
+namespace {
+    bool isFlat(const vvox::SmartVoxelContainer<ui16>& container) {
+        return container.getState() == vvox::VoxelStorageState::FLAT_ARRAY && container.getDataArray();
+    }
+
+    size_t getContainerBytes(const vvox::SmartVoxelContainer<ui16>& container) {
+        if (container.getState() == vvox::VoxelStorageState::FLAT_ARRAY) {
+            return container.getDataArray() ? CHUNK_SIZE * sizeof(ui16) : 0;
+        }
+        auto& dataTree = container.getTree();
+        return dataTree.size() ? dataTree.size() * sizeof(dataTree[0]) : 0;
+    }
+}
+
+void ChunkResidencyManager::init(PagedChunkAllocator* allocator, OPT ChunkMeshManager* meshManager, size_t budget /*= CHUNK_RESIDENCY_DEFAULT_BUDGET*/) {
+    m_allocator = allocator;
+    m_meshManager = meshManager;
+    m_budget = budget;
+    SpaceSystemAssemblages::onAddSphericalVoxelComponent += makeDelegate(*this, &ChunkResidencyManager::onAddSphericalVoxelComponent);
+    SpaceSystemAssemblages::onRemoveSphericalVoxelComponent += makeDelegate(*this, &ChunkResidencyManager::onRemoveSphericalVoxelComponent);
+    Chunk::DataChange += makeDelegate(*this, &ChunkResidencyManager::onDataChange);
+}
+
+void ChunkResidencyManager::dispose() {
+    SpaceSystemAssemblages::onAddSphericalVoxelComponent -= makeDelegate(*this, &ChunkResidencyManager::onAddSphericalVoxelComponent);
+    SpaceSystemAssemblages::onRemoveSphericalVoxelComponent -= makeDelegate(*this, &ChunkResidencyManager::onRemoveSphericalVoxelComponent);
+    Chunk::DataChange -= makeDelegate(*this, &ChunkResidencyManager::onDataChange);
+    std::vector<ChunkGrid*>().swap(m_grids);
+    std::vector<Candidate>().swap(m_candidates);
+    std::unordered_map<const Chunk*, ui32>().swap(m_lastChanges);
+    std::unordered_map<const Chunk*, MeasuredChunk>().swap(m_chunkBytes);
+    m_voxelDataBytes = 0;
+    m_sweepGrid = 0;
+    m_sweepChunk = 0;
+    m_allocator = nullptr;
+    m_meshManager = nullptr;
+}
+
+void ChunkResidencyManager::update(const VoxelPosition3D& cameraPosition) {
+    ui32 frame = ++m_frame;
+    { // Only recent changes matter
+        std::lock_guard<std::mutex> l(m_lckChanges);
+        for (auto it = m_lastChanges.begin(); it != m_lastChanges.end();) {
+            if (frame - it->second > CHUNK_RESIDENCY_MIN_AGE) {
+                it = m_lastChanges.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Empty pages are not worth keeping, budget or not. One stays for the next allocations.
+    m_numFreedPages += m_allocator->freeEmptyPages(1);
+
+    measureSlice();
+    m_usage = ChunkMemoryUsage();
+    m_usage.chunkPages = m_allocator->getPageBytes();
+    m_usage.cachedVoxelArrays = m_allocator->getCachedVoxelArrayBytes();
+    m_usage.voxelData = m_voxelDataBytes;
+    for (auto& grid : m_grids) {
+        std::lock_guard<std::mutex> l(grid->m_lckGridData);
+        m_usage.gridData += grid->m_chunkGridDataMap.size() * sizeof(ChunkGridData);
+    }
+    if (m_meshManager) m_usage.meshes = m_meshManager->getMemoryUsage();
+    if (m_usage.getTotal() <= m_budget) return;
+
+    // Cheapest to lose first: cached arrays, then mesh copies kept for splicing, then flat voxel arrays
+    m_allocator->clearVoxelArrayCache();
+    m_usage.cachedVoxelArrays = 0;
+    if (m_meshManager && m_usage.getTotal() > m_budget) {
+        m_usage.meshes -= m_meshManager->trimMeshData(m_usage.getTotal() - m_budget);
+    }
+    if (m_usage.getTotal() > m_budget) {
+        // Grids of the other cube faces are the farthest
+        for (auto& grid : m_grids) {
+            if (grid->m_face != cameraPosition.face) compressVoxelData(grid, cameraPosition);
+        }
+        for (auto& grid : m_grids) {
+            if (grid->m_face == cameraPosition.face) compressVoxelData(grid, cameraPosition);
+        }
+        // Compressing recycled the arrays
+        m_allocator->clearVoxelArrayCache();
+    }
+}
+
+ChunkMemoryUsage ChunkResidencyManager::measure() {
+    ChunkMemoryUsage usage;
+    usage.chunkPages = m_allocator->getPageBytes();
+    usage.cachedVoxelArrays = m_allocator->getCachedVoxelArrayBytes();
+    for (auto& grid : m_grids) {
+        {
+            std::lock_guard<std::mutex> l(grid->m_lckActiveChunks);
+            for (auto& h : grid->m_activeChunks) {
+                Chunk* chunk = h;
+                std::lock_guard<std::mutex> lChunk(chunk->dataMutex);
+                usage.voxelData += getContainerBytes(chunk->blocks) + getContainerBytes(chunk->tertiary);
+            }
+        }
+        std::lock_guard<std::mutex> l(grid->m_lckGridData);
+        usage.gridData += grid->m_chunkGridDataMap.size() * sizeof(ChunkGridData);
+    }
+    if (m_meshManager) usage.meshes = m_meshManager->getMemoryUsage();
+    return usage;
+}
+
+void ChunkResidencyManager::measureSlice() {
+    ui32 numMeasured = 0;
+    while (m_sweepGrid < m_grids.size() && numMeasured < CHUNK_RESIDENCY_MEASURES_PER_FRAME) {
+        ChunkGrid* grid = m_grids[m_sweepGrid];
+        {
+            std::lock_guard<std::mutex> l(grid->m_lckActiveChunks);
+            for (; m_sweepChunk < grid->m_activeChunks.size() && numMeasured < CHUNK_RESIDENCY_MEASURES_PER_FRAME; m_sweepChunk++) {
+                Chunk* chunk = grid->m_activeChunks[m_sweepChunk];
+                size_t bytes;
+                {
+                    std::lock_guard<std::mutex> lChunk(chunk->dataMutex);
+                    bytes = getContainerBytes(chunk->blocks) + getContainerBytes(chunk->tertiary);
+                }
+                setChunkBytes(chunk, bytes);
+                numMeasured++;
+            }
+            if (m_sweepChunk < grid->m_activeChunks.size()) break;
+        }
+        m_sweepGrid++;
+        m_sweepChunk = 0;
+    }
+    if (m_sweepGrid < m_grids.size()) return;
+
+    // Active chunks are reordered as they come and go, so one sweep can miss a chunk.
+    // Missing two in a row means it left the grids.
+    for (auto it = m_chunkBytes.begin(); it != m_chunkBytes.end();) {
+        if (m_sweep - it->second.sweep > 1) {
+            m_voxelDataBytes -= it->second.bytes;
+            it = m_chunkBytes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_sweep++;
+    m_sweepGrid = 0;
+}
+
+void ChunkResidencyManager::setChunkBytes(const Chunk* chunk, size_t bytes) {
+    MeasuredChunk& measured = m_chunkBytes[chunk];
+    if (measured.sweep) m_voxelDataBytes -= measured.bytes;
+    measured.bytes = bytes;
+    measured.sweep = m_sweep;
+    m_voxelDataBytes += bytes;
+}
+
+void ChunkResidencyManager::compressVoxelData(ChunkGrid* grid, const VoxelPosition3D& cameraPosition) {
+    if (m_usage.getTotal() <= m_budget) return;
+
+    // Holding the active list keeps the chunks from being freed
+    std::lock_guard<std::mutex> l(grid->m_lckActiveChunks);
+    m_candidates.clear();
+    {
+        std::lock_guard<std::mutex> lChanges(m_lckChanges);
+        for (auto& h : grid->m_activeChunks) {
+            Chunk* chunk = h;
+            // Chunks being generated or edited need their arrays
+            if (chunk->genLevel != GEN_DONE || m_lastChanges.find(chunk) != m_lastChanges.end()) continue;
+            if (!isFlat(chunk->blocks) && !isFlat(chunk->tertiary)) continue;
+            f64 distance2 = DBL_MAX;
+            if (chunk->getVoxelPosition().face == cameraPosition.face) {
+                f64v3 offset = chunk->getVoxelPosition().pos + f64v3(CHUNK_WIDTH / 2) - cameraPosition.pos;
+                distance2 = selfDot(offset);
+            }
+            m_candidates.push_back({ chunk, distance2 });
+        }
+    }
+    std::sort(m_candidates.begin(), m_candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.distance2 > b.distance2;
+    });
+
+    for (auto& candidate : m_candidates) {
+        Chunk* chunk = candidate.chunk;
+        size_t oldBytes, newBytes;
+        bool isBlocksFlat, isTertiaryFlat;
+        {
+            std::lock_guard<std::mutex> lChunk(chunk->dataMutex);
+            oldBytes = getContainerBytes(chunk->blocks) + getContainerBytes(chunk->tertiary);
+            isBlocksFlat = isFlat(chunk->blocks);
+            isTertiaryFlat = isFlat(chunk->tertiary);
+        }
+        // Takes the data lock itself
+        if (isBlocksFlat) chunk->blocks.changeState(vvox::VoxelStorageState::INTERVAL_TREE, chunk->dataMutex);
+        if (isTertiaryFlat) chunk->tertiary.changeState(vvox::VoxelStorageState::INTERVAL_TREE, chunk->dataMutex);
+        {
+            std::lock_guard<std::mutex> lChunk(chunk->dataMutex);
+            newBytes = getContainerBytes(chunk->blocks) + getContainerBytes(chunk->tertiary);
+        }
+        m_usage.voxelData = m_usage.voxelData + newBytes - oldBytes;
+        setChunkBytes(chunk, newBytes);
+        m_numCompressions++;
+        if (m_usage.getTotal() <= m_budget) break;
+    }
+}
+
+void ChunkResidencyManager::onAddSphericalVoxelComponent(Sender s VORB_UNUSED, SphericalVoxelComponent& cmp, vecs::EntityID e VORB_UNUSED) {
+    for (int i = 0; i < 6; i++) m_grids.push_back(&cmp.chunkGrids[i]);
+}
+
+void ChunkResidencyManager::onRemoveSphericalVoxelComponent(Sender s VORB_UNUSED, SphericalVoxelComponent& cmp, vecs::EntityID e VORB_UNUSED) {
+    for (int i = 0; i < 6; i++) {
+        auto it = std::find(m_grids.begin(), m_grids.end(), &cmp.chunkGrids[i]);
+        if (it != m_grids.end()) m_grids.erase(it);
+    }
+    // Restart the sweep, its chunks are dropped when it finishes
+    m_sweepGrid = 0;
+    m_sweepChunk = 0;
+}
+
+void ChunkResidencyManager::onDataChange(Sender s VORB_UNUSED, ChunkHandle& chunk) {
+    // Called from worker threads too
+    std::lock_guard<std::mutex> l(m_lckChanges);
+    m_lastChanges[(Chunk*)chunk] = m_frame.load();
+}
@@ -0,0 +1,113 @@
+///
+/// ChunkResidencyManager.h
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// Keeps the memory held by chunks, their grid data and their
+/// meshes under a byte budget by freeing what is cheapest to lose.
+///
+
+#pragma once
+
+#ifndef ChunkResidencyManager_h__
+#define ChunkResidencyManager_h__
+
+#include <Vorb/Events.hpp>
+#include <Vorb/ecs/Entity.h>
+
+#include "VoxelCoordinateSpaces.h"
+
+class Chunk;
+class ChunkGrid;
+class ChunkHandle;
+class ChunkMeshManager;
+class PagedChunkAllocator;
+struct SphericalVoxelComponent;
+
+#define CHUNK_RESIDENCY_DEFAULT_BUDGET ((size_t)1024 * 1024 * 1024)
+// Chunks changed more recently than this many updates keep their flat voxel arrays
+#define CHUNK_RESIDENCY_MIN_AGE 120
+// Chunks update() measures per frame, the rest keep their last size
+#define CHUNK_RESIDENCY_MEASURES_PER_FRAME 512
+
+struct ChunkMemoryUsage {
+    size_t chunkPages = 0; ///< Chunk structs, in use or free
+    size_t voxelData = 0; ///< Flat arrays and interval trees of live chunks
+    size_t cachedVoxelArrays = 0; ///< Flat arrays kept for reuse
+    size_t gridData = 0; ///< ChunkGridData, mostly heightmaps
+    size_t meshes = 0; ///< Uploaded quads and the CPU copies kept for splicing
+
+    size_t getTotal() const { return chunkPages + voxelData + cachedVoxelArrays + gridData + meshes; }
+};
+
+class ChunkResidencyManager {
+public:
+    /// Starts tracking the grids of every spherical voxel component added after this
+    /// @param meshManager: Optional, its meshes are counted and trimmed too
+    void init(PagedChunkAllocator* allocator, OPT ChunkMeshManager* meshManager, size_t budget = CHUNK_RESIDENCY_DEFAULT_BUDGET);
+    void dispose();
+
+    /// Measures memory, then frees cached and far away data until it fits the budget.
+    /// Chunks in use are never freed, so the budget can be exceeded by what the game holds.
+    /// Call once per frame on the update thread.
+    /// @param cameraPosition: Data of chunks far from it goes first
+    void update(const VoxelPosition3D& cameraPosition);
+
+    /// Measures every chunk without freeing anything. Locks each chunk, so update()
+    /// measures a slice per frame instead.
+    ChunkMemoryUsage measure();
+
+    void setBudget(size_t budget) { m_budget = budget; }
+    const size_t& getBudget() const { return m_budget; }
+    /// As of the last update
+    const ChunkMemoryUsage& getUsage() const { return m_usage; }
+    /// Voxel arrays compressed to interval trees to fit the budget
+    const ui32& getNumCompressions() const { return m_numCompressions; }
+    const ui32& getNumFreedPages() const { return m_numFreedPages; }
+private:
+    struct Candidate {
+        Chunk* chunk;
+        f64 distance2;
+    };
+    struct MeasuredChunk {
+        size_t bytes;
+        ui32 sweep; ///< Sweep it was last measured in
+    };
+
+    /// Measures the next CHUNK_RESIDENCY_MEASURES_PER_FRAME chunks of the grids into m_voxelDataBytes.
+    /// Chunks not seen for two whole sweeps are gone and dropped.
+    void measureSlice();
+    /// Sets the measured size of a chunk, keeping m_voxelDataBytes the sum
+    void setChunkBytes(const Chunk* chunk, size_t bytes);
+
+    /// Compresses flat voxel arrays of a grid, farthest first, until the usage fits
+    void compressVoxelData(ChunkGrid* grid, const VoxelPosition3D& cameraPosition);
+
+    void onAddSphericalVoxelComponent(Sender s, SphericalVoxelComponent& cmp, vecs::EntityID e);
+    void onRemoveSphericalVoxelComponent(Sender s, SphericalVoxelComponent& cmp, vecs::EntityID e);
+    void onDataChange(Sender s, ChunkHandle& chunk);
+
+    PagedChunkAllocator* m_allocator = nullptr;
+    ChunkMeshManager* m_meshManager = nullptr;
+    std::vector<ChunkGrid*> m_grids;
+    size_t m_budget = CHUNK_RESIDENCY_DEFAULT_BUDGET;
+    ChunkMemoryUsage m_usage;
+    ui32 m_numCompressions = 0;
+    ui32 m_numFreedPages = 0;
+    std::atomic<ui32> m_frame { 0 }; ///< Read by onDataChange on worker threads
+
+    std::mutex m_lckChanges;
+    std::unordered_map<const Chunk*, ui32> m_lastChanges; ///< Update when chunks were last changed, only recent ones
+    std::vector<Candidate> m_candidates; ///< Scratch space for compressVoxelData
+
+    std::unordered_map<const Chunk*, MeasuredChunk> m_chunkBytes; ///< Voxel data size of active chunks, as last measured
+    size_t m_voxelDataBytes = 0; ///< Sum of m_chunkBytes
+    ui32 m_sweep = 1;
+    size_t m_sweepGrid = 0; ///< Grid the next slice starts in
+    size_t m_sweepChunk = 0; ///< Active chunk of that grid the next slice starts at
+};
+
+#endif // ChunkResidencyManager_h__
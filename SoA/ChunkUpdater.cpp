@@ -118,15 +118,36 @@ void ChunkUpdater::randomBlockUpdates(PhysicsEngine* physicsEngine VORB_UNUSED,
     //if (lockedChunk) lockedChunk->unlock();
 }
 
+void ChunkUpdater::notifyDataChange(ChunkHandle& chunk) {
+    chunk->DataChange(chunk);
+    ui8 dirtyNeighbors = chunk->dirtyNeighbors.exchange(0);
+    for (int i = 0; i < 6; i++) {
+        if (!(dirtyNeighbors & (1 << i))) continue;
+        ChunkHandle& neighbor = chunk->neighbors[i];
+        if (neighbor.isAquired() && neighbor->isAccessible) {
+            neighbor->DataChange(neighbor);
+        }
+    }
+}
+
 void ChunkUpdater::placeBlockSafe(Chunk* chunk VORB_UNUSED, Chunk*& lockedChunk VORB_UNUSED, BlockIndex blockIndex VORB_UNUSED, BlockID blockData VORB_UNUSED) {
    /* vvox::swapLockedChunk(chunk, lockedChunk);
     placeBlock(chunk, lockedChunk, blockIndex, blockData);*/
 }
 
 void ChunkUpdater::placeBlockNoUpdate(Chunk* chunk, BlockIndex blockIndex, BlockID blockType) {
- 
+    BlockID oldType = chunk->blocks.get(blockIndex);
     chunk->blocks.set(blockIndex, blockType);
-    chunk->flagDirty();
+
+    // Neighbor faces only change if the block hides them differently
+    bool visibilityChanged = true;
+    if (blockPack) {
+        ui8 oldOcclusion = blockPack->getOcclusion(oldType);
+        ui8 newOcclusion = blockPack->getOcclusion(blockType);
+        visibilityChanged = oldOcclusion != newOcclusion ||
+            (oldType != blockType && ((oldOcclusion | newOcclusion) & BLOCK_OCCLUDES_SELF));
+    }
+    chunk->flagDirty(blockIndex, visibilityChanged);
 
     //Block &block = GETBLOCK(blockType);
 
@@ -22,6 +22,8 @@ class ChunkUpdater {
     }
     static void placeBlockSafe(Chunk* chunk, Chunk*& lockedChunk, BlockIndex blockIndex, BlockID blockData);
     static void placeBlockNoUpdate(Chunk* chunk, BlockIndex blockIndex, BlockID blockType);
+    /// Fires Chunk::DataChange for the chunk and for any neighbors its edits flagged for a remesh
+    static void notifyDataChange(ChunkHandle& chunk);
     static void placeBlockFromLiquidPhysics(Chunk* chunk, Chunk*& lockedChunk, int blockIndex, int blockType);
     static void placeBlockFromLiquidPhysicsSafe(Chunk* chunk, Chunk*& lockedChunk, int blockIndex, int blockType);
   
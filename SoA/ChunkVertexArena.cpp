@@ -0,0 +1,64 @@
+#include "stdafx.h"
+#include "ChunkVertexArena.h"
+
+#include "ChunkMesh.h"
+
+void ChunkVertexArena::init(ui32 capacity) {
+    m_capacity = capacity;
+    m_numUsedQuads = 0;
+    m_freeBlocks.clear();
+    m_freeBlocks[0] = capacity;
+
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capacity * sizeof(VoxelQuad), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ChunkVertexArena::dispose() {
+    if (m_vbo) {
+        glDeleteBuffers(1, &m_vbo);
+        m_vbo = 0;
+    }
+    m_capacity = 0;
+    m_numUsedQuads = 0;
+    std::map<ui32, ui32>().swap(m_freeBlocks);
+}
+
+ui32 ChunkVertexArena::allocate(ui32 numQuads) {
+    for (auto it = m_freeBlocks.begin(); it != m_freeBlocks.end(); ++it) {
+        if (it->second < numQuads) continue;
+        ui32 offset = it->first;
+        ui32 remaining = it->second - numQuads;
+        m_freeBlocks.erase(it);
+        if (remaining) m_freeBlocks[offset + numQuads] = remaining;
+        m_numUsedQuads += numQuads;
+        return offset;
+    }
+    return CHUNK_VERTEX_ARENA_NONE;
+}
+
+void ChunkVertexArena::free(ui32 offset, ui32 numQuads) {
+    m_numUsedQuads -= numQuads;
+    auto it = m_freeBlocks.emplace(offset, numQuads).first;
+    // Merge with the next block
+    auto next = std::next(it);
+    if (next != m_freeBlocks.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        m_freeBlocks.erase(next);
+    }
+    // Merge with the previous block
+    if (it != m_freeBlocks.begin()) {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            m_freeBlocks.erase(it);
+        }
+    }
+}
+
+void ChunkVertexArena::write(ui32 offset, const VoxelQuad* quads, ui32 numQuads) {
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)offset * sizeof(VoxelQuad), (GLsizeiptr)numQuads * sizeof(VoxelQuad), quads);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
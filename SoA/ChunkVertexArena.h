@@ -0,0 +1,49 @@
+///
+/// ChunkVertexArena.h
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// One vertex buffer that holds the opaque quads of many chunk
+/// meshes, so they can all be drawn with a single indirect call.
+///
+
+#pragma once
+
+#ifndef ChunkVertexArena_h__
+#define ChunkVertexArena_h__
+
+#include <Vorb/graphics/gtypes.h>
+
+#define CHUNK_VERTEX_ARENA_NONE UINT_MAX
+
+struct VoxelQuad;
+
+class ChunkVertexArena {
+public:
+    /// Creates the buffer. Call on render thread.
+    /// @param capacity: Number of quads the arena can hold
+    void init(ui32 capacity);
+    void dispose();
+
+    /// First fit allocation.
+    /// @return Offset in quads, or CHUNK_VERTEX_ARENA_NONE if there is no room
+    ui32 allocate(ui32 numQuads);
+    void free(ui32 offset, ui32 numQuads);
+    /// Uploads quads to a range returned by allocate. Call on render thread.
+    void write(ui32 offset, const VoxelQuad* quads, ui32 numQuads);
+
+    const VGVertexBuffer& getVbo() const { return m_vbo; }
+    const ui32& getCapacity() const { return m_capacity; }
+    const ui32& getNumUsedQuads() const { return m_numUsedQuads; }
+    size_t getNumFreeBlocks() const { return m_freeBlocks.size(); }
+private:
+    VGVertexBuffer m_vbo = 0;
+    ui32 m_capacity = 0;
+    ui32 m_numUsedQuads = 0;
+    std::map<ui32, ui32> m_freeBlocks; ///< Offset to size, neighbours are always merged
+};
+
+#endif // ChunkVertexArena_h__
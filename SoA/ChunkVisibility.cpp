@@ -0,0 +1,99 @@
+#include "stdafx.h"
+#include "ChunkVisibility.h"
+
+#include <Vorb/utils.h>
+#include "ChunkMesher.h"
+#include "Frustum.h"
+
+ui64 ChunkVisibility::computeConnections(const ui64* paddedOccluders) {
+    memset(m_visited, 0, sizeof(m_visited));
+    ui64 connections = 0;
+
+    for (int start = 0; start < CHUNK_SIZE; start++) {
+        if ((m_visited[start >> 6] >> (start & 63)) & 1) continue;
+        int x = start & (CHUNK_WIDTH - 1);
+        int z = (start / CHUNK_WIDTH) & (CHUNK_WIDTH - 1);
+        int y = start / CHUNK_LAYER;
+        int padded = (y + 1) * PADDED_CHUNK_LAYER + (z + 1) * PADDED_CHUNK_WIDTH + (x + 1);
+        if ((paddedOccluders[padded >> 6] >> (padded & 63)) & 1) continue;
+
+        // Fill the open region and note the faces it touches
+        ui32 faces = 0;
+        int stackSize = 0;
+        m_stack[stackSize++] = (ui16)start;
+        m_visited[start >> 6] |= 1ull << (start & 63);
+        while (stackSize) {
+            int i = m_stack[--stackSize];
+            x = i & (CHUNK_WIDTH - 1);
+            z = (i / CHUNK_WIDTH) & (CHUNK_WIDTH - 1);
+            y = i / CHUNK_LAYER;
+            padded = (y + 1) * PADDED_CHUNK_LAYER + (z + 1) * PADDED_CHUNK_WIDTH + (x + 1);
+
+            const int coords[3] = { x, y, z };
+            const int steps[3] = { 1, CHUNK_LAYER, CHUNK_WIDTH };
+            const int paddedSteps[3] = { 1, PADDED_CHUNK_LAYER, PADDED_CHUNK_WIDTH };
+            for (int axis = 0; axis < 3; axis++) {
+                for (int side = 0; side < 2; side++) {
+                    if (coords[axis] == (side ? CHUNK_WIDTH - 1 : 0)) {
+                        faces |= 1 << (axis * 2 + side);
+                        continue;
+                    }
+                    int next = side ? i + steps[axis] : i - steps[axis];
+                    int paddedNext = side ? padded + paddedSteps[axis] : padded - paddedSteps[axis];
+                    if ((m_visited[next >> 6] >> (next & 63)) & 1) continue;
+                    if ((paddedOccluders[paddedNext >> 6] >> (paddedNext & 63)) & 1) continue;
+                    m_visited[next >> 6] |= 1ull << (next & 63);
+                    m_stack[stackSize++] = (ui16)next;
+                }
+            }
+        }
+
+        for (int a = 0; a < CHUNK_VISIBILITY_FACES; a++) {
+            if (!(faces & (1 << a))) continue;
+            for (int b = 0; b < CHUNK_VISIBILITY_FACES; b++) {
+                if (faces & (1 << b)) connections |= 1ull << (a * CHUNK_VISIBILITY_FACES + b);
+            }
+        }
+        if (connections == CHUNK_FACES_ALL_CONNECTED) break;
+    }
+    return connections;
+}
+
+ui32 ChunkOcclusionCuller::markVisibleMeshes(const ChunkIDMap<ChunkMesh*>& meshes, const Frustum& frustum,
+                                             const f64v3& cameraPosition, const i32v3& minPos, const i32v3& maxPos, ui32 stamp) {
+    static const f32 CHUNK_RADIUS = CHUNK_WIDTH * 0.8660254f; // Half the diagonal
+    m_queue.clear();
+    m_walked.clear();
+
+    i32v3 cameraChunk(fastFloor(cameraPosition.x / CHUNK_WIDTH),
+                      fastFloor(cameraPosition.y / CHUNK_WIDTH),
+                      fastFloor(cameraPosition.z / CHUNK_WIDTH));
+    m_queue.push_back({ cameraChunk, -1, 0 });
+    m_walked.insert(ChunkID(cameraChunk).id);
+
+    for (size_t head = 0; head < m_queue.size(); head++) {
+        Step step = m_queue[head];
+        ui64 connections = CHUNK_FACES_ALL_CONNECTED;
+        auto it = meshes.find(ChunkID(step.chunkPos));
+        if (it != meshes.end()) {
+            it->second->occlusionStamp = stamp;
+            connections = it->second->renderData.faceConnections;
+        }
+
+        for (int face = 0; face < CHUNK_VISIBILITY_FACES; face++) {
+            if (step.directions & (1 << ChunkVisibility::getOppositeFace(face))) continue;
+            if (step.entryFace != -1 && !ChunkVisibility::areConnected(connections, step.entryFace, face)) continue;
+
+            i32v3 next = step.chunkPos + ChunkVisibility::getFaceOffset(face);
+            if (next.x < minPos.x || next.y < minPos.y || next.z < minPos.z ||
+                next.x > maxPos.x || next.y > maxPos.y || next.z > maxPos.z) continue;
+            if (!m_walked.insert(ChunkID(next).id).second) continue;
+
+            f64v3 center = f64v3(next) * (f64)CHUNK_WIDTH + f64v3(CHUNK_WIDTH / 2) - cameraPosition;
+            if (!frustum.sphereInFrustum(f32v3(center), CHUNK_RADIUS)) continue;
+
+            m_queue.push_back({ next, ChunkVisibility::getOppositeFace(face), step.directions | (1 << face) });
+        }
+    }
+    return (ui32)m_queue.size();
+}
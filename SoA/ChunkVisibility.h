@@ -0,0 +1,72 @@
+///
+/// ChunkVisibility.h
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// Which faces of a chunk can see each other through its open voxels,
+/// for skipping chunks hidden behind terrain.
+///
+
+#pragma once
+
+#ifndef ChunkVisibility_h__
+#define ChunkVisibility_h__
+
+#include "ChunkIDMap.hpp"
+#include "Constants.h"
+
+class ChunkMesh;
+class Frustum;
+
+// Faces are numbered like vvox::Cardinal: -x, +x, -y, +y, -z, +z
+#define CHUNK_VISIBILITY_FACES 6
+// Bit a * 6 + b is set when face b can be seen from face a
+#define CHUNK_FACES_ALL_CONNECTED 0xFFFFFFFFFull
+
+class ChunkVisibility {
+public:
+    /// Flood fills the open voxels of a chunk. Faces touched by the same open region are connected.
+    /// @param paddedOccluders: Bit per voxel of a padded chunk that hides what is behind it, see ChunkMesher
+    /// @return Face connection bits
+    ui64 computeConnections(const ui64* paddedOccluders);
+
+    static bool areConnected(ui64 connections, int faceA, int faceB) {
+        return ((connections >> (faceA * CHUNK_VISIBILITY_FACES + faceB)) & 1) != 0;
+    }
+    static int getOppositeFace(int face) { return face ^ 1; }
+    static i32v3 getFaceOffset(int face) {
+        i32v3 offset(0);
+        offset[face >> 1] = (face & 1) ? 1 : -1;
+        return offset;
+    }
+private:
+    ui64 m_visited[CHUNK_SIZE / 64];
+    ui16 m_stack[CHUNK_SIZE];
+};
+
+/// Finds the chunks the camera can see through the open voxels of the chunks in between
+class ChunkOcclusionCuller {
+public:
+    /// Walks breadth first from the camera chunk. Each step has to leave a chunk through a face
+    /// connected to the one it came in by, and never heads back toward the camera.
+    /// @param meshes: Meshes by chunk ID. Chunks without one are treated as open air.
+    /// @param frustum: Relative to cameraPosition. Only chunks in it are walked through.
+    /// @param minPos, maxPos: Chunk position bounds of the walk
+    /// @param stamp: Written to ChunkMesh::occlusionStamp of every reached mesh
+    /// @return Number of chunks walked through
+    ui32 markVisibleMeshes(const ChunkIDMap<ChunkMesh*>& meshes, const Frustum& frustum,
+                           const f64v3& cameraPosition, const i32v3& minPos, const i32v3& maxPos, ui32 stamp);
+private:
+    struct Step {
+        i32v3 chunkPos;
+        i32 entryFace; ///< -1 for the camera chunk
+        ui32 directions; ///< Bit per face stepped through to get here
+    };
+    std::vector<Step> m_queue;
+    std::unordered_set<ui64> m_walked;
+};
+
+#endif // ChunkVisibility_h__
@@ -112,5 +112,77 @@ void registerFuncs(vscript::Environment& env) {
     env.setNamespaces("CHS");
     env.addCDelegate("run", makeDelegate(runCHS));
 
+    env.setNamespaces("MDT");
+    env.addCRDelegate("run", makeRDelegate(runMDT));
+
+    env.setNamespaces("RFB");
+    env.addCRDelegate("run", makeRDelegate(runRFB));
+
+    env.setNamespaces("WGB");
+    env.addCRDelegate("run", makeRDelegate(runWGB));
+
+    env.setNamespaces("MMB");
+    env.addCRDelegate("run", makeRDelegate(runMMB));
+
+    env.setNamespaces("PGC");
+    env.addCRDelegate("run", makeRDelegate(runPGC));
+
+    env.setNamespaces("FCB");
+    env.addCRDelegate("run", makeRDelegate(runFCB));
+
+    env.setNamespaces("GRB");
+    env.addCRDelegate("run", makeRDelegate(runGRB));
+
+    env.setNamespaces("OPB");
+    env.addCRDelegate("run", makeRDelegate(runOPB));
+
+    env.setNamespaces("MDP");
+    env.addCRDelegate("run", makeRDelegate(runMDP));
+
+    env.setNamespaces("VMP");
+    env.addCRDelegate("run", makeRDelegate(runVMP));
+
+    env.setNamespaces("MIB");
+    env.addCRDelegate("run", makeRDelegate(runMIB));
+
+    env.setNamespaces("AOB");
+    env.addCRDelegate("run", makeRDelegate(runAOB));
+
+    env.setNamespaces("BTL");
+    env.addCRDelegate("run", makeRDelegate(runBTL));
+
+    env.setNamespaces("MPR");
+    env.addCRDelegate("run", makeRDelegate(runMPR));
+
+    env.setNamespaces("MDI");
+    env.addCRDelegate("run", makeRDelegate(runMDI));
+
+    env.setNamespaces("LOD");
+    env.addCRDelegate("run", makeRDelegate(runLOD));
+
+    env.setNamespaces("OCC");
+    env.addCRDelegate("run", makeRDelegate(runOCC));
+
+    env.setNamespaces("TMB");
+    env.addCRDelegate("run", makeRDelegate(runTMB));
+
+    env.setNamespaces("CRS");
+    env.addCRDelegate("run", makeRDelegate(runCRS));
+
+    env.setNamespaces("CAL");
+    env.addCRDelegate("run", makeRDelegate(runCAL));
+
+    env.setNamespaces("CHM");
+    env.addCRDelegate("run", makeRDelegate(runCHM));
+
+    env.setNamespaces("LQS");
+    env.addCRDelegate("run", makeRDelegate(runLQS));
+
+    env.setNamespaces("BUP");
+    env.addCRDelegate("run", makeRDelegate(runBUP));
+
+    env.setNamespaces("CED");
+    env.addCRDelegate("run", makeRDelegate(runCED));
+
     env.setNamespaces();
 }
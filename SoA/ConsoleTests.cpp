@@ -1,11 +1,43 @@
 #include "stdafx.h"
 #include "ConsoleTests.h"
 
+#include "BlockPack.h"
+#include "BlockTextureAtlasCache.h"
+#include "BlockTextureLoader.h"
+#include "BlockTexturePack.h"
+#include "BlockUpdateScheduler.h"
 #include "ChunkAllocator.h"
 #include "ChunkAccessor.h"
+#include "ChunkEditJournal.h"
+#include "ChunkIOManager.h"
+#include "ChunkIDMap.hpp"
+#include "ChunkMeshClassifier.h"
+#include "ChunkMeshDataPool.h"
+#include "ChunkMesher.h"
+#include "ChunkRenderer.h"
+#include "ChunkUpdater.h"
+#include "ChunkVisibility.h"
+#include "Frustum.h"
+#include "GpuReadback.h"
+#include "LiquidSimulation.h"
+#include "LoadTaskBlockData.h"
+#include "ModelMesher.h"
+#include "ModPathResolver.h"
+#include "OrbitComponentRenderer.h"
+#include "OrbitComponentUpdater.h"
+#include "PlanetGenData.h"
+#include "PlanetGenLoader.h"
+#include "RegionFileManager.h"
+#include "SpaceSystemComponents.h"
+#include "VoxelModel.h"
+#include "VoxelModelMeshCache.h"
+#include "WorldGenBenchmark.h"
 
+#include <algorithm>
+#include <numeric>
 #include <random>
 #include <Vorb/Timing.h>
+#include <Vorb/io/IOManager.h>
 
 struct ChunkAccessSpeedData {
     size_t numThreads;
@@ -102,3 +134,2102 @@ void runCHS() {
     h2.release();
     h1.release();
 }
+
+namespace {
+    // Fills a chunk with a fixed pseudo-random pattern of the given block
+    void fillTestChunk(ChunkHandle& chunk, BlockID id, ui32 seed) {
+        chunk->initAndFillEmpty(WorldCubeFace::FACE_TOP);
+        chunk->blocks.changeState(vvox::VoxelStorageState::FLAT_ARRAY, chunk->dataMutex);
+        std::mt19937 rEngine(seed);
+        std::uniform_int_distribution<int> solid(0, 2);
+        for (int i = 0; i < CHUNK_SIZE; i++) {
+            if (solid(rEngine)) chunk->blocks.set(i, id);
+        }
+    }
+
+    bool equalQuads(const std::vector<VoxelQuad>& a, const std::vector<VoxelQuad>& b) {
+        return a.size() == b.size() && (a.empty() || !memcmp(&a[0], &b[0], a.size() * sizeof(VoxelQuad)));
+    }
+}
+
+bool runMDT() {
+    // Random textured block, so variation must come from the position hash
+    BlockTexture texture;
+    texture.layers.base.method = ConnectedTextureMethods::RANDOM;
+    texture.layers.base.numTiles = 4;
+    texture.layers.base.totalWeight = 4;
+    texture.layers.base.initBlockTextureFunc();
+
+    BlockPack blocks;
+    Block b;
+    b.sID = "test";
+    for (int i = 0; i < 6; i++) b.textures[i] = &texture;
+    BlockID id = blocks.append(b);
+
+    PagedChunkAllocator allocator = {};
+    ChunkAccessor accessor = {};
+    accessor.init(&allocator);
+
+    ChunkHandle chunk = accessor.acquire(ChunkID(3, -2, 7));
+    ChunkHandle other = accessor.acquire(ChunkID(-5, 1, 2));
+    fillTestChunk(chunk, id, 1);
+    fillTestChunk(other, id, 2);
+
+    // The mesher is too big for the stack
+    ChunkMesher* mesherA = new ChunkMesher;
+    ChunkMesher* mesherB = new ChunkMesher;
+    mesherA->init(&blocks);
+    mesherB->init(&blocks);
+
+    mesherA->prepareData(chunk);
+    ChunkMeshData* first = mesherA->createChunkMeshData(MeshTaskType::DEFAULT);
+    // Dirty the first mesher's state before remeshing
+    mesherA->prepareData(other);
+    delete mesherA->createChunkMeshData(MeshTaskType::DEFAULT);
+    mesherA->prepareData(chunk);
+    ChunkMeshData* remesh = mesherA->createChunkMeshData(MeshTaskType::DEFAULT);
+    // And a different worker
+    mesherB->prepareData(chunk);
+    ChunkMeshData* otherWorker = mesherB->createChunkMeshData(MeshTaskType::DEFAULT);
+
+    // Make sure the test isn't vacuous
+    std::set<ui8> variants;
+    for (auto& q : first->opaqueQuads) variants.insert(q.v.v0.texturePosition.base.index);
+
+    bool passed = variants.size() > 1 &&
+        equalQuads(first->opaqueQuads, remesh->opaqueQuads) &&
+        equalQuads(first->opaqueQuads, otherWorker->opaqueQuads) &&
+        equalQuads(first->cutoutQuads, remesh->cutoutQuads) &&
+        equalQuads(first->cutoutQuads, otherWorker->cutoutQuads);
+    printf("Mesh determinism: %zu quads, %zu texture variants, %s\n",
+           first->opaqueQuads.size(), variants.size(), passed ? "PASSED" : "FAILED");
+
+    delete first;
+    delete remesh;
+    delete otherWorker;
+    delete mesherA;
+    delete mesherB;
+    chunk.release();
+    other.release();
+    accessor.destroy();
+    return passed;
+}
+
+namespace {
+    size_t getFileSize(const nString& path) {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file) return 0;
+        fseek(file, 0, SEEK_END);
+        size_t size = (size_t)ftell(file);
+        fclose(file);
+        return size;
+    }
+}
+
+bool runMDP(ui32 numRemeshes) {
+    BlockTexture texture;
+    texture.layers.base.initBlockTextureFunc();
+    BlockPack blocks;
+    Block b;
+    b.sID = "test";
+    for (int i = 0; i < 6; i++) b.textures[i] = &texture;
+    BlockID id = blocks.append(b);
+
+    PagedChunkAllocator allocator = {};
+    ChunkAccessor accessor = {};
+    accessor.init(&allocator);
+
+    // A few chunks so mesh sizes jump around between remeshes
+    const int NUM_CHUNKS = 4;
+    ChunkHandle chunks[NUM_CHUNKS];
+    for (int i = 0; i < NUM_CHUNKS; i++) {
+        chunks[i] = accessor.acquire(ChunkID(i, 0, 0));
+        fillTestChunk(chunks[i], id, i + 1);
+    }
+    // Thin out one of them to get a small mesh
+    for (int i = 0; i < CHUNK_SIZE; i++) {
+        if (i % 7) chunks[0]->blocks.set(i, 0);
+    }
+
+    ChunkMesher* mesher = new ChunkMesher;
+    mesher->init(&blocks);
+
+    ChunkMeshData* reference[NUM_CHUNKS];
+    for (int i = 0; i < NUM_CHUNKS; i++) {
+        mesher->prepareData(chunks[i]);
+        reference[i] = mesher->createChunkMeshData(MeshTaskType::DEFAULT);
+    }
+
+    // Old path, new mesh data per remesh that is freed after upload
+    PreciseTimer timer;
+    timer.start();
+    for (ui32 i = 0; i < numRemeshes; i++) {
+        mesher->prepareData(chunks[i % NUM_CHUNKS]);
+        delete mesher->createChunkMeshData(MeshTaskType::DEFAULT);
+    }
+    f64 freshMs = timer.stop();
+
+    // Pooled, sized from the previous mesh of the same chunk
+    ChunkMeshDataPool pool;
+    bool passed = true;
+    timer.start();
+    for (ui32 i = 0; i < numRemeshes; i++) {
+        int c = i % NUM_CHUNKS;
+        mesher->prepareData(chunks[c]);
+        ChunkMeshData* meshData = pool.alloc((ui32)reference[c]->opaqueQuads.size(), (ui32)reference[c]->cutoutQuads.size());
+        mesher->createChunkMeshData(MeshTaskType::DEFAULT, meshData);
+        passed &= equalQuads(meshData->opaqueQuads, reference[c]->opaqueQuads) &&
+                  equalQuads(meshData->cutoutQuads, reference[c]->cutoutQuads) &&
+                  meshData->chunkMeshRenderData.indexSize == reference[c]->chunkMeshRenderData.indexSize;
+        pool.recycle(meshData);
+    }
+    f64 pooledMs = timer.stop();
+
+    printf("%u remeshes over %d chunks (%zu to %zu quads):\n", numRemeshes, NUM_CHUNKS,
+           reference[0]->opaqueQuads.size(), reference[NUM_CHUNKS - 1]->opaqueQuads.size());
+    printf("  fresh mesh data:  %lf ms, %u allocations\n", freshMs, numRemeshes);
+    printf("  pooled mesh data: %lf ms, %u allocations\n", pooledMs, pool.getNumMisses());
+    passed &= pool.getNumMisses() <= (ui32)NUM_CHUNKS;
+    printf("Mesh data pool %s\n", passed ? "PASSED" : "FAILED");
+
+    for (int i = 0; i < NUM_CHUNKS; i++) {
+        delete reference[i];
+        chunks[i].release();
+    }
+    delete mesher;
+    accessor.destroy();
+    return passed;
+}
+
+bool runRFB() {
+    const nString SAVE_DIR = "RFBTest";
+    const nString REGION = "r.0.0.0";
+    const nString REGION_PATH = SAVE_DIR + "/Region/" + REGION + ".soar";
+    const int NUM_PASSES = 3;
+
+    vio::IOManager().makeDirectory(SAVE_DIR);
+    vio::IOManager().makeDirectory(SAVE_DIR + "/Region");
+    remove(REGION_PATH.c_str());
+
+    // Has large internal buffers
+    RegionFileManager* regions = new RegionFileManager(SAVE_DIR);
+
+    std::mt19937 rEngine(0);
+    // Roughly the spread of compressed chunk sizes
+    std::uniform_int_distribution<ui32> payloadSize(SECTOR_SIZE / 2, SECTOR_SIZE * 8);
+    std::vector<ui32> order(REGION_SIZE);
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<ui32> sizes(REGION_SIZE);
+    std::vector<ui8> payload(SECTOR_SIZE * 8);
+
+    // Every pass resizes each chunk, so later passes exercise relocation
+    bool passed = true;
+    for (int pass = 0; pass < NUM_PASSES && passed; pass++) {
+        std::shuffle(order.begin(), order.end(), rEngine);
+        PreciseTimer timer;
+        timer.start();
+        for (ui32 i : order) {
+            sizes[i] = payloadSize(rEngine);
+            for (ui32 j = 0; j < sizes[i]; j++) payload[j] = (ui8)(i * 31 + j + pass);
+            if (!regions->saveChunkData(REGION, i, &payload[0], sizes[i])) {
+                passed = false;
+                break;
+            }
+        }
+        f64 ms = timer.stop();
+        printf("Pass %d: saved %d chunks in %lf ms (%lf us/chunk), file %zu KiB\n",
+               pass, REGION_SIZE, ms, ms * 1000.0 / REGION_SIZE, getFileSize(REGION_PATH) / 1024);
+    }
+
+    if (passed) {
+        PreciseTimer timer;
+        timer.start();
+        passed = regions->compactRegionFile(REGION);
+        printf("Compaction: %lf ms, file %zu KiB\n", timer.stop(), getFileSize(REGION_PATH) / 1024);
+    }
+
+    // Reopens the compacted file, so this also checks the rebuilt sector map
+    std::vector<ui8> data;
+    for (ui32 i = 0; i < REGION_SIZE && passed; i++) {
+        passed = regions->loadChunkData(REGION, i, data) && data.size() == sizes[i];
+        for (ui32 j = 0; j < data.size() && passed; j++) {
+            passed = data[j] == (ui8)(i * 31 + j + NUM_PASSES - 1);
+        }
+    }
+    printf("Region file benchmark: %s\n", passed ? "PASSED" : "FAILED");
+
+    delete regions;
+    remove(REGION_PATH.c_str());
+    return passed;
+}
+
+bool runWGB(const cString planetName, ui32 numFrames) {
+    WorldGenBenchmarkConfig config;
+    config.planetName = planetName;
+    config.numFrames = numFrames;
+    WorldGenBenchmarkResults results;
+    if (!WorldGenBenchmark::run(config, results)) return false;
+    puts(WorldGenBenchmark::toJSON(config, results).c_str());
+    return true;
+}
+
+namespace {
+    // Fills a chunk with layered terrain around a rolling surface, with glass pockets in the stone
+    void fillTerrainChunk(ChunkHandle& chunk, const BlockID ids[4], ui32 seed) {
+        chunk->initAndFillEmpty(WorldCubeFace::FACE_TOP);
+        chunk->blocks.changeState(vvox::VoxelStorageState::FLAT_ARRAY, chunk->dataMutex);
+        std::mt19937 rEngine(seed);
+        std::uniform_int_distribution<int> pocket(0, 15);
+        f32 phase = (f32)(seed % 64);
+        for (int z = 0; z < CHUNK_WIDTH; z++) {
+            for (int x = 0; x < CHUNK_WIDTH; x++) {
+                int height = CHUNK_WIDTH / 2 + (int)(6.0f * sin((x + phase) * 0.3f) * cos((z - phase) * 0.2f));
+                for (int y = 0; y <= height && y < CHUNK_WIDTH; y++) {
+                    BlockID id;
+                    if (y == height) {
+                        id = ids[2];
+                    } else if (y > height - 4) {
+                        id = ids[1];
+                    } else {
+                        id = pocket(rEngine) ? ids[0] : ids[3];
+                    }
+                    chunk->blocks.set(y * CHUNK_LAYER + z * CHUNK_WIDTH + x, id);
+                }
+            }
+        }
+    }
+}
+
+bool runMMB(ui32 numChunks) {
+    BlockTexture texture;
+    texture.layers.base.initBlockTextureFunc();
+
+    BlockPack blocks;
+    const char* names[4] = { "stone", "dirt", "grass", "glass" };
+    BlockID ids[4];
+    for (int i = 0; i < 4; i++) {
+        Block b;
+        b.sID = names[i];
+        b.meshType = MeshType::BLOCK;
+        b.occlude = (i == 3) ? BlockOcclusion::SELF : BlockOcclusion::ALL;
+        for (int j = 0; j < 6; j++) b.textures[j] = &texture;
+        ids[i] = blocks.append(b);
+    }
+
+    PagedChunkAllocator allocator = {};
+    ChunkAccessor accessor = {};
+    accessor.init(&allocator);
+    std::vector<ChunkHandle> chunks(numChunks);
+    for (ui32 i = 0; i < numChunks; i++) {
+        chunks[i] = accessor.acquire(ChunkID(i, 0, 0));
+        fillTerrainChunk(chunks[i], ids, i + 1);
+    }
+
+    // The mesher is too big for the stack
+    ChunkMesher* mesher = new ChunkMesher;
+    mesher->init(&blocks);
+
+    // Full meshing through the per-ID tables
+    size_t numQuads = 0;
+    f64 meshMs = 0.0;
+    for (ui32 i = 0; i < numChunks; i++) {
+        PreciseTimer timer;
+        timer.start();
+        mesher->prepareData(chunks[i]);
+        ChunkMeshData* data = mesher->createChunkMeshData(MeshTaskType::DEFAULT);
+        meshMs += timer.stop();
+        numQuads += data->opaqueQuads.size();
+        delete data;
+    }
+
+    // Face culling alone, once through the Block structs and once through the occlusion
+    // table. Cache misses can't be counted portably, so report the bytes each lookup pulls in.
+    const int OFFSETS[6] = { -1, 1, -PADDED_CHUNK_LAYER, PADDED_CHUNK_LAYER, -PADDED_CHUNK_WIDTH, PADDED_CHUNK_WIDTH };
+    size_t blockFaces = 0, tableFaces = 0;
+    f64 blockMs = 0.0, tableMs = 0.0;
+    for (ui32 i = 0; i < numChunks; i++) {
+        mesher->prepareData(chunks[i]);
+        const ui16* data = mesher->blockData;
+        PreciseTimer timer;
+        timer.start();
+        for (int y = 1; y <= CHUNK_WIDTH; y++) for (int z = 1; z <= CHUNK_WIDTH; z++) for (int x = 1; x <= CHUNK_WIDTH; x++) {
+            int c = y * PADDED_CHUNK_LAYER + z * PADDED_CHUNK_WIDTH + x;
+            if (data[c] == 0) continue;
+            for (int f = 0; f < 6; f++) {
+                const Block& neighbor = blocks[data[c + OFFSETS[f]]];
+                if (neighbor.occlude == BlockOcclusion::ALL) continue;
+                if (neighbor.occlude == BlockOcclusion::SELF && neighbor.ID == data[c]) continue;
+                blockFaces++;
+            }
+        }
+        blockMs += timer.stop();
+        timer.start();
+        for (int y = 1; y <= CHUNK_WIDTH; y++) for (int z = 1; z <= CHUNK_WIDTH; z++) for (int x = 1; x <= CHUNK_WIDTH; x++) {
+            int c = y * PADDED_CHUNK_LAYER + z * PADDED_CHUNK_WIDTH + x;
+            if (data[c] == 0) continue;
+            for (int f = 0; f < 6; f++) {
+                BlockID id = data[c + OFFSETS[f]];
+                ui8 occlusion = blocks.getOcclusion(id);
+                if (occlusion & BLOCK_OCCLUDES_ALL) continue;
+                if ((occlusion & BLOCK_OCCLUDES_SELF) && id == data[c]) continue;
+                tableFaces++;
+            }
+        }
+        tableMs += timer.stop();
+    }
+
+    bool passed = numQuads > 0 && blockFaces == tableFaces;
+    printf("Meshing: %u chunks, %zu quads, %lf us/chunk, %lf ns/voxel\n",
+           numChunks, numQuads, meshMs * 1000.0 / numChunks, meshMs * 1e6 / ((f64)numChunks * CHUNK_SIZE));
+    printf("Face culling via Block (%zu bytes/lookup): %lf us/chunk\n", sizeof(Block), blockMs * 1000.0 / numChunks);
+    printf("Face culling via table (%zu bytes/lookup): %lf us/chunk\n", sizeof(ui8), tableMs * 1000.0 / numChunks);
+    printf("Mesher table benchmark: %zu visible faces, %s\n", tableFaces, passed ? "PASSED" : "FAILED");
+
+    delete mesher;
+    for (auto& chunk : chunks) chunk.release();
+    accessor.destroy();
+    return passed;
+}
+
+namespace {
+    bool equalInfluenceMaps(const PlanetGenData* a, const PlanetGenData* b) {
+        for (int y = 0; y < BIOME_MAP_WIDTH; y++) {
+            for (int x = 0; x < BIOME_MAP_WIDTH; x++) {
+                auto& ia = a->baseBiomeInfluenceMap[y][x];
+                auto& ib = b->baseBiomeInfluenceMap[y][x];
+                if (ia.size() != ib.size()) return false;
+                for (size_t i = 0; i < ia.size(); i++) {
+                    // Compare by index since the biomes live in different PlanetGenData
+                    if ((ia[i].b ? ia[i].b - &a->biomes[0] : -1) != (ib[i].b ? ib[i].b - &b->biomes[0] : -1)) return false;
+                    if (ia[i].weight != ib[i].weight) return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+bool runPGC(const cString searchDir, const cString terrainPath) {
+    vio::IOManager iom;
+    iom.setSearchDirectory(searchDir);
+    PlanetGenLoader loader;
+    loader.init(&iom);
+
+    // Cold, parsing only
+    loader.setUseCache(false);
+    PlanetGenData* cold = loader.loadPlanetGenData(terrainPath);
+    f64 coldMs = loader.getLastLoadMs();
+    if (!cold) {
+        printf("Failed to load %s%s\n", searchDir, terrainPath);
+        return false;
+    }
+
+    // Cold again, writing the image
+    loader.setUseCache(true);
+    vio::Path cachePath;
+    if (iom.resolvePath(nString(terrainPath) + ".bin", cachePath)) remove(cachePath.getString().c_str());
+    delete loader.loadPlanetGenData(terrainPath);
+    f64 writeMs = loader.getLastLoadMs();
+
+    // Warm
+    PlanetGenData* warm = loader.loadPlanetGenData(terrainPath);
+    f64 warmMs = loader.getLastLoadMs();
+
+    bool passed = warm && loader.lastLoadUsedCache() &&
+        warm->biomes.size() == cold->biomes.size() &&
+        warm->blockInfo.flora.size() == cold->blockInfo.flora.size() &&
+        warm->blockInfo.trees.size() == cold->blockInfo.trees.size() &&
+        warm->blockInfo.blockLayers.size() == cold->blockInfo.blockLayers.size() &&
+        warm->baseTerrainFuncs.funcs.size() == cold->baseTerrainFuncs.funcs.size() &&
+        equalInfluenceMaps(cold, warm);
+    printf("Planet gen load %s: cold %lf ms, cold + cache write %lf ms, warm %lf ms (%.1fx)\n",
+           terrainPath, coldMs, writeMs, warmMs, warmMs > 0.0 ? coldMs / warmMs : 0.0);
+    printf("Planet gen cache: %zu biomes, %s\n", cold->biomes.size(), passed ? "PASSED" : "FAILED");
+
+    delete cold;
+    delete warm;
+    return passed;
+}
+
+#define FCB_ITERATIONS 100
+
+bool runFCB(ui32 numSpheres, ui32 numThreads) {
+    if (numThreads == 0) numThreads = 1;
+
+    Frustum frustum;
+    frustum.setCamInternals(70.0f, 16.0f / 9.0f, 0.1f, 100000.0f);
+    frustum.update(f32v3(0.0f), f32v3(0.3f, 0.1f, -1.0f), f32v3(0.0f, 1.0f, 0.0f));
+
+    // Chunk sized spheres around the camera, like a chunk mesh list at high render distance
+    FrustumSpheres spheres;
+    std::mt19937 rEngine(0);
+    std::uniform_real_distribution<f32> coord(-4000.0f, 4000.0f);
+    for (ui32 i = 0; i < numSpheres; i++) {
+        spheres.add(f32v3(coord(rEngine), coord(rEngine), coord(rEngine)), 28.0f);
+    }
+    const f32v3 offset(16.0f, -8.0f, 4.0f);
+
+    std::vector<ui32> scalarVisible;
+    PreciseTimer timer;
+    timer.start();
+    for (int it = 0; it < FCB_ITERATIONS; it++) {
+        scalarVisible.clear();
+        for (ui32 i = 0; i < numSpheres; i++) {
+            f32v3 pos(spheres.x[i] - offset.x, spheres.y[i] - offset.y, spheres.z[i] - offset.z);
+            if (frustum.sphereInFrustum(pos, spheres.radius[i])) scalarVisible.push_back(i);
+        }
+    }
+    f64 scalarMs = timer.stop() / FCB_ITERATIONS;
+
+    std::vector<ui32> batchVisible;
+    timer.start();
+    for (int it = 0; it < FCB_ITERATIONS; it++) {
+        batchVisible.clear();
+        frustum.cullSpheres(spheres, offset, 0, numSpheres, batchVisible);
+    }
+    f64 batchMs = timer.stop() / FCB_ITERATIONS;
+
+    // Each thread culls a contiguous range, so concatenating keeps the order
+    std::vector<std::vector<ui32>> threadVisible(numThreads);
+    std::vector<ui32> splitVisible;
+    timer.start();
+    for (int it = 0; it < FCB_ITERATIONS; it++) {
+        std::vector<std::thread> threads;
+        size_t rangeSize = (numSpheres + numThreads - 1) / numThreads;
+        for (ui32 t = 0; t < numThreads; t++) {
+            size_t begin = std::min((size_t)numSpheres, t * rangeSize);
+            size_t end = std::min((size_t)numSpheres, begin + rangeSize);
+            threadVisible[t].clear();
+            threads.emplace_back([&, t, begin, end]() {
+                frustum.cullSpheres(spheres, offset, begin, end, threadVisible[t]);
+            });
+        }
+        splitVisible.clear();
+        for (ui32 t = 0; t < numThreads; t++) {
+            threads[t].join();
+            splitVisible.insert(splitVisible.end(), threadVisible[t].begin(), threadVisible[t].end());
+        }
+    }
+    f64 splitMs = timer.stop() / FCB_ITERATIONS;
+
+    bool passed = batchVisible == scalarVisible && splitVisible == scalarVisible;
+    printf("Frustum cull %u spheres, %zu visible: scalar %lf ms, batched %lf ms (%.1fx), %u threads %lf ms\n",
+           numSpheres, scalarVisible.size(), scalarMs, batchMs, batchMs > 0.0 ? scalarMs / batchMs : 0.0,
+           numThreads, splitMs);
+    printf("Frustum cull results %s\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+bool runGRB() {
+    bool passed = true;
+
+    { // Texture readback, each copy sees different texels
+        const int WIDTH = 2;
+        f32 texels[WIDTH * WIDTH * 4];
+        VGTexture texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, WIDTH, WIDTH, 0, GL_RGBA, GL_FLOAT, nullptr);
+
+        TextureReadback readback;
+        readback.init(sizeof(texels));
+        for (int i = 0; i < GPU_READBACK_FRAMES; i++) {
+            for (int j = 0; j < WIDTH * WIDTH * 4; j++) texels[j] = (f32)(i * 100 + j);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, WIDTH, WIDTH, GL_RGBA, GL_FLOAT, texels);
+            passed &= readback.readTexture(GL_TEXTURE_2D, GL_RGBA, GL_FLOAT);
+        }
+        passed &= !readback.readTexture(GL_TEXTURE_2D, GL_RGBA, GL_FLOAT);
+
+        glFinish();
+        for (int i = 0; i < GPU_READBACK_FRAMES; i++) {
+            passed &= readback.poll(texels);
+            for (int j = 0; j < WIDTH * WIDTH * 4; j++) passed &= (texels[j] == (f32)(i * 100 + j));
+        }
+        passed &= !readback.poll(texels);
+        printf("Texture readback %s\n", passed ? "PASSED" : "FAILED");
+
+        readback.dispose();
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDeleteTextures(1, &texture);
+    }
+
+    { // Query readback, timer queries need no draw state
+        bool queryPassed = true;
+        QueryReadback readback;
+        readback.init(GL_TIME_ELAPSED, 2);
+        for (int i = 0; i < GPU_READBACK_FRAMES; i++) {
+            queryPassed &= readback.beginFrame();
+            readback.beginQuery(0);
+            readback.endQuery();
+            readback.beginQuery(1);
+            readback.endQuery();
+            readback.endFrame();
+        }
+        queryPassed &= !readback.beginFrame();
+
+        glFinish();
+        GLint results[2];
+        for (int i = 0; i < GPU_READBACK_FRAMES; i++) {
+            queryPassed &= readback.poll(results) && results[0] >= 0 && results[1] >= 0;
+        }
+        queryPassed &= !readback.poll(results) && readback.beginFrame();
+        printf("Query readback %s\n", queryPassed ? "PASSED" : "FAILED");
+
+        readback.dispose();
+        passed &= queryPassed;
+    }
+    return passed;
+}
+
+bool runOPB(ui32 numBodies) {
+    // Synthetic system, no parents so paths are relative to the origin
+    std::vector<OrbitComponent> orbits(numBodies);
+    std::mt19937 rEngine(0);
+    std::uniform_real_distribution<f64> unit(0.0, 1.0);
+    for (auto& cmp : orbits) {
+        cmp.a = 1e5 + unit(rEngine) * 1e9;
+        cmp.e = unit(rEngine) * 0.9;
+        cmp.b = cmp.a * sqrt(1.0 - cmp.e * cmp.e);
+        cmp.t = 1e6 + unit(rEngine) * 1e9;
+        cmp.i = unit(rEngine) * M_PI * 0.5;
+        cmp.o = unit(rEngine) * M_PI * 2.0;
+        cmp.p = unit(rEngine) * M_PI * 2.0;
+        cmp.startMeanAnomaly = unit(rEngine) * M_PI * 2.0;
+        cmp.parentMass = 2e30;
+        cmp.isCalculated = true;
+    }
+
+    // Old load path, stepwise simulation into a vertex buffer per body
+    OrbitComponentUpdater updater;
+    NamePositionComponent npCmp;
+    std::vector<f32v4> verts(ORBIT_PATH_VERTS + 1);
+    f64 maxError = 0.0;
+    PreciseTimer timer;
+    timer.start();
+    for (auto& cmp : orbits) {
+        f64 timePerDeg = cmp.t / (f64)ORBIT_PATH_VERTS;
+        for (int i = 0; i < ORBIT_PATH_VERTS; i++) {
+            updater.updatePosition(cmp, i * timePerDeg, &npCmp);
+            verts[i] = f32v4(f32v3(npCmp.position), 1.0f - (f32)i / (f32)ORBIT_PATH_VERTS);
+        }
+        verts.back() = verts.front();
+    }
+    f64 bakeMs = timer.stop();
+
+    // Spot check that the instanced path matches the stepwise simulation
+    for (auto& cmp : orbits) {
+        for (int i = 0; i < ORBIT_PATH_VERTS; i += ORBIT_PATH_VERTS / 8) {
+            updater.updatePosition(cmp, i * (cmp.t / (f64)ORBIT_PATH_VERTS), &npCmp);
+            f64v3 pos = OrbitComponentRenderer::getPathPosition(cmp, (f64)i / (f64)ORBIT_PATH_VERTS);
+            maxError = glm::max(maxError, glm::length(pos - npCmp.position) / cmp.a);
+        }
+    }
+
+    // New path, nothing is baked at load. This is the per frame instance upload.
+    OrbitComponentRenderer renderer;
+    timer.start();
+    for (auto& cmp : orbits) {
+        cmp.pathColor[0] = f32v4(1.0f);
+        renderer.addPath(cmp, f64v3(0.0), 0.0f);
+    }
+    f64 instanceMs = timer.stop();
+
+    size_t bakedBytes = (size_t)numBodies * (ORBIT_PATH_VERTS + 1) * (sizeof(f32v3) + sizeof(f32));
+    size_t instancedBytes = (ORBIT_PATH_VERTS + 1) * sizeof(f32) + (size_t)numBodies * sizeof(OrbitComponentRenderer::PathInstance);
+    printf("Orbit paths for %u bodies:\n", numBodies);
+    printf("  baked:     load %lf ms, %zu KiB GPU, %u draw calls\n", bakeMs, bakedBytes / 1024, numBodies);
+    printf("  instanced: load 0 ms, %lf ms per frame to stream instances, %zu KiB GPU, 1 draw call\n",
+           instanceMs, instancedBytes / 1024);
+
+    bool passed = maxError < 1e-9;
+    printf("Orbit path max relative error %g %s\n", maxError, passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+bool runVMP(const cString modelPath) {
+    VoxelModel model;
+    VoxelModelMetrics loadMetrics;
+    if (!model.loadFromFile(modelPath, &loadMetrics)) {
+        printf("Failed to load %s\n", modelPath);
+        return false;
+    }
+    const VoxelMatrix& matrix = model.getMatrix();
+
+    // Cold, with no cache on disk
+    remove(VoxelModelMeshCache::getCachePath(modelPath, "greedy").c_str());
+    std::vector<VoxelModelVertex> vertices, cachedVertices;
+    std::vector<ui32> indices, cachedIndices;
+    VoxelModelMetrics cold, warm;
+    ModelMesher::genMesh(&model, vertices, indices, &cold);
+    // Warm, from the cache the cold run wrote
+    ModelMesher::genMesh(&model, cachedVertices, cachedIndices, &warm);
+
+    // Every visible voxel face should be covered exactly once, so the quad areas add up to the face count
+    const i32v3 SIDES[6] = { i32v3(-1, 0, 0), i32v3(1, 0, 0), i32v3(0, -1, 0), i32v3(0, 1, 0), i32v3(0, 0, -1), i32v3(0, 0, 1) };
+    ui32 numFaces = 0;
+    for (i32 z = 0; z < (i32)matrix.size.z; z++) {
+        for (i32 y = 0; y < (i32)matrix.size.y; y++) {
+            for (i32 x = 0; x < (i32)matrix.size.x; x++) {
+                if (matrix.getColor(x, y, z).a == 0) continue;
+                for (int face = 0; face < 6; face++) {
+                    if (matrix.getColorAndCheckBounds(i32v3(x, y, z) + SIDES[face]).a == 0) numFaces++;
+                }
+            }
+        }
+    }
+    f64 area = 0.0;
+    for (size_t i = 0; i + 3 < vertices.size(); i += 4) {
+        area += glm::length(glm::cross(vertices[i + 1].pos - vertices[i].pos, vertices[i + 2].pos - vertices[i].pos));
+    }
+
+    ui32 numQuads = (ui32)(vertices.size() / 4);
+    printf("Model %s (%u x %u x %u), load %lf ms\n", modelPath, matrix.size.x, matrix.size.y, matrix.size.z, loadMetrics.loadMs);
+    printf("  %u faces meshed into %u quads (%.1f%%)\n", numFaces, numQuads, numFaces ? numQuads * 100.0f / numFaces : 0.0f);
+    printf("  cold mesh %lf ms, warm mesh %lf ms%s\n", cold.meshMs, warm.meshMs, warm.meshFromCache ? "" : " (cache miss)");
+
+    bool passed = warm.meshFromCache && !cold.meshFromCache &&
+                  cachedVertices.size() == vertices.size() && cachedIndices == indices &&
+                  (vertices.empty() || memcmp(cachedVertices.data(), vertices.data(), vertices.size() * sizeof(VoxelModelVertex)) == 0) &&
+                  fabs(area - (f64)numFaces) < 0.5;
+    printf("Voxel model pipeline %s\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+bool runMIB(ui32 numEdits) {
+    BlockTexture texture;
+    texture.layers.base.initBlockTextureFunc();
+    BlockPack blocks;
+    Block b;
+    b.sID = "test";
+    for (int i = 0; i < 6; i++) b.textures[i] = &texture;
+    BlockID id = blocks.append(b);
+    // Flora goes to the cutout mesh, which is spliced separately
+    Block flora = b;
+    flora.sID = "testFlora";
+    flora.meshType = MeshType::CROSSFLORA;
+    BlockID floraID = blocks.append(flora);
+
+    PagedChunkAllocator allocator = {};
+    ChunkAccessor accessor = {};
+    accessor.init(&allocator);
+    ChunkHandle chunk = accessor.acquire(ChunkID(0, 0, 0));
+    fillTestChunk(chunk, id, 1);
+
+    ChunkMesher* mesher = new ChunkMesher;
+    mesher->init(&blocks);
+    mesher->prepareData(chunk);
+    ChunkMeshData* base = mesher->createChunkMeshData(MeshTaskType::DEFAULT);
+
+    std::mt19937 rEngine(1);
+    std::uniform_int_distribution<int> voxel(0, CHUNK_SIZE - 1);
+    std::uniform_int_distribution<int> type(0, 2);
+    const BlockID TYPES[3] = { 0, id, floraID };
+
+    bool passed = true;
+    f64 fullMs = 0.0;
+    f64 spliceMs = 0.0;
+    PreciseTimer timer;
+    for (ui32 i = 0; i < numEdits; i++) {
+        // Single voxel edit, as the voxel editor would make it
+        BlockIndex blockIndex = (BlockIndex)voxel(rEngine);
+        chunk->blocks.set(blockIndex, TYPES[type(rEngine)]);
+        chunk->flagDirty(blockIndex, true);
+
+        mesher->prepareData(chunk);
+        timer.start();
+        ChunkMeshData* full = mesher->createChunkMeshData(MeshTaskType::DEFAULT);
+        fullMs += timer.stop();
+
+        timer.start();
+        ChunkMeshData* spliced = mesher->createChunkMeshData(MeshTaskType::DEFAULT, nullptr, base);
+        spliceMs += timer.stop();
+
+        const ChunkMeshRenderData& a = full->chunkMeshRenderData;
+        const ChunkMeshRenderData& c = spliced->chunkMeshRenderData;
+        passed &= equalQuads(full->opaqueQuads, spliced->opaqueQuads) &&
+                  equalQuads(full->cutoutQuads, spliced->cutoutQuads) &&
+                  a.indexSize == c.indexSize && a.cutoutVboSize == c.cutoutVboSize &&
+                  a.nxVboSize == c.nxVboSize && a.pxVboSize == c.pxVboSize &&
+                  a.nyVboSize == c.nyVboSize && a.pyVboSize == c.pyVboSize &&
+                  a.nzVboSize == c.nzVboSize && a.pzVboSize == c.pzVboSize &&
+                  !memcmp(full->opaqueSlabQuads, spliced->opaqueSlabQuads, sizeof(full->opaqueSlabQuads)) &&
+                  !memcmp(full->cutoutSlabQuads, spliced->cutoutSlabQuads, sizeof(full->cutoutSlabQuads));
+
+        // prepareData leaves the flags alone, the mesh task would have cleared them
+        chunk->dirtySlabs = 0;
+        delete base;
+        delete full;
+        base = spliced;
+    }
+
+    printf("%u single voxel edits, %zu quads:\n", numEdits, base->opaqueQuads.size());
+    printf("  full remesh:   %lf ms per edit\n", fullMs / numEdits);
+    printf("  slab remesh:   %lf ms per edit\n", spliceMs / numEdits);
+    printf("Mesh invalidation %s\n", passed ? "PASSED" : "FAILED");
+
+    delete base;
+    delete mesher;
+    chunk.release();
+    accessor.destroy();
+    return passed;
+}
+
+namespace {
+    // Outside the chunk is air, as when it is meshed without neighbors
+    bool isTestOccluder(ChunkHandle& chunk, const i32v3& pos) {
+        if (pos.x < 0 || pos.y < 0 || pos.z < 0 ||
+            pos.x >= CHUNK_WIDTH || pos.y >= CHUNK_WIDTH || pos.z >= CHUNK_WIDTH) return false;
+        return chunk->blocks.get(pos.y * CHUNK_LAYER + pos.z * CHUNK_WIDTH + pos.x) != 0;
+    }
+}
+
+bool runAOB(ui32 numMeshes) {
+    // Vertex positions are in 7ths of a voxel
+    const int VERTEX_SCALE = 7;
+
+    BlockTexture texture;
+    texture.layers.base.initBlockTextureFunc();
+    BlockPack blocks;
+    Block b;
+    b.sID = "test";
+    for (int i = 0; i < 6; i++) b.textures[i] = &texture;
+    BlockID id = blocks.append(b);
+
+    PagedChunkAllocator allocator = {};
+    ChunkAccessor accessor = {};
+    accessor.init(&allocator);
+    ChunkHandle chunk = accessor.acquire(ChunkID(0, 0, 0));
+    fillTestChunk(chunk, id, 1);
+
+    ChunkMesher* mesher = new ChunkMesher;
+    mesher->init(&blocks);
+    mesher->prepareData(chunk);
+
+    PreciseTimer timer;
+    mesher->useAmbientOcclusion = false;
+    timer.start();
+    for (ui32 i = 0; i < numMeshes; i++) delete mesher->createChunkMeshData(MeshTaskType::DEFAULT);
+    f64 plainMs = timer.stop() / numMeshes;
+    ChunkMeshData* plain = mesher->createChunkMeshData(MeshTaskType::DEFAULT);
+
+    mesher->useAmbientOcclusion = true;
+    timer.start();
+    for (ui32 i = 0; i < numMeshes; i++) delete mesher->createChunkMeshData(MeshTaskType::DEFAULT);
+    f64 aoMs = timer.stop() / numMeshes;
+    ChunkMeshData* meshData = mesher->createChunkMeshData(MeshTaskType::DEFAULT);
+
+    // Every vertex of every merged quad must match occlusion taken straight from the voxels
+    bool passed = true;
+    ui32 numShaded = 0;
+    for (auto& q : meshData->opaqueQuads) {
+        int face = q.v.v0.face;
+        int normalAxis = face / 2;
+        int axisA = (normalAxis + 1) % 3;
+        int axisB = (normalAxis + 2) % 3;
+        i32v3 centerSum(0);
+        for (int i = 0; i < 4; i++) centerSum += i32v3(q.verts[i].position);
+        for (int i = 0; i < 4; i++) {
+            const BlockVertex& v = q.verts[i];
+            i32v3 vertexPos(v.position);
+            i32v3 corner = vertexPos / VERTEX_SCALE;
+            // The voxel in front of the face that this corner belongs to, then the ones beside it
+            i32v3 own;
+            own[normalAxis] = (face & 1) ? corner[normalAxis] : corner[normalAxis] - 1;
+            own[axisA] = centerSum[axisA] > vertexPos[axisA] * 4 ? corner[axisA] : corner[axisA] - 1;
+            own[axisB] = centerSum[axisB] > vertexPos[axisB] * 4 ? corner[axisB] : corner[axisB] - 1;
+            i32v3 side1 = own, side2 = own, diagonal = own;
+            side1[axisA] = own[axisA] == corner[axisA] ? corner[axisA] - 1 : corner[axisA];
+            side2[axisB] = own[axisB] == corner[axisB] ? corner[axisB] - 1 : corner[axisB];
+            diagonal[axisA] = side1[axisA];
+            diagonal[axisB] = side2[axisB];
+            int s1 = isTestOccluder(chunk, side1);
+            int s2 = isTestOccluder(chunk, side2);
+            int c = isTestOccluder(chunk, diagonal);
+            int expected = (s1 && s2) ? 3 : s1 + s2 + c;
+            if (v.ao != expected) passed = false;
+            if (v.ao) numShaded++;
+        }
+    }
+    passed &= numShaded > 0;
+
+    printf("%u meshes, %zu quads without and %zu quads with ambient occlusion:\n", numMeshes,
+           plain->opaqueQuads.size(), meshData->opaqueQuads.size());
+    printf("  no AO: %lf ms per mesh\n", plainMs);
+    printf("  AO:    %lf ms per mesh (%+.1lf%%)\n", aoMs, (aoMs / plainMs - 1.0) * 100.0);
+    printf("  %u of %zu vertices shaded\n", numShaded, meshData->opaqueQuads.size() * 4);
+    printf("Ambient occlusion %s\n", passed ? "PASSED" : "FAILED");
+
+    delete plain;
+    delete meshData;
+    delete mesher;
+    chunk.release();
+    accessor.destroy();
+    return passed;
+}
+
+namespace {
+    // Loads every block texture into a fresh pack the way the load screen does and keeps the atlas pixels
+    f64 loadBTLAtlas(const cString texturePackDir, OPT VoxPool* threadPool, bool useCache,
+                     OUT bool& usedCache, OUT std::vector<color4>& pixels) {
+        ModPathResolver resolver;
+        resolver.init(texturePackDir, texturePackDir);
+        BlockTexturePack texturePack;
+        texturePack.init(32, 4096);
+        BlockTextureLoader loader;
+        loader.init(&resolver, &texturePack, threadPool);
+        loader.setUseCache(useCache);
+
+        BlockPack blocks;
+        StaticLoadContext context;
+        LoadTaskBlockData blockLoader(&blocks, &loader, &context);
+        blockLoader.load();
+
+        usedCache = loader.lastLoadUsedCache();
+        pixels.clear();
+        for (ui32 i = 0; i < texturePack.getNumPages(); i++) {
+            const color4* page = texturePack.getPagePixels(i);
+            pixels.insert(pixels.end(), page, page + texturePack.getPagePixelCount());
+        }
+        return loader.getLastLoadMs();
+    }
+}
+
+bool runBTL(const cString texturePackDir, ui32 numThreads) {
+    if (numThreads == 0) numThreads = 1;
+    VoxPool threadPool;
+    threadPool.init(numThreads);
+
+    bool usedCache[4];
+    std::vector<color4> pixels[4];
+    // Serial, parallel, parallel writing the cache, then warm from the cache
+    f64 serialMs = loadBTLAtlas(texturePackDir, nullptr, false, usedCache[0], pixels[0]);
+    f64 parallelMs = loadBTLAtlas(texturePackDir, &threadPool, false, usedCache[1], pixels[1]);
+    remove(BLOCK_TEXTURE_ATLAS_CACHE_PATH);
+    f64 writeMs = loadBTLAtlas(texturePackDir, &threadPool, true, usedCache[2], pixels[2]);
+    f64 warmMs = loadBTLAtlas(texturePackDir, &threadPool, true, usedCache[3], pixels[3]);
+    threadPool.destroy();
+
+    printf("Block texture load from %s, %u threads\n", texturePackDir, numThreads);
+    printf("  serial %lf ms, parallel %lf ms (%.1fx)\n", serialMs, parallelMs, parallelMs > 0.0 ? serialMs / parallelMs : 0.0);
+    printf("  parallel + cache write %lf ms, warm %lf ms (%.1fx)%s\n", writeMs, warmMs,
+           warmMs > 0.0 ? parallelMs / warmMs : 0.0, usedCache[3] ? "" : " (cache miss)");
+    printf("  %zu atlas pixels with mipmaps\n", pixels[0].size());
+
+    // Every path has to build the same atlas, mipmaps included
+    bool passed = !usedCache[0] && !usedCache[1] && !usedCache[2] && usedCache[3] && pixels[0].size();
+    for (int i = 1; i < 4 && passed; i++) {
+        passed = pixels[i].size() == pixels[0].size() &&
+                 memcmp(pixels[i].data(), pixels[0].data(), pixels[0].size() * sizeof(color4)) == 0;
+    }
+    printf("Block texture loading %s\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+bool runMPR(const cString defaultDir, const cString modDir, ui32 numPasses) {
+    if (numPasses == 0) numPasses = 1;
+    ModPathResolver resolver;
+    resolver.init(defaultDir, modDir);
+
+    // Every indexed file plus as many misses
+    std::vector<nString> paths;
+    resolver.getIndexedPaths(paths);
+    size_t numFiles = paths.size();
+    for (size_t i = 0; i < numFiles; i++) paths.push_back("Missing/" + paths[i]);
+
+    std::vector<vio::Path> indexed(paths.size()), probed(paths.size());
+    std::vector<bool> indexedFound(paths.size()), probedFound(paths.size());
+    PreciseTimer timer;
+    timer.start();
+    for (ui32 pass = 0; pass < numPasses; pass++) {
+        for (size_t i = 0; i < paths.size(); i++) indexedFound[i] = resolver.resolvePath(paths[i], indexed[i]);
+    }
+    f64 indexMs = timer.stop();
+    ModPathResolverStats indexStats = resolver.getStats();
+
+    resolver.setUseIndex(false);
+    timer.start();
+    for (ui32 pass = 0; pass < numPasses; pass++) {
+        for (size_t i = 0; i < paths.size(); i++) probedFound[i] = resolver.resolvePath(paths[i], probed[i]);
+    }
+    f64 probeMs = timer.stop();
+
+    // Both have to find the same files
+    bool passed = numFiles > 0;
+    for (size_t i = 0; i < paths.size() && passed; i++) {
+        passed = indexedFound[i] == probedFound[i] && (i < numFiles) == indexedFound[i] &&
+                 (!indexedFound[i] || indexed[i].getLeaf() == probed[i].getLeaf());
+    }
+    printf("Mod paths %s over %s: %zu files indexed in %lf ms with %u checks\n",
+           modDir, defaultDir, numFiles, indexStats.scanMs, indexStats.numScanChecks);
+    printf("  %zu lookups x %u: index %lf ms, %u probes avoided. Probing %lf ms (%.1fx)\n",
+           paths.size(), numPasses, indexMs, indexStats.numProbesAvoided, probeMs, indexMs > 0.0 ? probeMs / indexMs : 0.0);
+    resolver.printStats("  Total");
+    printf("Mod path index %s\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+bool runMDI(ui32 chunkRadius) {
+    // Cube of fake meshes around the player, as if they were all visible
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<i32> faceQuads(1, 300);
+    i32 width = (i32)chunkRadius * 2 + 1;
+    std::vector<ChunkMesh> meshStorage(width * width * width);
+    std::vector<ChunkMesh*> meshes;
+    ui32 arenaOffset = 0;
+    for (size_t i = 0; i < meshStorage.size(); i++) {
+        ChunkMesh& cm = meshStorage[i];
+        i32v3 chunkPos((i32)(i % width), (i32)(i / width % width), (i32)(i / (width * width)));
+        cm.position = f64v3(chunkPos - i32v3(chunkRadius)) * (f64)CHUNK_WIDTH;
+        cm.vaoID = 1;
+        ChunkMeshRenderData& rd = cm.renderData;
+        i32* faces[6][2] = { { &rd.pxVboOff, &rd.pxVboSize }, { &rd.nxVboOff, &rd.nxVboSize },
+                             { &rd.pzVboOff, &rd.pzVboSize }, { &rd.nzVboOff, &rd.nzVboSize },
+                             { &rd.pyVboOff, &rd.pyVboSize }, { &rd.nyVboOff, &rd.nyVboSize } };
+        i32 numQuads = 0;
+        for (int f = 0; f < 6; f++) {
+            i32 quads = faceQuads(rng);
+            *faces[f][0] = numQuads * 6;
+            *faces[f][1] = quads * 6;
+            numQuads += quads;
+        }
+        rd.lowestX = rd.lowestY = rd.lowestZ = 0;
+        rd.highestX = rd.highestY = rd.highestZ = CHUNK_WIDTH;
+        // Every 16th mesh acts like it didn't fit in the arena
+        if (i % 16 != 15) {
+            cm.arenaOffset = arenaOffset;
+            cm.arenaQuads = (ui32)numQuads;
+            arenaOffset += (ui32)numQuads;
+        }
+        meshes.push_back(&cm);
+    }
+    f64v3 playerPos(0.5);
+
+    // What looping drawOpaque would draw
+    PreciseTimer timer;
+    timer.start();
+    ui32 perChunkDraws = 0;
+    ui64 perChunkIndices = 0;
+    i32v2 faces[6];
+    for (int i = meshes.size() - 1; i >= 0; i--) {
+        ui32 numFaces = ChunkRenderer::getVisibleOpaqueFaces(meshes[i], playerPos, faces);
+        perChunkDraws += numFaces;
+        for (ui32 j = 0; j < numFaces; j++) perChunkIndices += faces[j].y;
+    }
+    f64 perChunkMs = timer.stop();
+
+    std::vector<ChunkDrawCommand> commands;
+    std::vector<f32v3> chunkOffsets;
+    std::vector<const ChunkMesh*> unbatched;
+    timer.start();
+    ChunkRenderer::buildOpaqueCommands(meshes, playerPos, commands, chunkOffsets, unbatched);
+    f64 buildMs = timer.stop();
+
+    ui32 batchDraws = commands.size() ? 1 : 0;
+    ui64 batchIndices = 0;
+    bool passed = true;
+    for (auto& command : commands) {
+        batchIndices += command.count;
+        // Each command has to stay inside its chunk's quads and offset
+        passed = passed && command.instanceCount == 1 && command.baseInstance < chunkOffsets.size() &&
+                 command.firstIndex % 6 == 0 && command.count % 6 == 0;
+    }
+    for (auto& cm : unbatched) {
+        ui32 numFaces = ChunkRenderer::getVisibleOpaqueFaces(cm, playerPos, faces);
+        batchDraws += numFaces;
+        for (ui32 j = 0; j < numFaces; j++) batchIndices += faces[j].y;
+    }
+    passed = passed && batchIndices == perChunkIndices && unbatched.size() == meshes.size() / 16;
+
+    printf("Opaque draws of %zu chunks: per chunk %u draws and %zu matrix pairs, batched %u draws with %zu commands\n",
+           meshes.size(), perChunkDraws, meshes.size(), batchDraws, commands.size());
+    printf("  %llu indices either way, face culling %lf ms, command build %lf ms, %zu chunks outside the arena\n",
+           (unsigned long long)perChunkIndices, perChunkMs, buildMs, unbatched.size());
+    printf("Multi draw batching %s\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+bool runLOD(ui32 numMeshes) {
+    if (numMeshes == 0) numMeshes = 1;
+    BlockTexture texture;
+    texture.layers.base.initBlockTextureFunc();
+    BlockPack blocks;
+    Block b;
+    for (int i = 0; i < 6; i++) b.textures[i] = &texture;
+    b.sID = "dirt";
+    BlockID dirt = blocks.append(b);
+    b.sID = "grass";
+    BlockID grass = blocks.append(b);
+
+    // Rolling hills, grass over dirt
+    PagedChunkAllocator allocator = {};
+    ChunkAccessor accessor = {};
+    accessor.init(&allocator);
+    ChunkHandle chunk = accessor.acquire(ChunkID(0, 0, 0));
+    chunk->initAndFillEmpty(WorldCubeFace::FACE_TOP);
+    chunk->blocks.changeState(vvox::VoxelStorageState::FLAT_ARRAY, chunk->dataMutex);
+    for (int z = 0; z < CHUNK_WIDTH; z++) {
+        for (int x = 0; x < CHUNK_WIDTH; x++) {
+            int height = 14 + (int)(6.0 * sin(x / 5.0) + 4.0 * cos(z / 7.0));
+            for (int y = 0; y <= height; y++) {
+                chunk->blocks.set(y * CHUNK_LAYER + z * CHUNK_WIDTH + x, y == height ? grass : dirt);
+            }
+        }
+    }
+
+    ChunkMesher* mesher = new ChunkMesher;
+    mesher->init(&blocks);
+    std::vector<ui16> fineData(PADDED_CHUNK_SIZE);
+    size_t quads[CHUNK_MESH_LOD_LEVELS];
+    f64 meshMs[CHUNK_MESH_LOD_LEVELS];
+    bool passed = true;
+    PreciseTimer timer;
+    for (ui32 level = 0; level < CHUNK_MESH_LOD_LEVELS; level++) {
+        timer.start();
+        ChunkMeshData* meshData = nullptr;
+        for (ui32 i = 0; i < numMeshes; i++) {
+            delete meshData;
+            mesher->prepareData(chunk);
+            if (i == 0) fineData.assign(mesher->blockData, mesher->blockData + PADDED_CHUNK_SIZE);
+            mesher->downsample(level);
+            meshData = mesher->createChunkMeshData(MeshTaskType::DEFAULT);
+        }
+        meshMs[level] = timer.stop() / numMeshes;
+        quads[level] = meshData->opaqueQuads.size();
+        // Hills are height fields, so scaled or not the tops have to cover every column once.
+        // Mesh positions are 7 units per voxel.
+        ui32 topArea = 0;
+        for (auto& q : meshData->opaqueQuads) {
+            if (q.v.v0.face != (ui8)vvox::Cardinal::Y_POS) continue;
+            ui8v3 lo(255), hi(0);
+            for (int i = 0; i < 4; i++) {
+                lo = glm::min(lo, q.verts[i].position);
+                hi = glm::max(hi, q.verts[i].position);
+            }
+            topArea += (ui32)(hi.x - lo.x) * (hi.z - lo.z);
+        }
+        if (topArea != (ui32)CHUNK_LAYER * 7 * 7) passed = false;
+        delete meshData;
+
+        // The coarse volume has to cover the real one, and the padding must stay untouched
+        for (int y = 0; y < PADDED_CHUNK_WIDTH && passed; y++) {
+            for (int z = 0; z < PADDED_CHUNK_WIDTH; z++) {
+                for (int x = 0; x < PADDED_CHUNK_WIDTH; x++) {
+                    int i = y * PADDED_CHUNK_LAYER + z * PADDED_CHUNK_WIDTH + x;
+                    bool isPadding = x == 0 || y == 0 || z == 0 ||
+                                     x == PADDED_CHUNK_WIDTH - 1 || y == PADDED_CHUNK_WIDTH - 1 || z == PADDED_CHUNK_WIDTH - 1;
+                    if (isPadding ? mesher->blockData[i] != fineData[i] : (fineData[i] && !mesher->blockData[i])) passed = false;
+                }
+            }
+        }
+        // Distant hills should still look grassy
+        if (std::count(mesher->blockData, mesher->blockData + PADDED_CHUNK_SIZE, grass) < CHUNK_LAYER) passed = false;
+        if (level > 0 && quads[level] >= quads[level - 1]) passed = false;
+    }
+
+    printf("LOD meshes of a hill chunk, %u meshes per level:\n", numMeshes);
+    for (ui32 level = 0; level < CHUNK_MESH_LOD_LEVELS; level++) {
+        printf("  %2dx cells: %5zu quads (%5.1f%%), %lf ms per mesh\n", 1 << level, quads[level],
+               quads[0] ? 100.0 * quads[level] / quads[0] : 0.0, meshMs[level]);
+    }
+    printf("Chunk LOD meshing %s\n", passed ? "PASSED" : "FAILED");
+
+    delete mesher;
+    chunk.release();
+    accessor.destroy();
+    return passed;
+}
+
+namespace {
+    // Marks a padded voxel as an occluder
+    void setTestOccluder(std::vector<ui64>& occluders, int x, int y, int z) {
+        int i = (y + 1) * PADDED_CHUNK_LAYER + (z + 1) * PADDED_CHUNK_WIDTH + (x + 1);
+        occluders[i >> 6] |= 1ull << (i & 63);
+    }
+
+    ui64 connectedPair(int a, int b) {
+        return (1ull << (a * CHUNK_VISIBILITY_FACES + b)) | (1ull << (b * CHUNK_VISIBILITY_FACES + a));
+    }
+}
+
+bool runOCC(ui32 chunkRadius) {
+    const int X_NEG = 0, X_POS = 1, Y_NEG = 2, Y_POS = 3, Z_NEG = 4, Z_POS = 5;
+    bool passed = true;
+
+    { // Face connections of known shapes
+        ChunkVisibility* visibility = new ChunkVisibility;
+        const size_t numWords = (PADDED_CHUNK_SIZE + 63) / 64;
+        std::vector<ui64> open(numWords, 0);
+        std::vector<ui64> solid(numWords, ~0ull);
+        std::vector<ui64> wall(numWords, 0);
+        std::vector<ui64> tunnel(numWords, ~0ull);
+        for (int y = 0; y < CHUNK_WIDTH; y++) {
+            for (int z = 0; z < CHUNK_WIDTH; z++) setTestOccluder(wall, CHUNK_WIDTH / 2, y, z);
+        }
+        // Digs a 1x1 tunnel along z through the padded volume
+        for (int z = -1; z <= CHUNK_WIDTH; z++) {
+            int i = 9 * PADDED_CHUNK_LAYER + (z + 1) * PADDED_CHUNK_WIDTH + 9;
+            tunnel[i >> 6] &= ~(1ull << (i & 63));
+        }
+        ui64 wallExpected = 0;
+        for (int a = 0; a < CHUNK_VISIBILITY_FACES; a++) {
+            for (int b = 0; b < CHUNK_VISIBILITY_FACES; b++) {
+                if (!((a == X_NEG && b == X_POS) || (a == X_POS && b == X_NEG))) wallExpected |= connectedPair(a, b);
+            }
+        }
+        ui64 tunnelExpected = connectedPair(Z_NEG, Z_POS) | connectedPair(Z_NEG, Z_NEG) | connectedPair(Z_POS, Z_POS);
+
+        PreciseTimer timer;
+        timer.start();
+        ui64 results[4];
+        for (int i = 0; i < 100; i++) {
+            results[0] = visibility->computeConnections(open.data());
+            results[1] = visibility->computeConnections(solid.data());
+            results[2] = visibility->computeConnections(wall.data());
+            results[3] = visibility->computeConnections(tunnel.data());
+        }
+        f64 fillMs = timer.stop() / 400.0;
+        passed = results[0] == CHUNK_FACES_ALL_CONNECTED && results[1] == 0 &&
+                 results[2] == wallExpected && results[3] == tunnelExpected;
+        printf("Face connections: open %s, solid %s, wall %s, tunnel %s, %lf ms per chunk\n",
+               results[0] == CHUNK_FACES_ALL_CONNECTED ? "ok" : "wrong", results[1] == 0 ? "ok" : "wrong",
+               results[2] == wallExpected ? "ok" : "wrong", results[3] == tunnelExpected ? "ok" : "wrong", fillMs);
+        delete visibility;
+    }
+
+    // Flat terrain: solid chunks under a surface layer open to the top and sides, air above
+    i32 width = (i32)chunkRadius * 2 + 1;
+    std::vector<ChunkMesh> meshStorage(width * width * chunkRadius);
+    ChunkIDMap<ChunkMesh*> meshes;
+    ui64 surface = 0;
+    const int SURFACE_FACES[5] = { X_NEG, X_POS, Y_POS, Z_NEG, Z_POS };
+    for (int a = 0; a < 5; a++) {
+        for (int b = 0; b < 5; b++) surface |= connectedPair(SURFACE_FACES[a], SURFACE_FACES[b]);
+    }
+    for (size_t i = 0; i < meshStorage.size(); i++) {
+        i32v3 chunkPos((i32)(i % width) - (i32)chunkRadius, -1 - (i32)(i / (width * width)), (i32)(i / width % width) - (i32)chunkRadius);
+        ChunkMesh& cm = meshStorage[i];
+        cm.position = f64v3(chunkPos) * (f64)CHUNK_WIDTH;
+        cm.renderData.faceConnections = chunkPos.y == -1 ? surface : 0;
+        meshes[ChunkID(chunkPos)] = &cm;
+    }
+
+    Frustum frustum;
+    frustum.setCamInternals(70.0f, 16.0f / 9.0f, 0.1f, 100000.0f);
+    f64v3 cameraPos(5.0, 20.0, 5.0);
+    frustum.update(f32v3(0.0f), f32v3(0.3f, -0.5f, -1.0f), f32v3(0.0f, 1.0f, 0.0f));
+    i32v3 minPos(-(i32)chunkRadius, -(i32)chunkRadius, -(i32)chunkRadius);
+    i32v3 maxPos((i32)chunkRadius, 0, (i32)chunkRadius);
+
+    ChunkOcclusionCuller culler;
+    PreciseTimer timer;
+    ui32 numInFrustum = 0, numReached = 0, numWalked = 0;
+    bool reachedBuried = false;
+    const int NUM_WALKS = 10;
+    timer.start();
+    for (int walk = 1; walk <= NUM_WALKS; walk++) {
+        numWalked = culler.markVisibleMeshes(meshes, frustum, cameraPos, minPos, maxPos, walk);
+    }
+    f64 walkMs = timer.stop() / NUM_WALKS;
+    for (auto& cm : meshStorage) {
+        f32v3 center(cm.position + f64v3(CHUNK_WIDTH / 2) - cameraPos);
+        if (!frustum.sphereInFrustum(center, CHUNK_WIDTH * 0.8660254f)) continue;
+        numInFrustum++;
+        if (cm.occlusionStamp == NUM_WALKS) {
+            numReached++;
+            // Nothing under the surface layer can be seen from above
+            if (cm.position.y < -CHUNK_WIDTH) reachedBuried = true;
+        }
+    }
+    passed = passed && !reachedBuried && numReached > 0 && numReached < numInFrustum;
+
+    printf("Terrain of %zu chunk meshes, %u in the frustum, %u still drawn (%u culled), %u chunks walked in %lf ms\n",
+           meshStorage.size(), numInFrustum, numReached, numInFrustum - numReached, numWalked, walkMs);
+    printf("Occlusion culling %s\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+namespace {
+    // Refills the voxels below height and compresses the chunk, as generated chunks are
+    void fillTestLayers(ChunkHandle& chunk, BlockID id, int height) {
+        chunk->blocks.changeState(vvox::VoxelStorageState::FLAT_ARRAY, chunk->dataMutex);
+        for (int i = 0; i < CHUNK_SIZE; i++) chunk->blocks.set(i, i < height * CHUNK_LAYER ? id : 0);
+        chunk->blocks.changeState(vvox::VoxelStorageState::INTERVAL_TREE, chunk->dataMutex);
+    }
+}
+
+bool runTMB(ui32 numChunks) {
+    if (numChunks == 0) numChunks = 1;
+    BlockTexture texture;
+    texture.layers.base.initBlockTextureFunc();
+    BlockPack blocks;
+    Block b;
+    b.sID = "stone";
+    for (int i = 0; i < 6; i++) b.textures[i] = &texture;
+    BlockID stone = blocks.append(b);
+
+    // A chunk and its neighbors, in Chunk::neighbors order
+    PagedChunkAllocator allocator = {};
+    ChunkAccessor accessor = {};
+    accessor.init(&allocator);
+    ChunkHandle chunk = accessor.acquire(ChunkID(0, 0, 0));
+    chunk->initAndFillEmpty(WorldCubeFace::FACE_TOP);
+    const i32v3 NEIGHBOR_POSITIONS[6] = { i32v3(-1, 0, 0), i32v3(1, 0, 0), i32v3(0, -1, 0),
+                                          i32v3(0, 1, 0), i32v3(0, 0, -1), i32v3(0, 0, 1) };
+    ChunkHandle neighborHandles[6];
+    Chunk* neighbors[6];
+    for (int i = 0; i < 6; i++) {
+        neighborHandles[i] = accessor.acquire(ChunkID(NEIGHBOR_POSITIONS[i]));
+        neighborHandles[i]->initAndFillEmpty(WorldCubeFace::FACE_TOP);
+        fillTestLayers(neighborHandles[i], stone, CHUNK_WIDTH);
+        chunk->neighbors[i] = neighborHandles[i].acquire();
+        neighbors[i] = neighborHandles[i];
+    }
+
+    ChunkMesher* mesher = new ChunkMesher;
+    mesher->init(&blocks);
+
+    const cString CLASS_NAMES[3] = { "empty", "buried", "mixed" };
+    const int HEIGHTS[3] = { 0, CHUNK_WIDTH, CHUNK_WIDTH / 2 };
+    bool passed = true;
+    PreciseTimer timer;
+    printf("%u chunks per class, surrounded by stone:\n", numChunks);
+    for (int c = 0; c < 3; c++) {
+        fillTestLayers(chunk, stone, HEIGHTS[c]);
+
+        ChunkMeshClass meshClass = ChunkMeshClass::MIXED;
+        timer.start();
+        for (ui32 i = 0; i < numChunks; i++) meshClass = ChunkMeshClassifier::classify(chunk, neighbors, &blocks);
+        f64 classifyMs = timer.stop() / numChunks;
+
+        size_t numQuads = 0;
+        timer.start();
+        for (ui32 i = 0; i < numChunks; i++) {
+            mesher->prepareData(chunk);
+            ChunkMeshData* meshData = mesher->createChunkMeshData(MeshTaskType::DEFAULT);
+            numQuads = meshData->opaqueQuads.size() + meshData->cutoutQuads.size() + meshData->transQuads.size();
+            delete meshData;
+        }
+        f64 meshMs = timer.stop() / numChunks;
+
+        // Trivial chunks must really have empty meshes, and the flat array has to agree with the tree
+        chunk->blocks.changeState(vvox::VoxelStorageState::FLAT_ARRAY, chunk->dataMutex);
+        ChunkMeshClass flatClass = ChunkMeshClassifier::classify(chunk, neighbors, &blocks);
+        passed &= meshClass == (ChunkMeshClass)c && flatClass == meshClass &&
+                  (meshClass == ChunkMeshClass::MIXED) == (numQuads != 0);
+
+        printf("  %-6s: %6zu quads, meshed in %lf ms, classified in %lf ms (%.0fx)\n", CLASS_NAMES[c], numQuads,
+               meshMs, classifyMs, classifyMs > 0.0 ? meshMs / classifyMs : 0.0);
+    }
+
+    // One open voxel on a neighbor face shows the faces of a solid chunk
+    fillTestLayers(chunk, stone, CHUNK_WIDTH);
+    for (int i = 0; i < 6 && passed; i++) {
+        int face = i ^ 1;
+        int axis = face >> 1;
+        i32v3 pos(CHUNK_WIDTH / 2);
+        pos[axis] = (face & 1) ? CHUNK_WIDTH - 1 : 0;
+        neighbors[i]->blocks.set(pos.y * CHUNK_LAYER + pos.z * CHUNK_WIDTH + pos.x, 0);
+        passed &= !ChunkMeshClassifier::isFaceOpaque(neighbors[i], face, &blocks) &&
+                  ChunkMeshClassifier::classify(chunk, neighbors, &blocks) == ChunkMeshClass::MIXED;
+        neighbors[i]->blocks.changeState(vvox::VoxelStorageState::FLAT_ARRAY, neighbors[i]->dataMutex);
+        passed &= !ChunkMeshClassifier::isFaceOpaque(neighbors[i], face, &blocks);
+        // The other faces are still closed
+        passed &= ChunkMeshClassifier::isFaceOpaque(neighbors[i], i, &blocks);
+        fillTestLayers(neighborHandles[i], stone, CHUNK_WIDTH);
+    }
+    printf("Trivial chunk classification %s\n", passed ? "PASSED" : "FAILED");
+
+    delete mesher;
+    for (int i = 0; i < 6; i++) {
+        chunk->neighbors[i].release();
+        neighborHandles[i].release();
+    }
+    chunk.release();
+    accessor.destroy();
+    return passed;
+}
+
+bool runCRS(const cString planetName, ui32 numFrames, ui32 budgetMiB) {
+    bool passed = true;
+
+    { // Pages drain as their chunks are freed
+        PagedChunkAllocator allocator;
+        std::vector<Chunk*> chunks;
+        for (int i = 0; i < 3 * 2048; i++) chunks.push_back(allocator.alloc());
+        ui32 numPages = (ui32)allocator.getNumPages();
+        for (auto& chunk : chunks) allocator.free(chunk);
+        ui32 numFreed = allocator.freeEmptyPages(1);
+        printf("Allocator: %u pages, %u freed once empty, %u left\n", numPages, numFreed, (ui32)allocator.getNumPages());
+        if (numPages != 3 || numFreed != 2 || allocator.getNumPages() != 1 || allocator.getNumUsedChunks() != 0) {
+            puts("FAIL: empty pages were not freed");
+            passed = false;
+        }
+    }
+
+    WorldGenBenchmarkConfig config;
+    config.planetName = planetName;
+    config.numFrames = numFrames;
+    config.frameMs = 0.0;
+    config.memoryBudget = (size_t)budgetMiB * 1024 * 1024;
+    WorldGenBenchmarkResults results;
+    if (!WorldGenBenchmark::run(config, results)) return false;
+    puts(WorldGenBenchmark::toJSON(config, results).c_str());
+
+    // Flying on should not grow memory past what the budget allows
+    ui64 limitKiB = std::max((ui64)budgetMiB * 1024, results.peakChunkMemoryFirstHalfKiB * 11 / 10);
+    if (results.peakChunkMemorySecondHalfKiB > limitKiB) {
+        printf("FAIL: chunk memory kept growing, %llu KiB peak after %llu KiB\n",
+               (unsigned long long)results.peakChunkMemorySecondHalfKiB,
+               (unsigned long long)results.peakChunkMemoryFirstHalfKiB);
+        passed = false;
+    }
+    return passed;
+}
+
+bool runCAL(ui32 maxThreads, ui32 numOps) {
+    // Chunks each thread holds at once, like a generator working through its queue
+    const ui32 CAS_BATCH = 16;
+    bool passed = true;
+    PagedChunkAllocator allocator;
+    f64 singleThreadRate = 0.0;
+
+    for (ui32 numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+        std::vector<std::thread> threads;
+        std::vector<ui32> numBad(numThreads, 0);
+        PreciseTimer timer;
+        timer.start();
+        for (ui32 t = 0; t < numThreads; t++) {
+            threads.emplace_back([&, t]() {
+                Chunk* chunks[CAS_BATCH];
+                for (ui32 i = 0; i < numOps; i += CAS_BATCH) {
+                    for (ui32 j = 0; j < CAS_BATCH; j++) {
+                        chunks[j] = allocator.alloc();
+                        chunks[j]->blocks.init(vvox::VoxelStorageState::FLAT_ARRAY);
+                        chunks[j]->blocks.getDataArray()[j] = (ui16)(t + 1);
+                    }
+                    for (ui32 j = 0; j < CAS_BATCH; j++) {
+                        // Another thread writing the same chunk would show here
+                        if (chunks[j]->blocks.getDataArray()[j] != (ui16)(t + 1)) numBad[t]++;
+                        allocator.free(chunks[j]);
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        f64 ms = timer.stop();
+
+        f64 rate = (f64)numThreads * numOps / std::max(ms, 1e-6);
+        if (numThreads == 1) singleThreadRate = rate;
+        printf("%u threads: %.0f alloc/free pairs per ms, %.2fx one thread\n",
+               numThreads, rate, rate / singleThreadRate);
+        for (auto& n : numBad) {
+            if (n) {
+                puts("FAIL: a chunk was handed to two threads at once");
+                passed = false;
+                break;
+            }
+        }
+    }
+
+    allocator.freeEmptyPages(0);
+    if (allocator.getNumUsedChunks() != 0 || allocator.getNumPages() != 0) {
+        printf("FAIL: %zu chunks still in use after freeing everything\n", allocator.getNumUsedChunks());
+        passed = false;
+    }
+    return passed;
+}
+
+namespace {
+    // What std::hash<ChunkID> used to be
+    struct RawChunkIDHash {
+        size_t operator()(const ChunkID& id) const { return (size_t)id.id; }
+    };
+
+    // Sums the six neighbor lookups of every chunk, like submitAndConnect does
+    template<typename Map>
+    ui64 lookupNeighbors(const Map& map, const std::vector<ChunkID>& ids) {
+        static const i32v3 OFFSETS[6] = { i32v3(-1, 0, 0), i32v3(1, 0, 0), i32v3(0, -1, 0),
+                                          i32v3(0, 1, 0), i32v3(0, 0, -1), i32v3(0, 0, 1) };
+        ui64 sum = 0;
+        for (auto& id : ids) {
+            for (int i = 0; i < 6; i++) {
+                auto it = map.find(ChunkID((i32)id.x + OFFSETS[i].x, (i32)id.y + OFFSETS[i].y, (i32)id.z + OFFSETS[i].z));
+                if (it != map.end()) sum += it->second;
+            }
+        }
+        return sum;
+    }
+}
+
+bool runCHM(ui32 chunkRadius) {
+    const int CHM_OPS = 200000;
+    const int CHM_ITERATIONS = 20;
+    bool passed = true;
+
+    { // Random inserts and erases, with ids that only differ in their high bits
+        ChunkIDMap<ui32> map;
+        std::map<ui64, ui32> reference;
+        std::mt19937 rEngine(1337);
+        std::uniform_int_distribution<int> coord(-64, 63);
+        std::uniform_int_distribution<int> op(0, 3);
+        for (int i = 0; i < CHM_OPS; i++) {
+            ChunkID id(coord(rEngine) << 16, coord(rEngine) << 8, coord(rEngine));
+            if (op(rEngine) == 0) {
+                passed &= map.erase(id) == reference.erase(id.id);
+            } else {
+                map[id] = (ui32)i;
+                reference[id.id] = (ui32)i;
+            }
+        }
+        passed &= map.size() == reference.size();
+        for (auto& it : reference) {
+            auto mit = map.find(ChunkID(it.first));
+            passed &= mit != map.end() && mit->second == it.second;
+        }
+        size_t numIterated = 0;
+        for (auto& it : map) {
+            passed &= reference.count(it.first.id) && reference[it.first.id] == it.second;
+            numIterated++;
+        }
+        passed &= numIterated == map.size();
+        if (!passed) puts("FAIL: ChunkIDMap disagrees with std::map");
+    }
+
+    // Chunks of a sphere far from the origin, so the ids have high bits set
+    std::vector<ChunkID> ids;
+    i32v3 center(-100000, 500, 100000);
+    i32 radius = (i32)chunkRadius;
+    for (i32 y = -radius; y <= radius; y++) {
+        for (i32 z = -radius; z <= radius; z++) {
+            for (i32 x = -radius; x <= radius; x++) {
+                if (x * x + y * y + z * z > radius * radius) continue;
+                ids.push_back(ChunkID(center + i32v3(x, y, z)));
+            }
+        }
+    }
+    std::unordered_map<ChunkID, ui32, RawChunkIDHash> rawMap;
+    std::unordered_map<ChunkID, ui32> mixedMap;
+    ChunkIDMap<ui32> flatMap;
+    for (size_t i = 0; i < ids.size(); i++) {
+        rawMap[ids[i]] = (ui32)i;
+        mixedMap[ids[i]] = (ui32)i;
+        flatMap[ids[i]] = (ui32)i;
+    }
+
+    // Chunks sharing a bucket with an earlier one
+    size_t rawCollisions = 0;
+    size_t mixedCollisions = 0;
+    for (size_t b = 0; b < rawMap.bucket_count(); b++) rawCollisions += std::max((size_t)1, rawMap.bucket_size(b)) - 1;
+    for (size_t b = 0; b < mixedMap.bucket_count(); b++) mixedCollisions += std::max((size_t)1, mixedMap.bucket_size(b)) - 1;
+
+    PreciseTimer timer;
+    ui64 sums[3] = {};
+    f64 ms[3];
+    timer.start();
+    for (int i = 0; i < CHM_ITERATIONS; i++) sums[0] += lookupNeighbors(rawMap, ids);
+    ms[0] = timer.stop() / CHM_ITERATIONS;
+    timer.start();
+    for (int i = 0; i < CHM_ITERATIONS; i++) sums[1] += lookupNeighbors(mixedMap, ids);
+    ms[1] = timer.stop() / CHM_ITERATIONS;
+    timer.start();
+    for (int i = 0; i < CHM_ITERATIONS; i++) sums[2] += lookupNeighbors(flatMap, ids);
+    ms[2] = timer.stop() / CHM_ITERATIONS;
+
+    if (sums[0] != sums[1] || sums[0] != sums[2]) {
+        puts("FAIL: maps found different neighbors");
+        passed = false;
+    }
+    printf("%zu chunks, %zu neighbor lookups: bucket collisions raw %zu, mixed %zu\n",
+           ids.size(), ids.size() * 6, rawCollisions, mixedCollisions);
+    printf("unordered_map raw hash %lf ms, mixed hash %lf ms, ChunkIDMap %lf ms (%.1fx raw)\n",
+           ms[0], ms[1], ms[2], ms[2] > 0.0 ? ms[0] / ms[2] : 0.0);
+    printf("Chunk ID map %s\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+namespace {
+    const int LQS_LEVELS = 8;
+    const ui32 LQS_MAX_TICKS = 4096;
+
+    struct LiquidRun {
+        std::vector<ui16> voxels; ///< Every chunk, in creation order
+        ui64 massBefore = 0;
+        ui64 massAfter = 0;
+        ui32 numTicks = 0;
+        ui64 numCellsStepped = 0;
+        bool atRest = false;
+        bool floating = false; ///< Liquid was left over air or partial liquid
+        bool desynced = false; ///< A voxel didn't hold the block of its simulated level
+        f64 ms = 0.0;
+    };
+
+    ui64 sumLiquid(const LiquidSimulation& sim, const std::vector<ChunkID>& ids) {
+        ui64 sum = 0;
+        for (auto& id : ids) {
+            for (int i = 0; i < CHUNK_SIZE; i++) {
+                ui8 level = sim.getLevel(id, i);
+                if (level != LIQUID_BLOCKED) sum += level;
+            }
+        }
+        return sum;
+    }
+
+    /// Steps a width x 1 x width grid of chunks with a stone floor, random pillars and
+    /// a block of full liquid in every other chunk until it rests
+    LiquidRun runLiquid(ui32 width, BlockID stone, const LiquidData& liquid, OPT VoxPool* threadPool, ui32 maxChunksPerBatch) {
+        PagedChunkAllocator allocator = {};
+        ChunkAccessor accessor = {};
+        accessor.init(&allocator);
+        std::vector<ChunkHandle> chunks(width * width);
+        std::vector<ChunkID> ids;
+        std::mt19937 rEngine(1337);
+        std::uniform_int_distribution<int> coord(0, CHUNK_WIDTH - 1);
+        std::uniform_int_distribution<int> height(1, 5);
+        for (ui32 z = 0; z < width; z++) {
+            for (ui32 x = 0; x < width; x++) {
+                ChunkHandle& chunk = chunks[z * width + x];
+                chunk = accessor.acquire(ChunkID(x, 0, z));
+                ids.push_back(chunk.getID());
+                chunk->initAndFillEmpty(WorldCubeFace::FACE_TOP);
+                chunk->genLevel = GEN_DONE;
+                chunk->blocks.changeState(vvox::VoxelStorageState::FLAT_ARRAY, chunk->dataMutex);
+                for (int i = 0; i < CHUNK_LAYER; i++) chunk->blocks.set(i, stone);
+                for (int p = 0; p < 20; p++) {
+                    int i = coord(rEngine) * CHUNK_WIDTH + coord(rEngine);
+                    for (int y = height(rEngine); y > 0; y--) chunk->blocks.set(y * CHUNK_LAYER + i, stone);
+                }
+                if ((x + z) % 2 == 0) {
+                    for (int y = 10; y < 18; y++) {
+                        for (int i = 8; i < 16; i++) {
+                            for (int j = 8; j < 16; j++) {
+                                chunk->blocks.set(y * CHUNK_LAYER + i * CHUNK_WIDTH + j, (BlockID)(liquid.startBlockID + liquid.numLevels - 1));
+                            }
+                        }
+                    }
+                }
+                chunk->numBlocks = 0;
+                for (int i = 0; i < CHUNK_SIZE; i++) {
+                    if (chunk->blocks.get(i)) chunk->numBlocks++;
+                }
+            }
+        }
+
+        LiquidRun run;
+        LiquidSimulation sim;
+        sim.init(nullptr, liquid, threadPool, maxChunksPerBatch);
+        for (auto& chunk : chunks) sim.addChunk(chunk);
+        // The first tick loads the chunks
+        sim.step();
+        run.massBefore = sumLiquid(sim, ids);
+        PreciseTimer timer;
+        timer.start();
+        while (sim.getNumActiveChunks() && run.numTicks < LQS_MAX_TICKS) {
+            sim.step();
+            run.numTicks++;
+        }
+        run.ms = timer.stop();
+        run.numCellsStepped = sim.getNumCellsStepped();
+        run.atRest = sim.getNumActiveChunks() == 0;
+        run.massAfter = sumLiquid(sim, ids);
+
+        for (size_t c = 0; c < chunks.size(); c++) {
+            for (int i = CHUNK_LAYER; i < CHUNK_SIZE; i++) {
+                ui8 level = sim.getLevel(ids[c], i);
+                ui8 below = sim.getLevel(ids[c], i - CHUNK_LAYER);
+                if (level && level != LIQUID_BLOCKED && below < liquid.numLevels) run.floating = true;
+            }
+            // The voxels have to agree with the simulation
+            for (int i = 0; i < CHUNK_SIZE; i++) {
+                BlockID id = chunks[c]->blocks.get(i);
+                run.voxels.push_back(id);
+                ui8 level = sim.getLevel(ids[c], i);
+                if (level != LIQUID_BLOCKED && id != sim.getBlockID(level)) run.desynced = true;
+            }
+        }
+
+        sim.dispose();
+        for (auto& chunk : chunks) chunk.release();
+        accessor.destroy();
+        return run;
+    }
+}
+
+bool runLQS(ui32 chunkWidth, ui32 numThreads) {
+    if (chunkWidth == 0) chunkWidth = 1;
+    if (numThreads == 0) numThreads = 1;
+    BlockTexture texture;
+    texture.layers.base.initBlockTextureFunc();
+    BlockPack blocks;
+    Block b;
+    b.sID = "stone";
+    for (int i = 0; i < 6; i++) b.textures[i] = &texture;
+    BlockID stone = blocks.append(b);
+    // One block per level, level 1 first
+    LiquidData liquid;
+    liquid.numLevels = LQS_LEVELS;
+    for (int i = 0; i < LQS_LEVELS; i++) {
+        Block l;
+        l.sID = "water_" + std::to_string(i + 1);
+        l.meshType = MeshType::LIQUID;
+        l.occlude = BlockOcclusion::NONE;
+        for (int j = 0; j < 6; j++) l.textures[j] = &texture;
+        BlockID id = blocks.append(l);
+        if (i == 0) liquid.startBlockID = id;
+    }
+    for (int i = 0; i < LQS_LEVELS; i++) {
+        blocks[(BlockID)(liquid.startBlockID + i)].liquidStartID = (ui16)liquid.startBlockID;
+        blocks[(BlockID)(liquid.startBlockID + i)].liquidLevels = LQS_LEVELS;
+    }
+    blocks.updateMeshTables();
+
+    VoxPool threadPool;
+    threadPool.init(numThreads);
+    // Inline, then on the pool in batches too small to cover a tick
+    LiquidRun serial = runLiquid(chunkWidth, stone, liquid, nullptr, 0);
+    LiquidRun parallel = runLiquid(chunkWidth, stone, liquid, &threadPool, 3);
+    threadPool.destroy();
+
+    bool passed = true;
+    for (auto& run : { &serial, &parallel }) {
+        if (run->massAfter != run->massBefore) {
+            printf("FAIL: liquid went from %llu to %llu\n", run->massBefore, run->massAfter);
+            passed = false;
+        }
+        if (!run->atRest || run->floating) {
+            printf("FAIL: liquid not at rest after %u ticks\n", run->numTicks);
+            passed = false;
+        }
+        if (run->desynced) {
+            puts("FAIL: voxels disagree with the simulated levels");
+            passed = false;
+        }
+    }
+    if (serial.voxels != parallel.voxels || serial.numTicks != parallel.numTicks) {
+        puts("FAIL: threaded run differs from the serial one");
+        passed = false;
+    }
+
+    { // A settled chunk has to mesh its liquid
+        PagedChunkAllocator allocator = {};
+        ChunkAccessor accessor = {};
+        accessor.init(&allocator);
+        ChunkHandle chunk = accessor.acquire(ChunkID(0, 0, 0));
+        chunk->initAndFillEmpty(WorldCubeFace::FACE_TOP);
+        chunk->blocks.changeState(vvox::VoxelStorageState::FLAT_ARRAY, chunk->dataMutex);
+        for (int i = 0; i < CHUNK_SIZE; i++) chunk->blocks.set(i, serial.voxels[i]);
+        ChunkMesher* mesher = new ChunkMesher;
+        mesher->init(&blocks);
+        mesher->prepareData(chunk);
+        ChunkMeshData* meshData = mesher->createChunkMeshData(MeshTaskType::DEFAULT);
+        size_t numVertices = meshData->waterVertices.size();
+        if (!numVertices || numVertices % 4 || meshData->chunkMeshRenderData.waterIndexSize != numVertices / 4 * 6) {
+            printf("FAIL: %zu liquid vertices\n", numVertices);
+            passed = false;
+        }
+        printf("Settled chunk meshed to %zu liquid quads\n", numVertices / 4);
+        delete meshData;
+        delete mesher;
+        chunk.release();
+        accessor.destroy();
+    }
+
+    printf("%ux%u chunks, %llu units of liquid at rest after %u ticks\n", chunkWidth, chunkWidth, serial.massAfter, serial.numTicks);
+    printf("  serial %lf ms, %.1f Mcells/s\n", serial.ms, serial.ms > 0.0 ? serial.numCellsStepped / serial.ms / 1000.0 : 0.0);
+    printf("  %u threads %lf ms, %.1f Mcells/s\n", numThreads, parallel.ms, parallel.ms > 0.0 ? parallel.numCellsStepped / parallel.ms / 1000.0 : 0.0);
+    printf("  %.1f%% of cells stepped, the rest slept\n",
+           100.0 * serial.numCellsStepped / ((f64)serial.numTicks * chunkWidth * chunkWidth * CHUNK_SIZE + 1.0));
+    printf("Liquid simulation %s\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+namespace {
+    const ui32 BUP_TICKS = 200;
+    const ui32 BUP_BENCH_TICKS = 100;
+
+    struct BlockUpdateIDs {
+        BlockID stone, dirt, grass, sand, sapling, log;
+    };
+
+    /// Counts DataChange events per chunk within a tick
+    struct DataChangeCounter {
+        void onDataChange(Sender s VORB_UNUSED, ChunkHandle& chunk) {
+            std::lock_guard<std::mutex> l(lock);
+            counts[chunk.getID().id]++;
+        }
+        std::mutex lock;
+        std::map<ui64, ui32> counts;
+    };
+
+    struct BlockUpdateRun {
+        std::vector<ui16> voxels; ///< Every chunk, in creation order
+        ui32 numGrass = 0;
+        ui32 numSand = 0;
+        ui32 maxDataChanges = 0; ///< Most DataChange events one chunk got in one tick
+        bool isSmothered = false;
+        bool hasLanded = false; ///< Sand column rests on the floor, with nothing left hanging
+        bool hasGrown = false;
+        bool numBlocksMatch = true;
+        bool isCompressed = true;
+    };
+
+    /// Fills a 3x3x3 grid with a stone floor under dirt, two grass blocks, one of them covered,
+    /// a sapling and a column of sand hanging across a chunk border, then ticks it
+    BlockUpdateRun runBlockUpdates(const BlockPack& blocks, const BlockUpdateIDs& b, OPT VoxPool* threadPool, vvox::VoxelStorageState state) {
+        PagedChunkAllocator allocator = {};
+        ChunkAccessor accessor = {};
+        accessor.init(&allocator);
+        std::vector<ChunkHandle> chunks(27);
+        auto getIndex = [](int x, int y, int z) {
+            return ((y / CHUNK_WIDTH) * 9 + (z / CHUNK_WIDTH) * 3 + x / CHUNK_WIDTH) * CHUNK_SIZE +
+                (y % CHUNK_WIDTH) * CHUNK_LAYER + (z % CHUNK_WIDTH) * CHUNK_WIDTH + x % CHUNK_WIDTH;
+        };
+        std::vector<ui16> voxels(27 * CHUNK_SIZE, 0);
+        for (int z = 0; z < 3 * CHUNK_WIDTH; z++) {
+            for (int x = 0; x < 3 * CHUNK_WIDTH; x++) {
+                for (int y = 0; y < 20; y++) voxels[getIndex(x, y, z)] = b.stone;
+                voxels[getIndex(x, 20, z)] = b.dirt;
+            }
+        }
+        voxels[getIndex(5, 20, 5)] = b.grass;
+        voxels[getIndex(15, 20, 15)] = b.grass;
+        for (int z = 10; z < 20; z++) {
+            for (int x = 10; x < 20; x++) voxels[getIndex(x, 21, z)] = b.stone;
+        }
+        voxels[getIndex(50, 21, 50)] = b.sapling;
+        for (int y = 40; y < 70; y++) voxels[getIndex(40, y, 40)] = b.sand;
+
+        for (int i = 0; i < 27; i++) {
+            ChunkHandle& chunk = chunks[i];
+            chunk = accessor.acquire(ChunkID(i % 3, i / 9, (i / 3) % 3));
+            chunk->initAndFillEmpty(WorldCubeFace::FACE_TOP);
+            chunk->blocks.changeState(vvox::VoxelStorageState::FLAT_ARRAY, chunk->dataMutex);
+            chunk->numBlocks = 0;
+            for (int j = 0; j < CHUNK_SIZE; j++) {
+                chunk->blocks.set(j, voxels[i * CHUNK_SIZE + j]);
+                if (voxels[i * CHUNK_SIZE + j]) chunk->numBlocks++;
+            }
+            chunk->blocks.changeState(state, chunk->dataMutex);
+            chunk->genLevel = GEN_DONE;
+        }
+
+        DataChangeCounter counter;
+        Chunk::DataChange += makeDelegate(counter, &DataChangeCounter::onDataChange);
+        BlockUpdateScheduler scheduler;
+        scheduler.init(nullptr, &blocks, threadPool, 1337);
+        scheduler.setRandomTicksPerChunk(4096);
+        for (auto& chunk : chunks) scheduler.addChunk(chunk);
+        // Placed by hand, so the sand has to be scheduled
+        for (int y = 40; y < 70; y++) {
+            int i = getIndex(40, y, 40);
+            scheduler.scheduleUpdate(chunks[i / CHUNK_SIZE].getID(), (ui16)(i % CHUNK_SIZE), 0);
+        }
+
+        BlockUpdateRun run;
+        for (ui32 t = 0; t < BUP_TICKS; t++) {
+            scheduler.tick();
+            for (auto& it : counter.counts) run.maxDataChanges = glm::max(run.maxDataChanges, it.second);
+            counter.counts.clear();
+        }
+        scheduler.dispose();
+        Chunk::DataChange -= makeDelegate(counter, &DataChangeCounter::onDataChange);
+
+        for (auto& chunk : chunks) {
+            if (chunk->blocks.getState() != state) run.isCompressed = false;
+            ui32 numBlocks = 0;
+            for (int i = 0; i < CHUNK_SIZE; i++) {
+                BlockID id = chunk->blocks.get(i);
+                run.voxels.push_back(id);
+                if (id) numBlocks++;
+                if (id == b.grass) run.numGrass++;
+                if (id == b.sand) run.numSand++;
+            }
+            if (numBlocks != (ui32)chunk->numBlocks) run.numBlocksMatch = false;
+        }
+        run.isSmothered = run.voxels[getIndex(15, 20, 15)] == b.dirt;
+        run.hasLanded = run.voxels[getIndex(40, 21, 40)] == b.sand && run.voxels[getIndex(40, 50, 40)] == b.sand &&
+            run.voxels[getIndex(40, 51, 40)] == 0;
+        run.hasGrown = run.voxels[getIndex(50, 21, 50)] == b.log;
+
+        for (auto& chunk : chunks) chunk.release();
+        accessor.destroy();
+        return run;
+    }
+}
+
+bool runBUP(ui32 chunkWidth, ui32 numThreads) {
+    if (chunkWidth == 0) chunkWidth = 1;
+    if (numThreads == 0) numThreads = 1;
+    BlockTexture texture;
+    texture.layers.base.initBlockTextureFunc();
+    BlockPack blocks;
+    auto addBlock = [&](Block& block) {
+        for (int i = 0; i < 6; i++) block.textures[i] = &texture;
+        return blocks.append(block);
+    };
+    BlockUpdateIDs b;
+    Block stone;
+    stone.sID = "stone";
+    b.stone = addBlock(stone);
+    Block dirt;
+    dirt.sID = "dirt";
+    b.dirt = addBlock(dirt);
+    Block grass;
+    grass.sID = "grass";
+    grass.spreadsOntoID = "dirt";
+    grass.smotheredID = "dirt";
+    b.grass = addBlock(grass);
+    Block sand;
+    sand.sID = "sand";
+    sand.fallDelay = 2;
+    b.sand = addBlock(sand);
+    Block sapling;
+    sapling.sID = "sapling";
+    sapling.collide = false;
+    sapling.occlude = BlockOcclusion::NONE;
+    sapling.growsIntoID = "log";
+    sapling.growChance = 0.25f;
+    b.sapling = addBlock(sapling);
+    Block log;
+    log.sID = "log";
+    b.log = addBlock(log);
+    blocks.updateMeshTables();
+    blocks.updateTickRules();
+
+    VoxPool threadPool;
+    threadPool.init(numThreads);
+    bool passed = true;
+    // Inline and flat, then on the pool and compressed
+    BlockUpdateRun serial = runBlockUpdates(blocks, b, nullptr, vvox::VoxelStorageState::FLAT_ARRAY);
+    BlockUpdateRun parallel = runBlockUpdates(blocks, b, &threadPool, vvox::VoxelStorageState::INTERVAL_TREE);
+    for (auto& run : { &serial, &parallel }) {
+        if (run->numGrass < 3) {
+            printf("FAIL: grass only covers %u blocks\n", run->numGrass);
+            passed = false;
+        }
+        if (!run->isSmothered) {
+            puts("FAIL: covered grass wasn't smothered");
+            passed = false;
+        }
+        if (run->numSand != 30 || !run->hasLanded) {
+            printf("FAIL: %u of 30 sand blocks, landed %d\n", run->numSand, (int)run->hasLanded);
+            passed = false;
+        }
+        if (!run->hasGrown) {
+            puts("FAIL: sapling didn't grow");
+            passed = false;
+        }
+        if (!run->numBlocksMatch) {
+            puts("FAIL: numBlocks is off");
+            passed = false;
+        }
+        if (!run->isCompressed) {
+            puts("FAIL: updates changed the voxel storage");
+            passed = false;
+        }
+        if (run->maxDataChanges > 1) {
+            printf("FAIL: a chunk got %u DataChange events in one tick\n", run->maxDataChanges);
+            passed = false;
+        }
+    }
+    if (serial.voxels != parallel.voxels) {
+        puts("FAIL: threaded run differs from the serial one");
+        passed = false;
+    }
+    printf("Grass spread to %u blocks in %u ticks\n", serial.numGrass, BUP_TICKS);
+
+    { // Headless benchmark, grass scattered over the bottom layer of a chunkWidth x 4 x chunkWidth grid
+        PagedChunkAllocator allocator = {};
+        ChunkAccessor accessor = {};
+        accessor.init(&allocator);
+        std::vector<ChunkHandle> chunks;
+        chunks.reserve(chunkWidth * chunkWidth * 4);
+        std::mt19937 rEngine(1337);
+        std::uniform_int_distribution<int> coord(0, CHUNK_LAYER - 1);
+        for (ui32 y = 0; y < 4; y++) {
+            for (ui32 z = 0; z < chunkWidth; z++) {
+                for (ui32 x = 0; x < chunkWidth; x++) {
+                    chunks.push_back(accessor.acquire(ChunkID(x, y, z)));
+                    ChunkHandle& chunk = chunks.back();
+                    chunk->initAndFillEmpty(WorldCubeFace::FACE_TOP);
+                    chunk->genLevel = GEN_DONE;
+                    if (y) continue;
+                    chunk->blocks.changeState(vvox::VoxelStorageState::FLAT_ARRAY, chunk->dataMutex);
+                    for (int i = 0; i < 20 * CHUNK_LAYER; i++) chunk->blocks.set(i, b.stone);
+                    for (int i = 0; i < CHUNK_LAYER; i++) chunk->blocks.set(20 * CHUNK_LAYER + i, b.dirt);
+                    for (int i = 0; i < 32; i++) chunk->blocks.set(20 * CHUNK_LAYER + coord(rEngine), b.grass);
+                    chunk->numBlocks = 21 * CHUNK_LAYER;
+                    chunk->blocks.changeState(vvox::VoxelStorageState::INTERVAL_TREE, chunk->dataMutex);
+                }
+            }
+        }
+
+        BlockUpdateScheduler scheduler;
+        scheduler.init(nullptr, &blocks, &threadPool);
+        for (auto& chunk : chunks) scheduler.addChunk(chunk);
+        // The first tick counts the random ticked voxels
+        scheduler.tick();
+        ui64 randomTicks = scheduler.getNumRandomTicks();
+        ui64 changes = scheduler.getNumChanges();
+        PreciseTimer timer;
+        timer.start();
+        for (ui32 t = 0; t < BUP_BENCH_TICKS; t++) scheduler.tick();
+        f64 ms = timer.stop();
+        randomTicks = scheduler.getNumRandomTicks() - randomTicks;
+        changes = scheduler.getNumChanges() - changes;
+        printf("%zu chunks on %u threads, %zu stepped per tick\n", chunks.size(), numThreads, scheduler.getNumSteppedChunks());
+        printf("  %lf ms per tick, %.2f M random ticks/s, %.1f K changes/s\n", ms / BUP_BENCH_TICKS,
+               ms > 0.0 ? randomTicks / ms / 1000.0 : 0.0, ms > 0.0 ? changes / ms : 0.0);
+        scheduler.dispose();
+        for (auto& chunk : chunks) chunk.release();
+        accessor.destroy();
+    }
+    threadPool.destroy();
+
+    printf("Block updates %s\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+namespace {
+    /// Regenerates a chunk the way fillTerrainChunk does for its seed, and counts its blocks
+    void regenerateChunk(ChunkHandle& chunk, const BlockID ids[4], ui32 seed) {
+        fillTerrainChunk(chunk, ids, seed);
+        chunk->numBlocks = 0;
+        for (int i = 0; i < CHUNK_SIZE; i++) {
+            if (chunk->blocks.get(i)) chunk->numBlocks++;
+        }
+    }
+}
+
+bool runCED(ui32 numChunks, ui32 editsPerChunk) {
+    const nString SAVE_DIR = "CEDTest";
+    const BlockID ids[4] = { 1, 2, 3, 4 };
+    const BlockID NUM_IDS = 6;
+    if (numChunks == 0) numChunks = 1;
+    bool passed = true;
+
+    { // Codec edge cases
+        std::vector<VoxelEdit> edits, decoded;
+        std::vector<ui8> data;
+        ChunkEditJournal::encode(edits, data);
+        passed &= ChunkEditJournal::decode(data.data(), data.size(), decoded) && decoded.empty();
+        // Every voxel, in runs of 100
+        for (int i = 0; i < CHUNK_SIZE; i++) edits.push_back({ (ui16)i, (BlockID)(i / 100) });
+        ChunkEditJournal::encode(edits, data);
+        passed &= ChunkEditJournal::decode(data.data(), data.size(), decoded) && decoded.size() == edits.size() &&
+            memcmp(decoded.data(), edits.data(), edits.size() * sizeof(VoxelEdit)) == 0;
+        printf("Every voxel edited packs to %zu bytes\n", data.size());
+        data.pop_back();
+        passed &= !ChunkEditJournal::decode(data.data(), data.size(), decoded);
+        data[0] = CHUNK_EDITS_VERSION + 1;
+        passed &= !ChunkEditJournal::decode(data.data(), data.size(), decoded);
+        if (!passed) puts("FAIL: edit codec");
+    }
+
+    PagedChunkAllocator allocator = {};
+    ChunkAccessor accessor = {};
+    accessor.init(&allocator);
+    // A row crossing from negative into positive regions, and one chunk left unedited
+    std::vector<ChunkHandle> chunks(numChunks + 1);
+    for (ui32 i = 0; i <= numChunks; i++) {
+        chunks[i] = accessor.acquire(ChunkID((i32)i - (i32)numChunks / 2, -1, (i32)i));
+    }
+    auto removeRegions = [&]() {
+        for (auto& chunk : chunks) {
+            const ChunkID& id = chunk.getID();
+            nString path = SAVE_DIR + "/Region/edits." + std::to_string((int)WorldCubeFace::FACE_TOP) + "." +
+                std::to_string((i32)id.x >> RSHIFT) + "." + std::to_string((i32)id.y >> RSHIFT) + "." +
+                std::to_string((i32)id.z >> RSHIFT) + ".soar";
+            remove(path.c_str());
+        }
+    };
+    removeRegions();
+
+    // Generate and edit: scattered placements, overwrites and tunnels of air
+    std::vector<std::vector<ui16>> expected(numChunks + 1);
+    std::mt19937 rEngine(1337);
+    std::uniform_int_distribution<int> index(0, CHUNK_SIZE - 1);
+    std::uniform_int_distribution<int> block(0, NUM_IDS - 1);
+    size_t fullBytes = 0;
+    {
+        ChunkIOManager io(SAVE_DIR);
+        ChunkEditJournal journal;
+        journal.init(WorldCubeFace::FACE_TOP, &io);
+        for (ui32 c = 0; c <= numChunks; c++) {
+            ChunkHandle& chunk = chunks[c];
+            regenerateChunk(chunk, ids, c);
+            for (ui32 e = 0; e < editsPerChunk && c < numChunks; e++) {
+                int i = index(rEngine);
+                if (e % 16 == 0) {
+                    for (int j = i; j < i + CHUNK_WIDTH && j < CHUNK_SIZE; j++) {
+                        ChunkUpdater::placeBlockNoUpdate(chunk, j, 0);
+                        journal.record(chunk.getID(), (ui16)j, 0);
+                    }
+                } else {
+                    BlockID id = (BlockID)block(rEngine);
+                    ChunkUpdater::placeBlockNoUpdate(chunk, i, id);
+                    journal.record(chunk.getID(), (ui16)i, id);
+                }
+            }
+            for (int i = 0; i < CHUNK_SIZE; i++) expected[c].push_back(chunk->blocks.get(i));
+            fullBytes += CHUNK_SIZE * sizeof(ui16);
+        }
+        PreciseTimer timer;
+        timer.start();
+        size_t numSaved = journal.save();
+        f64 ms = timer.stop();
+        if (numSaved != (editsPerChunk ? numChunks : 0) || journal.save() != 0) {
+            printf("FAIL: saved %zu of %u chunks\n", numSaved, numChunks);
+            passed = false;
+        }
+        size_t deltaBytes = 0;
+        std::vector<VoxelEdit> edits;
+        std::vector<ui8> data;
+        for (auto& chunk : chunks) {
+            if (!journal.getEdits(chunk.getID(), edits)) continue;
+            ChunkEditJournal::encode(edits, data);
+            deltaBytes += data.size();
+        }
+        printf("Saved edits of %zu chunks in %lf ms: %zu bytes against %zu bytes of voxels (%.1fx smaller)\n",
+               numSaved, ms, deltaBytes, fullBytes, deltaBytes ? (f64)fullBytes / deltaBytes : 0.0);
+    }
+
+    { // Fresh journal and region cache, so everything comes from disk
+        ChunkIOManager io(SAVE_DIR);
+        ChunkEditJournal journal;
+        journal.init(WorldCubeFace::FACE_TOP, &io);
+        PreciseTimer timer;
+        timer.start();
+        for (ui32 c = 0; c <= numChunks; c++) {
+            ChunkHandle& chunk = chunks[c];
+            regenerateChunk(chunk, ids, c);
+            journal.load(chunk.getID());
+            journal.apply(chunk);
+        }
+        f64 ms = timer.stop();
+        for (ui32 c = 0; c <= numChunks; c++) {
+            ChunkHandle& chunk = chunks[c];
+            ui32 numBlocks = 0;
+            bool isSame = true;
+            for (int i = 0; i < CHUNK_SIZE; i++) {
+                BlockID id = chunk->blocks.get(i);
+                if (id != expected[c][i]) isSame = false;
+                if (id) numBlocks++;
+            }
+            if (!isSame || numBlocks != (ui32)chunk->numBlocks) {
+                printf("FAIL: chunk %u differs after regenerating and patching\n", c);
+                passed = false;
+            }
+        }
+        if (journal.getNumChunks() != (editsPerChunk ? numChunks : 0)) {
+            printf("FAIL: loaded edits of %zu chunks\n", journal.getNumChunks());
+            passed = false;
+        }
+        printf("Regenerated and patched %u chunks in %lf ms\n", numChunks + 1, ms);
+    }
+
+    for (auto& chunk : chunks) chunk.release();
+    accessor.destroy();
+    removeRegions();
+    printf("Chunk edit deltas %s\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
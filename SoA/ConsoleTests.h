@@ -27,4 +27,153 @@ void freeCAS(ChunkAccessSpeedData* data);
 
 void runCHS();
 
+/************************************************************************/
+/* Mesh Determinism                                                     */
+/************************************************************************/
+/// Meshes the same random-textured chunk several times and checks the quads are byte-identical
+bool runMDT();
+
+/************************************************************************/
+/* Region File Benchmark                                                */
+/************************************************************************/
+/// Saves every chunk of a region in random order a few times, compacts it and verifies the data
+bool runRFB();
+
+/************************************************************************/
+/* World Generation Benchmark                                           */
+/************************************************************************/
+/// Streams chunks over a planet headlessly and prints the JSON report. An empty name picks the first planet
+bool runWGB(const cString planetName, ui32 numFrames);
+
+/************************************************************************/
+/* Mesher Table Benchmark                                               */
+/************************************************************************/
+/// Meshes dense terrain chunks and compares face culling through Block structs against the BlockPack tables
+bool runMMB(ui32 numChunks);
+
+/************************************************************************/
+/* Planet Gen Cache                                                     */
+/************************************************************************/
+/// Loads a planet cold, then warm from its cache image, prints both times and checks the data matches
+bool runPGC(const cString searchDir, const cString terrainPath);
+
+/************************************************************************/
+/* Frustum Culling Benchmark                                            */
+/************************************************************************/
+/// Culls random spheres one at a time, batched, and batched across threads, then checks all three agree
+bool runFCB(ui32 numSpheres, ui32 numThreads);
+
+/************************************************************************/
+/* GPU Readback                                                         */
+/************************************************************************/
+/// Fills the texture and query readback rings, checks they refuse more, then drains them in order. Needs a GL context
+bool runGRB();
+
+/************************************************************************/
+/* Orbit Path Benchmark                                                 */
+/************************************************************************/
+/// Compares baking Kepler solved path vertices per body against instanced paths on a synthetic system
+bool runOPB(ui32 numBodies);
+
+/************************************************************************/
+/* Mesh Data Pool                                                       */
+/************************************************************************/
+/// Remeshes chunks with fresh and pooled mesh data, checks they match and prints timings and pool misses
+bool runMDP(ui32 numRemeshes);
+
+/************************************************************************/
+/* Voxel Model Pipeline                                                 */
+/************************************************************************/
+/// Loads a .qb model, meshes it cold and warm from the mesh cache, and checks the greedy mesh covers every visible face
+bool runVMP(const cString modelPath);
+
+/************************************************************************/
+/* Mesh Invalidation                                                    */
+/************************************************************************/
+/// Makes single voxel edits and checks remeshing only the dirty slabs matches a full remesh, printing timings of both
+bool runMIB(ui32 numEdits);
+
+/************************************************************************/
+/* Ambient Occlusion Benchmark                                          */
+/************************************************************************/
+/// Meshes a chunk with and without ambient occlusion, prints the cost and checks merged quads kept the right shading
+bool runAOB(ui32 numMeshes);
+
+/************************************************************************/
+/* Block Texture Loading                                                */
+/************************************************************************/
+/// Loads a texture pack serially, on a thread pool and from the atlas cache, prints the timings and checks the atlases match
+bool runBTL(const cString texturePackDir, ui32 numThreads);
+
+/************************************************************************/
+/* Mod Path Resolver                                                    */
+/************************************************************************/
+/// Resolves every file of a mod and default folder through the file index and by probing, checks they agree and prints timings
+bool runMPR(const cString defaultDir, const cString modDir, ui32 numPasses);
+
+/************************************************************************/
+/* Multi Draw Indirect                                                  */
+/************************************************************************/
+/// Batches a cube of fake chunk meshes into indirect commands, compares the draw calls against per chunk drawing and checks nothing was lost
+bool runMDI(ui32 chunkRadius);
+
+/************************************************************************/
+/* Chunk Level Of Detail                                                */
+/************************************************************************/
+/// Meshes a hill chunk at every LOD level, prints quad counts and timings and checks the coarse volumes cover the real one
+bool runLOD(ui32 numMeshes);
+
+/************************************************************************/
+/* Occlusion Culling                                                    */
+/************************************************************************/
+/// Checks chunk face connections of known shapes, then counts the meshes of a flat terrain that the visibility walk culls
+bool runOCC(ui32 chunkRadius);
+
+/************************************************************************/
+/* Trivial Chunk Meshes                                                 */
+/************************************************************************/
+/// Meshes and classifies empty, buried and mixed chunks, and checks that only mixed ones have faces
+bool runTMB(ui32 numChunks);
+
+/************************************************************************/
+/* Chunk Residency                                                      */
+/************************************************************************/
+/// Checks that emptied allocator pages are freed, then soaks a world gen run under a memory budget
+/// and checks the second half of the path peaks no higher than the budget or the first half
+bool runCRS(const cString planetName, ui32 numFrames, ui32 budgetMiB);
+
+/************************************************************************/
+/* Chunk Allocator Scaling                                              */
+/************************************************************************/
+/// Allocates and frees chunks with voxel arrays from 1 up to maxThreads threads and prints the speedup over one thread
+bool runCAL(ui32 maxThreads, ui32 numOps);
+
+/************************************************************************/
+/* Chunk ID Hash Map                                                    */
+/************************************************************************/
+/// Checks ChunkIDMap against std::map, then times the six neighbor lookups of ChunkSphereComponentUpdater::submitAndConnect
+/// for every chunk in a sphere with the raw id hash, the mixed hash and ChunkIDMap
+bool runCHM(ui32 chunkRadius);
+
+/************************************************************************/
+/* Liquid Simulation                                                    */
+/************************************************************************/
+/// Lets liquid settle on a chunkWidth x chunkWidth floor inline and on numThreads threads, checks that both
+/// conserve it, come to rest and agree, then meshes a settled chunk
+bool runLQS(ui32 chunkWidth, ui32 numThreads);
+
+/************************************************************************/
+/* Block Updates                                                        */
+/************************************************************************/
+/// Ticks grass, sand and a sapling inline on flat chunks and on numThreads threads on compressed ones, checks the rules
+/// and that both runs agree, then times ticks of a chunkWidth x 4 x chunkWidth grid
+bool runBUP(ui32 chunkWidth, ui32 numThreads);
+
+/************************************************************************/
+/* Chunk Edit Deltas                                                    */
+/************************************************************************/
+/// Edits generated chunks, saves only the edits to region files, then regenerates the chunks,
+/// loads and applies the edits and checks every voxel matches. Prints saved bytes against full voxel arrays
+bool runCED(ui32 numChunks, ui32 editsPerChunk);
+
 #endif // !ConsoleTests_h__
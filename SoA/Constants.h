@@ -37,6 +37,10 @@ const i32 CHUNK_WIDTH_M1 = 31;
 const i32 HALF_CHUNK_WIDTH = CHUNK_WIDTH / 2;
 const i32 CHUNK_LAYER = CHUNK_WIDTH*CHUNK_WIDTH;
 const i32 CHUNK_SIZE = CHUNK_LAYER*CHUNK_WIDTH;
+// Chunk meshes are built and spliced in horizontal slabs of this many layers
+const i32 CHUNK_MESH_SLAB_HEIGHT = 8;
+const i32 CHUNK_MESH_SLABS = CHUNK_WIDTH / CHUNK_MESH_SLAB_HEIGHT;
+const ui8 CHUNK_MESH_SLABS_ALL = (1 << CHUNK_MESH_SLABS) - 1;
 const i32 SURFACE_DEPTH = 256;
 const i32 OBJECT_LIST_SIZE = 24096;
 
@@ -39,19 +39,13 @@ void CutoutVoxelRenderStage::render(const Camera* camera VORB_UNUSED) {
     //     saveTicks = SDL_GetTicks();
     // }
 
-    ChunkMesh *cm;
-
-    const std::vector <ChunkMesh *>& chunkMeshes = cmm->getChunkMeshes();
+    const std::vector <ChunkMesh *>& chunkMeshes = cmm->getVisibleChunkMeshes();
     {
         std::lock_guard<std::mutex> l(cmm->lckActiveChunkMeshes);
         if (chunkMeshes.empty()) return;
         for (int i = chunkMeshes.size() - 1; i >= 0; i--) {
-            cm = chunkMeshes[i];
-
-            if (cm->inFrustum) {
-                m_renderer->drawCutout(cm, position,
-                                       m_gameRenderParams->chunkCamera->getViewProjectionMatrix());
-            }
+            m_renderer->drawCutout(chunkMeshes[i], position,
+                                   m_gameRenderParams->chunkCamera->getViewProjectionMatrix());
         }
     }
     glEnable(GL_CULL_FACE);
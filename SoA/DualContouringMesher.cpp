@@ -6,20 +6,26 @@
 #include <Vorb/Timing.h>
 
 #include "Octree.h"
+#include "VoxelModel.h"
 
-void DualContouringMesher::genMatrixMesh(const VoxelMatrix& matrix, std::vector<VoxelModelVertex>& vertices, std::vector<ui32>& indices) {
-    int octreeSize = glm::max(glm::max(matrix.size.x, matrix.size.y), matrix.size.z);
+void DualContouringMesher::genMatrixMesh(const VoxelMatrix& matrix, std::vector<VoxelModelVertex>& vertices, std::vector<ui32>& indices,
+                                         OPT VoxelModelMetrics* metrics /*= nullptr*/) {
+    // Smallest power of two that holds the matrix plus a layer of air on each side,
+    // so the surface on the model's bounds is still inside the octree
+    ui32 maxSize = glm::max(glm::max(matrix.size.x, matrix.size.y), matrix.size.z);
+    ui32 octreeSize = 2;
+    while (octreeSize < maxSize + 2) octreeSize <<= 1;
 
     gMatrix = &matrix;
-    octreeSize = 128;
-    std::cout << octreeSize << std::endl;
     const int MAX_THRESHOLDS = 5;
     const float THRESHOLDS[MAX_THRESHOLDS] = { -1.f, 0.1f, 1.f, 10.f, 50.f };
     int thresholdIndex = 3;
     PreciseTimer timer;
-    OctreeNode* root = BuildOctree(i32v3(-octreeSize / 2), octreeSize, THRESHOLDS[thresholdIndex]);
-    std::cout << timer.stop() << std::endl;
+    timer.start();
+    OctreeNode* root = BuildOctree(i32v3(-(i32)octreeSize / 2), (int)octreeSize, THRESHOLDS[thresholdIndex]);
+    if (metrics) metrics->octreeMs = timer.stop();
     timer.start();
     GenerateMeshFromOctree(root, vertices, indices);
-    std::cout << timer.stop() << std::endl;
-}
\ No newline at end of file
+    DestroyOctree(root);
+    if (metrics) metrics->contourMs = timer.stop();
+}
@@ -19,12 +19,15 @@
 #include "VoxelModelMesh.h"
 
 class VoxelMatrix;
+struct VoxelModelMetrics;
 
 // TODO(Ben): I don't understand this
 // Source: http://ngildea.blogspot.com/2014/11/implementing-dual-contouring.html
 class DualContouringMesher {
 public:
-    static void genMatrixMesh(const VoxelMatrix& matrix, std::vector<VoxelModelVertex>& vertices, std::vector<ui32>& indices);
+    /// Not reentrant, the density function reads the matrix through gMatrix
+    static void genMatrixMesh(const VoxelMatrix& matrix, std::vector<VoxelModelVertex>& vertices, std::vector<ui32>& indices,
+                              OPT VoxelModelMetrics* metrics = nullptr);
 private:
 
 };
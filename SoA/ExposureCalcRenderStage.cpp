@@ -43,6 +43,7 @@ void ExposureCalcRenderStage::dispose(StaticLoadContext& context VORB_UNUSED) {
         m_renderTargets[i].dispose();
     }
     m_renderTargets.clear();
+    m_readback.dispose();
     m_needsScriptLoad = true;
 }
 
@@ -55,6 +56,9 @@ void ExposureCalcRenderStage::render(const Camera* camera VORB_UNUSED /*= nullpt
             m_renderTargets[i].init(vg::TextureInternalFormat::RGBA16F);
         }    
     }
+    if (!m_readback.isInitialized()) {
+        m_readback.init(sizeof(f32v4));
+    }
     // Lazy shader load
     if (!m_program.isCreated()) {
         m_program = ShaderLoader::createProgramFromFile("Shaders/PostProcessing/PassThrough.vert",
@@ -82,18 +86,25 @@ void ExposureCalcRenderStage::render(const Camera* camera VORB_UNUSED /*= nullpt
         // Final Step
         m_renderTargets[m_mipStep].bindTexture();
         m_mipStep = 1;
+        // Queue this cycle's result and use the newest one the GPU has finished,
+        // since reading the texture directly would stall until it is rendered.
+        // If every buffer is still in flight this result is simply skipped.
+        m_readback.readTexture(GL_TEXTURE_2D, GL_RGBA, GL_FLOAT);
         f32v4 pixel = f32v4(0.0f);
-        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, &pixel[0]);
+        bool hasPixel = false;
+        while (m_readback.poll(&pixel[0])) hasPixel = true;
 
-        // LUA SCRIPT
+        if (hasPixel) {
+            // LUA SCRIPT
 #if defined(__GNUC__) && !defined(__clang__)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
-        m_exposure = m_calculateExposure(pixel.r, pixel.g, pixel.b, pixel.a);
+            m_exposure = m_calculateExposure(pixel.r, pixel.g, pixel.b, pixel.a);
 #pragma GCC diagnostic pop
 #else
-        m_exposure = m_calculateExposure(pixel.r, pixel.g, pixel.b, pixel.a);
+            m_exposure = m_calculateExposure(pixel.r, pixel.g, pixel.b, pixel.a);
 #endif
+        }
 
         prog = &m_program;
         m_hdrFrameBuffer->bindGeometryTexture(0, 0);
@@ -22,6 +22,7 @@
 #include <Vorb/graphics/GLProgram.h>
 #include <Vorb/graphics/GBuffer.h>
 
+#include "GpuReadback.h"
 #include "IRenderStage.h"
 
 DECL_VG(class GLProgram);
@@ -59,6 +60,7 @@ class ExposureCalcRenderStage : public IRenderStage {
     int m_mipStep = -1;
     f32 m_exposure = 0.0005f;
     vg::GLProgram m_program;
+    TextureReadback m_readback; ///< Final 1x1 level, read a few cycles late
 
     // Script for exposure calc
     bool m_needsScriptLoad = true;
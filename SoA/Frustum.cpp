@@ -3,6 +3,39 @@
 
 #include "Constants.h"
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+// Only the side planes are tested, see sphereInFrustum
+#define NUM_CULL_PLANES 4
+
+void FrustumSpheres::add(const f32v3& center, f32 r) {
+    x.push_back(center.x);
+    y.push_back(center.y);
+    z.push_back(center.z);
+    radius.push_back(r);
+}
+
+void FrustumSpheres::swapRemove(size_t i) {
+    x[i] = x.back();
+    y[i] = y.back();
+    z[i] = z.back();
+    radius[i] = radius.back();
+    x.pop_back();
+    y.pop_back();
+    z.pop_back();
+    radius.pop_back();
+}
+
+void FrustumSpheres::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    radius.clear();
+}
+
 void Frustum::Plane::setNormalAndPoint(const f32v3 &normal, const f32v3 &point) {
     this->normal = glm::normalize(normal);
     d = -(glm::dot(this->normal, point));
@@ -124,3 +157,53 @@ bool Frustum::sphereInFrustum(const f32v3& pos, float radius) const {
     }
     return true;
 }
+
+void Frustum::cullSpheres(const FrustumSpheres& spheres, const f32v3& offset,
+                          size_t begin, size_t end, OUT std::vector<ui32>& visible) const {
+    const f32* xs = spheres.x.data();
+    const f32* ys = spheres.y.data();
+    const f32* zs = spheres.z.data();
+    const f32* rs = spheres.radius.data();
+
+    size_t i = begin;
+#ifdef FRUSTUM_USE_SSE
+    // Broadcast the planes once
+    __m128 nx[NUM_CULL_PLANES], ny[NUM_CULL_PLANES], nz[NUM_CULL_PLANES], nd[NUM_CULL_PLANES];
+    for (int p = 0; p < NUM_CULL_PLANES; p++) {
+        nx[p] = _mm_set1_ps(m_planes[p].normal.x);
+        ny[p] = _mm_set1_ps(m_planes[p].normal.y);
+        nz[p] = _mm_set1_ps(m_planes[p].normal.z);
+        nd[p] = _mm_set1_ps(m_planes[p].d);
+    }
+    const __m128 ox = _mm_set1_ps(offset.x);
+    const __m128 oy = _mm_set1_ps(offset.y);
+    const __m128 oz = _mm_set1_ps(offset.z);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= end; i += 4) {
+        __m128 px = _mm_sub_ps(_mm_loadu_ps(xs + i), ox);
+        __m128 py = _mm_sub_ps(_mm_loadu_ps(ys + i), oy);
+        __m128 pz = _mm_sub_ps(_mm_loadu_ps(zs + i), oz);
+        __m128 negR = _mm_sub_ps(zero, _mm_loadu_ps(rs + i));
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+        for (int p = 0; p < NUM_CULL_PLANES; p++) {
+            // Same operation order as Plane::distance
+            __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], px), _mm_mul_ps(ny[p], py)), _mm_mul_ps(nz[p], pz));
+            __m128 dist = _mm_add_ps(nd[p], dot);
+            inside = _mm_and_ps(inside, _mm_cmpgt_ps(dist, negR));
+        }
+        int mask = _mm_movemask_ps(inside);
+        while (mask) {
+            int lane = 0;
+            while (!(mask & (1 << lane))) lane++;
+            visible.push_back((ui32)(i + lane));
+            mask &= ~(1 << lane);
+        }
+    }
+#endif
+    // Remainder, or everything without SSE
+    for (; i < end; i++) {
+        f32v3 pos(xs[i] - offset.x, ys[i] - offset.y, zs[i] - offset.z);
+        if (sphereInFrustum(pos, rs[i])) visible.push_back((ui32)i);
+    }
+}
@@ -17,6 +17,22 @@
 
 #include "Vorb/types.h"
 
+/// Bounding spheres kept as one array per component, so
+/// Frustum::cullSpheres can test several at a time.
+/// Owners mirror their own list order, including swap removal.
+struct FrustumSpheres {
+    void add(const f32v3& center, f32 radius);
+    /// Moves the last sphere into i and shrinks by one
+    void swapRemove(size_t i);
+    void clear();
+    size_t size() const { return x.size(); }
+
+    std::vector<f32> x;
+    std::vector<f32> y;
+    std::vector<f32> z;
+    std::vector<f32> radius;
+};
+
 class Frustum {
 public:
 
@@ -55,6 +71,17 @@ class Frustum {
     /// @param radius: Radius of the sphere
     /// @return true if it is in the frustum
     bool sphereInFrustum(const f32v3& pos, float radius) const;
+
+    /// Tests a range of spheres, four at a time when SSE is available.
+    /// Gives the same answers as sphereInFrustum.
+    /// Ranges are independent, so a large set can be split across threads.
+    /// @param spheres: The bounding spheres
+    /// @param offset: Subtracted from each center, usually the camera position
+    /// @param begin: First sphere to test
+    /// @param end: One past the last sphere to test
+    /// @param visible: Indices of spheres in the frustum are appended here
+    void cullSpheres(const FrustumSpheres& spheres, const f32v3& offset,
+                     size_t begin, size_t end, OUT std::vector<ui32>& visible) const;
 private:
     float m_fov = 0.0f; ///< Vertical field of view in degrees
     float m_aspectRatio = 0.0f; ///< Screen aspect ratio
@@ -131,6 +131,8 @@ void GameplayScreen::onExit(const vui::GameTime& gameTime VORB_UNUSED) {
 void GameplayScreen::update(const vui::GameTime& gameTime VORB_UNUSED) {
 
     if (m_shouldReloadShaders) {
+        // Pick up files added to the texture packs too
+        m_soaState->clientState.texturePathResolver.refresh();
         m_renderer.reloadShaders();
         m_shouldReloadShaders = false;
     }
@@ -146,6 +148,7 @@ void GameplayScreen::update(const vui::GameTime& gameTime VORB_UNUSED) {
     // TODO(Ben): Don't hardcode for a single player
     auto& vpCmp = m_soaState->gameSystem->voxelPosition.getFromEntity(m_soaState->clientState.playerEntity);
     m_soaState->clientState.chunkMeshManager->update(vpCmp.gridPosition.pos, true);
+    m_soaState->chunkResidency.update(vpCmp.gridPosition);
 
     // Update the PDA
     if (m_pda.isOpen()) m_pda.update();
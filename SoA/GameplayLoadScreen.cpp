@@ -66,6 +66,8 @@ void GameplayLoadScreen::update(const vui::GameTime& gameTime VORB_UNUSED) {
     m_glrpc.processRequests(1);
     m_commonState->loadContext.processRequests(1);
     m_gameplayScreen->m_renderer.updateGL();
+    // Stream in the atlas pages that are done
+    m_commonState->state->clientState.blockTextures->update();
 
     // Defer texture loading
     static bool loadedTextures = false;
@@ -79,6 +81,8 @@ void GameplayLoadScreen::update(const vui::GameTime& gameTime VORB_UNUSED) {
         m_commonState->state->clientState.blockTextures->update();
         m_commonState->state->clientState.blockTextures->writeDebugAtlases();
         //m_commonState->state->blockTextures->save(&m_commonState->state->blocks);
+        m_monitor.printReport();
+        m_commonState->state->clientState.texturePathResolver.printStats("Texture");
         m_state = vui::ScreenState::CHANGE_NEXT;
         loadedTextures = true;
     }
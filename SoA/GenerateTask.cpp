@@ -24,6 +24,9 @@ void GenerateTask::execute(WorkerData* workerData) {
                     workerData->floraGenerator = new FloraGenerator;
                 }
                 generateFlora(workerData, chunk);
+                // Only player edits are saved, they go over the regenerated voxels
+                query->grid->edits.load(chunk.getID());
+                query->grid->edits.apply(&chunk);
                 chunk.genLevel = ChunkGenLevel::GEN_DONE;
                 break;
             case ChunkGenLevel::GEN_FLORA:
@@ -90,8 +93,15 @@ void GenerateTask::generateFlora(WorkerData* workerData, Chunk& chunk) {
                     }
                 }
             }
+            // Flora can't grow back over player edits. Also before GEN_DONE: if the chunk applied its
+            // edits before these nodes landed, nothing else would. If it hasn't, it applies them after.
+            query->grid->edits.apply(h);
 
-            if (h->genLevel == GEN_DONE) h->DataChange(h);
+            if (h->genLevel == GEN_DONE) {
+                // Nodes can land anywhere, so remesh the whole chunk
+                h->flagDirty();
+                h->DataChange(h);
+            }
         } else {
             query->grid->nodeSetter.setNodes(h, GEN_TERRAIN, it.second.wNodes, it.second.fNodes);
         }
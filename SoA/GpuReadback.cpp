@@ -0,0 +1,132 @@
+#include "stdafx.h"
+#include "GpuReadback.h"
+
+namespace {
+    bool isSignaled(GLsync fence) {
+        GLenum rv = glClientWaitSync(fence, 0, 0);
+        return rv == GL_ALREADY_SIGNALED || rv == GL_CONDITION_SATISFIED;
+    }
+}
+
+void TextureReadback::init(size_t bytes, ui32 numBuffers) {
+    dispose();
+    m_bytes = bytes;
+    m_buffers.resize(numBuffers);
+    m_fences.resize(numBuffers, nullptr);
+    glGenBuffers(numBuffers, m_buffers.data());
+    for (auto& buffer : m_buffers) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void TextureReadback::dispose() {
+    for (auto& fence : m_fences) {
+        if (fence) glDeleteSync(fence);
+    }
+    if (m_buffers.size()) glDeleteBuffers(m_buffers.size(), m_buffers.data());
+    std::vector<VGBuffer>().swap(m_buffers);
+    std::vector<GLsync>().swap(m_fences);
+    m_head = 0;
+    m_numPending = 0;
+}
+
+bool TextureReadback::readTexture(GLenum target, GLenum format, GLenum type, int level /*= 0*/) {
+    if (!beginCopy()) return false;
+    glGetTexImage(target, level, format, type, nullptr);
+    endCopy();
+    return true;
+}
+
+bool TextureReadback::readPixels(i32 x, i32 y, i32 width, i32 height, GLenum format, GLenum type) {
+    if (!beginCopy()) return false;
+    glReadPixels(x, y, width, height, format, type, nullptr);
+    endCopy();
+    return true;
+}
+
+bool TextureReadback::poll(OUT void* dst) {
+    if (m_numPending == 0) return false;
+    ui32 tail = (m_head + m_buffers.size() - m_numPending) % m_buffers.size();
+    if (!isSignaled(m_fences[tail])) return false;
+
+    glDeleteSync(m_fences[tail]);
+    m_fences[tail] = nullptr;
+    m_numPending--;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffers[tail]);
+    void* src = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_bytes, GL_MAP_READ_BIT);
+    if (src) {
+        memcpy(dst, src, m_bytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return src != nullptr;
+}
+
+bool TextureReadback::beginCopy() {
+    if (m_numPending == m_buffers.size()) return false;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffers[m_head]);
+    return true;
+}
+
+void TextureReadback::endCopy() {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_fences[m_head] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Make sure the fence reaches the GPU, or it may never signal
+    glFlush();
+    m_head = (m_head + 1) % m_buffers.size();
+    m_numPending++;
+}
+
+void QueryReadback::init(GLenum target, ui32 queriesPerFrame, ui32 numFrames) {
+    dispose();
+    m_target = target;
+    m_queriesPerFrame = queriesPerFrame;
+    m_numFrames = numFrames;
+    m_queries.resize(queriesPerFrame * numFrames);
+    glGenQueries(m_queries.size(), m_queries.data());
+}
+
+void QueryReadback::dispose() {
+    if (m_queries.size()) glDeleteQueries(m_queries.size(), m_queries.data());
+    std::vector<VGQuery>().swap(m_queries);
+    m_head = 0;
+    m_numPending = 0;
+}
+
+bool QueryReadback::beginFrame() {
+    return m_numPending < m_numFrames;
+}
+
+void QueryReadback::beginQuery(ui32 index) {
+    glBeginQuery(m_target, m_queries[m_head * m_queriesPerFrame + index]);
+}
+
+void QueryReadback::endQuery() {
+    glEndQuery(m_target);
+}
+
+void QueryReadback::endFrame() {
+    m_head = (m_head + 1) % m_numFrames;
+    m_numPending++;
+}
+
+bool QueryReadback::poll(OUT GLint* results) {
+    if (m_numPending == 0) return false;
+    ui32 tail = (m_head + m_numFrames - m_numPending) % m_numFrames;
+    const VGQuery* queries = &m_queries[tail * m_queriesPerFrame];
+
+    // Results become available in order, but check each to be safe
+    for (ui32 i = 0; i < m_queriesPerFrame; i++) {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return false;
+    }
+    for (ui32 i = 0; i < m_queriesPerFrame; i++) {
+        glGetQueryObjectiv(queries[i], GL_QUERY_RESULT, &results[i]);
+    }
+    m_numPending--;
+    return true;
+}
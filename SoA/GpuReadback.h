@@ -0,0 +1,95 @@
+///
+/// GpuReadback.h
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// Reads data back from the GPU without stalling the pipeline.
+/// Copies and queries are issued into a small ring and picked up
+/// a few frames later, once the GPU reports them finished.
+///
+
+#pragma once
+
+#ifndef GpuReadback_h__
+#define GpuReadback_h__
+
+#include <Vorb/graphics/gtypes.h>
+
+/// Frames a readback may be in flight before new ones are dropped
+#define GPU_READBACK_FRAMES 3
+
+/// Copies textures or framebuffer pixels into a ring of pixel pack buffers,
+/// each guarded by a fence.
+class TextureReadback {
+public:
+    /// @param bytes: Size of one readback
+    /// @param numBuffers: Ring size, and the most readbacks in flight
+    void init(size_t bytes, ui32 numBuffers = GPU_READBACK_FRAMES);
+    void dispose();
+    bool isInitialized() const { return !m_buffers.empty(); }
+
+    /// Queues a copy of a level of the texture bound to target.
+    /// @return false if the ring is full, nothing is queued then
+    bool readTexture(GLenum target, GLenum format, GLenum type, int level = 0);
+    /// Queues a copy of a rectangle of the bound read framebuffer.
+    /// @return false if the ring is full, nothing is queued then
+    bool readPixels(i32 x, i32 y, i32 width, i32 height, GLenum format, GLenum type);
+
+    /// Copies the oldest finished readback into dst. Never waits on the GPU.
+    /// @param dst: Must hold the bytes given to init()
+    /// @return false if nothing has finished yet
+    bool poll(OUT void* dst);
+
+    /// Readbacks issued but not yet polled
+    ui32 getNumPending() const { return m_numPending; }
+private:
+    /// Binds the next free buffer for packing, or returns false
+    bool beginCopy();
+    void endCopy();
+
+    std::vector<VGBuffer> m_buffers;
+    std::vector<GLsync> m_fences;
+    size_t m_bytes = 0;
+    ui32 m_head = 0; ///< Next buffer to write
+    ui32 m_numPending = 0;
+};
+
+/// Query objects grouped by frame, polled with GL_QUERY_RESULT_AVAILABLE
+/// instead of waiting on GL_QUERY_RESULT.
+class QueryReadback {
+public:
+    /// @param target: Query target, such as GL_SAMPLES_PASSED
+    /// @param queriesPerFrame: Queries issued in each frame
+    /// @param numFrames: Ring size, and the most frames in flight
+    void init(GLenum target, ui32 queriesPerFrame, ui32 numFrames = GPU_READBACK_FRAMES);
+    void dispose();
+    bool isInitialized() const { return !m_queries.empty(); }
+
+    /// Starts a frame of queries
+    /// @return false if every frame is still in flight. Skip the queries then.
+    bool beginFrame();
+    /// Wraps draw calls in query index of the current frame
+    void beginQuery(ui32 index);
+    void endQuery();
+    void endFrame();
+
+    /// Reads the oldest finished frame. Never waits on the GPU.
+    /// @param results: Must hold queriesPerFrame values
+    /// @return false if no frame has finished yet
+    bool poll(OUT GLint* results);
+
+    /// Frames issued but not yet polled
+    ui32 getNumPending() const { return m_numPending; }
+private:
+    std::vector<VGQuery> m_queries; ///< queriesPerFrame for each frame
+    GLenum m_target = 0;
+    ui32 m_queriesPerFrame = 0;
+    ui32 m_numFrames = 0;
+    ui32 m_head = 0; ///< Frame being written
+    ui32 m_numPending = 0;
+};
+
+#endif // GpuReadback_h__
@@ -0,0 +1,448 @@
+#include "stdafx.h"
+#include "LiquidSimulation.h"
+
+#include <Vorb/ThreadPool.h>
+
+#include "Chunk.h"
+#include "ChunkGrid.h"
+#include "ChunkUpdater.h"
+
+namespace {
+    const int W = LiquidStepper::WINDOW_WIDTH;
+    const int DY = W * W;
+    const int DZ = W;
+
+    inline int getWindowIndex(int x, int y, int z) {
+        return ((y + LIQUID_STEP_RADIUS) * W + (z + LIQUID_STEP_RADIUS)) * W + (x + LIQUID_STEP_RADIUS);
+    }
+
+    /// Grows a box by r and clips it to the chunk
+    LiquidBox expandBox(const LiquidBox& box, int r) {
+        LiquidBox rv;
+        if (box.isEmpty()) return rv;
+        rv.min = glm::max(box.min - r, i32v3(0));
+        rv.max = glm::min(box.max + r, i32v3(CHUNK_WIDTH - 1));
+        return rv;
+    }
+
+    /// Simulation remeshing its own writes on this thread, they are not edits to reread
+    thread_local const LiquidSimulation* notifyingSimulation = nullptr;
+}
+
+void LiquidStepTask::execute(WorkerData* workerData) {
+    // Lazily allocate the stepper, it is too big to make per task
+    if (workerData->liquidStepper == nullptr) {
+        workerData->liquidStepper = new LiquidStepper;
+    }
+    simulation->stepChunk(workerData->liquidStepper, chunk);
+}
+
+void LiquidStepper::step(LiquidChunk* chunk, const LiquidChunk* const neighbors[27], ui8 numLevels, ui32 phase) {
+    const ui8* src = chunk->levels[chunk->front];
+    ui8* dst = chunk->levels[chunk->front ^ 1];
+    memcpy(dst, src, CHUNK_SIZE);
+    chunk->changed = LiquidBox();
+
+    const LiquidBox& region = chunk->dirty[phase];
+    if (region.isEmpty()) return;
+    fillWindow(region.min - LIQUID_STEP_RADIUS, region.max + LIQUID_STEP_RADIUS, neighbors);
+
+    // Vertical pairs, the upper one drops what fits. One wider than the region,
+    // since the horizontal pass looks at the partner and what is below both.
+    int vParity = phase & 1;
+    i32v3 lo = region.min - 1;
+    i32v3 hi = region.max + 1;
+    for (int y = lo.y; y <= hi.y; y++) {
+        bool isBottom = (y & 1) == vParity;
+        for (int z = lo.z; z <= hi.z; z++) {
+            int i = getWindowIndex(lo.x, y, z);
+            for (int x = lo.x; x <= hi.x; x++, i++) {
+                int v = m_window[i];
+                int p = m_window[isBottom ? i + DY : i - DY];
+                if (v == LIQUID_BLOCKED || p == LIQUID_BLOCKED) {
+                    m_fallen[i] = (ui8)v;
+                } else if (isBottom) {
+                    m_fallen[i] = (ui8)(v + glm::min(p, numLevels - v));
+                } else {
+                    m_fallen[i] = (ui8)(v - glm::min(v, numLevels - p));
+                }
+            }
+        }
+    }
+
+    // Horizontal pairs along x or z. The higher one gives half the difference if it rests on
+    // something, and only if that is at least 2, so still liquid doesn't slosh.
+    bool alongZ = (phase & 1) != 0;
+    int hParity = (phase >> 1) & 1;
+    int partnerStep = alongZ ? DZ : 1;
+    for (int y = region.min.y; y <= region.max.y; y++) {
+        for (int z = region.min.z; z <= region.max.z; z++) {
+            int i = getWindowIndex(region.min.x, y, z);
+            int c = y * CHUNK_LAYER + z * CHUNK_WIDTH + region.min.x;
+            for (int x = region.min.x; x <= region.max.x; x++, i++, c++) {
+                int v = m_fallen[i];
+                if (v == LIQUID_BLOCKED) continue;
+                bool isLow = ((alongZ ? z : x) & 1) == hParity;
+                int pi = isLow ? i + partnerStep : i - partnerStep;
+                int p = m_fallen[pi];
+                if (p != LIQUID_BLOCKED) {
+                    if (v >= p + 2 && m_fallen[i - DY] >= numLevels) {
+                        v -= (v - p) / 2;
+                    } else if (p >= v + 2 && m_fallen[pi - DY] >= numLevels) {
+                        v += (p - v) / 2;
+                    }
+                }
+                if (v == m_window[i]) continue;
+                dst[c] = (ui8)v;
+                chunk->changed.add(i32v3(x, y, z));
+            }
+        }
+    }
+}
+
+void LiquidStepper::fillWindow(const i32v3& lo, const i32v3& hi, const LiquidChunk* const neighbors[27]) {
+    // Ranges of each neighbor along an axis, in chunk space
+    static const int SEGMENTS[3][2] = {
+        { -LIQUID_STEP_RADIUS, -1 },
+        { 0, CHUNK_WIDTH - 1 },
+        { CHUNK_WIDTH, CHUNK_WIDTH + LIQUID_STEP_RADIUS - 1 }
+    };
+    for (int sy = 0; sy < 3; sy++) {
+        int y0 = glm::max(lo.y, SEGMENTS[sy][0]);
+        int y1 = glm::min(hi.y, SEGMENTS[sy][1]);
+        if (y0 > y1) continue;
+        for (int sz = 0; sz < 3; sz++) {
+            int z0 = glm::max(lo.z, SEGMENTS[sz][0]);
+            int z1 = glm::min(hi.z, SEGMENTS[sz][1]);
+            if (z0 > z1) continue;
+            for (int sx = 0; sx < 3; sx++) {
+                int x0 = glm::max(lo.x, SEGMENTS[sx][0]);
+                int x1 = glm::min(hi.x, SEGMENTS[sx][1]);
+                if (x0 > x1) continue;
+
+                const LiquidChunk* n = neighbors[sy * 9 + sz * 3 + sx];
+                size_t width = x1 - x0 + 1;
+                // Offset from this chunk's space to the neighbor's
+                i32v3 offset((sx - 1) * CHUNK_WIDTH, (sy - 1) * CHUNK_WIDTH, (sz - 1) * CHUNK_WIDTH);
+                for (int y = y0; y <= y1; y++) {
+                    for (int z = z0; z <= z1; z++) {
+                        ui8* dst = &m_window[getWindowIndex(x0, y, z)];
+                        if (n) {
+                            int c = (y - offset.y) * CHUNK_LAYER + (z - offset.z) * CHUNK_WIDTH + (x0 - offset.x);
+                            memcpy(dst, &n->levels[n->front][c], width);
+                        } else {
+                            memset(dst, LIQUID_BLOCKED, width);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void LiquidSimulation::init(OPT ChunkGrid* grid, const LiquidData& liquid, OPT VoxPool* threadPool, ui32 maxChunksPerBatch) {
+    m_grid = grid;
+    m_liquid = liquid;
+    // LIQUID_BLOCKED is not a level
+    m_liquid.numLevels = glm::clamp(m_liquid.numLevels, 1, LIQUID_BLOCKED - 1);
+    m_threadPool = threadPool;
+    m_maxChunksPerBatch = maxChunksPerBatch;
+    if (!m_threadPool) m_stepper = new LiquidStepper;
+    m_tick = 0;
+    m_numCellsStepped = 0;
+    if (m_grid) {
+        m_grid->onNeighborsAcquire += makeDelegate(*this, &LiquidSimulation::onNeighborsAcquire);
+        m_grid->onNeighborsRelease += makeDelegate(*this, &LiquidSimulation::onNeighborsRelease);
+        Chunk::DataChange += makeDelegate(*this, &LiquidSimulation::onDataChange);
+    }
+}
+
+void LiquidSimulation::dispose() {
+    if (m_grid) {
+        Chunk::DataChange -= makeDelegate(*this, &LiquidSimulation::onDataChange);
+        m_grid->onNeighborsAcquire -= makeDelegate(*this, &LiquidSimulation::onNeighborsAcquire);
+        m_grid->onNeighborsRelease -= makeDelegate(*this, &LiquidSimulation::onNeighborsRelease);
+        m_grid = nullptr;
+    }
+    while (!collectTasks()) std::this_thread::yield();
+    for (auto& change : m_pendingChanges) {
+        if (change.chunk) {
+            change.chunk->chunk.release();
+            delete change.chunk;
+        }
+    }
+    std::vector<PendingChange>().swap(m_pendingChanges);
+    for (auto& it : m_chunks) {
+        it.second->chunk.release();
+        delete it.second;
+    }
+    ChunkIDMap<LiquidChunk*>().swap(m_chunks);
+    std::vector<LiquidChunk*>().swap(m_tickChunks);
+    m_tickCursor = 0;
+    m_isTicking = false;
+    delete m_stepper;
+    m_stepper = nullptr;
+}
+
+void LiquidSimulation::addChunk(ChunkHandle& chunk) {
+    LiquidChunk* lc = new LiquidChunk;
+    lc->chunk = chunk.acquire();
+    lc->id = chunk.getID();
+    std::lock_guard<std::mutex> l(m_lckPending);
+    m_pendingChanges.push_back({ PendingOp::ADD, lc->id, lc, nullptr });
+}
+
+void LiquidSimulation::removeChunk(const ChunkID& id) {
+    std::lock_guard<std::mutex> l(m_lckPending);
+    m_pendingChanges.push_back({ PendingOp::REMOVE, id, nullptr, nullptr });
+}
+
+void LiquidSimulation::wakeChunk(const ChunkID& id) {
+    std::lock_guard<std::mutex> l(m_lckPending);
+    m_pendingChanges.push_back({ PendingOp::WAKE, id, nullptr, nullptr });
+}
+
+void LiquidSimulation::update() {
+    if (!collectTasks()) return;
+    if (m_isTicking && m_tickCursor == m_tickChunks.size()) {
+        finishTick();
+        return;
+    }
+    if (!m_isTicking) beginTick();
+    launchBatch();
+}
+
+void LiquidSimulation::step() {
+    ui32 tick = m_tick;
+    while (m_tick == tick) {
+        update();
+        if (m_tasks.size()) std::this_thread::yield();
+    }
+}
+
+ui8 LiquidSimulation::getLevel(const ChunkID& id, int blockIndex) const {
+    auto it = m_chunks.find(id);
+    if (it == m_chunks.end()) return LIQUID_BLOCKED;
+    return it->second->levels[it->second->front][blockIndex];
+}
+
+ui8 LiquidSimulation::getBlockLevel(ui16 blockID) const {
+    if (blockID == 0) return 0;
+    int level = (int)blockID - m_liquid.startBlockID + 1;
+    if (level < 1 || level > m_liquid.numLevels) return LIQUID_BLOCKED;
+    return (ui8)level;
+}
+
+ui16 LiquidSimulation::getBlockID(ui8 level) const {
+    if (level == 0) return 0;
+    return (ui16)(m_liquid.startBlockID + level - 1);
+}
+
+size_t LiquidSimulation::getNumActiveChunks() const {
+    size_t n = 0;
+    for (auto& it : m_chunks) {
+        for (int i = 0; i < LIQUID_PHASES; i++) {
+            if (!it.second->dirty[i].isEmpty()) {
+                n++;
+                break;
+            }
+        }
+    }
+    return n;
+}
+
+void LiquidSimulation::beginTick() {
+    {
+        std::lock_guard<std::mutex> l(m_lckPending);
+        for (auto& change : m_pendingChanges) applyChange(change);
+        m_pendingChanges.clear();
+    }
+    // Chunks added before they were generated
+    LiquidBox all;
+    all.min = i32v3(0);
+    all.max = i32v3(CHUNK_WIDTH - 1);
+    for (auto& it : m_chunks) {
+        LiquidChunk* chunk = it.second;
+        if (chunk->isLoaded || chunk->chunk->genLevel != GEN_DONE) continue;
+        loadLevels(chunk);
+        wakeAround(chunk->id, all);
+    }
+
+    m_tickChunks.clear();
+    ui32 phase = m_tick % LIQUID_PHASES;
+    for (auto& it : m_chunks) {
+        if (!it.second->dirty[phase].isEmpty()) m_tickChunks.push_back(it.second);
+    }
+    // Same batches every run
+    std::sort(m_tickChunks.begin(), m_tickChunks.end(), [](const LiquidChunk* a, const LiquidChunk* b) {
+        return a->id.id < b->id.id;
+    });
+    m_tickCursor = 0;
+    m_isTicking = true;
+}
+
+void LiquidSimulation::finishTick() {
+    // Every step of the tick read the old levels, so only now can the buffers flip
+    ui32 phase = m_tick % LIQUID_PHASES;
+    for (auto& chunk : m_tickChunks) {
+        chunk->front ^= 1;
+        chunk->dirty[phase] = LiquidBox();
+    }
+    for (auto& chunk : m_tickChunks) {
+        wakeAround(chunk->id, chunk->changed);
+    }
+    // One remesh per chunk. This also signals DataChange, which must not wake them again.
+    notifyingSimulation = this;
+    for (auto& chunk : m_tickChunks) {
+        if (!chunk->changed.isEmpty()) ChunkUpdater::notifyDataChange(chunk->chunk);
+    }
+    notifyingSimulation = nullptr;
+    m_isTicking = false;
+    m_tick++;
+}
+
+void LiquidSimulation::launchBatch() {
+    size_t end = m_tickChunks.size();
+    if (m_maxChunksPerBatch) end = glm::min(end, m_tickCursor + m_maxChunksPerBatch);
+    for (; m_tickCursor < end; m_tickCursor++) {
+        LiquidChunk* chunk = m_tickChunks[m_tickCursor];
+        m_numCellsStepped += chunk->dirty[m_tick % LIQUID_PHASES].getVolume();
+        if (m_threadPool) {
+            LiquidStepTask* task = new LiquidStepTask;
+            task->simulation = this;
+            task->chunk = chunk;
+            m_tasks.push_back(task);
+            m_threadPool->addTask(task);
+        } else {
+            stepChunk(m_stepper, chunk);
+        }
+    }
+}
+
+bool LiquidSimulation::collectTasks() {
+    for (auto& task : m_tasks) {
+        if (!task->getIsFinished()) return false;
+    }
+    for (auto& task : m_tasks) delete task;
+    m_tasks.clear();
+    return true;
+}
+
+void LiquidSimulation::applyChange(const PendingChange& change) {
+    LiquidBox all;
+    all.min = i32v3(0);
+    all.max = i32v3(CHUNK_WIDTH - 1);
+
+    auto it = m_chunks.find(change.id);
+    switch (change.op) {
+        case PendingOp::ADD:
+            if (it != m_chunks.end()) {
+                // Already simulated, so just reread it
+                change.chunk->chunk.release();
+                delete change.chunk;
+                loadLevels(it->second);
+            } else {
+                loadLevels(change.chunk);
+                m_chunks[change.id] = change.chunk;
+            }
+            // Neighbors saw a wall where this chunk is
+            wakeAround(change.id, all);
+            break;
+        case PendingOp::REMOVE:
+            if (it == m_chunks.end()) break;
+            it->second->chunk.release();
+            delete it->second;
+            m_chunks.erase(it);
+            wakeAround(change.id, all);
+            break;
+        case PendingOp::WAKE:
+            if (it == m_chunks.end()) break;
+            if (change.edited && (Chunk*)it->second->chunk != change.edited) break;
+            loadLevels(it->second);
+            wakeAround(change.id, all);
+            break;
+    }
+}
+
+void LiquidSimulation::loadLevels(LiquidChunk* chunk) {
+    ui8* levels = chunk->levels[chunk->front];
+    Chunk* c = chunk->chunk;
+    chunk->changed = LiquidBox();
+    chunk->isLoaded = c->genLevel == GEN_DONE;
+    if (!chunk->isLoaded) {
+        memset(levels, LIQUID_BLOCKED, CHUNK_SIZE);
+        return;
+    }
+    std::lock_guard<std::mutex> l(c->dataMutex);
+    for (int i = 0; i < CHUNK_SIZE; i++) {
+        levels[i] = getBlockLevel(c->blocks.get(i));
+    }
+}
+
+void LiquidSimulation::wakeAround(const ChunkID& id, const LiquidBox& box) {
+    if (box.isEmpty()) return;
+    for (int y = -1; y <= 1; y++) {
+        for (int z = -1; z <= 1; z++) {
+            for (int x = -1; x <= 1; x++) {
+                auto it = m_chunks.find(ChunkID((i32)id.x + x, (i32)id.y + y, (i32)id.z + z));
+                if (it == m_chunks.end()) continue;
+                // The box in the neighbor's space
+                LiquidBox moved;
+                i32v3 offset(x * CHUNK_WIDTH, y * CHUNK_WIDTH, z * CHUNK_WIDTH);
+                moved.min = box.min - offset;
+                moved.max = box.max - offset;
+                moved = expandBox(moved, LIQUID_STEP_RADIUS);
+                for (int i = 0; i < LIQUID_PHASES; i++) it->second->dirty[i].add(moved);
+            }
+        }
+    }
+}
+
+void LiquidSimulation::stepChunk(LiquidStepper* stepper, LiquidChunk* chunk) {
+    // Chunks only change between ticks, so the lookups are safe from any thread
+    const LiquidChunk* neighbors[27];
+    for (int y = -1; y <= 1; y++) {
+        for (int z = -1; z <= 1; z++) {
+            for (int x = -1; x <= 1; x++) {
+                auto it = m_chunks.find(ChunkID((i32)chunk->id.x + x, (i32)chunk->id.y + y, (i32)chunk->id.z + z));
+                neighbors[(y + 1) * 9 + (z + 1) * 3 + (x + 1)] = (it == m_chunks.end()) ? nullptr : it->second;
+            }
+        }
+    }
+    stepper->step(chunk, neighbors, (ui8)m_liquid.numLevels, m_tick % LIQUID_PHASES);
+
+    const LiquidBox& box = chunk->changed;
+    if (box.isEmpty()) return;
+    // Levels feed the mesher through the voxels
+    const ui8* oldLevels = chunk->levels[chunk->front];
+    const ui8* newLevels = chunk->levels[chunk->front ^ 1];
+    Chunk* c = chunk->chunk;
+    std::lock_guard<std::mutex> l(c->dataMutex);
+    for (int y = box.min.y; y <= box.max.y; y++) {
+        for (int z = box.min.z; z <= box.max.z; z++) {
+            for (int x = box.min.x; x <= box.max.x; x++) {
+                int i = y * CHUNK_LAYER + z * CHUNK_WIDTH + x;
+                if (newLevels[i] == oldLevels[i]) continue;
+                ChunkUpdater::placeBlockNoUpdate(c, i, getBlockID(newLevels[i]));
+                // Chunks with no blocks are never meshed
+                if (!oldLevels[i]) c->numBlocks++;
+                if (!newLevels[i]) c->numBlocks--;
+            }
+        }
+    }
+}
+
+void LiquidSimulation::onNeighborsAcquire(Sender s VORB_UNUSED, ChunkHandle& chunk) {
+    addChunk(chunk);
+}
+
+void LiquidSimulation::onNeighborsRelease(Sender s VORB_UNUSED, ChunkHandle& chunk) {
+    removeChunk(chunk.getID());
+}
+
+void LiquidSimulation::onDataChange(Sender s VORB_UNUSED, ChunkHandle& chunk) {
+    // Called from worker threads too
+    if (notifyingSimulation == this) return;
+    std::lock_guard<std::mutex> l(m_lckPending);
+    m_pendingChanges.push_back({ PendingOp::WAKE, chunk.getID(), nullptr, (Chunk*)chunk });
+}
@@ -0,0 +1,200 @@
+///
+/// LiquidSimulation.h
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// Cellular automaton for liquid levels. Chunks step in parallel
+/// from double buffered levels, and only where liquid can move.
+///
+
+#pragma once
+
+#ifndef LiquidSimulation_h__
+#define LiquidSimulation_h__
+
+#include <Vorb/Events.hpp>
+#include <Vorb/IThreadPoolTask.h>
+
+#include "ChunkHandle.h"
+#include "ChunkIDMap.hpp"
+#include "Constants.h"
+#include "LiquidData.h"
+#include "VoxPool.h"
+
+#define LIQUID_STEP_TASK_ID 9
+
+/// Level of a cell liquid can't enter
+#define LIQUID_BLOCKED 0xFF
+/// How far a cell's next level can depend on other cells
+#define LIQUID_STEP_RADIUS 3
+/// Ticks before cells pair up the same way again
+#define LIQUID_PHASES 4
+/// Chunk steps worlds launch per update, so a busy tick spreads over frames
+#define LIQUID_CHUNKS_PER_BATCH 32
+
+/// Box of cells in chunk space, empty when min > max on any axis
+struct LiquidBox {
+    i32v3 min = i32v3(CHUNK_WIDTH);
+    i32v3 max = i32v3(-1);
+
+    bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+    ui32 getVolume() const {
+        if (isEmpty()) return 0;
+        i32v3 size = max - min + 1;
+        return (ui32)(size.x * size.y * size.z);
+    }
+    void add(const i32v3& p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    void add(const LiquidBox& b) {
+        if (b.isEmpty()) return;
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+};
+
+/// Liquid levels of one chunk. Neighbors read the front buffer while the chunk steps into the other one.
+struct LiquidChunk {
+    ChunkHandle chunk;
+    ChunkID id;
+    ui8 levels[2][CHUNK_SIZE]; ///< LIQUID_BLOCKED, or 0 to LiquidData::numLevels
+    ui8 front = 0; ///< Buffer of the last finished tick
+    bool isLoaded = false; ///< False until the chunk is generated, it blocks liquid until then
+    /// Per phase, cells whose neighborhood changed since they last stepped in that phase.
+    /// Cells that stepped in every phase without changing are at rest.
+    LiquidBox dirty[LIQUID_PHASES];
+    LiquidBox changed; ///< Cells the last step changed
+};
+
+/// Steps one chunk at a time. Each worker thread has one.
+class LiquidStepper {
+public:
+    /// Steps the dirty cells of a chunk into its back buffer and sets its changed box
+    /// @param neighbors: The 3x3x3 block of chunks, index (y + 1) * 9 + (z + 1) * 3 + (x + 1). nullptr is blocked.
+    /// @param phase: Tick modulo LIQUID_PHASES
+    void step(LiquidChunk* chunk, const LiquidChunk* const neighbors[27], ui8 numLevels, ui32 phase);
+
+    static const int WINDOW_WIDTH = CHUNK_WIDTH + 2 * LIQUID_STEP_RADIUS;
+    static const int WINDOW_SIZE = WINDOW_WIDTH * WINDOW_WIDTH * WINDOW_WIDTH;
+private:
+    /// Copies front levels of the chunk and its neighbors between lo and hi, in chunk space
+    void fillWindow(const i32v3& lo, const i32v3& hi, const LiquidChunk* const neighbors[27]);
+
+    ui8 m_window[WINDOW_SIZE]; ///< Levels around the chunk
+    ui8 m_fallen[WINDOW_SIZE]; ///< Levels after the vertical pairs exchanged
+};
+
+class ChunkGrid;
+class LiquidSimulation;
+
+class LiquidStepTask : public vcore::IThreadPoolTask<WorkerData> {
+public:
+    LiquidStepTask() : vcore::IThreadPoolTask<WorkerData>(LIQUID_STEP_TASK_ID) {}
+
+    // Executes the task
+    void execute(WorkerData* workerData) override;
+
+    LiquidSimulation* simulation = nullptr;
+    LiquidChunk* chunk = nullptr;
+};
+
+/// Every tick, cells pair up with a neighbor above or below and the upper one drops what fits.
+/// Then they pair up with one along x or z, and if the higher one rests on something it gives
+/// half the difference. Pairs alternate with the tick so liquid spreads both ways, and as each
+/// pair only trades with itself, mass is conserved and every chunk computes the same trade
+/// across its borders. A tick only depends on the levels of the last one, so results are the
+/// same whatever the thread count or batch size.
+class LiquidSimulation {
+    friend class LiquidStepTask;
+public:
+    /// @param grid: If not nullptr, its chunks are simulated while their neighbors are
+    /// acquired, and reread whenever something else edits their voxels.
+    /// @param liquid: Block IDs liquid levels map to. Level n is startBlockID + n - 1.
+    /// @param threadPool: Runs the steps. If nullptr, they run on the calling thread.
+    /// @param maxChunksPerBatch: Chunk steps update() launches at once, 0 for all.
+    void init(OPT ChunkGrid* grid, const LiquidData& liquid, OPT VoxPool* threadPool, ui32 maxChunksPerBatch);
+    /// Waits for running steps and frees all chunks
+    void dispose();
+
+    /// Simulates a chunk from the next tick on, reading its levels from its voxels
+    /// once it is generated. Chunks that aren't simulated are blocked. Thread safe.
+    void addChunk(ChunkHandle& chunk);
+    void removeChunk(const ChunkID& id);
+    /// Rereads the levels of a chunk at the next tick, after its voxels were edited. Thread safe.
+    void wakeChunk(const ChunkID& id);
+
+    /// Collects finished steps and launches the next batch without blocking.
+    /// A tick finishes on the update after its last batch.
+    void update();
+    /// Blocks until the running tick, or a new one, finishes
+    void step();
+
+    /// @return Level of a voxel, or LIQUID_BLOCKED if it isn't simulated or is solid
+    ui8 getLevel(const ChunkID& id, int blockIndex) const;
+    /// @return Level a block ID maps to, or LIQUID_BLOCKED if it's neither air nor the liquid
+    ui8 getBlockLevel(ui16 blockID) const;
+    ui16 getBlockID(ui8 level) const;
+
+    /// Number of simulated chunks not yet at rest
+    size_t getNumActiveChunks() const;
+    size_t getNumChunks() const { return m_chunks.size(); }
+    ui64 getNumCellsStepped() const { return m_numCellsStepped; }
+    /// Number of finished ticks
+    ui32 getTick() const { return m_tick; }
+private:
+    enum class PendingOp {
+        ADD,
+        REMOVE,
+        WAKE
+    };
+    struct PendingChange {
+        PendingOp op;
+        ChunkID id;
+        LiquidChunk* chunk; ///< Only for ADD
+        Chunk* edited; ///< Only for WAKE from a DataChange, IDs repeat across grids
+    };
+
+    /// Applies pending changes and lists the chunks to step
+    void beginTick();
+    /// Flips stepped chunks, wakes cells near their changes and remeshes them
+    void finishTick();
+    /// Launches the next batch of listed chunks
+    void launchBatch();
+    /// @return true if no task is running
+    bool collectTasks();
+
+    void applyChange(const PendingChange& change);
+    void loadLevels(LiquidChunk* chunk);
+    /// Dirties cells of the chunk and its neighbors within LIQUID_STEP_RADIUS of box
+    void wakeAround(const ChunkID& id, const LiquidBox& box);
+    /// Steps a chunk and writes its changed levels to its voxels. Thread safe.
+    void stepChunk(LiquidStepper* stepper, LiquidChunk* chunk);
+
+    void onNeighborsAcquire(Sender s, ChunkHandle& chunk);
+    void onNeighborsRelease(Sender s, ChunkHandle& chunk);
+    void onDataChange(Sender s, ChunkHandle& chunk);
+
+    ChunkGrid* m_grid = nullptr;
+    LiquidData m_liquid;
+    VoxPool* m_threadPool = nullptr;
+    ui32 m_maxChunksPerBatch = 0;
+    LiquidStepper* m_stepper = nullptr; ///< Only without a thread pool
+
+    ChunkIDMap<LiquidChunk*> m_chunks; ///< Only changed between ticks
+    std::vector<PendingChange> m_pendingChanges;
+    std::mutex m_lckPending;
+
+    std::vector<LiquidChunk*> m_tickChunks; ///< Chunks stepping this tick
+    size_t m_tickCursor = 0; ///< First of m_tickChunks not yet launched
+    bool m_isTicking = false;
+    std::vector<LiquidStepTask*> m_tasks; ///< Launched this batch
+
+    ui32 m_tick = 0;
+    ui64 m_numCellsStepped = 0;
+};
+
+#endif // LiquidSimulation_h__
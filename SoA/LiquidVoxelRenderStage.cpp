@@ -26,7 +26,7 @@ void LiquidVoxelRenderStage::render(const Camera* camera VORB_UNUSED) {
     if (m_gameRenderParams->isUnderwater) glDisable(GL_CULL_FACE);
     glDepthMask(GL_FALSE);
 
-    const std::vector <ChunkMesh *>& chunkMeshes = cmm->getChunkMeshes();
+    const std::vector <ChunkMesh *>& chunkMeshes = cmm->getVisibleChunkMeshes();
     {
         std::lock_guard<std::mutex> l(cmm->lckActiveChunkMeshes);
         if (chunkMeshes.empty()) return;
@@ -1,20 +1,29 @@
 #include "stdafx.h"
 #include "LoadMonitor.h"
 
+#include <algorithm>
+
+namespace {
+    f64 msSince(const std::chrono::steady_clock::time_point& t) {
+        return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - t).count();
+    }
+}
+
 LoadMonitor::LoadMonitor() :
 _lock(),
-_completionCondition() {
+_readyCondition() {
     // Empty
 }
 LoadMonitor::~LoadMonitor() {
+    // Workers reference this monitor, so they must drain before we go away
+    for (auto& t : _internalThreads) {
+        if (t.joinable()) t.join();
+    }
     if (_internalTasks.size() > 0) {
         for (ILoadTask* t : _internalTasks) {
             if (t) delete t;
         }
     }
-    for (auto& t : _internalThreads) {
-        t.detach();
-    }
 }
 
 void LoadMonitor::addTask(nString name, ILoadTask* task) {
@@ -27,6 +36,11 @@ bool LoadMonitor::isTaskFinished(nString task) {
     return state;
 }
 
+f32 LoadMonitor::getProgress() const {
+    if (_nodes.empty()) return _tasks.empty() ? 1.0f : 0.0f;
+    return (f32)_numFinished / (f32)_nodes.size();
+}
+
 bool LoadMonitor::isFinished(nString task) {
     auto kvp = _tasks.find(task);
     if (kvp == _tasks.end()) {
@@ -35,58 +49,136 @@ bool LoadMonitor::isFinished(nString task) {
     }
     return kvp->second->isFinished();
 }
-bool LoadMonitor::canStart(nString task) {
-    // Check that the dependency exists
-    auto kvp = _tasks.find(task);
-    if (kvp == _tasks.end()) {
-        fprintf(stderr, "LoadMonitor Warning: task %s does not exist\n", task.c_str());
-        return false;
+
+void LoadMonitor::buildGraph() {
+    _nodes.clear();
+    _nodes.reserve(_tasks.size());
+
+    // Resolve names to indices once, so workers never touch the string maps
+    std::unordered_map<nString, size_t> indices;
+    for (auto& kvp : _tasks) {
+        indices[kvp.first] = _nodes.size();
+        _nodes.push_back({ kvp.first, kvp.second, {}, 0, 0 });
+    }
+    for (auto& node : _nodes) {
+        for (auto& dep : node.task->dependencies) {
+            auto it = indices.find(dep);
+            if (it == indices.end()) {
+                fprintf(stderr, "LoadMonitor Warning: dependency %s of %s does not exist\n", dep.c_str(), node.name.c_str());
+                continue;
+            }
+            _nodes[it->second].dependents.push_back(&node - &_nodes[0]);
+            node.pendingDeps++;
+        }
+    }
+
+    // Critical path lengths via a reverse topological order (Kahn's algorithm)
+    std::vector<size_t> order;
+    order.reserve(_nodes.size());
+    std::vector<ui32> pending(_nodes.size());
+    for (size_t i = 0; i < _nodes.size(); i++) {
+        pending[i] = _nodes[i].pendingDeps;
+        if (pending[i] == 0) order.push_back(i);
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        for (size_t d : _nodes[order[i]].dependents) {
+            if (--pending[d] == 0) order.push_back(d);
+        }
+    }
+    if (order.size() != _nodes.size()) {
+        fprintf(stderr, "LoadMonitor Warning: dependency cycle detected, %zu tasks will never start\n", _nodes.size() - order.size());
     }
-    // Check all dependencies
-    for (auto& dep : kvp->second->dependencies) {
-        if (!isFinished(dep)) {
-            return false;
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        TaskNode& node = _nodes[*it];
+        node.criticalPath = 1;
+        for (size_t d : node.dependents) {
+            node.criticalPath = std::max(node.criticalPath, _nodes[d].criticalPath + 1);
         }
     }
-    return true;
 }
 
-void LoadMonitor::start() {
-    LoadMonitor* monitor = this;
-    for (auto& kvp : _tasks) {
-        ILoadTask* task = kvp.second;
-        nString name = kvp.first;
-        _internalThreads.emplace_back([=] () {
-            // Wait For Dependencies To Complete
-            std::unique_lock<std::mutex> uLock(monitor->_lock);
-            _completionCondition.wait(uLock, [=] {
-#ifdef DEBUG
-                printf("CHECK: %s\r\n", name.c_str());
-#endif
-                return monitor->canStart(name);
-            });
-            uLock.unlock();
+void LoadMonitor::pushReady(size_t index) {
+    _readyQueue.push_back(index);
+    std::push_heap(_readyQueue.begin(), _readyQueue.end(), [this] (size_t a, size_t b) {
+        return _nodes[a].criticalPath < _nodes[b].criticalPath;
+    });
+}
+
+void LoadMonitor::start(ui32 maxThreads /*= 0*/) {
+    buildGraph();
+    _readyQueue.clear();
+    _timings.clear();
+    _numRunning = 0;
+    _numFinished = 0;
+    _isAborted = false;
+    for (size_t i = 0; i < _nodes.size(); i++) {
+        if (_nodes[i].pendingDeps == 0) pushReady(i);
+    }
+    // Every task is in a cycle, let the workers exit immediately
+    if (_readyQueue.empty()) _isAborted = true;
+
+    if (maxThreads == 0) maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    size_t numThreads = std::min((size_t)maxThreads, _nodes.size());
+
+    _startTime = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < numThreads; i++) {
+        _internalThreads.emplace_back(&LoadMonitor::workerThread, this);
+    }
+}
+
+void LoadMonitor::workerThread() {
+    std::unique_lock<std::mutex> uLock(_lock);
+    while (true) {
+        // Only wake up when there is work or the graph is drained
+        _readyCondition.wait(uLock, [this] {
+            return !_readyQueue.empty() || _isAborted || _numFinished == _nodes.size();
+        });
+        if (_readyQueue.empty()) return;
+
+        // Pop the task with the longest chain behind it
+        std::pop_heap(_readyQueue.begin(), _readyQueue.end(), [this] (size_t a, size_t b) {
+            return _nodes[a].criticalPath < _nodes[b].criticalPath;
+        });
+        size_t index = _readyQueue.back();
+        _readyQueue.pop_back();
+        TaskNode& node = _nodes[index];
+        _numRunning++;
+        uLock.unlock();
 
+        f64 startMs = msSince(_startTime);
 #ifdef DEBUG
-            printf("BEGIN: %s\r\n", name.c_str());
-            task->doWork();
-            printf("END: %s\r\n", name.c_str());
+        printf("BEGIN: %s\r\n", node.name.c_str());
+        node.task->doWork();
+        printf("END: %s\r\n", node.name.c_str());
 #else
-            task->doWork();
+        node.task->doWork();
 #endif // DEBUG
+        f64 durationMs = msSince(_startTime) - startMs;
 
-            // Notify That This Task Is Completed
-            uLock.lock();
-            _completionCondition.notify_all();
-            uLock.unlock();
-        });
+        uLock.lock();
+        _timings.push_back({ node.name, startMs, durationMs });
+        _numRunning--;
+        _numFinished++;
+        for (size_t d : node.dependents) {
+            if (--_nodes[d].pendingDeps == 0) {
+                pushReady(d);
+                _readyCondition.notify_one();
+            }
+        }
+        if (_numFinished == _nodes.size()) {
+            _readyCondition.notify_all();
+        } else if (_readyQueue.empty() && _numRunning == 0) {
+            // Remaining tasks are part of a cycle, nothing can ever become ready
+            _isAborted = true;
+            _readyCondition.notify_all();
+        }
     }
 }
+
 void LoadMonitor::wait() {
-    // Wait for all threads to complete
+    // Wait for all workers to complete
     for (auto& t : _internalThreads) {
         t.join();
-        t.detach();
     }
 
     _internalThreads.clear();
@@ -96,6 +188,22 @@ void LoadMonitor::wait() {
     _internalTasks.clear();
 }
 
+std::vector<LoadTaskTiming> LoadMonitor::getTimings() {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _timings;
+}
+
+void LoadMonitor::printReport() {
+    std::vector<LoadTaskTiming> timings = getTimings();
+    f64 totalMs = 0.0;
+    printf("LoadMonitor: %zu/%zu tasks finished\n", timings.size(), _nodes.size());
+    for (auto& t : timings) {
+        printf("  %-24s start %9.2f ms  took %9.2f ms\n", t.name.c_str(), t.startMs, t.durationMs);
+        totalMs = std::max(totalMs, t.startMs + t.durationMs);
+    }
+    printf("  %-24s %9.2f ms\n", "Total", totalMs);
+}
+
 void LoadMonitor::setDep(nString name, nString dep) {
     // Check that the task exists
     auto kvp = _tasks.find(name);
@@ -114,5 +222,3 @@ void LoadMonitor::setDep(nString name, nString dep) {
     // Add the dependency
     kvp->second->dependencies.insert(dep);
 }
-
-
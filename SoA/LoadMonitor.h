@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <unordered_map>
 #include <unordered_set>
@@ -38,7 +40,7 @@ class LoadFunctor : public ILoadTask {
     LoadFunctor() {
         // Empty
     }
-    LoadFunctor(F& f) 
+    LoadFunctor(F& f)
         : _f(f) {
         // Empty
     }
@@ -57,6 +59,13 @@ inline ILoadTask* makeLoader(F f) {
     return new LoadFunctor<F>(f);
 }
 
+// Timing Information For A Finished Task
+struct LoadTaskTiming {
+    nString name;
+    f64 startMs; // Relative To LoadMonitor::start
+    f64 durationMs;
+};
+
 class LoadMonitor {
 public:
     LoadMonitor();
@@ -70,33 +79,65 @@ class LoadMonitor {
         _internalTasks.push_back(t);
         addTask(name, t);
     }
-    
+
     // Make A Loading Task Dependant On Another (Blocks Until Dependency Completes)
     void setDep(nString name, nString dep);
 
-    // Fires Up Every Task In A Separate Thread
-    void start();
-    // Blocks On Current Thread Until All Child Threads Have Completed
+    // Resolves The Dependency Graph And Runs Tasks On A Bounded Worker Pool
+    // maxThreads Of 0 Uses The Hardware Concurrency
+    void start(ui32 maxThreads = 0);
+    // Blocks On Current Thread Until All Tasks Have Completed
     void wait();
 
     // Checks If A Task Is Finished
     bool isTaskFinished(nString task);
+    // Fraction Of Tasks That Have Completed In [0, 1]
+    f32 getProgress() const;
+
+    // Per Task Timings In Completion Order
+    std::vector<LoadTaskTiming> getTimings();
+    // Prints A Startup Time Report For Every Finished Task
+    void printReport();
 private:
+    struct TaskNode {
+        nString name;
+        ILoadTask* task;
+        std::vector<size_t> dependents;
+        ui32 pendingDeps;
+        ui32 criticalPath; // Length Of The Longest Chain Of Tasks Starting Here
+    };
+
     // Is A Task Finished (False If Task Does Not Exist
     bool isFinished(nString task);
-    // Check Dependencies Of A Task To See If It Can Begin
-    bool canStart(nString task);
+    // Builds The Task Graph From The Name Keyed Dependencies
+    void buildGraph();
+    // Worker Loop That Pulls Ready Tasks Until The Graph Is Drained
+    void workerThread();
+    // Pushes A Task Whose Dependencies Are Satisfied, Must Hold _lock
+    void pushReady(size_t index);
 
     // Tasks Mapped By Name
     std::unordered_map<nString, ILoadTask*> _tasks;
-    
-    // Thread For Each Task
+
+    // Resolved Task Graph
+    std::vector<TaskNode> _nodes;
+    // Ready Tasks As A Heap Ordered By Critical Path
+    std::vector<size_t> _readyQueue;
+    ui32 _numRunning = 0;
+    std::atomic<ui32> _numFinished{ 0 };
+    bool _isAborted = false;
+
+    // Bounded Worker Pool
     std::vector<std::thread> _internalThreads;
 
     // Functor Wrapper Tasks That Must Be Deallocated By This Monitor
     std::vector<ILoadTask*> _internalTasks;
 
+    // Timing
+    std::chrono::steady_clock::time_point _startTime;
+    std::vector<LoadTaskTiming> _timings;
+
     // Monitor Lock
     std::mutex _lock;
-    std::condition_variable _completionCondition;
-};
\ No newline at end of file
+    std::condition_variable _readyCondition;
+};
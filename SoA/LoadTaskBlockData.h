@@ -38,11 +38,19 @@ class LoadTaskBlockData : public ILoadTask {
                 loader->loadBlockTextures(b);
             }
         }
+        // Decode and map all the textures at once
+        ui32 numFailed = loader->flushLayers();
+        if (numFailed) printf("%u block textures failed to load\n", numFailed);
         // Set the none textures so we dont get a crash later
         Block& b = blockPack->operator[]("none");
         for (int i = 0; i < 6; i++) {
             b.textures[i] = loader->getTexturePack()->getDefaultTexture();
         }
+        // Textures were assigned in place
+        blockPack->updateMeshTables();
+        // Every block is in, so names of other blocks resolve
+        blockPack->updateTickRules();
+        blockPack->updateLiquids();
         context->addWorkCompleted(10);
 
 
@@ -180,6 +180,7 @@ void MainMenuLoadScreen::update(const vui::GameTime& gameTime) {
     // End condition
     if (m_mainMenuScreen->m_renderer.isLoaded() && m_monitor.isTaskFinished("SpaceSystem") && (m_isSkipDetected || (!m_isOnVorb && m_timer > m_regrowthScreenDuration))) {
         m_commonState->loadContext.end();
+        m_monitor.printReport();
         m_state = vui::ScreenState::CHANGE_NEXT;
     }
 }
@@ -244,8 +245,8 @@ void MainMenuLoadScreen::draw(const vui::GameTime& gameTime VORB_UNUSED) {
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     m_sb->render(windowSize, &vg::SamplerState::LINEAR_CLAMP);
 
-    // Draw progress
-    f32 progress = m_commonState->loadContext.getPercentComplete();
+    // Draw progress, weighting GL work and load tasks equally
+    f32 progress = (m_commonState->loadContext.getPercentComplete() + m_monitor.getProgress()) * 0.5f;
     static f32 maxw = 48.0f;
     static f32 alpha = 1.0f;
     if (alpha > 0.0f) {
@@ -286,6 +286,7 @@ void MainMenuScreen::onReloadSystem(Sender s VORB_UNUSED, ui32 a VORB_UNUSED) {
 
 void MainMenuScreen::onReloadShaders(Sender s VORB_UNUSED, ui32 a VORB_UNUSED) {
     printf("Reloading Shaders...\n");
+    m_soaState->clientState.texturePathResolver.refresh();
     m_renderer.dispose(m_commonState->loadContext);
 
     m_renderer.init(m_commonState->window, m_commonState->loadContext, this, m_commonState);
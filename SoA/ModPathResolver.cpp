@@ -1,24 +1,52 @@
 #include "stdafx.h"
 #include "ModPathResolver.h"
 
+#include <algorithm>
+#include <Vorb/Timing.h>
+
 void ModPathResolver::init(const vio::Path& defaultPath, const vio::Path& modPath) {
-    setDefaultDir(defaultPath);
-    setModDir(modPath);
+    defaultIom.setSearchDirectory(defaultPath);
+    modIom.setSearchDirectory(modPath);
+    buildIndex();
 }
 
 void ModPathResolver::setDefaultDir(const vio::Path& path) {
     defaultIom.setSearchDirectory(path);
+    buildIndex();
 }
 
 void ModPathResolver::setModDir(const vio::Path& path) {
     modIom.setSearchDirectory(path);
+    buildIndex();
 }
 
 bool ModPathResolver::resolvePath(const vio::Path& path, vio::Path& resultAbsolutePath, bool printModNotFound /* = false */) const {
+    m_numLookups++;
+
+    nString key;
+    if (m_useIndex && m_hasIndex && getIndexKey(path, key)) {
+        m_numIndexHits++;
+        auto it = m_files.find(key);
+        if (it != m_files.end()) {
+            resultAbsolutePath = it->second.path;
+            // Probing would have stopped at the mod folder or checked both
+            m_numProbesAvoided += it->second.inModDir ? 1 : 2;
+            return true;
+        }
+        m_numProbesAvoided += 2;
+        if (printModNotFound) {
+            printf("Did not find path %s in %s.", path.getCString(), modIom.getSearchDirectory().getCString());
+            printf("Did not find path %s in %s.", path.getCString(), defaultIom.getSearchDirectory().getCString());
+        }
+        return false;
+    }
+
+    m_numProbes++;
     if (!modIom.resolvePath(path, resultAbsolutePath)) {
         if (printModNotFound) {
             printf("Did not find path %s in %s.", path.getCString(), modIom.getSearchDirectory().getCString());
         }
+        m_numProbes++;
         if (!defaultIom.resolvePath(path, resultAbsolutePath)) {
             if (printModNotFound) {
                 printf("Did not find path %s in %s.", path.getCString(), defaultIom.getSearchDirectory().getCString());
@@ -28,3 +56,98 @@ bool ModPathResolver::resolvePath(const vio::Path& path, vio::Path& resultAbsolu
     }
     return true;
 }
+
+void ModPathResolver::refresh() {
+    buildIndex();
+    onRefresh();
+}
+
+void ModPathResolver::getIndexedPaths(OUT std::vector<nString>& paths) const {
+    paths.clear();
+    paths.reserve(m_files.size());
+    for (auto& it : m_files) paths.push_back(it.first);
+}
+
+ModPathResolverStats ModPathResolver::getStats() const {
+    ModPathResolverStats stats = m_scanStats;
+    stats.numLookups = m_numLookups;
+    stats.numIndexHits = m_numIndexHits;
+    stats.numProbes = m_numProbes;
+    stats.numProbesAvoided = m_numProbesAvoided;
+    return stats;
+}
+
+void ModPathResolver::printStats(const cString name) const {
+    ModPathResolverStats stats = getStats();
+    printf("%s paths: %u files indexed with %u checks in %lf ms, %u lookups, %u from the index, %u probes made, %u avoided\n",
+           name, stats.numIndexedFiles, stats.numScanChecks, stats.scanMs,
+           stats.numLookups, stats.numIndexHits, stats.numProbes, stats.numProbesAvoided);
+}
+
+void ModPathResolver::buildIndex() {
+    PreciseTimer timer;
+    timer.start();
+    std::unordered_map<nString, IndexedFile>().swap(m_files);
+    m_scanStats.numScanChecks = 0;
+
+    // Defaults first so mod files replace them
+    if (defaultIom.getSearchDirectory().getString() != modIom.getSearchDirectory().getString()) {
+        indexDirectory(defaultIom.getSearchDirectory(), "", false);
+    }
+    indexDirectory(modIom.getSearchDirectory(), "", true);
+
+    m_hasIndex = true;
+    m_scanStats.numIndexedFiles = (ui32)m_files.size();
+    m_scanStats.scanMs = timer.stop();
+}
+
+void ModPathResolver::indexDirectory(const vio::Path& dirPath, const nString& prefix, bool inModDir) {
+    if (dirPath.getString().empty()) return;
+    vio::Path absolutePath = dirPath;
+    if (prefix.empty()) absolutePath.makeAbsolute();
+
+    m_scanStats.numScanChecks++;
+    vio::Directory dir;
+    if (!absolutePath.asDirectory(&dir)) return;
+    dir.forEachEntry([&] (Sender s VORB_UNUSED, const vio::Path& p) {
+        nString key = prefix + p.getLeaf();
+#ifdef _WINDOWS
+        // Lookups are case insensitive there
+        std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+#endif
+        m_scanStats.numScanChecks++;
+        if (p.isFile()) {
+            IndexedFile& file = m_files[key];
+            file.path = p;
+            file.inModDir = inModDir;
+        } else {
+            m_scanStats.numScanChecks++;
+            if (p.isDirectory()) indexDirectory(p, key + "/", inModDir);
+        }
+    });
+}
+
+bool ModPathResolver::getIndexKey(const vio::Path& path, OUT nString& key) {
+    const nString& str = path.getString();
+    // Absolute paths are left to the filesystem
+    if (str.empty() || str[0] == '/' || str[0] == '\\' || str.find(':') != nString::npos) return false;
+
+    key.clear();
+    size_t start = 0;
+    while (start <= str.size()) {
+        size_t end = str.find_first_of("/\\", start);
+        if (end == nString::npos) end = str.size();
+        nString part = str.substr(start, end - start);
+        // So are parent relative ones
+        if (part == "..") return false;
+        if (part.size() && part != ".") {
+            if (key.size()) key += '/';
+            key += part;
+        }
+        start = end + 1;
+    }
+#ifdef _WINDOWS
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+#endif
+    return !key.empty();
+}
@@ -7,7 +7,7 @@
 /// MIT License
 ///
 /// Summary:
-/// Resolves file paths for mod files by first looking in 
+/// Resolves file paths for mod files by first looking in
 /// a mod folder, then a default if it fails.
 ///
 
@@ -16,22 +16,68 @@
 #ifndef ModPathResolver_h__
 #define ModPathResolver_h__
 
+#include <atomic>
+#include <Vorb/Events.hpp>
 #include <Vorb/io/IOManager.h>
 
+/// Filesystem work done by a resolver, for startup reports
+struct ModPathResolverStats {
+    ui32 numIndexedFiles = 0; ///< Files in the index, mod overrides counted once
+    ui32 numScanChecks = 0; ///< Directory listings and entry checks made building the index
+    f64 scanMs = 0.0;
+    ui32 numLookups = 0; ///< resolvePath calls
+    ui32 numIndexHits = 0; ///< Lookups the index answered, found or not
+    ui32 numProbes = 0; ///< Filesystem checks made by lookups the index couldn't answer
+    ui32 numProbesAvoided = 0; ///< Checks probing both folders would have made for the lookups the index answered
+};
+
 class ModPathResolver {
 public:
-    /// Initialization
+    /// Initialization. Scans both folders into the file index.
     void init(const vio::Path& defaultPath, const vio::Path& modPath);
     /// Sets directory for defaults
     void setDefaultDir(const vio::Path& path);
     /// Sets directory for mods
     void setModDir(const vio::Path& path);
     /// Gets the absolute path. If not in Mod, checks in default.
+    /// Relative paths are answered from the file index without touching the filesystem.
     /// @return false on failure
     bool resolvePath(const vio::Path& path, vio::Path& resultAbsolutePath, bool printModNotFound = false) const;
 
+    /// Rescans both folders so added, removed or overridden files are picked up.
+    /// Must not run while other threads are resolving paths.
+    void refresh();
+    /// Disable to probe the folders on every lookup like before the index
+    void setUseIndex(bool useIndex) { m_useIndex = useIndex; }
+
+    /// Relative paths of every indexed file
+    void getIndexedPaths(OUT std::vector<nString>& paths) const;
+
+    ModPathResolverStats getStats() const;
+    void printStats(const cString name) const;
+
+    Event<> onRefresh; ///< Fired after refresh, so users can reload what they resolved
+
     vio::IOManager defaultIom;
     vio::IOManager modIom;
+private:
+    void buildIndex();
+    void indexDirectory(const vio::Path& dirPath, const nString& prefix, bool inModDir);
+    /// Index key for a path, or false if only probing can answer it
+    static bool getIndexKey(const vio::Path& path, OUT nString& key);
+
+    struct IndexedFile {
+        vio::Path path; ///< Absolute
+        bool inModDir;
+    };
+    std::unordered_map<nString, IndexedFile> m_files; ///< Keyed by relative path, mod files win
+    bool m_useIndex = true;
+    bool m_hasIndex = false;
+    ModPathResolverStats m_scanStats; ///< Only the scan fields are used
+    mutable std::atomic<ui32> m_numLookups { 0 };
+    mutable std::atomic<ui32> m_numIndexHits { 0 };
+    mutable std::atomic<ui32> m_numProbes { 0 };
+    mutable std::atomic<ui32> m_numProbesAvoided { 0 };
 };
 
 #endif // ModPathResolver_h__
@@ -6,9 +6,12 @@
 #include "VoxelModelMesh.h"
 #include "MarchingCubesTable.h"
 #include "DualContouringMesher.h"
+#include "VoxelModelMeshCache.h"
 
 #include <vector>
 
+#include <Vorb/Timing.h>
+
 const f32v3 VOXEL_MODEL[24] = {
     f32v3(0, 1, 0),
     f32v3(0, 1, 1),
@@ -55,13 +58,45 @@ const i32v3 VOXEL_SIDES[6] = {
     i32v3(0, 0, 1),
 };
 
-VoxelModelMesh ModelMesher::createMesh(const VoxelModel* model) {
+VoxelModelMesh ModelMesher::createMesh(const VoxelModel* model, OPT VoxelModelMetrics* metrics /*= nullptr*/) {
     std::vector<VoxelModelVertex> vertices;
     std::vector<ui32> indices;
-    VoxelModelMesh rv;
     
-    genMatrixMesh(model->getMatrix(), vertices, indices);
+    genMesh(model, vertices, indices, metrics);
+
+    PreciseTimer timer;
+    timer.start();
+    VoxelModelMesh rv = uploadMesh(vertices, indices);
+    if (metrics) metrics->uploadMs = timer.stop();
+    return rv;
+}
+
+void ModelMesher::genMesh(const VoxelModel* model, OUT std::vector<VoxelModelVertex>& vertices,
+                          OUT std::vector<ui32>& indices, OPT VoxelModelMetrics* metrics /*= nullptr*/) {
+    PreciseTimer timer;
+    timer.start();
+
+    nString cachePath;
+    bool fromCache = false;
+    if (model->getFilePath().size()) {
+        cachePath = VoxelModelMeshCache::getCachePath(model->getFilePath(), "greedy");
+        fromCache = VoxelModelMeshCache::load(cachePath, model->getContentHash(), vertices, indices);
+    }
+    if (!fromCache) {
+        genMatrixMesh(model->getMatrix(), vertices, indices);
+        if (cachePath.size()) VoxelModelMeshCache::save(cachePath, model->getContentHash(), vertices, indices);
+    }
+
+    if (metrics) {
+        metrics->meshMs = timer.stop();
+        metrics->meshFromCache = fromCache;
+        metrics->numVertices = (ui32)vertices.size();
+        metrics->numIndices = (ui32)indices.size();
+    }
+}
 
+VoxelModelMesh ModelMesher::uploadMesh(const std::vector<VoxelModelVertex>& vertices, const std::vector<ui32>& indices) {
+    VoxelModelMesh rv;
     if (indices.size() == 0) return rv;
 
     glGenVertexArrays(1, &rv.m_vao);
@@ -91,10 +126,12 @@ VoxelModelMesh ModelMesher::createMesh(const VoxelModel* model) {
     return rv;
 }
 
-VoxelModelMesh ModelMesher::createMarchingCubesMesh(const VoxelModel* model) {
+VoxelModelMesh ModelMesher::createMarchingCubesMesh(const VoxelModel* model, OPT VoxelModelMetrics* metrics /*= nullptr*/) {
     std::vector<VoxelModelVertex> vertices;
     std::vector<ui32> indices;
     VoxelModelMesh rv;
+    PreciseTimer timer;
+    timer.start();
 
     auto& matrix = model->getMatrix();
 
@@ -120,6 +157,12 @@ VoxelModelMesh ModelMesher::createMarchingCubesMesh(const VoxelModel* model) {
     // TODO(Ben): Indexed drawing
     rv.m_triCount = vertices.size() / 3;
     delete[] points;
+    if (metrics) {
+        metrics->meshMs = timer.stop();
+        metrics->numVertices = (ui32)vertices.size();
+        metrics->numIndices = 0;
+        timer.start();
+    }
 
     glGenVertexArrays(1, &rv.m_vao);
     glBindVertexArray(rv.m_vao);
@@ -144,42 +187,36 @@ VoxelModelMesh ModelMesher::createMarchingCubesMesh(const VoxelModel* model) {
     // THIS CAUSES CRASH v v v
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    if (metrics) metrics->uploadMs = timer.stop();
     return rv;
 }
 
-VoxelModelMesh ModelMesher::createDualContouringMesh(const VoxelModel* model) {
+VoxelModelMesh ModelMesher::createDualContouringMesh(const VoxelModel* model, OPT VoxelModelMetrics* metrics /*= nullptr*/) {
     std::vector<VoxelModelVertex> vertices;
     std::vector<ui32> indices;
-    VoxelModelMesh rv;
-
-    DualContouringMesher::genMatrixMesh(model->getMatrix(), vertices, indices);
-
-    if (indices.size() == 0) return rv;
-
-    glGenVertexArrays(1, &rv.m_vao);
-    glBindVertexArray(rv.m_vao);
-
-    glGenBuffers(1, &rv.m_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, rv.m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(VoxelModelVertex), vertices.data(), GL_STATIC_DRAW);
-
-    rv.m_indCount = indices.size();
-    rv.m_triCount = (indices.size() * 2) / 6;
-    glGenBuffers(1, &rv.m_ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, rv.m_ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, rv.m_indCount * sizeof(ui32), indices.data(), GL_STATIC_DRAW);
-
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    PreciseTimer timer;
+    timer.start();
+
+    nString cachePath;
+    bool fromCache = false;
+    if (model->getFilePath().size()) {
+        cachePath = VoxelModelMeshCache::getCachePath(model->getFilePath(), "dc");
+        fromCache = VoxelModelMeshCache::load(cachePath, model->getContentHash(), vertices, indices);
+    }
+    if (!fromCache) {
+        DualContouringMesher::genMatrixMesh(model->getMatrix(), vertices, indices, metrics);
+        if (cachePath.size()) VoxelModelMeshCache::save(cachePath, model->getContentHash(), vertices, indices);
+    }
 
-    glBindVertexArray(rv.m_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, rv.m_vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, rv.m_ibo);
-    glBindVertexArray(0);
-    // THIS CAUSES CRASH v v v
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    if (metrics) {
+        metrics->meshMs = timer.stop();
+        metrics->meshFromCache = fromCache;
+        metrics->numVertices = (ui32)vertices.size();
+        metrics->numIndices = (ui32)indices.size();
+        timer.start();
+    }
+    VoxelModelMesh rv = uploadMesh(vertices, indices);
+    if (metrics) metrics->uploadMs = timer.stop();
     return rv;
 }
 
@@ -695,41 +732,111 @@ void ModelMesher::marchingCubes(const VoxelMatrix& matrix,
 }
 
 void ModelMesher::genMatrixMesh(const VoxelMatrix& matrix, std::vector<VoxelModelVertex>& vertices, std::vector<ui32>& indices) {
-    // TODO(Ben): Could be optimized
+    // Faces pointing different ways never merge, so each direction is independent
+    std::vector<VoxelModelVertex> faceVertices[6];
+    std::vector<ui32> faceIndices[6];
+    std::thread threads[6];
+    for (int face = 0; face < 6; face++) {
+        threads[face] = std::thread(&ModelMesher::genFaceMesh, std::cref(matrix), face,
+                                    std::ref(faceVertices[face]), std::ref(faceIndices[face]));
+    }
+    for (int face = 0; face < 6; face++) threads[face].join();
+
+    size_t numVertices = 0;
+    size_t numIndices = 0;
+    for (int face = 0; face < 6; face++) {
+        numVertices += faceVertices[face].size();
+        numIndices += faceIndices[face].size();
+    }
+    vertices.clear();
+    indices.clear();
+    vertices.reserve(numVertices);
+    indices.reserve(numIndices);
+    for (int face = 0; face < 6; face++) {
+        ui32 indexOffset = (ui32)vertices.size();
+        vertices.insert(vertices.end(), faceVertices[face].begin(), faceVertices[face].end());
+        for (auto& i : faceIndices[face]) indices.push_back(i + indexOffset);
+    }
+}
+
+void ModelMesher::genFaceMesh(const VoxelMatrix& matrix, int face, std::vector<VoxelModelVertex>& vertices, std::vector<ui32>& indices) {
     f32v3 mainOffset(matrix.size.x / 2.0f, matrix.size.y / 2.0f, matrix.size.z / 2.0f);
-    int voxelIndex;
-    for(ui32 z = 0; z < matrix.size.z; z++) {
-        for (ui32 y = 0; y < matrix.size.y; y++) {
-            for (ui32 x = 0; x < matrix.size.x; x++) {
-                voxelIndex = matrix.getIndex(x, y, z);
-                const ColorRGBA8& voxel = matrix.getColor(voxelIndex); // Get the current voxel's color
-                if(voxel.a == 0) continue; // If the current voxel is invisible go to next voxel
-
-                f32v3 offset = f32v3(x, y, z) - mainOffset; // Position of the current voxel in the model
-                for (int face = 0; face < 6; face++) { // For each face of the voxel
-                    if(matrix.getColorAndCheckBounds(i32v3(x, y, z) + VOXEL_SIDES[face]).a == 0) { // Check if the adjacent voxel is invisible
-                        int indexStart = (int)vertices.size();
-                        int indiceStart = (int)indices.size();
-
-                        // Add the 4 vertices for this face
-                        vertices.resize(indexStart + 4);
-                        for (int l = 0; l < 4; l++) {
-                            vertices[indexStart + l].pos = offset + VOXEL_MODEL[face * 4 + l];
-                            vertices[indexStart + l].color = voxel.color.rgb;
-                            vertices[indexStart + l].normal = f32v3(VOXEL_SIDES[face]);
-                        }
-
-                        // Add the 6 indices for this face
-                        indices.resize(indiceStart + 6);
-                        indices[indiceStart] = indexStart + VOXEL_INDICES[0];
-                        indices[indiceStart + 1] = indexStart + VOXEL_INDICES[1];
-                        indices[indiceStart + 2] = indexStart + VOXEL_INDICES[2];
-                        indices[indiceStart + 3] = indexStart + VOXEL_INDICES[3];
-                        indices[indiceStart + 4] = indexStart + VOXEL_INDICES[4];
-                        indices[indiceStart + 5] = indexStart + VOXEL_INDICES[5];
-                    }
+    const i32v3 size(matrix.size);
+    const i32v3& side = VOXEL_SIDES[face];
+    // Axis the face points along and the two that span it
+    const int axis = face / 2;
+    const int uAxis = (axis + 1) % 3;
+    const int vAxis = (axis + 2) % 3;
+    const int uSize = size[uAxis];
+    const int vSize = size[vAxis];
+
+    // Visible face colors for one slice, 0 where there is no face
+    std::vector<ui32> mask(uSize * vSize);
+    for (int d = 0; d < size[axis]; d++) {
+        i32v3 pos;
+        pos[axis] = d;
+        for (int v = 0; v < vSize; v++) {
+            pos[vAxis] = v;
+            for (int u = 0; u < uSize; u++) {
+                pos[uAxis] = u;
+                const ColorRGBA8& voxel = matrix.getColor(pos);
+                if (voxel.a == 0 || matrix.getColorAndCheckBounds(pos + side).a != 0) {
+                    mask[v * uSize + u] = 0;
+                } else {
+                    mask[v * uSize + u] = 0xFF000000 | voxel.r | (voxel.g << 8) | (voxel.b << 16);
+                }
+            }
+        }
+
+        // Grow each face along u, then along v while the whole row matches
+        for (int v = 0; v < vSize; v++) {
+            for (int u = 0; u < uSize;) {
+                const ui32 key = mask[v * uSize + u];
+                if (key == 0) {
+                    u++;
+                    continue;
                 }
+                int w = 1;
+                while (u + w < uSize && mask[v * uSize + u + w] == key) w++;
+                int h = 1;
+                for (; v + h < vSize; h++) {
+                    const ui32* row = &mask[(v + h) * uSize + u];
+                    int i = 0;
+                    while (i < w && row[i] == key) i++;
+                    if (i < w) break;
+                }
+                for (int j = 0; j < h; j++) {
+                    memset(&mask[(v + j) * uSize + u], 0, w * sizeof(ui32));
+                }
+
+                pos[uAxis] = u;
+                pos[vAxis] = v;
+                f32v3 offset = f32v3(pos) - mainOffset; // Position of the first voxel in the model
+                f32v3 scale(1.0f);
+                scale[uAxis] = (f32)w;
+                scale[vAxis] = (f32)h;
+                const ColorRGBA8& voxel = matrix.getColor(pos);
+
+                int indexStart = (int)vertices.size();
+                int indiceStart = (int)indices.size();
+
+                // Add the 4 vertices for this face
+                vertices.resize(indexStart + 4);
+                for (int l = 0; l < 4; l++) {
+                    vertices[indexStart + l].pos = offset + VOXEL_MODEL[face * 4 + l] * scale;
+                    vertices[indexStart + l].color = voxel.color.rgb;
+                    vertices[indexStart + l].normal = f32v3(side);
+                    vertices[indexStart + l].padding = 0;
+                }
+
+                // Add the 6 indices for this face
+                indices.resize(indiceStart + 6);
+                for (int l = 0; l < 6; l++) {
+                    indices[indiceStart + l] = indexStart + VOXEL_INDICES[l];
+                }
+
+                u += w;
             }
         }
     }
-}
\ No newline at end of file
+}
@@ -8,15 +8,27 @@ class VoxelMatrix;
 class VoxelModel;
 class VoxelModelMesh;
 class VoxelModelVertex;
+struct VoxelModelMetrics;
 
 class ModelMesher {
 public:
-    static VoxelModelMesh createMesh(const VoxelModel* model);
-    static VoxelModelMesh createMarchingCubesMesh(const VoxelModel* model);
-    static VoxelModelMesh createDualContouringMesh(const VoxelModel* model);
+    /// Greedy meshed voxel faces. Uses the on-disk mesh cache for models loaded from a file.
+    static VoxelModelMesh createMesh(const VoxelModel* model, OPT VoxelModelMetrics* metrics = nullptr);
+    static VoxelModelMesh createMarchingCubesMesh(const VoxelModel* model, OPT VoxelModelMetrics* metrics = nullptr);
+    /// Uses the on-disk mesh cache for models loaded from a file.
+    static VoxelModelMesh createDualContouringMesh(const VoxelModel* model, OPT VoxelModelMetrics* metrics = nullptr);
+
+    /// CPU side of createMesh, no GL calls
+    static void genMesh(const VoxelModel* model, OUT std::vector<VoxelModelVertex>& vertices,
+                        OUT std::vector<ui32>& indices, OPT VoxelModelMetrics* metrics = nullptr);
 private:
+    static VoxelModelMesh uploadMesh(const std::vector<VoxelModelVertex>& vertices, const std::vector<ui32>& indices);
+
     // *** Regular ***
+    /// Meshes each face direction on its own thread
     static void genMatrixMesh(const VoxelMatrix& matrix, std::vector<VoxelModelVertex>& vertices, std::vector<ui32>& indices);
+    /// Greedy merges same colored faces pointing along VOXEL_SIDES[face], slice by slice
+    static void genFaceMesh(const VoxelMatrix& matrix, int face, std::vector<VoxelModelVertex>& vertices, std::vector<ui32>& indices);
 
     // *** Marching Cubes ***
     static color3 getColor(const f32v3& pos, const VoxelMatrix& matrix);
@@ -92,7 +92,7 @@ const int processEdgeMask[3][4] = { { 3, 2, 1, 0 }, { 7, 5, 6, 4 }, { 11, 10, 9,
 
 // -------------------------------------------------------------------------------
 
-OctreeNode* SimplifyOctree(OctreeNode* node, float threshold) {
+OctreeNode* SimplifyOctree(OctreeNode* node, float threshold, bool simplifyChildren = true) {
     if (!node) {
         return NULL;
     }
@@ -109,7 +109,7 @@ OctreeNode* SimplifyOctree(OctreeNode* node, float threshold) {
     bool isCollapsible = true;
 
     for (int i = 0; i < 8; i++) {
-        node->children[i] = SimplifyOctree(node->children[i], threshold);
+        if (simplifyChildren) node->children[i] = SimplifyOctree(node->children[i], threshold);
         if (node->children[i]) {
             OctreeNode* child = node->children[i];
             if (child->type == Node_Internal) {
@@ -549,10 +549,33 @@ OctreeNode* BuildOctree(const i32v3& min, const int size, const float threshold)
     root->size = size;
     root->type = Node_Internal;
 
-    ConstructOctreeNodes(root);
-    root = SimplifyOctree(root, threshold);
+    if (size == 1) return ConstructLeaf(root);
 
-    return root;
+    // Octants only touch each other when the root collapses, so each one
+    // is built and simplified on its own thread
+    const int childSize = size / 2;
+    std::thread threads[8];
+    for (int i = 0; i < 8; i++) {
+        OctreeNode* child = new OctreeNode;
+        child->size = childSize;
+        child->min = min + (CHILD_MIN_OFFSETS[i] * childSize);
+        child->type = Node_Internal;
+        threads[i] = std::thread([=] {
+            root->children[i] = SimplifyOctree(ConstructOctreeNodes(child), threshold);
+        });
+    }
+    bool hasChildren = false;
+    for (int i = 0; i < 8; i++) {
+        threads[i].join();
+        hasChildren |= (root->children[i] != nullptr);
+    }
+
+    if (!hasChildren) {
+        delete root;
+        return nullptr;
+    }
+
+    return SimplifyOctree(root, threshold, false);
 }
 
 // ----------------------------------------------------------------------------
@@ -28,25 +28,14 @@ void OpaqueVoxelRenderStage::render(const Camera* camera VORB_UNUSED) {
     m_renderer->beginOpaque(m_gameRenderParams->blockTexturePack->getAtlasTexture(), m_gameRenderParams->sunlightDirection,
                             m_gameRenderParams->sunlightColor);
     
-    // f64v3 closestPoint;
-    // static const f64v3 boxDims(CHUNK_WIDTH);
-    static const f64v3 boxDims_2(CHUNK_WIDTH / 2);
-    const std::vector <ChunkMesh *>& chunkMeshes = cmm->getChunkMeshes();
+    const Camera* chunkCamera = m_gameRenderParams->chunkCamera;
     {
         std::lock_guard<std::mutex> l(cmm->lckActiveChunkMeshes);
-        if (chunkMeshes.empty()) return;
-        for (int i = chunkMeshes.size() - 1; i >= 0; i--) {
-            ChunkMesh* cm = chunkMeshes[i];
-
-            if (m_gameRenderParams->chunkCamera->sphereInFrustum(f32v3(cm->position + boxDims_2 - position), CHUNK_DIAGONAL_LENGTH)) {
-                // TODO(Ben): Implement perfect fade
-                cm->inFrustum = 1;
-                m_renderer->drawOpaque(cm, position,
-                                       m_gameRenderParams->chunkCamera->getViewProjectionMatrix());
-            } else {
-                cm->inFrustum = 0;
-            }
-        }
+        // Culls for the later voxel stages as well
+        const std::vector<ChunkMesh*>& visibleMeshes = cmm->cullChunkMeshes(chunkCamera->getFrustum(), position);
+        if (visibleMeshes.empty()) return;
+        // TODO(Ben): Implement perfect fade
+        m_renderer->drawOpaqueBatch(visibleMeshes, position, chunkCamera->getViewProjectionMatrix());
     }
     
     m_renderer->end();
@@ -10,59 +10,118 @@
 #include "SpaceSystemComponents.h"
 #include "OrbitComponentUpdater.h"
 
-void OrbitComponentRenderer::drawPath(OrbitComponent& cmp, vg::GLProgram& colorProgram, const f32m4& wvp, NamePositionComponent* npComponent VORB_UNUSED, const f64v3& camPos, float blendFactor, NamePositionComponent* parentNpComponent /*= nullptr*/) {
+void OrbitComponentRenderer::addPath(const OrbitComponent& cmp, const f64v3& camPos, float blendFactor,
+                                     NamePositionComponent* parentNpComponent /*= nullptr*/) {
+    // Orbits are only solved for bodies with a parent
+    if (!cmp.isCalculated || cmp.a == 0.0) return;
 
-    // Lazily generate mesh
-    if (cmp.vbo == 0) generateOrbitEllipse(cmp, colorProgram);
-    if (cmp.numVerts == 0) return;
-    
-    f32m4 w(1.0f);
+    f32v4 newColor = lerp(cmp.pathColor[0], cmp.pathColor[1], blendFactor);
+    if (newColor.a <= 0.0f) return;
+
+    PathInstance instance;
+    instance.shape = f32v4(cmp.a, cmp.e, cmp.i, cmp.o);
+    float currentAngle = cmp.currentMeanAnomaly - (f32)cmp.startMeanAnomaly;
+    instance.phase = f32v4(cmp.p, cmp.startMeanAnomaly, currentAngle / (f32)(2.0 * M_PI), 0.0f);
     if (parentNpComponent) {
-        setMatrixTranslation(w, parentNpComponent->position - camPos);
+        instance.offset = f32v3(parentNpComponent->position - camPos);
     } else {
-        setMatrixTranslation(w, -camPos);
+        instance.offset = f32v3(-camPos);
     }
-    
-    f32m4 pathMatrix = wvp * w;
+    instance.color = newColor;
+    m_instances.push_back(instance);
+}
 
-    f32v4 newColor = lerp(cmp.pathColor[0], cmp.pathColor[1], blendFactor);
-    if (newColor.a <= 0.0f) return;
-    glUniform4f(colorProgram.getUniform("unColor"), newColor.r, newColor.g, newColor.b, newColor.a);
+void OrbitComponentRenderer::drawPaths(vg::GLProgram& colorProgram, const f32m4& VP) {
+    m_numPathsDrawn = m_instances.size();
+    if (m_instances.empty()) return;
 
-    glUniformMatrix4fv(colorProgram.getUniform("unWVP"), 1, GL_FALSE, &pathMatrix[0][0]);
+    // Lazily generate mesh
+    if (m_vao == 0) initMesh(colorProgram);
 
-    float currentAngle = cmp.currentMeanAnomaly - (f32)cmp.startMeanAnomaly;
-    glUniform1f(colorProgram.getUniform("currentAngle"), currentAngle / (float)M_2_PI);
+    // Orphan and refill the instance stream
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, m_instances.size() * sizeof(PathInstance), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, m_instances.size() * sizeof(PathInstance), m_instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    // Draw the ellipse
+    glUniformMatrix4fv(colorProgram.getUniform("unVP"), 1, GL_FALSE, &VP[0][0]);
+    // One full orbit of mean anomaly per period
+    glUniform1f(colorProgram.getUniform("unMeanAnomalyPerPeriod"), (f32)(2.0 * M_PI));
+
+    // Draw the ellipses
     glDepthMask(false);
-    glBindVertexArray(cmp.vao);
-    glDrawArrays(GL_LINE_STRIP, 0, cmp.numVerts);
+    glBindVertexArray(m_vao);
+    glDrawArraysInstanced(GL_LINE_STRIP, 0, ORBIT_PATH_VERTS + 1, m_instances.size());
     glBindVertexArray(0);
     glDepthMask(true);
+
+    m_instances.clear();
+}
+
+void OrbitComponentRenderer::dispose() {
+    if (m_vao) {
+        glDeleteVertexArrays(1, &m_vao);
+        m_vao = 0;
+    }
+    if (m_pathVbo) vg::GpuMemory::freeBuffer(m_pathVbo);
+    if (m_instanceVbo) vg::GpuMemory::freeBuffer(m_instanceVbo);
+    std::vector<PathInstance>().swap(m_instances);
 }
 
-void OrbitComponentRenderer::generateOrbitEllipse(OrbitComponent& cmp, vg::GLProgram& colorProgram) {
+f64v3 OrbitComponentRenderer::getPathPosition(const OrbitComponent& cmp, f64 fraction) {
+    // Same math as OrbitComponentUpdater::updatePosition at time fraction * t, with a full orbit per period
+    f64 meanAnomaly = 2.0 * M_PI * fraction + cmp.startMeanAnomaly;
+    f64 v = OrbitComponentUpdater().calculateTrueAnomaly(meanAnomaly, cmp.e);
+    f64 r = cmp.a * (1.0 - cmp.e * cmp.e) / (1.0 + cmp.e * cos(v));
+    f64 cosv = cos(v + cmp.p - cmp.o);
+    f64 sinv = sin(v + cmp.p - cmp.o);
+    f64 coso = cos(cmp.o);
+    f64 sino = sin(cmp.o);
+    f64 cosi = cos(cmp.i);
+    f64 sini = sin(cmp.i);
+    return f64v3(r * (coso * cosv - sino * sinv * cosi),
+                 r * (sinv * sini),
+                 r * (sino * cosv + coso * sinv * cosi));
+}
 
-    if (cmp.verts.empty()) return;
+void OrbitComponentRenderer::initMesh(vg::GLProgram& colorProgram) {
+    // Fraction of the period at each point, the angle is 1 - fraction
+    std::vector<f32> fractions(ORBIT_PATH_VERTS + 1);
+    for (int i = 0; i < ORBIT_PATH_VERTS; i++) {
+        fractions[i] = (f32)i / (f32)ORBIT_PATH_VERTS;
+    }
+    fractions.back() = fractions.front();
 
-    glGenVertexArrays(1, &cmp.vao);
-    glBindVertexArray(cmp.vao);
+    glGenVertexArrays(1, &m_vao);
+    glBindVertexArray(m_vao);
 
     colorProgram.enableVertexAttribArrays();
 
     // Upload the buffer data
-    vg::GpuMemory::createBuffer(cmp.vbo);
-    vg::GpuMemory::bindBuffer(cmp.vbo, vg::BufferTarget::ARRAY_BUFFER);
-    vg::GpuMemory::uploadBufferData(cmp.vbo,
+    vg::GpuMemory::createBuffer(m_pathVbo);
+    vg::GpuMemory::bindBuffer(m_pathVbo, vg::BufferTarget::ARRAY_BUFFER);
+    vg::GpuMemory::uploadBufferData(m_pathVbo,
                                     vg::BufferTarget::ARRAY_BUFFER,
-                                    cmp.verts.size() * sizeof(OrbitComponent::Vertex),
-                                    cmp.verts.data(),
+                                    fractions.size() * sizeof(f32),
+                                    fractions.data(),
                                     vg::BufferUsageHint::STATIC_DRAW);
-    vg::GpuMemory::bindBuffer(0, vg::BufferTarget::ELEMENT_ARRAY_BUFFER);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(OrbitComponent::Vertex), 0);
-    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(OrbitComponent::Vertex), (const void*)offsetof(OrbitComponent::Vertex, angle));
+    glVertexAttribPointer(colorProgram.getAttribute("vFraction"), 1, GL_FLOAT, GL_FALSE, sizeof(f32), 0);
+
+    vg::GpuMemory::createBuffer(m_instanceVbo);
+    vg::GpuMemory::bindBuffer(m_instanceVbo, vg::BufferTarget::ARRAY_BUFFER);
+    VGAttribute shape = colorProgram.getAttribute("vShape");
+    VGAttribute phase = colorProgram.getAttribute("vPhase");
+    VGAttribute offset = colorProgram.getAttribute("vOffset");
+    VGAttribute color = colorProgram.getAttribute("vColor");
+    glVertexAttribPointer(shape, 4, GL_FLOAT, GL_FALSE, sizeof(PathInstance), (const void*)offsetof(PathInstance, shape));
+    glVertexAttribPointer(phase, 4, GL_FLOAT, GL_FALSE, sizeof(PathInstance), (const void*)offsetof(PathInstance, phase));
+    glVertexAttribPointer(offset, 3, GL_FLOAT, GL_FALSE, sizeof(PathInstance), (const void*)offsetof(PathInstance, offset));
+    glVertexAttribPointer(color, 4, GL_FLOAT, GL_FALSE, sizeof(PathInstance), (const void*)offsetof(PathInstance, color));
+    glVertexAttribDivisor(shape, 1);
+    glVertexAttribDivisor(phase, 1);
+    glVertexAttribDivisor(offset, 1);
+    glVertexAttribDivisor(color, 1);
+
+    vg::GpuMemory::bindBuffer(0, vg::BufferTarget::ARRAY_BUFFER);
     glBindVertexArray(0);
-    cmp.numVerts = cmp.verts.size();
-    std::vector<OrbitComponent::Vertex>().swap(cmp.verts);
-}
\ No newline at end of file
+}
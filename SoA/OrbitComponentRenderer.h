@@ -17,6 +17,7 @@
 
 #include <Vorb/types.h>
 #include <Vorb/VorbPreDecl.inl>
+#include <Vorb/graphics/gtypes.h>
 
 class SpaceSystem;
 struct OrbitComponent;
@@ -24,13 +25,40 @@ struct NamePositionComponent;
 
 DECL_VG(class GLProgram)
 
+// Points along each path. The last point closes the loop.
+#define ORBIT_PATH_VERTS 2880
+
 class OrbitComponentRenderer {
 public:
-    /// Draws the ellipse
-    void drawPath(OrbitComponent& cmp, vg::GLProgram& colorProgram, const f32m4& WVP, NamePositionComponent* npComponent,
-                  const f64v3& camPos, float blendFactor, NamePositionComponent* parentNpComponent = nullptr);
+    /// Per orbit data, the ellipse itself is solved in the vertex shader
+    struct PathInstance {
+        f32v4 shape; ///< a, e, i, o
+        f32v4 phase; ///< p, startMeanAnomaly, currentAngle, unused
+        f32v3 offset; ///< Parent position relative to the camera
+        f32v4 color;
+    };
+
+    /// Queues the ellipse of an orbit for the next drawPaths()
+    void addPath(const OrbitComponent& cmp, const f64v3& camPos, float blendFactor,
+                 NamePositionComponent* parentNpComponent = nullptr);
+    /// Draws every queued ellipse with a single instanced draw call
+    void drawPaths(vg::GLProgram& colorProgram, const f32m4& VP);
+    void dispose();
+
+    /// Paths drawn by the last drawPaths()
+    ui32 getNumPathsDrawn() const { return m_numPathsDrawn; }
+
+    /// CPU version of the path the vertex shader evaluates, relative to the parent
+    /// @param fraction: Fraction of the period since startMeanAnomaly, 0-1
+    static f64v3 getPathPosition(const OrbitComponent& cmp, f64 fraction);
 private:
-    void generateOrbitEllipse(OrbitComponent& cmp, vg::GLProgram& colorProgram);
+    void initMesh(vg::GLProgram& colorProgram);
+
+    std::vector<PathInstance> m_instances;
+    VGBuffer m_pathVbo = 0; ///< Shared fractions along the path
+    VGBuffer m_instanceVbo = 0;
+    VGVertexArray m_vao = 0;
+    ui32 m_numPathsDrawn = 0;
 };
 
 #endif // OrbitComponentRenderer_h__
\ No newline at end of file
@@ -27,7 +27,7 @@ void OrbitComponentUpdater::updatePosition(OrbitComponent& cmp, f64 time, NamePo
     /// http://en.wikipedia.org/wiki/Kepler%27s_laws_of_planetary_motion#Position_as_a_function_of_time
 
     // 1. Calculate the mean anomaly
-    f64 meanAnomaly = (M_2_PI / cmp.t) * time + cmp.startMeanAnomaly;
+    f64 meanAnomaly = (2.0 * M_PI / cmp.t) * time + cmp.startMeanAnomaly;
     cmp.currentMeanAnomaly = (f32)meanAnomaly;
 
     f64 v = calculateTrueAnomaly(meanAnomaly, cmp.e);
@@ -0,0 +1,467 @@
+#include "stdafx.h"
+#include "PlanetGenCache.h"
+
+#ifdef _WINDOWS
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif//_WINDOWS
+
+#include <Vorb/io/IOManager.h>
+
+#include "PlanetGenData.h"
+
+#define CACHE_MAGIC "SOAP"
+#define NULL_BIOME_INDEX 0xFFFF
+
+namespace {
+    struct CacheHeader {
+        char magic[4];
+        ui32 version;
+        ui64 contentHash;
+        ui64 size; ///< Whole image, catches truncated writes
+    };
+
+    /// Read only view of a whole file
+    class MappedFile {
+    public:
+        ~MappedFile() {
+#ifdef _WINDOWS
+            if (data) UnmapViewOfFile(data);
+            if (m_mapping) CloseHandle(m_mapping);
+            if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+#else
+            if (data) munmap((void*)data, size);
+#endif//_WINDOWS
+        }
+
+        bool map(const nString& path) {
+#ifdef _WINDOWS
+            m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (m_file == INVALID_HANDLE_VALUE) return false;
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0) return false;
+            m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!m_mapping) return false;
+            data = (const ui8*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+            size = (size_t)fileSize.QuadPart;
+#else
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0) {
+                close(fd);
+                return false;
+            }
+            void* mem = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            // The mapping keeps the file alive
+            close(fd);
+            if (mem == MAP_FAILED) return false;
+            data = (const ui8*)mem;
+            size = (size_t)st.st_size;
+#endif//_WINDOWS
+            return data != nullptr;
+        }
+
+        const ui8* data = nullptr;
+        size_t size = 0;
+    private:
+#ifdef _WINDOWS
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = nullptr;
+#endif//_WINDOWS
+    };
+
+    /************************************************************************/
+    /* Archives. Every transfer function below is used for both directions. */
+    /************************************************************************/
+    class CacheWriter {
+    public:
+        bool isReading() const { return false; }
+
+        template<typename T>
+        void pod(T& v) {
+            const ui8* p = (const ui8*)&v;
+            bytes.insert(bytes.end(), p, p + sizeof(T));
+        }
+        void raw(void* v, size_t size) {
+            const ui8* p = (const ui8*)v;
+            bytes.insert(bytes.end(), p, p + size);
+        }
+
+        std::vector<ui8> bytes;
+    };
+
+    class CacheReader {
+    public:
+        CacheReader(const ui8* data, size_t size) : m_cur(data), m_end(data + size) {}
+
+        bool isReading() const { return true; }
+
+        template<typename T>
+        void pod(T& v) {
+            raw(&v, sizeof(T));
+        }
+        void raw(void* v, size_t size) {
+            if ((size_t)(m_end - m_cur) < size) {
+                // Leave the rest zeroed, the caller rejects the whole image
+                memset(v, 0, size);
+                failed = true;
+                return;
+            }
+            memcpy(v, m_cur, size);
+            m_cur += size;
+        }
+
+        bool failed = false;
+    private:
+        const ui8* m_cur;
+        const ui8* m_end;
+    };
+
+    template<typename A>
+    void transfer(A& a, nString& s) {
+        ui32 length = (ui32)s.size();
+        a.pod(length);
+        if (a.isReading()) s.resize(length);
+        if (length) a.raw(&s[0], length);
+    }
+
+    template<typename A, typename T>
+    void transferEnum(A& a, T& e) {
+        ui32 v = (ui32)e;
+        a.pod(v);
+        e = (T)v;
+    }
+
+    // Plain data elements
+    template<typename A, typename T>
+    void transferPODs(A& a, std::vector<T>& v) {
+        ui32 n = (ui32)v.size();
+        a.pod(n);
+        if (a.isReading()) v.resize(n);
+        if (n) a.raw(&v[0], n * sizeof(T));
+    }
+
+    template<typename A, typename T>
+    void transferVector(A& a, std::vector<T>& v) {
+        ui32 n = (ui32)v.size();
+        a.pod(n);
+        if (a.isReading()) v.resize(n);
+        for (auto& e : v) transfer(a, e);
+    }
+
+    template<typename A>
+    void transfer(A& a, TerrainFuncProperties& p);
+
+    template<typename A>
+    void transfer(A& a, Array<TerrainFuncProperties>& funcs) {
+        ui32 n = (ui32)funcs.size();
+        a.pod(n);
+        if (a.isReading()) {
+            // Keg arrays are raw storage, construct the elements before assigning into them
+            funcs.setData(n);
+            for (ui32 i = 0; i < n; i++) new (&funcs[i]) TerrainFuncProperties();
+        }
+        for (ui32 i = 0; i < n; i++) transfer(a, funcs[i]);
+    }
+
+    template<typename A>
+    void transfer(A& a, TerrainFuncProperties& p) {
+        transferEnum(a, p.func);
+        transferEnum(a, p.op);
+        a.pod(p.octaves);
+        a.pod(p.persistence);
+        a.pod(p.frequency);
+        a.pod(p.low);
+        a.pod(p.high);
+        a.pod(p.clamp);
+        transfer(a, p.children);
+    }
+
+    template<typename A>
+    void transfer(A& a, NoiseBase& p) {
+        a.pod(p.base);
+        transfer(a, p.funcs);
+    }
+
+    template<typename A>
+    void transfer(A& a, BlockLayerKegProperties& p) {
+        transfer(a, p.block);
+        transfer(a, p.surface);
+        a.pod(p.width);
+    }
+
+    template<typename A>
+    void transfer(A& a, FloraKegProperties& p) {
+        transfer(a, p.id);
+        transfer(a, p.block);
+        transfer(a, p.nextFlora);
+        a.pod(p.height);
+        a.pod(p.slope);
+        a.pod(p.dSlope);
+        transferEnum(a, p.dir);
+    }
+
+    template<typename A>
+    void transfer(A& a, FruitKegProperties& p) {
+        transfer(a, p.flora);
+        a.pod(p.chance);
+    }
+
+    template<typename A>
+    void transfer(A& a, LeafKegProperties& p) {
+        transferEnum(a, p.type);
+        transfer(a, p.fruitProps);
+        // The mushroom layout is the largest member of the union
+        a.raw(&p.mushroom, sizeof(p.mushroom));
+        transfer(a, p.block);
+        transfer(a, p.mushGillBlock);
+        transfer(a, p.mushCapBlock);
+    }
+
+    template<typename A>
+    void transfer(A& a, BranchKegProperties& p) {
+        a.pod(p.coreWidth);
+        a.pod(p.barkWidth);
+        a.pod(p.widthFalloff);
+        a.pod(p.branchChance);
+        a.pod(p.angle);
+        a.pod(p.subBranchAngle);
+        a.pod(p.changeDirChance);
+        transfer(a, p.coreBlock);
+        transfer(a, p.barkBlock);
+        transfer(a, p.fruitProps);
+        transfer(a, p.leafProps);
+    }
+
+    template<typename A>
+    void transfer(A& a, TrunkKegProperties& p) {
+        a.pod(p.loc);
+        a.pod(p.coreWidth);
+        a.pod(p.barkWidth);
+        a.pod(p.branchChance);
+        a.pod(p.changeDirChance);
+        a.pod(p.slope);
+        transfer(a, p.coreBlock);
+        transfer(a, p.barkBlock);
+        transferEnum(a, p.interp);
+        transfer(a, p.fruitProps);
+        transfer(a, p.leafProps);
+        transfer(a, p.branchProps);
+    }
+
+    template<typename A>
+    void transfer(A& a, TreeKegProperties& p) {
+        transfer(a, p.id);
+        a.pod(p.height);
+        a.pod(p.branchPoints);
+        a.pod(p.branchStep);
+        a.pod(p.killMult);
+        a.pod(p.infRadius);
+        transferPODs(a, p.branchVolumes);
+        transferVector(a, p.trunkProps);
+    }
+
+    // Shared by BiomeFloraKegProperties and BiomeTreeKegProperties
+    template<typename A, typename T>
+    void transferBiomeChance(A& a, T& p) {
+        transfer(a, p.chance);
+        transfer(a, p.id);
+    }
+    template<typename A>
+    void transfer(A& a, BiomeFloraKegProperties& p) {
+        transferBiomeChance(a, p);
+    }
+    template<typename A>
+    void transfer(A& a, BiomeTreeKegProperties& p) {
+        transferBiomeChance(a, p);
+    }
+
+    /************************************************************************/
+    /* Biome pointers are stored as indices into PlanetGenData::biomes      */
+    /************************************************************************/
+    ui16 getBiomeIndex(const PlanetGenData* genData, const Biome* biome) {
+        if (!biome) return NULL_BIOME_INDEX;
+        return (ui16)(biome - &genData->biomes[0]);
+    }
+    const Biome* getBiome(const PlanetGenData* genData, ui16 index, bool& failed) {
+        if (index == NULL_BIOME_INDEX) return nullptr;
+        if (index >= genData->biomes.size()) {
+            failed = true;
+            return nullptr;
+        }
+        return &genData->biomes[index];
+    }
+
+    template<typename A>
+    void transferBiomes(A& a, PlanetGenData* genData, bool& failed) {
+        ui32 numBiomes = (ui32)genData->biomes.size();
+        a.pod(numBiomes);
+        // Never resized after this, so the pointers below stay valid
+        if (a.isReading()) genData->biomes.resize(numBiomes);
+        for (auto& biome : genData->biomes) {
+            transfer(a, biome.id);
+            transfer(a, biome.displayName);
+            a.pod(biome.mapColor);
+            transferPODs(a, biome.blockLayers);
+            ui32 numChildren = (ui32)biome.children.size();
+            a.pod(numChildren);
+            if (a.isReading()) biome.children.resize(numChildren);
+            for (auto& child : biome.children) {
+                ui16 index = getBiomeIndex(genData, child);
+                a.pod(index);
+                child = const_cast<Biome*>(getBiome(genData, index, failed));
+            }
+            transfer(a, biome.childNoise);
+            transfer(a, biome.terrainNoise);
+            a.pod(biome.heightRange);
+            a.pod(biome.heightScale);
+            a.pod(biome.noiseRange);
+            a.pod(biome.noiseScale);
+        }
+    }
+
+    // std::map<const Biome*, std::vector<T>>
+    template<typename A, typename M>
+    void transferBiomeMap(A& a, PlanetGenData* genData, M& map, bool& failed) {
+        ui32 n = (ui32)map.size();
+        a.pod(n);
+        if (a.isReading()) {
+            for (ui32 i = 0; i < n; i++) {
+                ui16 index;
+                a.pod(index);
+                const Biome* biome = getBiome(genData, index, failed);
+                transferVector(a, map[biome]);
+            }
+        } else {
+            for (auto& it : map) {
+                ui16 index = getBiomeIndex(genData, it.first);
+                a.pod(index);
+                transferVector(a, it.second);
+            }
+        }
+    }
+
+    template<typename A>
+    void transferInfluenceMaps(A& a, PlanetGenData* genData, bool& failed) {
+        for (int y = 0; y < BIOME_MAP_WIDTH; y++) {
+            for (int x = 0; x < BIOME_MAP_WIDTH; x++) {
+                ui16 index = getBiomeIndex(genData, genData->baseBiomeLookup[y][x]);
+                a.pod(index);
+                genData->baseBiomeLookup[y][x] = getBiome(genData, index, failed);
+            }
+        }
+        // Blurred influences, at most FILTER_SIZE^2 per cell
+        for (int y = 0; y < BIOME_MAP_WIDTH; y++) {
+            for (int x = 0; x < BIOME_MAP_WIDTH; x++) {
+                std::vector<BiomeInfluence>& influences = genData->baseBiomeInfluenceMap[y][x];
+                ui8 n = (ui8)influences.size();
+                a.pod(n);
+                if (a.isReading()) influences.resize(n);
+                for (auto& influence : influences) {
+                    ui16 index = getBiomeIndex(genData, influence.b);
+                    a.pod(index);
+                    a.pod(influence.weight);
+                    influence.b = getBiome(genData, index, failed);
+                }
+            }
+        }
+    }
+
+    template<typename A>
+    void transferGenData(A& a, PlanetGenData* genData, PlanetGenCacheInfo& info, bool& failed) {
+        transfer(a, info.terrainColorPath);
+        a.pod(info.hasBiomes);
+
+        a.pod(genData->liquidTint);
+        a.pod(genData->terrainTint);
+        a.pod(genData->liquidDepthScale);
+        a.pod(genData->liquidFreezeTemp);
+        a.pod(genData->tempLatitudeFalloff);
+        a.pod(genData->tempHeightFalloff);
+        a.pod(genData->humLatitudeFalloff);
+        a.pod(genData->humHeightFalloff);
+
+        // Noise programs
+        transfer(a, genData->baseTerrainFuncs);
+        transfer(a, genData->tempTerrainFuncs);
+        transfer(a, genData->humTerrainFuncs);
+
+        // Block layers, flora and trees
+        PlanetBlockInitInfo& blockInfo = genData->blockInfo;
+        transferVector(a, blockInfo.blockLayers);
+        transferVector(a, blockInfo.flora);
+        transferVector(a, blockInfo.trees);
+        transfer(a, blockInfo.liquidBlockName);
+        transfer(a, blockInfo.surfaceBlockName);
+
+        // Biome tree and the blurred maps
+        if (info.hasBiomes) {
+            transferBiomes(a, genData, failed);
+            transferBiomeMap(a, genData, blockInfo.biomeFlora, failed);
+            transferBiomeMap(a, genData, blockInfo.biomeTrees, failed);
+            transferInfluenceMaps(a, genData, failed);
+        }
+    }
+}
+
+ui64 PlanetGenCache::hashDependencies(vio::IOManager& iom, const std::vector<nString>& dependencies) {
+    ui64 hash = 14695981039346656037ull;
+    nString data;
+    for (auto& path : dependencies) {
+        if (!iom.readFileToString(path.c_str(), data)) return 0;
+        // Path too, so moving a file invalidates the image
+        for (char c : path) hash = (hash ^ (ui8)c) * 1099511628211ull;
+        for (char c : data) hash = (hash ^ (ui8)c) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool PlanetGenCache::save(vio::IOManager& iom, const nString& cachePath, const PlanetGenData* genData, const PlanetGenCacheInfo& info) {
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = PLANET_GEN_CACHE_VERSION;
+    header.contentHash = hashDependencies(iom, info.dependencies);
+    if (header.contentHash == 0) return false;
+
+    CacheWriter writer;
+    writer.pod(header);
+    std::vector<nString> dependencies = info.dependencies;
+    transferVector(writer, dependencies);
+    bool failed = false;
+    // The writer only reads through these
+    transferGenData(writer, const_cast<PlanetGenData*>(genData), const_cast<PlanetGenCacheInfo&>(info), failed);
+    ((CacheHeader*)&writer.bytes[0])->size = writer.bytes.size();
+
+    vio::FileStream fs = iom.openFile(cachePath.c_str(), vio::FileOpenFlags::WRITE_ONLY_CREATE | vio::FileOpenFlags::BINARY);
+    if (!fs.isOpened()) return false;
+    fs.write(1, writer.bytes.size(), &writer.bytes[0]);
+    return true;
+}
+
+bool PlanetGenCache::load(vio::IOManager& iom, const nString& cachePath, OUT PlanetGenData* genData, OUT PlanetGenCacheInfo& info) {
+    vio::Path path;
+    if (!iom.resolvePath(cachePath, path)) return false;
+    MappedFile file;
+    if (!file.map(path.getString())) return false;
+
+    CacheReader reader(file.data, file.size);
+    CacheHeader header;
+    reader.pod(header);
+    if (reader.failed || memcmp(header.magic, CACHE_MAGIC, 4) != 0 ||
+        header.version != PLANET_GEN_CACHE_VERSION || header.size != file.size) {
+        return false;
+    }
+
+    // Stale if any source changed
+    transferVector(reader, info.dependencies);
+    if (reader.failed || hashDependencies(iom, info.dependencies) != header.contentHash) return false;
+
+    bool failed = false;
+    transferGenData(reader, genData, info, failed);
+    return !failed && !reader.failed;
+}
@@ -0,0 +1,48 @@
+///
+/// PlanetGenCache.h
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// Binary image of a compiled PlanetGenData, so warm loads skip
+/// the YAML parsing, the biome map decode and the influence blur.
+///
+
+#pragma once
+
+#ifndef PlanetGenCache_h__
+#define PlanetGenCache_h__
+
+#include <Vorb/VorbPreDecl.inl>
+
+DECL_VIO(class IOManager);
+
+struct PlanetGenData;
+
+// Bump this whenever the layout or anything the loader computes changes
+#define PLANET_GEN_CACHE_VERSION 1
+
+/// What the loader needs besides the image itself
+struct PlanetGenCacheInfo {
+    std::vector<nString> dependencies; ///< Source files, in load order. Their contents are hashed.
+    nString terrainColorPath = ""; ///< Color map pixels are still decoded from the image file
+    bool hasBiomes = false; ///< False means every cell uses DEFAULT_BIOME
+};
+
+namespace PlanetGenCache {
+    /// Writes genData as a cache image
+    /// @param info: Must list every file genData was built from
+    bool save(vio::IOManager& iom, const nString& cachePath, const PlanetGenData* genData, const PlanetGenCacheInfo& info);
+
+    /// Memory maps a cache image and fills genData from it
+    /// @return false if the image is missing, stale, from another version or corrupt.
+    /// genData may be partially filled in that case and should be discarded.
+    bool load(vio::IOManager& iom, const nString& cachePath, OUT PlanetGenData* genData, OUT PlanetGenCacheInfo& info);
+
+    /// 64 bit FNV-1a over the contents of each dependency. 0 if one can't be read
+    ui64 hashDependencies(vio::IOManager& iom, const std::vector<nString>& dependencies);
+}
+
+#endif // PlanetGenCache_h__
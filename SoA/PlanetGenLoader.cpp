@@ -15,6 +15,7 @@
 #include "BlockPack.h"
 #include "Errors.h"
 #include "Biome.h"
+#include "PlanetGenCache.h"
 
 typedef ui32 BiomeColorCode;
 
@@ -59,6 +60,29 @@ void PlanetGenLoader::init(vio::IOManager* ioManager) {
 }
 
 CALLER_DELETE PlanetGenData* PlanetGenLoader::loadPlanetGenData(const nString& terrainPath) {
+    PreciseTimer timer;
+    timer.start();
+    nString cachePath = terrainPath + ".bin";
+
+    // Warm path, everything but the color map pixels comes from the cache image
+    if (m_useCache) {
+        PlanetGenData* genData = new PlanetGenData;
+        PlanetGenCacheInfo info;
+        if (PlanetGenCache::load(*m_iom, cachePath, genData, info)) {
+            genData->terrainFilePath = terrainPath;
+            if (!info.hasBiomes) setDefaultBiome(genData);
+            if (info.terrainColorPath.size()) loadTerrainColorPixels(info.terrainColorPath, genData);
+            m_lastLoadUsedCache = true;
+            m_lastLoadMs = timer.stop();
+            return genData;
+        }
+        delete genData;
+    }
+
+    // Cold path, remember every file we read so the image can be validated later
+    m_cacheInfo = PlanetGenCacheInfo();
+    m_cacheInfo.dependencies.push_back(terrainPath);
+
     nString data;
     m_iom->readFileToString(terrainPath.c_str(), data);
 
@@ -117,25 +141,38 @@ CALLER_DELETE PlanetGenData* PlanetGenLoader::loadPlanetGenData(const nString& t
     delete f;
 
     if (floraPath.size()) {
+        m_cacheInfo.dependencies.push_back(floraPath);
         loadFlora(floraPath, genData);
     }
     if (treesPath.size()) {
+        m_cacheInfo.dependencies.push_back(treesPath);
         loadTrees(treesPath, genData);
     }
 
     if (biomePath.size()) {
+        m_cacheInfo.dependencies.push_back(biomePath);
+        m_cacheInfo.hasBiomes = true;
         loadBiomes(biomePath, genData);
     } else {
-        // Set default biome
-        for (int y = 0; y < BIOME_MAP_WIDTH; y++) {
-            for (int x = 0; x < BIOME_MAP_WIDTH; x++) {
-                genData->baseBiomeLookup[y][x] = &DEFAULT_BIOME;
-            }
-        }
+        setDefaultBiome(genData);
     }
+
+    if (m_useCache && !PlanetGenCache::save(*m_iom, cachePath, genData, m_cacheInfo)) {
+        printf("Failed to write planet cache %s\n", cachePath.c_str());
+    }
+    m_lastLoadUsedCache = false;
+    m_lastLoadMs = timer.stop();
     return genData;
 }
 
+void PlanetGenLoader::setDefaultBiome(PlanetGenData* genData) {
+    for (int y = 0; y < BIOME_MAP_WIDTH; y++) {
+        for (int x = 0; x < BIOME_MAP_WIDTH; x++) {
+            genData->baseBiomeLookup[y][x] = &DEFAULT_BIOME;
+        }
+    }
+}
+
 PlanetGenData* PlanetGenLoader::getDefaultGenData(vcore::RPCManager* glrpc VORB_UNUSED /* = nullptr */) {
     // Lazily construct default data
     if (!m_defaultGenData) {
@@ -171,12 +208,7 @@ CALLER_DELETE PlanetGenData* PlanetGenLoader::getRandomGenData(f32 radius, vcore
         //genData->liquidTexture = m_textureCache.addTexture("_shared/water_a.png", vg::TextureTarget::TEXTURE_2D, &vg::SamplerState::LINEAR_WRAP_MIPMAP);
     }
 
-    // Set default biome
-    for (int y = 0; y < BIOME_MAP_WIDTH; y++) {
-        for (int x = 0; x < BIOME_MAP_WIDTH; x++) {
-            genData->baseBiomeLookup[y][x] = &DEFAULT_BIOME;
-        }
-    }
+    setDefaultBiome(genData);
 
     return genData;
 }
@@ -694,6 +726,7 @@ void PlanetGenLoader::loadBiomes(const nString& filePath, PlanetGenData* genData
     auto baseParser = makeFunctor([&](Sender, const nString& key, keg::Node value) {
         // Parse based on type
         if (key == "baseLookupMap") {
+            m_cacheInfo.dependencies.push_back(keg::convert<nString>(value));
             vpath texPath;
             m_iom->resolvePath(keg::convert<nString>(value), texPath);
             vg::ScopedBitmapResource rs(vg::ImageIO().load(texPath.getString(), vg::ImageIOFormat::RGB_UI8, true));
@@ -866,12 +899,9 @@ void PlanetGenLoader::parseTerrainColor(keg::ReadContext& context VORB_UNUSED, k
     }
 
     if (kegProps.colorPath.size()) {
-        vio::Path p;
-        if (m_iom->resolvePath(kegProps.colorPath, p)) {
-            // Handle RPC for texture upload
-            genData->terrainColorPixels = vg::ImageIO().load(p, vg::ImageIOFormat::RGB_UI8,
-                                                             true);
-        }
+        m_cacheInfo.dependencies.push_back(kegProps.colorPath);
+        m_cacheInfo.terrainColorPath = kegProps.colorPath;
+        loadTerrainColorPixels(kegProps.colorPath, genData);
     }
     // TODO(Ben): stop being lazy and copy pasting
     if (kegProps.grassTexturePath.size()) {
@@ -901,6 +931,15 @@ void PlanetGenLoader::parseTerrainColor(keg::ReadContext& context VORB_UNUSED, k
     genData->terrainTint = kegProps.tint;
 }
 
+void PlanetGenLoader::loadTerrainColorPixels(const nString& colorPath, PlanetGenData* genData) {
+    vio::Path p;
+    if (m_iom->resolvePath(colorPath, p)) {
+        // Handle RPC for texture upload
+        genData->terrainColorPixels = vg::ImageIO().load(p, vg::ImageIOFormat::RGB_UI8,
+                                                         true);
+    }
+}
+
 void PlanetGenLoader::parseBlockLayers(keg::ReadContext& context, keg::Node node, PlanetGenData* genData) {
     if (keg::getType(node) != keg::NodeType::MAP) {
         std::cout << "Failed to parse node in parseBlockLayers. Should be MAP";
@@ -22,6 +22,7 @@
 #include <Vorb/graphics/TextureCache.h>
 #include <Vorb/VorbPreDecl.inl>
 
+#include "PlanetGenCache.h"
 #include "PlanetGenerator.h"
 #include "SpaceSystemLoadStructs.h"
 
@@ -39,7 +40,8 @@ class PlanetGenLoader {
 public:
     void init(vio::IOManager* ioManager);
 
-    /// Loads a planet from file
+    /// Loads a planet from file, or from its compiled cache image next to it
+    /// when that is up to date. A cold load writes the image.
     CALLER_DELETE PlanetGenData* loadPlanetGenData(const nString& terrainPath);
     /// Returns a default planetGenData
     /// @param glrpc: Optional RPC if you want to load on a non-render thread
@@ -51,6 +53,12 @@ class PlanetGenLoader {
     CALLER_DELETE PlanetGenData* getRandomGenData(f32 radius, vcore::RPCManager* glrpc = nullptr);
     AtmosphereProperties getRandomAtmosphere();
 
+    /// Disable to always parse the source files and never write cache images
+    void setUseCache(bool useCache) { m_useCache = useCache; }
+    /// Wall time of the last loadPlanetGenData call
+    f64 getLastLoadMs() const { return m_lastLoadMs; }
+    bool lastLoadUsedCache() const { return m_lastLoadUsedCache; }
+
 private:
 
     void loadFlora(const nString& filePath, PlanetGenData* genData);
@@ -62,6 +70,9 @@ class PlanetGenLoader {
     void parseTerrainColor(keg::ReadContext& context, keg::Node node, PlanetGenData* genData);
     void parseBlockLayers(keg::ReadContext& context, keg::Node node, PlanetGenData* genData);
 
+    void loadTerrainColorPixels(const nString& colorPath, PlanetGenData* genData);
+    void setDefaultBiome(PlanetGenData* genData);
+
     static PlanetGenData* m_defaultGenData; ///< Default generation data handle
 
     vio::IOManager* m_iom = nullptr; ///< IOManager handle
@@ -71,6 +82,11 @@ class PlanetGenLoader {
     vcore::RPCManager* m_glRpc = nullptr;
 
     PlanetGenerator m_planetGenerator;
+
+    bool m_useCache = true;
+    PlanetGenCacheInfo m_cacheInfo; ///< Files read by the current cold load
+    f64 m_lastLoadMs = 0.0;
+    bool m_lastLoadUsedCache = false;
 };
 
 #endif // PlanetLoader_h__
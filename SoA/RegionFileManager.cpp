@@ -4,7 +4,10 @@
 #ifdef _WINDOWS
 #include <direct.h> //for mkdir windows
 #include <io.h>
+#else
+#include <unistd.h> //for fsync
 #endif//_WINDOWS
+#include <algorithm>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -35,6 +38,17 @@ inline i32 fileTruncate(i32 fd, i64 size)
 #endif
 }
 
+//Flushes the stdio buffer, then waits for the OS to put the file on disk.
+//Without the second step a power loss can still reorder or drop the writes.
+inline bool syncFile(FILE* file) {
+    if (fflush(file) != 0) return false;
+#if defined(_WIN32) || defined(_WIN64)
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
 inline i32 sectorsFromBytes(ui32 bytes) {
     // Adding 0.1f to be damn sure the cast is right
     return (i32)(ceil(bytes / (float)SECTOR_SIZE) + 0.1f);
@@ -74,7 +88,6 @@ bool checkZlibError(nString message, int zerror) {
 }
 
 RegionFileManager::RegionFileManager(const nString& saveDir) :
-_copySectorsBuffer(nullptr),
 _maxCacheSize(8),
 m_saveDir(saveDir),
 _regionFile(nullptr) {
@@ -90,11 +103,6 @@ void RegionFileManager::clear() {
         closeRegionFile(_regionFileCacheQueue[i]);
     }
 
-    if (_copySectorsBuffer) {
-        delete[] _copySectorsBuffer;
-        _copySectorsBuffer = nullptr;
-    }
-
     _regionFileCache.clear();
     _regionFileCacheQueue.clear();
     _regionFile = nullptr;
@@ -157,20 +165,24 @@ bool RegionFileManager::openRegionFile(nString region, const ChunkPosition3D& gr
         }
     }
 
-    _regionFile = new RegionFile;
-    memset(_regionFile, 0, sizeof(RegionFile));
+    _regionFile = new RegionFile();
 
     _regionFile->region = region;
     _regionFile->file = file;
 
-    _regionFileCache[region] = _regionFile;
-    _regionFileCacheQueue.push_back(_regionFile);
+    //Only cached once the header and sector map are valid, so a failed open leaves nothing behind
+    auto fail = [this]() {
+        fclose(_regionFile->file);
+        delete _regionFile;
+        _regionFile = nullptr;
+        return false;
+    };
 
     _regionFile->fileDescriptor = _fileno(_regionFile->file); //get file descriptor for truncate if needed
 
     if (fstat(_regionFile->fileDescriptor, &statbuf) != 0) {
         pError("Stat call failed for region file open"); //get the file stats
-        return false;
+        return fail();
     }
     
     _off_t fileSize = statbuf.st_size;
@@ -178,22 +190,28 @@ bool RegionFileManager::openRegionFile(nString region, const ChunkPosition3D& gr
     //If the file is new, write an empty header
     if (fileSize == 0){ 
         //Save the empty header
-        if (saveRegionHeader() == false) return false;
+        if (saveRegionHeader() == false) return fail();
 
         _regionFile->totalSectors = 0;
-        fflush(_regionFile->file);
+        _regionFile->sectorCounts.assign(REGION_SIZE, 0);
+        syncFile(_regionFile->file);
     } else{ //load header data into the header class 
 
-        if (loadRegionHeader() == false) return false;
+        if (loadRegionHeader() == false) return fail();
 
         if ((fileSize - sizeof(RegionFileHeader)) % SECTOR_SIZE){
             pError(filePath + ": Region file chunk storage must be multiple of " + std::to_string(SECTOR_SIZE) + ". Remainder = " + std::to_string(sectorsFromBytes(fileSize - sizeof(RegionFileHeader))));
-            return false;
+            return fail();
         }
 
         _regionFile->totalSectors = sectorsFromBytes(fileSize - sizeof(RegionFileHeader));
+
+        if (buildSectorMap() == false) return fail();
     }
 
+    _regionFileCache[region] = _regionFile;
+    _regionFileCacheQueue.push_back(_regionFile);
+
     return true;
 }
 
@@ -201,8 +219,12 @@ void RegionFileManager::closeRegionFile(RegionFile* regionFile) {
 
     if (regionFile->file == nullptr) return;
 
-    if (_regionFile->isHeaderDirty) {
-        saveRegionHeader();
+    //Other regions were flushed when they stopped being the open one
+    if (regionFile == _regionFile) {
+        if (_regionFile->isHeaderDirty) {
+            saveRegionHeader();
+        }
+        _regionFile = nullptr;
     }
 
     fclose(regionFile->file);
@@ -263,126 +285,258 @@ bool RegionFileManager::tryLoadChunk(Chunk* chunk VORB_UNUSED) {
 //Saves a chunk to a region file
 bool RegionFileManager::saveChunk(Chunk* chunk VORB_UNUSED) {
 
-    ////Used for copying sectors if we need to resize the file
-    //if (_copySectorsBuffer) {
-    //    delete[] _copySectorsBuffer;
-    //    _copySectorsBuffer = nullptr;
-    //}
-
     //nString regionString = getRegionString(chunk);
 
     //if (!openRegionFile(regionString, chunk->gridPosition, true)) return false;
 
     //ui32 tableOffset;
-    //ui32 chunkSectorOffset = getChunkSectorOffset(chunk, &tableOffset);
+    //getChunkSectorOffset(chunk, &tableOffset);
 
-    //i32 numOldSectors;
+    ////Compress the chunk data
+    //rleCompressChunk(chunk);
+    //zlibCompress();
 
-    ////If chunkOffset is zero, then we need to add the entry
-    //if (chunkSectorOffset == 0) {
+    //return writeChunk(tableOffset);
+    return true;
+}
 
-    //    //Set the sector offset in the table
-    //    BufferUtils::setInt(_regionFile->header.lookupTable, tableOffset, _regionFile->totalSectors + 1); //we add 1 so that 0 can indicate not saved
-    //    _regionFile->isHeaderDirty = true;
+bool RegionFileManager::saveChunkData(const nString& region, ui32 chunkIndex, const ui8* data, ui32 size) {
+    if (chunkIndex >= REGION_SIZE) return false;
+    //Leave room for the sector padding written by writeSectors
+    if (size + sizeof(ChunkHeader) + SECTOR_SIZE > sizeof(_compressedByteBuffer)) {
+        pError("Region voxel output buffer overflow");
+        return false;
+    }
 
-    //    chunkSectorOffset = _regionFile->totalSectors;
+    if (!openRegionFile(region, ChunkPosition3D(), true)) return false;
 
-    //    numOldSectors = 0;
-    //  
-    //} else {
-    //    //Convert sector offset from 1 indexed to 0 indexed
-    //    chunkSectorOffset--;
-    //    //seek to the chunk
-    //    if (!seekToChunk(chunkSectorOffset)){
-    //        pError("Region: Chunk data fseek save error BB! " + std::to_string(chunkSectorOffset));
-    //        return false;
-    //    }
+    memcpy(_compressedByteBuffer + sizeof(ChunkHeader), data, size);
+    _compressedBufferSize = size + sizeof(ChunkHeader);
 
-    //    //Get the chunk header
-    //    if (!readChunkHeader()) return false;
-    //    ui32 oldDataLength = BufferUtils::extractInt(_chunkHeader.dataLength);
-    //    numOldSectors = sectorsFromBytes(oldDataLength + sizeof(ChunkHeader));
+    return writeChunk(chunkIndex * 4);
+}
 
-    //    if (numOldSectors > _regionFile->totalSectors) {
-    //        std::cout << (std::to_string(chunkSectorOffset) + " " + std::to_string(tableOffset) + "Chunk Header Corrupted\n");
-    //        return false;
-    //    }
-    //}
+bool RegionFileManager::loadChunkData(const nString& region, ui32 chunkIndex, std::vector<ui8>& data) {
+    if (chunkIndex >= REGION_SIZE) return false;
 
-    ////Compress the chunk data
-    //rleCompressChunk(chunk);
-    //zlibCompress();
+    if (!openRegionFile(region, ChunkPosition3D(), false)) return false;
 
-    //i32 numSectors = sectorsFromBytes(_compressedBufferSize);
-    //i32 sectorDiff = numSectors - numOldSectors;
+    ui32 chunkSectorOffset = BufferUtils::extractInt(_regionFile->header.lookupTable, chunkIndex * 4);
+    //If chunkOffset is zero, it hasnt been saved
+    if (chunkSectorOffset == 0) return false;
 
-    ////If we need to resize the number of sectors in the file and this chunk is not at the end of file,
-    ////then we should copy all sectors at the end of the file so we can resize it. This operation should be
-    ////fairly rare.
-    //if ((sectorDiff != 0) && ((chunkSectorOffset + numOldSectors) != _regionFile->totalSectors)) {
-    //    if (!seekToChunk(chunkSectorOffset + numOldSectors)){
-    //        pError("Region: Failed to seek for sectorCopy " + std::to_string(chunkSectorOffset) + " " + std::to_string(numOldSectors) + " " + std::to_string(_regionFile->totalSectors));
-    //        return false;
-    //    }
+    if (!seekToChunk(chunkSectorOffset - 1)) {
+        pError("Region: Chunk data fseek load error! " + std::to_string(chunkSectorOffset - 1));
+        return false;
+    }
+    if (!readChunkHeader()) return false;
 
-    //    _copySectorsBufferSize = (_regionFile->totalSectors - (chunkSectorOffset + numOldSectors)) * SECTOR_SIZE;
-    //    _copySectorsBuffer = new ui8[_copySectorsBufferSize]; //for storing all the data that will need to be copied in the end
-    //   
-    //    readSectors(_copySectorsBuffer, _copySectorsBufferSize);
-    //}
+    data.resize(BufferUtils::extractInt(_chunkHeader.dataLength));
+    if (data.size() && fread(&data[0], 1, data.size(), _regionFile->file) != data.size()) {
+        pError("Chunk Loading: Did not read enough bytes at B " + std::to_string(data.size()));
+        return false;
+    }
+    return true;
+}
 
-    ////Set the header data
-    //BufferUtils::setInt(_chunkHeader.compression, COMPRESSION_RLE | COMPRESSION_ZLIB);
-    //BufferUtils::setInt(_chunkHeader.timeStamp, 0);
-    //BufferUtils::setInt(_chunkHeader.dataLength, _compressedBufferSize - sizeof(ChunkHeader));
+//Writes the header and data in _compressedByteBuffer for the chunk at tableOffset.
+//The data always goes to freshly allocated sectors and the lookup table entry is only
+//updated once it is on disk, so a crash at any point leaves either the old or the new
+//copy of the chunk reachable. Only the single 4 byte table entry is rewritten.
+bool RegionFileManager::writeChunk(ui32 tableOffset) {
+    ui32 chunkIndex = tableOffset / 4;
+    ui32 oldSectorOffset = BufferUtils::extractInt(_regionFile->header.lookupTable, tableOffset);
+    ui32 numOldSectors = _regionFile->sectorCounts[chunkIndex];
+
+    ui32 numSectors = sectorsFromBytes((ui32)_compressedBufferSize);
+    ui32 chunkSectorOffset = allocateSectors(numSectors);
+
+    //Set the header data
+    BufferUtils::setInt(_chunkHeader.compression, COMPRESSION_RLE | COMPRESSION_ZLIB);
+    BufferUtils::setInt(_chunkHeader.timeStamp, 0);
+    BufferUtils::setInt(_chunkHeader.dataLength, (ui32)_compressedBufferSize - sizeof(ChunkHeader));
+
+    //Copy the header data to the write buffer
+    memcpy(_compressedByteBuffer, &_chunkHeader, sizeof(ChunkHeader));
+
+    //Write the header and data
+    if (!seekToChunk(chunkSectorOffset)) {
+        pError("Region: Chunk data fseek save error GG! " + std::to_string(chunkSectorOffset));
+        freeSectors(chunkSectorOffset, numSectors);
+        return false;
+    }
+    if (!writeSectors(_compressedByteBuffer, (ui32)_compressedBufferSize)) {
+        freeSectors(chunkSectorOffset, numSectors);
+        return false;
+    }
+    //The data must be on disk before the table entry that points at it
+    if (!syncFile(_regionFile->file)) {
+        pError("Region write error: could not sync chunk " + std::to_string(chunkIndex));
+        freeSectors(chunkSectorOffset, numSectors);
+        return false;
+    }
 
-    ////Copy the header data to the write buffer
-    //memcpy(_compressedByteBuffer, &_chunkHeader, sizeof(ChunkHeader));
+    //Commit the new location, we add 1 so that 0 can indicate not saved
+    BufferUtils::setInt(_regionFile->header.lookupTable, tableOffset, chunkSectorOffset + 1);
+    if (!seek(tableOffset) || fwrite(_regionFile->header.lookupTable + tableOffset, 1, 4, _regionFile->file) != 4) {
+        pError("Region write error: could not write table entry " + std::to_string(chunkIndex));
+        //Restore the old entry so the in memory table matches what is on disk
+        BufferUtils::setInt(_regionFile->header.lookupTable, tableOffset, oldSectorOffset);
+        freeSectors(chunkSectorOffset, numSectors);
+        return false;
+    }
+    //And the entry before the old sectors can be overwritten
+    syncFile(_regionFile->file);
 
-    ////seek to the chunk
-    //if (!seekToChunk(chunkSectorOffset)){
-    //    pError("Region: Chunk data fseek save error GG! " + std::to_string(chunkSectorOffset));
-    //    return false;
-    //}
+    //The old copy is unreachable now, so its sectors can be reused
+    if (oldSectorOffset != 0) freeSectors(oldSectorOffset - 1, numOldSectors);
+    _regionFile->sectorCounts[chunkIndex] = (ui16)numSectors;
 
-    ////Write the header and data
-    //writeSectors(_compressedByteBuffer, (ui32)_compressedBufferSize);
+    return true;
+}
 
-    ////Keep track of total sectors in file so we can infer filesize
-    //_regionFile->totalSectors += sectorDiff;
+//Marks the sectors of every saved chunk as used
+bool RegionFileManager::buildSectorMap() {
+    _regionFile->sectorUsed.assign(_regionFile->totalSectors, false);
+    _regionFile->sectorCounts.assign(REGION_SIZE, 0);
 
-    ////If we need to move some sectors around
-    //if (_copySectorsBuffer) {
-   
-    //    if (!seekToChunk(chunkSectorOffset + numSectors)){
-    //        pError("Region: Chunk data fseek save error GG! " + std::to_string(chunkSectorOffset));
-    //        return false;
-    //    }
-    //    //Write the buffer of sectors
-    //    writeSectors(_copySectorsBuffer, _copySectorsBufferSize);
-    //    delete[] _copySectorsBuffer;
-    //    _copySectorsBuffer = nullptr;
-
-    //    //if the file got smaller
-    //    if (sectorDiff < 0){
-    //        //truncate the file
-    //        if (fileTruncate(_regionFile->fileDescriptor, sizeof(RegionFileHeader)+_regionFile->totalSectors * SECTOR_SIZE) != 0) {
-    //            perror("Region file: Truncate error!\n");
-    //        }
-    //    }
+    for (ui32 i = 0; i < REGION_SIZE; i++) {
+        ui32 chunkSectorOffset = BufferUtils::extractInt(_regionFile->header.lookupTable, i * 4);
+        if (chunkSectorOffset == 0) continue;
+        //Convert sector offset from 1 indexed to 0 indexed
+        chunkSectorOffset--;
 
-    //    //Update the table
-    //    ui32 nextChunkSectorOffset;
-    //    for (int i = 0; i < REGION_SIZE * 4; i += 4){
-    //        nextChunkSectorOffset = BufferUtils::extractInt(_regionFile->header.lookupTable, i);
-    //        //See if the 1 indexed nextChunkSectorOffset is > the 0 indexed chunkSectorOffset
-    //        if (nextChunkSectorOffset > (chunkSectorOffset + 1)){ 
-    //            BufferUtils::setInt(_regionFile->header.lookupTable, i, nextChunkSectorOffset + sectorDiff);
-    //        } 
-    //    }
-    //    _regionFile->isHeaderDirty = true;
-    //}
-    //fflush(_regionFile->file);
+        if (!seekToChunk(chunkSectorOffset) || !readChunkHeader()) {
+            pError("Region: Could not read chunk header " + std::to_string(i) + " at sector " + std::to_string(chunkSectorOffset));
+            return false;
+        }
+        ui32 numSectors = sectorsFromBytes(BufferUtils::extractInt(_chunkHeader.dataLength) + sizeof(ChunkHeader));
+        if (chunkSectorOffset + numSectors > (ui32)_regionFile->totalSectors) {
+            pError("Region: Chunk header corrupted " + std::to_string(i) + " " + std::to_string(chunkSectorOffset) + " " + std::to_string(numSectors));
+            return false;
+        }
+
+        for (ui32 s = chunkSectorOffset; s < chunkSectorOffset + numSectors; s++) {
+            _regionFile->sectorUsed[s] = true;
+        }
+        _regionFile->sectorCounts[i] = (ui16)numSectors;
+    }
+
+    _regionFile->firstFreeSector = 0;
+    while (_regionFile->firstFreeSector < _regionFile->sectorUsed.size() && _regionFile->sectorUsed[_regionFile->firstFreeSector]) {
+        _regionFile->firstFreeSector++;
+    }
+    return true;
+}
+
+//Finds the first run of numSectors free sectors, growing the file if there is none.
+//Returns the 0 indexed sector offset
+ui32 RegionFileManager::allocateSectors(ui32 numSectors) {
+    std::vector<bool>& used = _regionFile->sectorUsed;
+
+    ui32 runStart = _regionFile->firstFreeSector;
+    ui32 runLength = 0;
+    for (ui32 i = runStart; i < used.size() && runLength < numSectors; i++) {
+        if (used[i]) {
+            runStart = i + 1;
+            runLength = 0;
+        } else {
+            runLength++;
+        }
+    }
+    //A free run at the end of the file can simply be extended
+    if (runStart + numSectors > used.size()) {
+        used.resize(runStart + numSectors, false);
+        _regionFile->totalSectors = (i32)used.size();
+    }
+
+    for (ui32 i = runStart; i < runStart + numSectors; i++) {
+        used[i] = true;
+    }
+    while (_regionFile->firstFreeSector < used.size() && used[_regionFile->firstFreeSector]) {
+        _regionFile->firstFreeSector++;
+    }
+    return runStart;
+}
+
+void RegionFileManager::freeSectors(ui32 sectorOffset, ui32 numSectors) {
+    for (ui32 i = sectorOffset; i < sectorOffset + numSectors && i < _regionFile->sectorUsed.size(); i++) {
+        _regionFile->sectorUsed[i] = false;
+    }
+    if (sectorOffset < _regionFile->firstFreeSector) _regionFile->firstFreeSector = sectorOffset;
+}
+
+bool RegionFileManager::compactRegionFile(const nString& region) {
+
+    if (!openRegionFile(region, ChunkPosition3D(), false)) return false;
+
+    nString filePath = m_saveDir + "/Region/" + region + ".soar";
+    nString tmpPath = filePath + ".tmp";
+
+    //Copy chunks in file order so the reads stay sequential
+    std::vector<ui32> order;
+    order.reserve(REGION_SIZE);
+    for (ui32 i = 0; i < REGION_SIZE; i++) {
+        if (BufferUtils::extractInt(_regionFile->header.lookupTable, i * 4)) order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](ui32 a, ui32 b) {
+        return BufferUtils::extractInt(_regionFile->header.lookupTable, a * 4) <
+               BufferUtils::extractInt(_regionFile->header.lookupTable, b * 4);
+    });
+
+    //Chunks are packed back to back, so the new table is known up front
+    std::vector<ui8> lookupTable(sizeof(RegionFileHeader), 0);
+    ui32 nextSector = 0;
+    for (ui32 i : order) {
+        BufferUtils::setInt(&lookupTable[0], i * 4, nextSector + 1);
+        nextSector += _regionFile->sectorCounts[i];
+    }
+
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    if (file == nullptr) {
+        perror(tmpPath.c_str());
+        pError("Failed to create compacted region file");
+        return false;
+    }
+
+    bool success = fwrite(&lookupTable[0], 1, lookupTable.size(), file) == lookupTable.size();
+    std::vector<ui8> sectors;
+    for (size_t i = 0; i < order.size() && success; i++) {
+        ui32 chunkSectorOffset = BufferUtils::extractInt(_regionFile->header.lookupTable, order[i] * 4) - 1;
+        sectors.resize(_regionFile->sectorCounts[order[i]] * SECTOR_SIZE);
+        success = seekToChunk(chunkSectorOffset) && readSectors(&sectors[0], (ui32)sectors.size()) &&
+                  fwrite(&sectors[0], 1, sectors.size(), file) == sectors.size();
+    }
+    //The copy must be on disk before it replaces the original
+    success = syncFile(file) && success;
+    fclose(file);
+
+    if (!success) {
+        pError("Region: Compaction of " + region + " failed, keeping the original file");
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    //Close the region before replacing it
+    _regionFileCache.erase(region);
+    for (auto it = _regionFileCacheQueue.begin(); it != _regionFileCacheQueue.end(); it++) {
+        if (*it == _regionFile) {
+            _regionFileCacheQueue.erase(it);
+            break;
+        }
+    }
+    closeRegionFile(_regionFile);
+    _regionFile = nullptr;
+
+    //rename replaces the file atomically on POSIX, so a crash leaves one complete copy
+#ifdef _WINDOWS
+    remove(filePath.c_str());
+#endif//_WINDOWS
+    if (rename(tmpPath.c_str(), filePath.c_str()) != 0) {
+        perror(filePath.c_str());
+        pError("Region: Could not replace " + filePath + " with its compacted copy");
+        return false;
+    }
     return true;
 }
 
@@ -390,7 +544,7 @@ void RegionFileManager::flush() {
     if (_regionFile && _regionFile->file) {
         if (_regionFile->isHeaderDirty) {
             saveRegionHeader();
-            fflush(_regionFile->file);
+            syncFile(_regionFile->file);
         }  
     }
 }
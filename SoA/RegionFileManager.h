@@ -1,6 +1,7 @@
 #pragma once
 #include <deque>
 #include <map>
+#include <vector>
 
 #include <zconf.h>
 #include <Vorb/Vorb.h>
@@ -49,6 +50,12 @@ class RegionFile {
     int fileDescriptor;
     i32 totalSectors;
     bool isHeaderDirty;
+    //One bit per sector, set when a chunk occupies it. Rebuilt from the chunk headers on open
+    std::vector<bool> sectorUsed;
+    //Number of sectors each lookup table entry occupies
+    std::vector<ui16> sectorCounts;
+    //There are no free sectors before this one
+    ui32 firstFreeSector;
 };
 
 class SaveVersion {
@@ -71,6 +78,15 @@ class RegionFileManager {
     bool tryLoadChunk(Chunk* chunk);
     bool saveChunk(Chunk* chunk);
 
+    //Saves an already compressed chunk payload to slot chunkIndex of a region
+    bool saveChunkData(const nString& region, ui32 chunkIndex, const ui8* data, ui32 size);
+    //Loads the payload stored in slot chunkIndex of a region. Returns false if it was never saved
+    bool loadChunkData(const nString& region, ui32 chunkIndex, std::vector<ui8>& data);
+
+    //Rewrites a region file with all of its chunks packed at the front, reclaiming holes.
+    //Meant to run offline, the region is closed afterwards
+    bool compactRegionFile(const nString& region);
+
     void flush();
 
     bool saveVersionFile();
@@ -88,6 +104,11 @@ class RegionFileManager {
     bool saveRegionHeader();
     bool loadRegionHeader();
 
+    bool buildSectorMap();
+    ui32 allocateSectors(ui32 numSectors);
+    void freeSectors(ui32 sectorOffset, ui32 numSectors);
+    bool writeChunk(ui32 tableOffset);
+
     void rleCompressArray(ui8* data, int jStart, int jMult, int jEnd, int jInc, int kStart, int kMult, int kEnd, int kInc);
     void rleCompressArray(ui16* data, int jStart, int jMult, int jEnd, int jInc, int kStart, int kMult, int kEnd, int kInc);
     bool rleCompressChunk(Chunk* chunk);
@@ -110,9 +131,6 @@ class RegionFileManager {
     //Byte buffer for compressed data. It is slightly larger because of worst case with RLE
     uLongf _compressedBufferSize;
     ui8 _compressedByteBuffer[CHUNK_DATA_SIZE + CHUNK_SIZE * 4 + sizeof(ChunkHeader)];
-    //Dynamic byte buffer used in copying contents of a file for resize
-//    ui32 _copySectorsBufferSize;
-    ui8* _copySectorsBuffer;
 
 //    ui16 _blockIDBuffer[CHUNK_SIZE];
 //    ui8 _sunlightBuffer[CHUNK_SIZE];
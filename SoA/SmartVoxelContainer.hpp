@@ -19,7 +19,7 @@
 
 #include "Constants.h"
 
-#include <Vorb/FixedSizeArrayRecycler.hpp>
+#include "VoxelArrayRecycler.hpp"
 #include <Vorb/voxel/IntervalTree.h>
 
 #define QUIET_FRAMES_UNTIL_COMPRESS 60
@@ -83,7 +83,7 @@ namespace vorb {
             *
             * @param arrayRecycler: The recycler to be used in place of the default generated recycler.
             */
-            SmartVoxelContainer(vcore::FixedSizeArrayRecycler<SIZE, T>* arrayRecycler) {
+            SmartVoxelContainer(VoxelArrayRecycler<SIZE, T>* arrayRecycler) {
                 setArrayRecycler(arrayRecycler);
             }
 
@@ -91,7 +91,7 @@ namespace vorb {
             *
             * @param arrayRecycler: The recycler to be used in place of the default generated recycler.
             */
-            void setArrayRecycler(vcore::FixedSizeArrayRecycler<SIZE, T>* arrayRecycler) {
+            void setArrayRecycler(VoxelArrayRecycler<SIZE, T>* arrayRecycler) {
                 _arrayRecycler = arrayRecycler;
             }
 
@@ -301,7 +301,7 @@ namespace vorb {
 
             VoxelStorageState _state = VoxelStorageState::FLAT_ARRAY; ///< Current data structure state
 
-            vcore::FixedSizeArrayRecycler<CHUNK_SIZE, T>* _arrayRecycler = nullptr; ///< For recycling the voxel arrays
+            VoxelArrayRecycler<SIZE, T>* _arrayRecycler = nullptr; ///< For recycling the voxel arrays
         };
 
         /*template<typename T, size_t SIZE>
@@ -20,6 +20,7 @@
 
 #include "BlockPack.h"
 #include "ChunkAllocator.h"
+#include "ChunkResidencyManager.h"
 #include "ClientState.h"
 #include "Item.h"
 
@@ -41,6 +42,7 @@ struct SoaState {
 
     // TODO(Ben): Clean up this dumping ground
     PagedChunkAllocator chunkAllocator;
+    ChunkResidencyManager chunkResidency;
 
     ECSTemplateLibrary templateLib;
     
@@ -93,6 +93,7 @@ void SoaEngine::initState(SoaState* state) {
 
     // TODO(Ben): Move somewhere else
     initClientState(state, state->clientState);
+    state->chunkResidency.init(&state->chunkAllocator, state->clientState.chunkMeshManager);
 }
 
 void SoaEngine::initClientState(SoaState* soaState, ClientState& state) {
@@ -106,7 +107,7 @@ void SoaEngine::initClientState(SoaState* soaState, ClientState& state) {
     // TODO(Ben): Don't hardcode this. Load a texture pack file
     state.blockTextures = new BlockTexturePack;
     state.blockTextures->init(32, 4096);
-    state.blockTextureLoader.init(&state.texturePathResolver, state.blockTextures);
+    state.blockTextureLoader.init(&state.texturePathResolver, state.blockTextures, soaState->threadPool);
 }
 
 bool SoaEngine::loadSpaceSystem(SoaState* state, const nString& filePath) {
@@ -435,6 +436,7 @@ void SoaEngine::destroyAll(SoaState* state) {
     delete state->gameSystem;
     delete state->systemIoManager;
     delete state->options;
+    state->chunkResidency.dispose();
     destroyClientState(state->clientState);
     destroyGameSystem(state);
     destroySpaceSystem(state);
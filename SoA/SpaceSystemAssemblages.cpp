@@ -1,6 +1,8 @@
 #include "stdafx.h"
 #include "SpaceSystemAssemblages.h"
 
+#include "BlockUpdateScheduler.h"
+#include "LiquidSimulation.h"
 #include "ChunkGrid.h"
 #include "ChunkIOManager.h"
 #include "ChunkAllocator.h"
@@ -270,6 +272,17 @@ vecs::ComponentID SpaceSystemAssemblages::addSphericalVoxelComponent(SpaceSystem
     for (int i = 0; i < 6; i++) {
         svcmp.chunkGrids[i].init(static_cast<WorldCubeFace>(i), svcmp.threadPool, 1, ftcmp.planetGenData, &soaState->chunkAllocator);
         svcmp.chunkGrids[i].blockPack = &soaState->blocks;
+        svcmp.chunkGrids[i].edits.init(static_cast<WorldCubeFace>(i), svcmp.chunkIo);
+    }
+    svcmp.blockUpdaters = new BlockUpdateScheduler[6];
+    for (int i = 0; i < 6; i++) {
+        svcmp.blockUpdaters[i].init(&svcmp.chunkGrids[i], &soaState->blocks, svcmp.threadPool);
+    }
+    if (soaState->blocks.getLiquid().numLevels) {
+        svcmp.liquidSimulations = new LiquidSimulation[6];
+        for (int i = 0; i < 6; i++) {
+            svcmp.liquidSimulations[i].init(&svcmp.chunkGrids[i], soaState->blocks.getLiquid(), svcmp.threadPool, LIQUID_CHUNKS_PER_BATCH);
+        }
     }
 
     svcmp.planetGenData = ftcmp.planetGenData;
@@ -351,8 +364,6 @@ vecs::ComponentID SpaceSystemAssemblages::addStarComponent(SpaceSystem* spaceSys
     sCmp.radius = radius;
     sCmp.temperature = temperature;
     sCmp.mass = mass;
-    sCmp.occlusionQuery[0] = 0;
-    sCmp.occlusionQuery[1] = 0;
 
     return sCmpId;
 }
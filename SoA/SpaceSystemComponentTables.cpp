@@ -4,10 +4,12 @@
 #include <Vorb/graphics/GpuMemory.h>
 #include <Vorb/graphics/ShaderManager.h>
 
+#include "BlockUpdateScheduler.h"
 #include "ChunkAllocator.h"
 #include "ChunkIOManager.h"
 #include "FarTerrainPatch.h"
 #include "ChunkGrid.h"
+#include "LiquidSimulation.h"
 #include "PlanetGenData.h"
 #include "SphericalHeightmapGenerator.h"
 #include "TerrainPatch.h"
@@ -17,7 +19,24 @@ void SphericalVoxelComponentTable::disposeComponent(vecs::ComponentID cID, vecs:
     SphericalVoxelComponent& cmp = _components[cID].second;
     // Let the threadpool finish
     while (cmp.threadPool->getTasksSizeApprox() > 0);
+    // Player edits are all that is saved of the chunks
+    if (cmp.chunkGrids) {
+        for (int i = 0; i < 6; i++) {
+            cmp.chunkGrids[i].edits.save();
+            // Running generate tasks may still be loading through chunkIo
+            cmp.chunkGrids[i].edits.dispose();
+        }
+    }
     delete cmp.chunkIo;
+    // They hold chunks of the grids
+    if (cmp.blockUpdaters) {
+        for (int i = 0; i < 6; i++) cmp.blockUpdaters[i].dispose();
+        delete[] cmp.blockUpdaters;
+    }
+    if (cmp.liquidSimulations) {
+        for (int i = 0; i < 6; i++) cmp.liquidSimulations[i].dispose();
+        delete[] cmp.liquidSimulations;
+    }
     delete[] cmp.chunkGrids;
     cmp = _components[0].second;
 }
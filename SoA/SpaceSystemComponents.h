@@ -33,9 +33,11 @@
 #include "ChunkGrid.h"
 
 class BlockPack;
+class BlockUpdateScheduler;
 class ChunkIOManager;
 class ChunkManager;
 class FarTerrainPatch;
+class LiquidSimulation;
 class PagedChunkAllocator;
 class ParticleEngine;
 class PhysicsEngine;
@@ -129,14 +131,6 @@ struct OrbitComponent {
     f32v4 pathColor[2]; ///< Color of the path
     vecs::ComponentID npID = 0; ///< Component ID of NamePosition component
     vecs::ComponentID parentOrbId = 0; ///< Component ID of parent OrbitComponent
-    VGBuffer vbo = 0; ///< vbo for the ellipse mesh
-    VGBuffer vao = 0; ///< vao for the ellipse mesh
-    ui32 numVerts = 0; ///< Number of vertices in the ellipse
-    struct Vertex {
-        f32v3 position;
-        f32 angle;
-    };
-    std::vector<Vertex> verts; ///< Vertices for the ellipse
     f32 currentMeanAnomaly;
     SpaceObjectType type; ///< Type of object
     bool isCalculated = false; ///< True when orbit has been calculated
@@ -167,6 +161,8 @@ KEG_TYPE_DECL(SphericalGravityComponent);
 
 struct SphericalVoxelComponent {
     ChunkGrid* chunkGrids = nullptr; // should be size 6, one for each face
+    BlockUpdateScheduler* blockUpdaters = nullptr; // should be size 6, one for each face
+    LiquidSimulation* liquidSimulations = nullptr; // size 6 like blockUpdaters, nullptr if blockPack has no liquid
     ChunkIOManager* chunkIo = nullptr;
 
     SphericalHeightmapGenerator* generator = nullptr;
@@ -189,7 +185,7 @@ struct SphericalVoxelComponent {
 
     f64 voxelRadius = 0; ///< Radius of the planet in voxels
     int refCount = 1;
-    ui32 updateCount = 0;
+    ui32 updateCount = 0; ///< Counts to CHUNK_EDITS_SAVE_INTERVAL
 };
 KEG_TYPE_DECL(SphericalVoxelComponent);
 
@@ -236,7 +232,6 @@ struct StarComponent {
     f64 mass = 0.0; ///< In KG
     f64 radius = 0.0; ///< In KM
     f64 temperature = 0.0; ///< In kelvin
-    VGQuery occlusionQuery[2]; ///< TODO(Ben): Delete this
     f32 visibility = 1.0;
 };
 typedef vecs::ComponentTable<StarComponent> StarComponentTable;
@@ -4,7 +4,6 @@
 #include "Constants.h"
 #include "Errors.h"
 #include "SoaOptions.h"
-#include "OrbitComponentUpdater.h"
 #include "PlanetGenData.h"
 #include "PlanetGenLoader.h"
 #include "ProgramGenDelegate.h"
@@ -354,30 +353,5 @@ void SpaceSystemLoader::calculateOrbit(vecs::EntityID entity, f64 parentMass,
         }
     }
 
-    { // Make the ellipse mesh with stepwise simulation
-        OrbitComponentUpdater updater;
-        static const int NUM_VERTS = 2880;
-        orbitC.verts.resize(NUM_VERTS + 1);
-        f64 timePerDeg = orbitC.t / (f64)NUM_VERTS;
-        NamePositionComponent& npCmp = m_spaceSystem->namePosition.get(orbitC.npID);
-        f64v3 startPos = npCmp.position;
-        for (int i = 0; i < NUM_VERTS; i++) {
-
-            if (orbitC.parentOrbId) {
-                OrbitComponent* pOrbC = &m_spaceSystem->orbit.get(orbitC.parentOrbId);
-                updater.updatePosition(orbitC, i * timePerDeg, &npCmp,
-                                       pOrbC,
-                                       &m_spaceSystem->namePosition.get(pOrbC->npID));
-            } else {
-                updater.updatePosition(orbitC, i * timePerDeg, &npCmp);
-            }
-
-            OrbitComponent::Vertex vert;
-            vert.position = npCmp.position;
-            vert.angle = 1.0f - (f32)i / (f32)NUM_VERTS;
-            orbitC.verts[i] = vert;
-        }
-        orbitC.verts.back() = orbitC.verts.front();
-        npCmp.position = startPos;
-    }
+    // The path itself is solved on the GPU by OrbitComponentRenderer
 }
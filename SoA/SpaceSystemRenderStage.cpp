@@ -322,12 +322,13 @@ void SpaceSystemRenderStage::drawBodies() {
         f32v3 fRelCamPos(relCamPos);
 
         // Render the star
-        m_starRenderer.updateOcclusionQuery(sCmp, zCoef, m_spaceCamera->getViewProjectionMatrix(), relCamPos);
+        m_starRenderer.updateOcclusionQuery(it.first, sCmp, zCoef, m_spaceCamera->getViewProjectionMatrix(), relCamPos);
         m_starRenderer.drawStar(sCmp, m_spaceCamera->getViewProjectionMatrix(), f64q(), fRelCamPos, zCoef);
         m_starRenderer.drawCorona(sCmp, m_spaceCamera->getViewProjectionMatrix(), m_spaceCamera->getViewMatrix(), fRelCamPos, zCoef);
         
         m_starGlowsToRender.emplace_back(sCmp, relCamPos);
     }
+    m_starRenderer.pruneOcclusionQueries();
 
     glDisable(GL_DEPTH_CLAMP);
     vg::DepthState::FULL.set();
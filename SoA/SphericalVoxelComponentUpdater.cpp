@@ -3,6 +3,7 @@
 
 #include <SDL2/SDL_timer.h> // For SDL_GetTicks
 
+#include "BlockUpdateScheduler.h"
 #include "Chunk.h"
 #include "ChunkAllocator.h"
 #include "ChunkGrid.h"
@@ -13,6 +14,7 @@
 #include "ChunkUpdater.h"
 #include "GameSystem.h"
 #include "GenerateTask.h"
+#include "LiquidSimulation.h"
 #include "PlanetGenData.h"
 #include "SoaOptions.h"
 #include "SoAState.h"
@@ -41,6 +43,14 @@ void SphericalVoxelComponentUpdater::updateComponent(SphericalVoxelComponent& cm
     for (int i = 0; i < 6; i++) {
         updateChunks(cmp.chunkGrids[i], true);
         cmp.chunkGrids[i].update();
+        if (cmp.blockUpdaters) cmp.blockUpdaters[i].update();
+        if (cmp.liquidSimulations) cmp.liquidSimulations[i].update();
+    }
+    // Player edits are all that is saved of the chunks, so a crash shouldn't lose all of them.
+    // Saves are on this thread, like the one on dispose, and only write chunks edited since the last.
+    if (++cmp.updateCount >= CHUNK_EDITS_SAVE_INTERVAL) {
+        cmp.updateCount = 0;
+        for (int i = 0; i < 6; i++) cmp.chunkGrids[i].edits.save();
     }
 }
 
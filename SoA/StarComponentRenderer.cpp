@@ -203,7 +203,8 @@ void StarComponentRenderer::drawGlow(const StarComponent& sCmp,
     m_glowProgram.unuse();
 }
 
-void StarComponentRenderer::updateOcclusionQuery(StarComponent& sCmp,
+void StarComponentRenderer::updateOcclusionQuery(vecs::EntityID entity,
+                                                 StarComponent& sCmp,
                                                  const f32 zCoef,
                                                  const f32m4& VP,
                                                  const f64v3& relCamPos) {
@@ -217,19 +218,27 @@ void StarComponentRenderer::updateOcclusionQuery(StarComponent& sCmp,
         glVertexAttribPointer(m_occlusionProgram.getAttribute("vPosition"), 2, GL_FLOAT, GL_FALSE, 0, 0);
         glBindVertexArray(0);
     }
-    if (sCmp.occlusionQuery[0] == 0) {
-        glGenQueries(2, sCmp.occlusionQuery);
+    // Results arrive a few frames late, but waiting on them would stall the pipeline
+    // Kept here rather than in the component so dispose can delete them
+    StarOcclusion& occlusion = m_occlusionQueries[entity];
+    occlusion.isUpdated = true;
+    QueryReadback& queries = occlusion.queries;
+    if (!queries.isInitialized()) {
+        queries.init(GL_SAMPLES_PASSED, 2);
     } else {
-        int totalSamples = 0;
-        int passedSamples = 0;
-        glGetQueryObjectiv(sCmp.occlusionQuery[0], GL_QUERY_RESULT, &totalSamples);
-        glGetQueryObjectiv(sCmp.occlusionQuery[1], GL_QUERY_RESULT, &passedSamples);
-        if (passedSamples == 0) {
-            sCmp.visibility = 0.0f;
-        } else {
-            sCmp.visibility = (f32)passedSamples / (f32)totalSamples;
+        GLint samples[2];
+        while (queries.poll(samples)) {
+            // samples[0] is total, samples[1] is passed
+            if (samples[1] == 0) {
+                sCmp.visibility = 0.0f;
+            } else {
+                sCmp.visibility = (f32)samples[1] / (f32)samples[0];
+            }
         }
     }
+    // Every query is still in flight, keep the last visibility
+    if (!queries.beginFrame()) return;
+
     // Have to calculate on the CPU since we need 64 bit precision. Otherwise
     // we get the "phantom star" bug.
     f64v4 pos(-relCamPos, 1.0);
@@ -257,15 +266,16 @@ void StarComponentRenderer::updateOcclusionQuery(StarComponent& sCmp,
     glBindVertexArray(m_oVao);
 
     glDepthMask(GL_FALSE);
-    glBeginQuery(GL_SAMPLES_PASSED, sCmp.occlusionQuery[0]);
+    queries.beginQuery(0);
     glDisable(GL_DEPTH_TEST);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LEQUAL);
-    glEndQuery(GL_SAMPLES_PASSED);
-    glBeginQuery(GL_SAMPLES_PASSED, sCmp.occlusionQuery[1]);
+    queries.endQuery();
+    queries.beginQuery(1);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
-    glEndQuery(GL_SAMPLES_PASSED);
+    queries.endQuery();
+    queries.endFrame();
     glDepthMask(GL_TRUE);
     glDepthFunc(GL_LESS);
 
@@ -274,9 +284,24 @@ void StarComponentRenderer::updateOcclusionQuery(StarComponent& sCmp,
     m_occlusionProgram.unuse();
 }
 
+void StarComponentRenderer::pruneOcclusionQueries() {
+    // Removed stars stop being updated, and their entities can be reused
+    for (auto it = m_occlusionQueries.begin(); it != m_occlusionQueries.end();) {
+        if (it->second.isUpdated) {
+            it->second.isUpdated = false;
+            ++it;
+        } else {
+            it->second.queries.dispose();
+            it = m_occlusionQueries.erase(it);
+        }
+    }
+}
+
 void StarComponentRenderer::dispose() {
     disposeShaders();
     disposeBuffers();
+    for (auto& it : m_occlusionQueries) it.second.queries.dispose();
+    std::unordered_map<vecs::EntityID, StarOcclusion>().swap(m_occlusionQueries);
     if (m_tempColorMap.data) {
         vg::ImageIO().free(m_tempColorMap);
         m_tempColorMap.data = nullptr;
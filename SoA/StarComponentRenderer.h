@@ -24,6 +24,8 @@
 #include <Vorb/script/Environment.h>
 #include <Vorb/script/Function.h>
 
+#include "GpuReadback.h"
+
 class ModPathResolver;
 
 struct StarComponent;
@@ -53,10 +55,13 @@ class StarComponentRenderer {
                   const f32v3& viewDirW,
                   const f32v3& viewRightW,
                   const f32v3& colorMult = f32v3(1.0f));
-    void updateOcclusionQuery(StarComponent& sCmp,
+    void updateOcclusionQuery(vecs::EntityID entity,
+                              StarComponent& sCmp,
                               const f32 zCoef,
                               const f32m4& VP,
                               const f64v3& relCamPos);
+    /// Deletes the queries of stars that weren't updated since the last call
+    void pruneOcclusionQueries();
 
     void dispose();
     void disposeShaders();
@@ -89,6 +94,11 @@ class StarComponentRenderer {
     VGVertexArray m_gVao = 0;
     // Occlusion
     VGVertexArray m_oVao = 0;
+    struct StarOcclusion {
+        QueryReadback queries; ///< Total and passed samples
+        bool isUpdated = false; ///< Since the last pruneOcclusionQueries
+    };
+    std::unordered_map<vecs::EntityID, StarOcclusion> m_occlusionQueries; ///< Per star entity
     
     vg::BitmapResource m_tempColorMap;
     VGTexture m_glowColorMap = 0;
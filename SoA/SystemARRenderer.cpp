@@ -17,26 +17,57 @@
 #include <Vorb/utils.h>
 
 namespace {
+    // Orbit paths are solved per vertex from instanced orbital elements,
+    // with the same math as OrbitComponentUpdater
     const cString VERT_SRC = R"(
-uniform mat4 unWVP;
-in vec4 vPosition;
-in float vAngle;
+uniform mat4 unVP;
+uniform float unMeanAnomalyPerPeriod;
+in float vFraction;
+in vec4 vShape; // a, e, i, o
+in vec4 vPhase; // p, startMeanAnomaly, currentAngle
+in vec3 vOffset;
+in vec4 vColor;
 out float fAngle;
+out float fCurrentAngle;
+out vec4 fColor;
 #include "Shaders/Utils/logz.glsl"
 void main() {
-    fAngle = vAngle;
-    gl_Position = unWVP * vPosition;
+    float e = vShape.y;
+    float meanAnomaly = unMeanAnomalyPerPeriod * vFraction + vPhase.y;
+    // Newton's method for the eccentric anomaly
+    float E = meanAnomaly;
+    float F = E - e * sin(meanAnomaly) - meanAnomaly;
+    for (int n = 0; n < 3; n++) {
+        E = E - F / (1.0 - e * cos(E));
+        F = E - e * sin(E) - meanAnomaly;
+    }
+    float v = atan(sqrt(1.0 - e * e) * sin(E), cos(E) - e);
+    float r = vShape.x * (1.0 - e * e) / (1.0 + e * cos(v));
+    float cosv = cos(v + vPhase.x - vShape.w);
+    float sinv = sin(v + vPhase.x - vShape.w);
+    float coso = cos(vShape.w);
+    float sino = sin(vShape.w);
+    float cosi = cos(vShape.z);
+    float sini = sin(vShape.z);
+    vec3 position = r * vec3(coso * cosv - sino * sinv * cosi,
+                             sinv * sini,
+                             sino * cosv + coso * sinv * cosi);
+
+    fAngle = 1.0 - vFraction;
+    fCurrentAngle = vPhase.z;
+    fColor = vColor;
+    gl_Position = unVP * vec4(position + vOffset, 1.0);
     applyLogZ();
 }
 )";
 
     const cString FRAG_SRC = R"(
-uniform vec4 unColor;
-uniform float currentAngle;
 in float fAngle;
+in float fCurrentAngle;
+in vec4 fColor;
 out vec4 pColor;
 void main() {
-    pColor = unColor * vec4(1.0, 1.0, 1.0, 1.0 - mod(fAngle + currentAngle, 1.0));
+    pColor = fColor * vec4(1.0, 1.0, 1.0, 1.0 - mod(fAngle + fCurrentAngle, 1.0));
 }
 )";
 }
@@ -83,6 +114,7 @@ void SystemARRenderer::dispose() {
     if (m_colorProgram.isCreated()) {
         m_colorProgram.dispose();
     }
+    m_orbitComponentRenderer.dispose();
   
     if (m_spriteBatch) {
         m_spriteBatch->dispose();
@@ -157,16 +189,16 @@ void SystemARRenderer::drawPaths() {
 
         if (cmp.parentOrbId) {
             OrbitComponent& pOrbCmp = m_spaceSystem->orbit.get(cmp.parentOrbId);
-            m_orbitComponentRenderer.drawPath(cmp, m_colorProgram, wvp, &m_spaceSystem->namePosition.getFromEntity(it.first),
-                                              m_camera->getPosition(), blendFactor, &m_spaceSystem->namePosition.get(pOrbCmp.npID));
+            m_orbitComponentRenderer.addPath(cmp, m_camera->getPosition(), blendFactor,
+                                             &m_spaceSystem->namePosition.get(pOrbCmp.npID));
         } else {
-            m_orbitComponentRenderer.drawPath(cmp, m_colorProgram, wvp, &m_spaceSystem->namePosition.getFromEntity(it.first),
-                                              m_camera->getPosition(), blendFactor);
+            m_orbitComponentRenderer.addPath(cmp, m_camera->getPosition(), blendFactor);
         }
 
         // Restore path color
         if (isSelected) cmp.pathColor[0] = oldPathColor;
     }
+    m_orbitComponentRenderer.drawPaths(m_colorProgram, wvp);
     m_colorProgram.disableVertexAttribArrays();
     m_colorProgram.unuse();
 }
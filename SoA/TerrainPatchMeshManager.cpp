@@ -132,24 +132,29 @@ void TerrainPatchMeshManager::drawSphericalMeshes(const f64v3& relativePos,
                 m = m_meshes.back();
                 m_meshes.pop_back();
             } else {
-                /// Use bounding box to find closest point
-                f64v3 closestPoint = m->getClosestPoint(rotpos);
-                
-                // Check horizon culling first, it's more likely to cull spherical patches
-                if (!TerrainPatch::isOverHorizon(rotpos, closestPoint,
-                    m_planetGenData->radius)) {
-                    // Check frustum culling
-                    // TODO(Ben): There could be a way to reduce the number of frustum checks
-                    // via caching or checking a parent
-                    f32v3 relSpherePos = orientationF32 * m->m_aabbCenter - f32v3(relativePos);
-                    if (camera->sphereInFrustum(relSpherePos,
-                        m->m_boundingSphereRadius)) {
-                        m->draw(WVP, program, drawSkirts);
-                    }
-                }
                 i++;
             }
         }
+
+        // Frustum cull the whole list at once, then horizon cull what is left
+        // TODO(Ben): There could be a way to reduce the number of frustum checks
+        // via caching or checking a parent
+        m_cullSpheres.clear();
+        for (auto& m : m_meshes) {
+            m_cullSpheres.add(orientationF32 * m->m_aabbCenter, m->m_boundingSphereRadius);
+        }
+        m_visibleIndices.clear();
+        camera->getFrustum().cullSpheres(m_cullSpheres, f32v3(relativePos), 0, m_cullSpheres.size(), m_visibleIndices);
+
+        for (auto& i : m_visibleIndices) {
+            auto& m = m_meshes[i];
+            /// Use bounding box to find closest point
+            f64v3 closestPoint = m->getClosestPoint(rotpos);
+            if (!TerrainPatch::isOverHorizon(rotpos, closestPoint,
+                m_planetGenData->radius)) {
+                m->draw(WVP, program, drawSkirts);
+            }
+        }
         program.disableVertexAttribArrays();
         program.unuse();
     }
@@ -307,22 +312,29 @@ void TerrainPatchMeshManager::drawFarMeshes(const f64v3& relativePos,
                 m = m_farMeshes.back();
                 m_farMeshes.pop_back();
             } else {
-                // Check frustum culling
-                // TODO(Ben): There could be a way to reduce the number of frustum checks
-                // via caching or checking a parent
-                // Check frustum culling first, it's more likely to cull far patches
-                f32v3 relSpherePos = m->m_aabbCenter - f32v3(relativePos);
-                if (camera->sphereInFrustum(relSpherePos, m->m_boundingSphereRadius)) {
-                    /// Use bounding box to find closest point
-                    f64v3 closestPoint = m->getClosestPoint(relativePos);
-                    if (!FarTerrainPatch::isOverHorizon(relativePos, closestPoint,
-                        m_planetGenData->radius)) {
-                        m->drawAsFarTerrain(relativePos, camera->getViewProjectionMatrix(), program, drawSkirts);
-                    }
-                }
                 i++;
             }
         }
+
+        // Check frustum culling first, it's more likely to cull far patches
+        // TODO(Ben): There could be a way to reduce the number of frustum checks
+        // via caching or checking a parent
+        m_cullSpheres.clear();
+        for (auto& m : m_farMeshes) {
+            m_cullSpheres.add(m->m_aabbCenter, m->m_boundingSphereRadius);
+        }
+        m_visibleIndices.clear();
+        camera->getFrustum().cullSpheres(m_cullSpheres, f32v3(relativePos), 0, m_cullSpheres.size(), m_visibleIndices);
+
+        for (auto& i : m_visibleIndices) {
+            auto& m = m_farMeshes[i];
+            /// Use bounding box to find closest point
+            f64v3 closestPoint = m->getClosestPoint(relativePos);
+            if (!FarTerrainPatch::isOverHorizon(relativePos, closestPoint,
+                m_planetGenData->radius)) {
+                m->drawAsFarTerrain(relativePos, camera->getViewProjectionMatrix(), program, drawSkirts);
+            }
+        }
         program.disableVertexAttribArrays();
         program.unuse();
     }
@@ -19,6 +19,8 @@
 #include <Vorb/RPC.h>
 #include <Vorb/VorbPreDecl.inl>
 
+#include "Frustum.h"
+
 class Camera;
 class TerrainPatchMesh;
 struct AtmosphereComponent;
@@ -96,6 +98,9 @@ class TerrainPatchMeshManager {
     std::vector<TerrainPatchMesh*> m_waterMeshes; ///< Meshes with water active
     std::vector<TerrainPatchMesh*> m_farMeshes; ///< All meshes
     std::vector<TerrainPatchMesh*> m_farWaterMeshes; ///< Meshes with water active
+
+    FrustumSpheres m_cullSpheres; ///< Scratch bounding spheres, rebuilt for each draw
+    std::vector<ui32> m_visibleIndices; ///< Scratch space for culling
 };
 
 #endif // TerrainPatchMeshManager_h__
@@ -147,23 +147,27 @@ void TestVoxelModelScreen::onEntry(const vui::GameTime& gameTime VORB_UNUSED) {
     { // Female model
         nString path = "Models/human_female.qb";
         VoxelModel* model = new VoxelModel();
-        model->loadFromFile(path);
+        VoxelModelMetrics metrics;
+        model->loadFromFile(path, &metrics);
         
-        addMesh(path, VoxelMeshType::BASIC, model);
-        addMesh(path, VoxelMeshType::MARCHING_CUBES, model);
-        // You can add DUAL_COUNTOURING too, but beware: The implementation is very slow.
-        // addMesh("Models/human_female.qb", VoxelMeshType::DUAL_CONTOURING, model);
+        addMesh(path, VoxelMeshType::BASIC, model, metrics);
+        addMesh(path, VoxelMeshType::MARCHING_CUBES, model, metrics);
+        // You can add DUAL_COUNTOURING too, but beware: The implementation is very slow
+        // the first time. Later runs come from the mesh cache.
+        // addMesh(path, VoxelMeshType::DUAL_CONTOURING, model, metrics);
     }
 
     { // Male model
         nString path = "Models/human_male.qb";
         VoxelModel* model = new VoxelModel;
-        model->loadFromFile(path);
+        VoxelModelMetrics metrics;
+        model->loadFromFile(path, &metrics);
         
-        addMesh(path, VoxelMeshType::BASIC, model);
-        addMesh(path, VoxelMeshType::MARCHING_CUBES, model);
-        // You can add DUAL_COUNTOURING too, but beware: The implementation is very slow.
-        // addMesh("Models/human_female.qb", VoxelMeshType::DUAL_CONTOURING, model);
+        addMesh(path, VoxelMeshType::BASIC, model, metrics);
+        addMesh(path, VoxelMeshType::MARCHING_CUBES, model, metrics);
+        // You can add DUAL_COUNTOURING too, but beware: The implementation is very slow
+        // the first time. Later runs come from the mesh cache.
+        // addMesh(path, VoxelMeshType::DUAL_CONTOURING, model, metrics);
     }
     /************************************************************************/
     /*                                                                      */
@@ -248,12 +252,19 @@ void TestVoxelModelScreen::draw(const vui::GameTime& gameTime VORB_UNUSED) {
     }
 
     // Build the string to draw
-    sprintf(buf, "Name: %s\nType: %s\nTriangles: %d\nBuild Time: %.4lf ms\nsize: %f mb",
+    const VoxelModelMetrics& metrics = m_meshInfos[m_currentMesh].metrics;
+    sprintf(buf, "Name: %s\nType: %s\nTriangles: %d\nBuild Time: %.4lf ms\nsize: %f mb\n"
+            "Load: %.4lf ms\nMesh: %.4lf ms%s\nOctree: %.4lf ms\nContour: %.4lf ms\nUpload: %.4lf ms",
             m_meshInfos[m_currentMesh].name.c_str(),
             typeString.c_str(),
             m_meshInfos[m_currentMesh].numPolygons,
             m_meshInfos[m_currentMesh].buildTime,
-            m_meshInfos[m_currentMesh].size / 1000.0f / 1000.0f);
+            m_meshInfos[m_currentMesh].size / 1000.0f / 1000.0f,
+            metrics.loadMs,
+            metrics.meshMs, metrics.meshFromCache ? " (cached)" : "",
+            metrics.octreeMs,
+            metrics.contourMs,
+            metrics.uploadMs);
 
     // Draw the string
     m_sb.drawString(&m_sf, buf, f32v2(30.0f), f32v2(1.0f), color::White);
@@ -265,7 +276,7 @@ void TestVoxelModelScreen::draw(const vui::GameTime& gameTime VORB_UNUSED) {
     checkGlError("TestVoxelModelScreen::draw");
 }
 
-void TestVoxelModelScreen::addMesh(const nString& name, VoxelMeshType meshType, VoxelModel* model) {
+void TestVoxelModelScreen::addMesh(const nString& name, VoxelMeshType meshType, VoxelModel* model, VoxelModelMetrics metrics) {
     MeshDebugInfo info;
     info.name = name;
     info.meshType = meshType;
@@ -276,16 +287,17 @@ void TestVoxelModelScreen::addMesh(const nString& name, VoxelMeshType meshType,
     // TODO(Ben): Move the switch inside ModelMesher
     switch (meshType) {
         case VoxelMeshType::BASIC:
-            m_meshes.push_back(ModelMesher::createMesh(model));
+            m_meshes.push_back(ModelMesher::createMesh(model, &metrics));
             break;
         case VoxelMeshType::MARCHING_CUBES:
-            m_meshes.push_back(ModelMesher::createMarchingCubesMesh(model));
+            m_meshes.push_back(ModelMesher::createMarchingCubesMesh(model, &metrics));
             break;
         case VoxelMeshType::DUAL_CONTOURING:
-            m_meshes.push_back(ModelMesher::createDualContouringMesh(model));
+            m_meshes.push_back(ModelMesher::createDualContouringMesh(model, &metrics));
             break;
     }
     info.buildTime = timer.stop();
     info.numPolygons = m_meshes.back().getTriCount();
+    info.metrics = metrics;
     m_meshInfos.push_back(info);
 }
\ No newline at end of file
@@ -40,6 +40,7 @@ struct MeshDebugInfo {
     ui32 numPolygons;
     f64 buildTime;
     f32 size;
+    VoxelModelMetrics metrics;
 };
 
 class TestVoxelModelScreen : public vui::IAppScreen<App> {
@@ -57,7 +58,8 @@ class TestVoxelModelScreen : public vui::IAppScreen<App> {
     virtual void update(const vui::GameTime& gameTime) override;
     virtual void draw(const vui::GameTime& gameTime) override;
 private:
-    void addMesh(const nString& name, VoxelMeshType meshType, VoxelModel* model);
+    /// @param metrics: Load metrics for the model, filled in with the mesh stages
+    void addMesh(const nString& name, VoxelMeshType meshType, VoxelModel* model, VoxelModelMetrics metrics);
     Camera m_camera;
     AutoDelegatePool m_hooks; ///< Input hooks reservoir
     bool m_mouseButtons[3];
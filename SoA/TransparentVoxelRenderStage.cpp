@@ -42,35 +42,36 @@ void TransparentVoxelRenderStage::render(const Camera* camera VORB_UNUSED) {
         sort = true;
         oldPos = intPosition;
     }
-    const std::vector <ChunkMesh *>& chunkMeshes = cmm->getChunkMeshes();
+    const std::vector <ChunkMesh *>& chunkMeshes = cmm->getVisibleChunkMeshes();
     {
         std::lock_guard<std::mutex> l(cmm->lckActiveChunkMeshes);
         if (chunkMeshes.empty()) return;
+        // Meshes outside the frustum must still resort once they come into view
+        if (sort) {
+            for (auto& cm : cmm->getChunkMeshes()) cm->needsSort = true;
+        }
         for (size_t i = 0; i < chunkMeshes.size(); i++) {
             ChunkMesh* cm = chunkMeshes[i];
-            if (sort) cm->needsSort = true;
-
-            if (cm->inFrustum) {
-                // TODO(Ben): We should probably do this outside of a lock
-                if (cm->needsSort) {
-                    cm->needsSort = false;
-                    if (cm->transQuadIndices.size() != 0) {
-                        GeometrySorter::sortTransparentBlocks(cm, intPosition);
-
-                        //update index data buffer
-                        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cm->transIndexID);
-                        glBufferData(GL_ELEMENT_ARRAY_BUFFER, cm->transQuadIndices.size() * sizeof(ui32), NULL, GL_STATIC_DRAW);
-                        void* v = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, cm->transQuadIndices.size() * sizeof(ui32), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
-
-                        if (v == NULL) pError("Failed to map sorted transparency buffer.");
-                        memcpy(v, &(cm->transQuadIndices[0]), cm->transQuadIndices.size() * sizeof(ui32));
-                        glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
-                    }
-                }
 
-                m_renderer->drawTransparent(cm, position,
-                                            m_gameRenderParams->chunkCamera->getViewProjectionMatrix());
+            // TODO(Ben): We should probably do this outside of a lock
+            if (cm->needsSort) {
+                cm->needsSort = false;
+                if (cm->transQuadIndices.size() != 0) {
+                    GeometrySorter::sortTransparentBlocks(cm, intPosition);
+
+                    //update index data buffer
+                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cm->transIndexID);
+                    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cm->transQuadIndices.size() * sizeof(ui32), NULL, GL_STATIC_DRAW);
+                    void* v = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, cm->transQuadIndices.size() * sizeof(ui32), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+                    if (v == NULL) pError("Failed to map sorted transparency buffer.");
+                    memcpy(v, &(cm->transQuadIndices[0]), cm->transQuadIndices.size() * sizeof(ui32));
+                    glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+                }
             }
+
+            m_renderer->drawTransparent(cm, position,
+                                        m_gameRenderParams->chunkCamera->getViewProjectionMatrix());
         }
     }
     glEnable(GL_CULL_FACE);
@@ -77,12 +77,12 @@ struct BlockVertex {
     ui8 mesherFlags;
 
     color3 overlayColor;
-    ui8 padding;
+    ui8 ao; ///< Ambient occlusion, 0 for none to 3 for a fully hidden corner. Already applied to the colors.
 
     // This isn't a full comparison. Its just for greedy mesh comparison so its lightweight.
     bool operator==(const BlockVertex& rhs) const {
         return (color == rhs.color && overlayColor == rhs.overlayColor &&
-                texturePosition == rhs.texturePosition);
+                texturePosition == rhs.texturePosition && ao == rhs.ao);
     }
 };
 static_assert(sizeof(BlockVertex) == 32, "Size of BlockVertex is not 32");
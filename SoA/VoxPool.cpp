@@ -3,9 +3,11 @@
 
 #include "CAEngine.h"
 #include "ChunkMesher.h"
+#include "LiquidSimulation.h"
 #include "VoxelLightEngine.h"
 
 WorkerData::~WorkerData() {
     delete chunkMesher;
     delete voxelLightEngine;
+    delete liquidStepper;
 }
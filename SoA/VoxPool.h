@@ -29,6 +29,7 @@ class WorkerData {
     class TerrainPatchMesher* terrainMesher = nullptr;
     class FloraGenerator* floraGenerator = nullptr;
     class VoxelLightEngine* voxelLightEngine = nullptr;
+    class LiquidStepper* liquidStepper = nullptr;
 };
 
 typedef vcore::ThreadPool<WorkerData> VoxPool;
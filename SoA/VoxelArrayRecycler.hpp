@@ -0,0 +1,151 @@
+///
+/// VoxelArrayRecycler.hpp
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// Recycles fixed size voxel arrays through per-thread magazines,
+/// so mesher and generator threads rarely touch the shared pool.
+///
+
+#pragma once
+
+#ifndef VoxelArrayRecycler_h__
+#define VoxelArrayRecycler_h__
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// Arrays a thread keeps before handing half back to the shared pool
+#define VOXEL_ARRAY_MAGAZINE_SIZE 8
+
+namespace vorb {
+    namespace voxel {
+
+        template<size_t SIZE, typename T>
+        class VoxelArrayRecycler {
+        public:
+            /// @param maxSize: Arrays kept in the shared pool, the rest are freed
+            VoxelArrayRecycler(size_t maxSize) : m_maxSize(maxSize), m_id(nextID++) {
+                // Empty
+            }
+            ~VoxelArrayRecycler() {
+                destroy();
+                for (auto& magazine : m_magazines) delete magazine;
+            }
+
+            /// Gets an uninitialized array. Thread safe.
+            CALLER_DELETE T* create() {
+                Magazine* magazine = getMagazine();
+                std::lock_guard<std::mutex> l(magazine->lock);
+                if (magazine->arrays.empty()) {
+                    // Refill half the magazine in one go
+                    std::lock_guard<std::mutex> lPool(m_lock);
+                    size_t n = std::min(m_arrays.size(), (size_t)VOXEL_ARRAY_MAGAZINE_SIZE / 2);
+                    magazine->arrays.insert(magazine->arrays.end(), m_arrays.end() - n, m_arrays.end());
+                    m_arrays.resize(m_arrays.size() - n);
+                }
+                if (magazine->arrays.empty()) return new T[SIZE];
+                T* data = magazine->arrays.back();
+                magazine->arrays.pop_back();
+                return data;
+            }
+            /// Keeps an array for reuse. Thread safe.
+            void recycle(CALLEE_DELETE T* data) {
+                Magazine* magazine = getMagazine();
+                std::lock_guard<std::mutex> l(magazine->lock);
+                if (magazine->arrays.size() == VOXEL_ARRAY_MAGAZINE_SIZE) {
+                    // Hand back the older half in one go
+                    std::lock_guard<std::mutex> lPool(m_lock);
+                    returnArrays(magazine, VOXEL_ARRAY_MAGAZINE_SIZE / 2);
+                }
+                magazine->arrays.push_back(data);
+            }
+
+            /// Frees all kept arrays, including those in the magazines of every thread
+            void destroy() {
+                std::vector<Magazine*> magazines;
+                {
+                    std::lock_guard<std::mutex> l(m_lckMagazines);
+                    magazines = m_magazines;
+                }
+                for (auto& magazine : magazines) {
+                    std::lock_guard<std::mutex> l(magazine->lock);
+                    for (auto& data : magazine->arrays) delete[] data;
+                    magazine->arrays.clear();
+                }
+                std::lock_guard<std::mutex> l(m_lock);
+                for (auto& data : m_arrays) delete[] data;
+                std::vector<T*>().swap(m_arrays);
+            }
+
+            /// Number of kept arrays
+            size_t getSize() {
+                size_t size = 0;
+                {
+                    std::lock_guard<std::mutex> l(m_lckMagazines);
+                    for (auto& magazine : m_magazines) {
+                        std::lock_guard<std::mutex> lMagazine(magazine->lock);
+                        size += magazine->arrays.size();
+                    }
+                }
+                std::lock_guard<std::mutex> l(m_lock);
+                return size + m_arrays.size();
+            }
+        private:
+            struct Magazine {
+                std::mutex lock; ///< Only contended while the pool is destroyed or measured
+                std::vector<T*> arrays;
+                ui8 padding[64]; ///< Keeps magazines of different threads off the same cache line
+            };
+
+            /// Magazine of the calling thread, created on first use
+            Magazine* getMagazine() {
+                // IDs are never reused, so entries of destroyed recyclers are never matched
+                thread_local std::vector<std::pair<ui32, Magazine*>> magazines;
+                for (auto& it : magazines) {
+                    if (it.first == m_id) return it.second;
+                }
+                Magazine* magazine = new Magazine;
+                magazine->arrays.reserve(VOXEL_ARRAY_MAGAZINE_SIZE);
+                {
+                    std::lock_guard<std::mutex> l(m_lckMagazines);
+                    m_magazines.push_back(magazine);
+                }
+                magazines.emplace_back(m_id, magazine);
+                return magazine;
+            }
+
+            /// Moves the first n arrays of a magazine to the pool. Lock both first.
+            void returnArrays(Magazine* magazine, size_t n) {
+                for (size_t i = 0; i < n; i++) {
+                    if (m_arrays.size() < m_maxSize) {
+                        m_arrays.push_back(magazine->arrays[i]);
+                    } else {
+                        delete[] magazine->arrays[i];
+                    }
+                }
+                magazine->arrays.erase(magazine->arrays.begin(), magazine->arrays.begin() + n);
+            }
+
+            size_t m_maxSize;
+            ui32 m_id;
+            std::mutex m_lock; ///< Guards m_arrays
+            std::vector<T*> m_arrays; ///< Shared pool
+            std::mutex m_lckMagazines;
+            std::vector<Magazine*> m_magazines; ///< Every thread's magazine, owned here
+
+            static std::atomic<ui32> nextID;
+        };
+
+        template<size_t SIZE, typename T>
+        std::atomic<ui32> VoxelArrayRecycler<SIZE, T>::nextID(1);
+    }
+}
+namespace vvox = vorb::voxel;
+
+#endif // VoxelArrayRecycler_h__
@@ -106,12 +106,14 @@ void VoxelEditor::placeAABox(ChunkGrid& grid, ItemStack* block) {
                         block->count--;
 
                         // ChunkUpdater::placeBlock(chunk, )
-                        ChunkUpdater::placeBlockNoUpdate(chunk, voxelIndex, block->pack->operator[](block->id).blockID);
+                        BlockID blockID = (BlockID)block->pack->operator[](block->id).blockID;
+                        ChunkUpdater::placeBlockNoUpdate(chunk, voxelIndex, blockID);
+                        grid.edits.record(currentID, (ui16)voxelIndex, blockID);
                         if (block->count == 0) {
                             if (locked) chunk->dataMutex.unlock();
                             for (auto& it : modifiedChunks) {
                                 if (it.second->isAccessible) {
-                                    it.second->DataChange(it.second);
+                                    ChunkUpdater::notifyDataChange(it.second);
                                 }
                                 it.second.release();
                             }
@@ -127,7 +129,7 @@ void VoxelEditor::placeAABox(ChunkGrid& grid, ItemStack* block) {
     if (locked) chunk->dataMutex.unlock();
     for (auto& it : modifiedChunks) {
         if (it.second->isAccessible) {
-            it.second->DataChange(it.second);
+            ChunkUpdater::notifyDataChange(it.second);
         }
         it.second.release();
     }
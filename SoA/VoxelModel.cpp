@@ -5,6 +5,8 @@
 #include "VoxelModelLoader.h"
 #include "ModelMesher.h"
 
+#include <Vorb/Timing.h>
+
 VoxelModel::VoxelModel():
 m_mesh() {
     // Empty
@@ -14,11 +16,18 @@ VoxelModel::~VoxelModel() {
     m_matrix.dispose();
 }
 
-bool VoxelModel::loadFromFile(const nString& path) {
+bool VoxelModel::loadFromFile(const nString& path, OPT VoxelModelMetrics* metrics /*= nullptr*/) {
+    PreciseTimer timer;
+    timer.start();
     VoxelMatrix matrix;
-    if (!VoxelModelLoader::loadModel(path, matrix)) {
+    ui64 contentHash;
+    if (!VoxelModelLoader::loadModel(path, matrix, &contentHash)) {
         return false;
     }
+    m_matrix.dispose();
     setMatrix(matrix);
+    m_filePath = path;
+    m_contentHash = contentHash;
+    if (metrics) metrics->loadMs = timer.stop();
     return true;
 }
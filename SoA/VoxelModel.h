@@ -12,12 +12,24 @@
 
 class VoxelModelVertex;
 
+/// Time spent in each stage of getting a model on screen, in ms
+struct VoxelModelMetrics {
+    f64 loadMs = 0.0;
+    f64 meshMs = 0.0; ///< Includes octree and contour for dual contouring
+    f64 octreeMs = 0.0;
+    f64 contourMs = 0.0;
+    f64 uploadMs = 0.0;
+    ui32 numVertices = 0;
+    ui32 numIndices = 0;
+    bool meshFromCache = false;
+};
+
 class VoxelModel {
 public:
     VoxelModel();
     ~VoxelModel();
     
-    bool loadFromFile(const nString& path);
+    bool loadFromFile(const nString& path, OPT VoxelModelMetrics* metrics = nullptr);
     
     void setMatrix(const VoxelMatrix& matrix) { m_matrix = matrix; }
     void setMesh(const VoxelModelMesh& mesh) { m_mesh = mesh; }
@@ -25,9 +37,14 @@ class VoxelModel {
     VoxelMatrix& getMatrix() { return m_matrix; }
     const VoxelMatrix& getMatrix() const { return m_matrix; }
     const VoxelModelMesh& getMesh() const { return m_mesh; }
+    /// Empty unless the model came from a file
+    const nString& getFilePath() const { return m_filePath; }
+    ui64 getContentHash() const { return m_contentHash; }
 
 private:
     VoxelMatrix m_matrix;
+    nString m_filePath = "";
+    ui64 m_contentHash = 0;
     VoxelModelMesh m_mesh;
 };
 
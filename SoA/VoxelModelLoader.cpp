@@ -1,106 +1,151 @@
 #include "stdafx.h"
 #include "VoxelModelLoader.h"
 
-#include <iostream>
-#include <fstream>
-
 #include "VoxelMatrix.h"
 
+namespace {
+    // Bounds checked cursor over the file contents
+    class QbReader {
+    public:
+        QbReader(const ui8* data, size_t size) : m_data(data), m_size(size) {}
+
+        template<typename T>
+        bool read(T& value) {
+            if (m_pos + sizeof(T) > m_size) return false;
+            memcpy(&value, m_data + m_pos, sizeof(T));
+            m_pos += sizeof(T);
+            return true;
+        }
+
+        bool skip(size_t bytes) {
+            if (m_pos + bytes > m_size) return false;
+            m_pos += bytes;
+            return true;
+        }
+
+        const ui8* current() const { return m_data + m_pos; }
+        size_t remaining() const { return m_size - m_pos; }
+    private:
+        const ui8* m_data;
+        size_t m_size;
+        size_t m_pos = 0;
+    };
+
+    inline ColorRGBA8 toColor(ui32 data) {
+        ui32 r = data & 0x000000ff;
+        ui32 g = (data & 0x0000ff00) >> 8;
+        ui32 b = (data & 0x00ff0000) >> 16;
+        ui32 a = (data & 0xff000000) >> 24;
+        return ColorRGBA8(r / 255.0f, g / 255.0f, b / 255.0f, a / 255.0f);
+    }
+}
+
 VoxelModelLoader::VoxelModelLoader() {
     //Empty
 }
 
-    
-bool VoxelModelLoader::loadModel(const nString& filePath,
+bool VoxelModelLoader::loadModel(const nString& filePath, VoxelMatrix& matrix, OPT ui64* contentHash /*= nullptr*/) {
+    FILE* file = fopen(filePath.c_str(), "rb");
+    if (!file) return false;
+
+    // One read for the whole file instead of one per voxel
+    std::vector<ui8> contents;
+    bool ok = fseek(file, 0, SEEK_END) == 0;
+    long length = ok ? ftell(file) : -1;
+    ok = length > 0 && fseek(file, 0, SEEK_SET) == 0;
+    if (ok) {
+        contents.resize((size_t)length);
+        ok = fread(contents.data(), 1, contents.size(), file) == contents.size();
+    }
+    fclose(file);
+    if (!ok) return false;
+
+    if (contentHash) *contentHash = hashContents(contents.data(), contents.size());
+    return parseModel(contents.data(), contents.size(), matrix);
+}
+
+bool VoxelModelLoader::parseModel(const ui8* data, size_t size,
     VoxelMatrix& matrix /* Even though .qb can have multiple matrices, we assume a single matrix. */) {
-    FILE* file = NULL;
-    file=fopen( filePath.c_str(), "rb");
+    QbReader reader(data, size);
 
-    bool ok = true;
-    ui8* version = new ui8[4];
-    ok = fread(&version[0], sizeof(char)*4, 1, file) == 1;
+    ui32 version;
     ui32 colorFormat;
-    ok = fread(&colorFormat, sizeof(ui32), 1, file) == 1;
     ui32 zAxisOrientation;
-    ok = fread(&zAxisOrientation, sizeof(ui32), 1, file) == 1;
     ui32 compressed;
-    ok = fread(&compressed, sizeof(ui32), 1, file) == 1;
     ui32 visibilityMaskEncoded;
-    ok = fread(&visibilityMaskEncoded, sizeof(ui32), 1, file) == 1;
     ui32 numMatrices;
-    ok = fread(&numMatrices, sizeof(ui32), 1, file) == 1;
-
-    char nameLength = 0;
-    ok = fread((char*)&nameLength, sizeof(char), 1, file) == 1;
-    char* name = new char[nameLength + 1];
-    ok = fread(name, sizeof(char)*nameLength, 1, file) == 1;
-    name[(size_t)nameLength] = 0;
-    printf("%s", name);
-
-    ok = fread(&matrix.size.x, sizeof(ui32), 1, file) == 1;
-    ok = fread(&matrix.size.y, sizeof(ui32), 1, file) == 1;
-    ok = fread(&matrix.size.z, sizeof(ui32), 1, file) == 1;
-
-    ok = fread(&matrix.position.x, sizeof(ui32), 1, file) == 1;
-    ok = fread(&matrix.position.y, sizeof(ui32), 1, file) == 1;
-    ok = fread(&matrix.position.z, sizeof(ui32), 1, file) == 1;
-
-    matrix.data = new ColorRGBA8[matrix.size.x * matrix.size.y * matrix.size.z];
-
-    if(compressed == 0) { // Uncompressed Data
-        for(ui32 z = 0; z < matrix.size.z; z++) {
-            for(ui32 y = 0; y < matrix.size.y; y++) {
-                for(ui32 x = 0; x < matrix.size.x; x++) {
-                    ui32 data = 0;
-                    ok = fread(&data, sizeof(ui32), 1, file) == 1;
-                    ui32 r = data & 0x000000ff;
-                    ui32 g = (data & 0x0000ff00) >> 8;
-                    ui32 b = (data & 0x00ff0000) >> 16;
-                    ui32 a = (data & 0xff000000) >> 24;
-                    int location = matrix.getIndex(x, y, z);
-                    matrix.data[location] = ColorRGBA8(r / 255.0f, g / 255.0f, b / 255.0f, a / 255.0f);
-                }
-            }
+    ui8 nameLength;
+    if (!reader.read(version) || !reader.read(colorFormat) || !reader.read(zAxisOrientation) ||
+        !reader.read(compressed) || !reader.read(visibilityMaskEncoded) || !reader.read(numMatrices) ||
+        !reader.read(nameLength) || reader.remaining() < nameLength) {
+        return false;
+    }
+    matrix.name.assign((const char*)reader.current(), nameLength);
+    reader.skip(nameLength);
+
+    if (!reader.read(matrix.size.x) || !reader.read(matrix.size.y) || !reader.read(matrix.size.z) ||
+        !reader.read(matrix.position.x) || !reader.read(matrix.position.y) || !reader.read(matrix.position.z)) {
+        return false;
+    }
+
+    const size_t numVoxels = (size_t)matrix.size.x * matrix.size.y * matrix.size.z;
+    if (numVoxels == 0) return false;
+    matrix.data = new ColorRGBA8[numVoxels];
+
+    if (compressed == 0) { // Uncompressed Data
+        // Stored z, y, x which is already our index order
+        if (reader.remaining() < numVoxels * sizeof(ui32)) {
+            matrix.dispose();
+            return false;
+        }
+        const ui8* src = reader.current();
+        for (size_t i = 0; i < numVoxels; i++) {
+            ui32 voxel;
+            memcpy(&voxel, src + i * sizeof(ui32), sizeof(ui32));
+            matrix.data[i] = toColor(voxel);
         }
     } else { // RLE compressed
-        ui32 z = 0;
-        while(z < matrix.size.z) {
+        const ui32 sliceSize = matrix.size.x * matrix.size.y;
+        for (ui32 z = 0; z < matrix.size.z; z++) {
+            ColorRGBA8* slice = matrix.data + (size_t)z * sliceSize;
             ui32 index = 0;
-            while(true) {
-                ui32 data = 0;
-                ok = fread(&data, sizeof(ui32), 1, file) == 1;
-                if(data == NEXT_SLICE_FLAG) {
+            while (true) {
+                ui32 voxel;
+                if (!reader.read(voxel)) {
+                    matrix.dispose();
+                    return false;
+                }
+                if (voxel == NEXT_SLICE_FLAG) {
                     break;
-                } else if(data == CODE_FLAG) {
-                    ui32 count = 0;
-                    ok = fread(&count, sizeof(ui32), 1, file) == 1;
-                    ok = fread(&data, sizeof(ui32), 1, file) == 1;
-                    for(ui32 j = 0; j < count; j++) {
-                        i32 x = index % matrix.size.x;
-                        i32 y = index / matrix.size.x;
-                        index++;
-                        ui32 r = data & 0x000000ff;
-                        ui32 g = (data & 0x0000ff00) >> 8;
-                        ui32 b = (data & 0x00ff0000) >> 16;
-                        ui32 a = (data & 0xff000000) >> 24;
-                        int location = matrix.getIndex(x, y, z);
-                        matrix.data[location] = ColorRGBA8(r / 255.0f, g / 255.0f, b / 255.0f, a / 255.0f);
+                } else if (voxel == CODE_FLAG) {
+                    ui32 count;
+                    if (!reader.read(count) || !reader.read(voxel) || count > sliceSize - index) {
+                        matrix.dispose();
+                        return false;
+                    }
+                    ColorRGBA8 color = toColor(voxel);
+                    for (ui32 j = 0; j < count; j++) {
+                        slice[index++] = color;
                     }
                 } else {
-                    i32 x = index % matrix.size.x;
-                    i32 y = index / matrix.size.x;
-                    index++;
-                    ui32 r = data & 0x000000ff;
-                    ui32 g = (data & 0x0000ff00) >> 8;
-                    ui32 b = (data & 0x00ff0000) >> 16;
-                    ui32 a = (data & 0xff000000) >> 24;
-                    int location = matrix.getIndex(x, y, z);
-                    matrix.data[location] = ColorRGBA8(r / 255.0f, g / 255.0f, b / 255.0f, a / 255.0f);
+                    if (index >= sliceSize) {
+                        matrix.dispose();
+                        return false;
+                    }
+                    slice[index++] = toColor(voxel);
                 }
             }
-            z++;
         }
     }
-    
-    return ok;
-}
\ No newline at end of file
+
+    return true;
+}
+
+ui64 VoxelModelLoader::hashContents(const ui8* data, size_t size) {
+    ui64 hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
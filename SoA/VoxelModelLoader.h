@@ -27,7 +27,13 @@ class VoxelMatrix;
 
 class VoxelModelLoader {
 public:
-    static bool loadModel(const nString& filePath, VoxelMatrix& matrix);
+    /// Reads the whole file in one go and parses it from memory
+    /// @param contentHash: Optional hash of the file contents, used to key the mesh cache
+    static bool loadModel(const nString& filePath, VoxelMatrix& matrix, OPT ui64* contentHash = nullptr);
+    /// Parses a .qb file that is already in memory
+    static bool parseModel(const ui8* data, size_t size, VoxelMatrix& matrix);
+    /// 64 bit FNV-1a
+    static ui64 hashContents(const ui8* data, size_t size);
 private:
     VoxelModelLoader();
 };
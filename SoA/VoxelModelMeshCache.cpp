@@ -0,0 +1,69 @@
+#include "stdafx.h"
+#include "VoxelModelMeshCache.h"
+
+#include "VoxelModelMesh.h"
+
+namespace {
+    const ui32 CACHE_MAGIC = 0x564D4D43; // "CMMV"
+
+    struct CacheHeader {
+        ui32 magic;
+        ui32 version;
+        ui64 contentHash;
+        ui32 vertexSize;
+        ui32 numVertices;
+        ui32 numIndices;
+        ui32 padding;
+    };
+}
+
+nString VoxelModelMeshCache::getCachePath(const nString& modelPath, const cString mesherName) {
+    return modelPath + "." + mesherName + ".mesh";
+}
+
+bool VoxelModelMeshCache::save(const nString& cachePath, ui64 contentHash,
+                               const std::vector<VoxelModelVertex>& vertices, const std::vector<ui32>& indices) {
+    FILE* file = fopen(cachePath.c_str(), "wb");
+    if (!file) return false;
+
+    CacheHeader header = {};
+    header.magic = CACHE_MAGIC;
+    header.version = VOXEL_MODEL_MESH_CACHE_VERSION;
+    header.contentHash = contentHash;
+    header.vertexSize = sizeof(VoxelModelVertex);
+    header.numVertices = (ui32)vertices.size();
+    header.numIndices = (ui32)indices.size();
+
+    bool ok = fwrite(&header, sizeof(CacheHeader), 1, file) == 1;
+    if (ok && vertices.size()) ok = fwrite(vertices.data(), sizeof(VoxelModelVertex), vertices.size(), file) == vertices.size();
+    if (ok && indices.size()) ok = fwrite(indices.data(), sizeof(ui32), indices.size(), file) == indices.size();
+    fclose(file);
+    // Don't leave a truncated image behind
+    if (!ok) remove(cachePath.c_str());
+    return ok;
+}
+
+bool VoxelModelMeshCache::load(const nString& cachePath, ui64 contentHash,
+                               OUT std::vector<VoxelModelVertex>& vertices, OUT std::vector<ui32>& indices) {
+    FILE* file = fopen(cachePath.c_str(), "rb");
+    if (!file) return false;
+
+    CacheHeader header;
+    bool ok = fread(&header, sizeof(CacheHeader), 1, file) == 1 &&
+              header.magic == CACHE_MAGIC &&
+              header.version == VOXEL_MODEL_MESH_CACHE_VERSION &&
+              header.contentHash == contentHash &&
+              header.vertexSize == sizeof(VoxelModelVertex);
+    if (ok) {
+        vertices.resize(header.numVertices);
+        indices.resize(header.numIndices);
+        if (vertices.size()) ok = fread(vertices.data(), sizeof(VoxelModelVertex), vertices.size(), file) == vertices.size();
+        if (ok && indices.size()) ok = fread(indices.data(), sizeof(ui32), indices.size(), file) == indices.size();
+    }
+    fclose(file);
+    if (!ok) {
+        vertices.clear();
+        indices.clear();
+    }
+    return ok;
+}
@@ -0,0 +1,39 @@
+///
+/// VoxelModelMeshCache.h
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// On-disk cache of meshed voxel models, keyed by a hash of the
+/// model file so warm loads skip meshing entirely.
+///
+
+#pragma once
+
+#ifndef VoxelModelMeshCache_h__
+#define VoxelModelMeshCache_h__
+
+#include <Vorb/types.h>
+
+class VoxelModelVertex;
+
+// Bump this whenever a mesher or the vertex layout changes
+#define VOXEL_MODEL_MESH_CACHE_VERSION 1
+
+namespace VoxelModelMeshCache {
+    /// Cache file for a model file and mesher, next to the model
+    nString getCachePath(const nString& modelPath, const cString mesherName);
+
+    /// Writes the mesh data
+    bool save(const nString& cachePath, ui64 contentHash,
+              const std::vector<VoxelModelVertex>& vertices, const std::vector<ui32>& indices);
+
+    /// Reads back mesh data written by save
+    /// @return false if the file is missing, stale, from another version or corrupt
+    bool load(const nString& cachePath, ui64 contentHash,
+              OUT std::vector<VoxelModelVertex>& vertices, OUT std::vector<ui32>& indices);
+}
+
+#endif // VoxelModelMeshCache_h__
@@ -55,6 +55,7 @@ void VoxelNodeSetter::update() {
                 newTask->h = it->second.h.acquire();
                 newTask->forcedNodes.swap(it->second.forcedNodes);
                 newTask->condNodes.swap(it->second.condNodes);
+                newTask->edits = &grid->edits;
                 threadPool->addTask(newTask);
             }
            
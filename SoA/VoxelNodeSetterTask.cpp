@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "VoxelNodeSetterTask.h"
 
+#include "ChunkEditJournal.h"
 #include "ChunkHandle.h"
 #include "Chunk.h"
 
@@ -17,8 +18,14 @@ void VoxelNodeSetterTask::execute(WorkerData* workerData VORB_UNUSED) {
             }
         }
     }
+    // Nodes can land after the chunk's own edits were applied
+    if (edits) edits->apply(h);
 
-    if (h->genLevel >= GEN_DONE) h->DataChange(h);
+    if (h->genLevel >= GEN_DONE) {
+        // Nodes can land anywhere, so remesh the whole chunk
+        h->flagDirty();
+        h->DataChange(h);
+    }
 
     h.release();
 }
@@ -18,6 +18,7 @@
 #include <Vorb/IThreadPoolTask.h>
 #include "ChunkHandle.h"
 
+class ChunkEditJournal;
 class WorkerData;
 
 struct VoxelToPlace {
@@ -37,6 +38,7 @@ class VoxelNodeSetterTask : public vcore::IThreadPoolTask<WorkerData> {
     ChunkHandle h;
     std::vector<VoxelToPlace> forcedNodes; ///< Always added
     std::vector<VoxelToPlace> condNodes; ///< Conditionally added
+    const ChunkEditJournal* edits = nullptr; ///< Player edits written back over the nodes
 };
 
 #endif // VoxelNodeSetterTask_h__
@@ -17,8 +17,8 @@
 
 #include "ChunkHandle.h"
 #include "Chunk.h"
+#include "ChunkIDMap.hpp"
 
-#include <unordered_map>
 
 struct VoxelUpdateBuffer {
     inline void finish() { h.release(); }
@@ -33,7 +33,7 @@ struct VoxelUpdateBuffer {
 
 class VoxelUpdateBufferer {
 public:
-    void reserve(std::unordered_map<ChunkID, VoxelUpdateBuffer>::size_type sizeApprox) {
+    void reserve(ChunkIDMap<VoxelUpdateBuffer>::size_type sizeApprox) {
         buffers.reserve(sizeApprox);
     }
     inline void addUpdate(ChunkHandle chunk, BlockIndex index) {
@@ -59,7 +59,7 @@ class VoxelUpdateBufferer {
     }
 
     // You must manually call finish on all buffers then clear it yourself
-    std::unordered_map<ChunkID, VoxelUpdateBuffer> buffers;
+    ChunkIDMap<VoxelUpdateBuffer> buffers;
 };
 
 #endif // VoxelUpdateBuffer_h__
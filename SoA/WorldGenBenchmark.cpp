@@ -0,0 +1,261 @@
+#include "stdafx.h"
+#include "WorldGenBenchmark.h"
+
+#ifdef _WINDOWS
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif//_WINDOWS
+
+#include <algorithm>
+#include <chrono>
+
+#include "ChunkGrid.h"
+#include "ChunkMesh.h"
+#include "ChunkMeshManager.h"
+#include "ChunkSphereComponentUpdater.h"
+#include "GameSystem.h"
+#include "GameSystemAssemblages.h"
+#include "LoadContext.h"
+#include "LoadTaskBlockData.h"
+#include "SoAState.h"
+#include "SoaEngine.h"
+#include "SpaceSystem.h"
+#include "SpaceSystemAssemblages.h"
+#include "SphericalHeightmapGenerator.h"
+#include "SphericalVoxelComponentUpdater.h"
+#include "VoxelSpaceConversions.h"
+
+// Frames with no finished work after the path before we stop waiting
+#define IDLE_FRAMES 60
+// Keep the camera above the surface so the sphere covers air and ground
+#define CAMERA_HEIGHT 32.0
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    f32 msSince(const Clock::time_point& t) {
+        return std::chrono::duration<f32, std::milli>(Clock::now() - t).count();
+    }
+
+    f32 percentile(std::vector<f32>& samples, f32 p) {
+        if (samples.empty()) return 0.0f;
+        size_t i = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+        std::nth_element(samples.begin(), samples.begin() + i, samples.end());
+        return samples[i];
+    }
+
+    f64 getSurfaceHeight(const SphericalHeightmapGenerator* generator, const VoxelPosition3D& pos) {
+        VoxelPosition2D pos2D;
+        pos2D.pos = f64v2(pos.pos.x, pos.pos.z);
+        pos2D.face = pos.face;
+        PlanetHeightData height;
+        generator->generateHeightData(height, pos2D);
+        return (f64)height.height;
+    }
+
+    // Collects stats from the generator and mesh manager events
+    struct StatsCollector {
+        void onQueryFinish(Sender, ChunkQuery* query) {
+            if (query->chunk->genLevel != GEN_DONE) return;
+            genLatencies.push_back(std::chrono::duration<f32, std::milli>(Clock::now() - query->submitTime).count());
+            lastWork = Clock::now();
+        }
+        void onMeshUpdate(Sender, ChunkMeshUpdateMessage& message) {
+            meshLatencies.push_back(std::chrono::duration<f32, std::milli>(Clock::now() - message.submitTime).count());
+            if (message.meshData) {
+                numQuads += message.meshData->opaqueQuads.size() +
+                            message.meshData->cutoutQuads.size() +
+                            message.meshData->transQuads.size();
+            }
+            lastWork = Clock::now();
+        }
+
+        std::vector<f32> genLatencies;
+        std::vector<f32> meshLatencies;
+        ui64 numQuads = 0;
+        Clock::time_point lastWork;
+    };
+}
+
+bool WorldGenBenchmark::run(const WorldGenBenchmarkConfig& config, OUT WorldGenBenchmarkResults& results) {
+    SoaState* state = new SoaState;
+    SoaEngine::initState(state);
+
+    { // Block data, texture pixels are loaded but never uploaded
+        StaticLoadContext context;
+        LoadTaskBlockData blockLoader(&state->blocks, &state->clientState.blockTextureLoader, &context);
+        blockLoader.load();
+    }
+
+    SoaEngine::loadSpaceSystem(state, config.spaceSystemDir);
+    SpaceSystem* spaceSystem = state->spaceSystem;
+    GameSystem* gameSystem = state->gameSystem;
+
+    // Find the planet
+    vecs::EntityID planet = 0;
+    for (auto& it : spaceSystem->sphericalTerrain) {
+        auto& stCmp = it.second;
+        if (!stCmp.planetGenData || !stCmp.cpuGenerator) continue;
+        const nString& name = spaceSystem->namePosition.get(stCmp.namePositionComponent).name;
+        if (config.planetName.empty() || name == config.planetName) {
+            planet = it.first;
+            results.planetName = name;
+            break;
+        }
+    }
+    if (!planet) {
+        fprintf(stderr, "WorldGenBenchmark: no planet %s in %s\n", config.planetName.c_str(), config.spaceSystemDir.c_str());
+        return false;
+    }
+
+    // Same post processing as the gameplay load screen, without the texture upload
+    for (auto& it : spaceSystem->sphericalTerrain) {
+        SoaEngine::initVoxelGen(it.second.planetGenData, state->blocks);
+    }
+
+    ChunkMeshManager* meshManager = state->clientState.chunkMeshManager;
+    meshManager->setHeadless(true);
+    if (config.memoryBudget) state->chunkResidency.setBudget(config.memoryBudget);
+
+    // Voxel components, as SphericalTerrainComponentUpdater would add them
+    vecs::ComponentID stCmpID = spaceSystem->sphericalTerrain.getComponentID(planet);
+    auto& stCmp = spaceSystem->sphericalTerrain.get(stCmpID);
+    stCmp.farTerrainComponent = SpaceSystemAssemblages::addFarTerrainComponent(spaceSystem, planet, stCmp, FACE_TOP);
+    stCmp.sphericalVoxelComponent = SpaceSystemAssemblages::addSphericalVoxelComponent(spaceSystem, planet, stCmpID,
+                                                                                       stCmp.farTerrainComponent,
+                                                                                       stCmp.axisRotationComponent,
+                                                                                       stCmp.namePositionComponent,
+                                                                                       FACE_TOP, state);
+    auto& svCmp = spaceSystem->sphericalVoxel.get(stCmp.sphericalVoxelComponent);
+
+    // Hook up stats
+    StatsCollector stats;
+    for (int i = 0; i < 6; i++) {
+        ChunkGrid& grid = svCmp.chunkGrids[i];
+        for (ui32 j = 0; j < grid.numGenerators; j++) {
+            grid.generators[j].onQueryFinish += makeDelegate(stats, &StatsCollector::onQueryFinish);
+        }
+    }
+    meshManager->onMeshUpdate += makeDelegate(stats, &StatsCollector::onMeshUpdate);
+
+    // The camera
+    VoxelPosition3D position;
+    position.face = FACE_TOP;
+    position.pos = f64v3(0.0);
+    position.pos.y = getSurfaceHeight(svCmp.generator, position) + CAMERA_HEIGHT;
+
+    vecs::EntityID camera = gameSystem->addEntity();
+    vecs::ComponentID vpCmpID = GameSystemAssemblages::addVoxelPosition(gameSystem, camera, stCmp.sphericalVoxelComponent,
+                                                                        f64q(1.0, 0.0, 0.0, 0.0), position);
+    GameSystemAssemblages::addChunkSphere(gameSystem, camera, vpCmpID,
+                                          VoxelSpaceConversions::voxelToChunk(position).pos, config.chunkRadius);
+    auto& vpCmp = gameSystem->voxelPosition.get(vpCmpID);
+
+    ChunkSphereComponentUpdater chunkSphereUpdater;
+    SphericalVoxelComponentUpdater sphericalVoxelUpdater;
+
+    Clock::time_point start = Clock::now();
+    stats.lastWork = start;
+    ui32 idleFrames = 0;
+    for (ui32 frame = 0; frame < config.numFrames + config.maxDrainFrames; frame++) {
+        Clock::time_point frameStart = Clock::now();
+        size_t prevWork = stats.genLatencies.size() + stats.meshLatencies.size();
+
+        // Follow the terrain in a straight line
+        if (frame < config.numFrames) {
+            position.pos.x += config.speed;
+            position.pos.y = getSurfaceHeight(svCmp.generator, position) + CAMERA_HEIGHT;
+            vpCmp.gridPosition = position;
+        }
+
+        chunkSphereUpdater.update(gameSystem, spaceSystem);
+        sphericalVoxelUpdater.update(state);
+        meshManager->update(position.pos, false);
+        state->chunkResidency.update(position);
+
+        // Peaks of each half of the path, the second half shows whether memory keeps growing
+        ui64 chunkMemoryKiB = state->chunkResidency.getUsage().getTotal() / 1024;
+        ui64& peakChunkMemoryKiB = (frame < config.numFrames / 2) ? results.peakChunkMemoryFirstHalfKiB :
+                                                                     results.peakChunkMemorySecondHalfKiB;
+        peakChunkMemoryKiB = std::max(peakChunkMemoryKiB, chunkMemoryKiB);
+
+        if (frame >= config.numFrames) {
+            if (stats.genLatencies.size() + stats.meshLatencies.size() == prevWork) {
+                if (++idleFrames == IDLE_FRAMES) break;
+            } else {
+                idleFrames = 0;
+            }
+        }
+
+        if (config.frameMs > 0.0) {
+            f32 remaining = (f32)config.frameMs - msSince(frameStart);
+            if (remaining > 0.0f) std::this_thread::sleep_for(std::chrono::duration<f32, std::milli>(remaining));
+        }
+    }
+
+    // Measure up to the last finished piece of work so the idle tail doesn't count
+    results.seconds = std::chrono::duration<f64>(stats.lastWork - start).count();
+    results.numChunks = (ui32)stats.genLatencies.size();
+    results.numMeshes = (ui32)stats.meshLatencies.size();
+    results.numQuads = stats.numQuads;
+    results.genLatencyP50 = percentile(stats.genLatencies, 0.5f);
+    results.genLatencyP99 = percentile(stats.genLatencies, 0.99f);
+    results.meshLatencyP50 = percentile(stats.meshLatencies, 0.5f);
+    results.meshLatencyP99 = percentile(stats.meshLatencies, 0.99f);
+    results.peakRSSKiB = getPeakRSSKiB();
+    results.numChunkPages = (ui32)state->chunkAllocator.getNumPages();
+    results.numCompressions = state->chunkResidency.getNumCompressions();
+
+    // Stop listening before the collector goes out of scope. The state itself is
+    // left alive since worker threads may still reference it.
+    for (int i = 0; i < 6; i++) {
+        ChunkGrid& grid = svCmp.chunkGrids[i];
+        for (ui32 j = 0; j < grid.numGenerators; j++) {
+            grid.generators[j].onQueryFinish -= makeDelegate(stats, &StatsCollector::onQueryFinish);
+        }
+    }
+    meshManager->onMeshUpdate -= makeDelegate(stats, &StatsCollector::onMeshUpdate);
+    return true;
+}
+
+nString WorldGenBenchmark::toJSON(const WorldGenBenchmarkConfig& config, const WorldGenBenchmarkResults& results) {
+    f64 seconds = std::max(results.seconds, 1e-9);
+    char buf[1024];
+    snprintf(buf, sizeof(buf),
+             "{\"planet\": \"%s\", \"chunkRadius\": %u, \"frames\": %u, \"speed\": %.2f, "
+             "\"seconds\": %.3f, \"chunks\": %u, \"chunksPerSecond\": %.1f, "
+             "\"meshes\": %u, \"quads\": %llu, \"quadsPerSecond\": %.1f, "
+             "\"genLatencyMs\": {\"p50\": %.3f, \"p99\": %.3f}, "
+             "\"meshLatencyMs\": {\"p50\": %.3f, \"p99\": %.3f}, "
+             "\"peakRSSKiB\": %llu, "
+             "\"chunkMemoryKiB\": {\"firstHalfPeak\": %llu, \"secondHalfPeak\": %llu}, "
+             "\"chunkPages\": %u, \"compressions\": %u}",
+             results.planetName.c_str(), config.chunkRadius, config.numFrames, config.speed,
+             results.seconds, results.numChunks, results.numChunks / seconds,
+             results.numMeshes, (unsigned long long)results.numQuads, results.numQuads / seconds,
+             results.genLatencyP50, results.genLatencyP99,
+             results.meshLatencyP50, results.meshLatencyP99,
+             (unsigned long long)results.peakRSSKiB,
+             (unsigned long long)results.peakChunkMemoryFirstHalfKiB,
+             (unsigned long long)results.peakChunkMemorySecondHalfKiB,
+             results.numChunkPages, results.numCompressions);
+    return buf;
+}
+
+ui64 WorldGenBenchmark::getPeakRSSKiB() {
+#ifdef _WINDOWS
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // Bytes on OS X
+#else
+    return usage.ru_maxrss;
+#endif//__APPLE__
+#endif//_WINDOWS
+}
@@ -0,0 +1,61 @@
+///
+/// WorldGenBenchmark.h
+/// Seed of Andromeda
+///
+/// Copyright 2014 Regrowth Studios
+/// MIT License
+///
+/// Summary:
+/// Headless world generation and meshing benchmark. Streams
+/// a chunk sphere along a scripted path over a planet with no
+/// GL context and reports throughput and latency.
+///
+
+#pragma once
+
+#ifndef WorldGenBenchmark_h__
+#define WorldGenBenchmark_h__
+
+#include <Vorb/types.h>
+
+struct WorldGenBenchmarkConfig {
+    nString spaceSystemDir = "StarSystems/Trinity";
+    nString planetName = ""; ///< Empty picks the first planet with terrain
+    ui32 chunkRadius = 6;
+    ui32 numFrames = 600; ///< Frames spent moving along the path
+    f64 speed = 4.0; ///< Voxels per frame
+    f64 frameMs = 1000.0 / 60.0; ///< Minimum frame length, 0 runs uncapped
+    ui32 maxDrainFrames = 3600; ///< Upper bound on frames spent waiting for work after the path
+    size_t memoryBudget = 0; ///< Chunk residency budget in bytes, 0 keeps the default
+};
+
+struct WorldGenBenchmarkResults {
+    nString planetName;
+    f64 seconds = 0.0;
+    ui32 numChunks = 0; ///< Chunks that reached GEN_DONE
+    ui32 numMeshes = 0;
+    ui64 numQuads = 0;
+    f32 genLatencyP50 = 0.0f; ///< Query submit to generation finished, in ms
+    f32 genLatencyP99 = 0.0f;
+    f32 meshLatencyP50 = 0.0f; ///< Mesh task creation to mesh finished, in ms
+    f32 meshLatencyP99 = 0.0f;
+    ui64 peakRSSKiB = 0;
+    ui64 peakChunkMemoryFirstHalfKiB = 0; ///< Chunk memory as accounted by ChunkResidencyManager
+    ui64 peakChunkMemorySecondHalfKiB = 0;
+    ui32 numChunkPages = 0; ///< Allocator pages at the end of the run
+    ui32 numCompressions = 0; ///< Voxel arrays compressed to fit the budget
+};
+
+namespace WorldGenBenchmark {
+    /// Loads the space system and block data, then streams chunks along the path.
+    /// @return false if the planet could not be set up
+    bool run(const WorldGenBenchmarkConfig& config, OUT WorldGenBenchmarkResults& results);
+
+    /// Results as a single JSON object
+    nString toJSON(const WorldGenBenchmarkConfig& config, const WorldGenBenchmarkResults& results);
+
+    /// Peak resident set size of this process
+    ui64 getPeakRSSKiB();
+}
+
+#endif // WorldGenBenchmark_h__
@@ -0,0 +1,76 @@
+#include "stdafx.h"
+
+#include <Vorb/Vorb.h>
+#include <Vorb/VorbLibs.h>
+
+#include "WorldGenBenchmark.h"
+
+namespace {
+    void printHelp() {
+        printf(R"(
+Headless world generation benchmark. Run from the game directory.
+Command-line arguments:
+"-system <dir>" star system to load (StarSystems/Trinity)
+"-planet <name>" planet to stream over (first planet with terrain)
+"-radius <chunks>" chunk sphere radius (6)
+"-frames <n>" frames spent moving along the path (600)
+"-speed <voxels>" voxels moved per frame (4)
+"-framems <ms>" minimum frame length, 0 runs uncapped (16.7)
+"-o <file>" write the JSON report to a file instead of stdout
+)");
+    }
+}
+
+// Entry
+int main(int argc, char **argv) {
+    WorldGenBenchmarkConfig config;
+    nString outputPath;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "-system") == 0 && hasValue) {
+            config.spaceSystemDir = argv[++i];
+        } else if (strcmp(argv[i], "-planet") == 0 && hasValue) {
+            config.planetName = argv[++i];
+        } else if (strcmp(argv[i], "-radius") == 0 && hasValue) {
+            config.chunkRadius = (ui32)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-frames") == 0 && hasValue) {
+            config.numFrames = (ui32)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-speed") == 0 && hasValue) {
+            config.speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-framems") == 0 && hasValue) {
+            config.frameMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            printHelp();
+            return 1;
+        }
+    }
+
+    // Initialize Vorb modules
+    vorb::init(vorb::InitParam::ALL);
+
+    WorldGenBenchmarkResults results;
+    bool success = WorldGenBenchmark::run(config, results);
+    if (success) {
+        nString json = WorldGenBenchmark::toJSON(config, results);
+        if (outputPath.empty()) {
+            puts(json.c_str());
+        } else {
+            FILE* file = fopen(outputPath.c_str(), "w");
+            if (file) {
+                fprintf(file, "%s\n", json.c_str());
+                fclose(file);
+            } else {
+                perror(outputPath.c_str());
+                success = false;
+            }
+        }
+    }
+    fflush(stdout);
+
+    // Worker threads are still attached to the leaked state, so skip the
+    // Vorb teardown and exit straight away
+    std::_Exit(success ? 0 : 1);
+}